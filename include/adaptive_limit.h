@@ -0,0 +1,100 @@
+/**
+ * 自适应并发限制模块头文件
+ * 每个Worker（可选每条路由）按观测到的请求延迟调整允许同时处理的请求数：
+ * gradient算法按空载延迟（定期重新探测的最小延迟）与最近延迟的比值收缩或增长，aimd算法在延迟翻倍或上游失败时乘性减小、否则加性增长。
+ * 超过限制的请求在解析后立即返回503（带Retry-After），或在Worker限制上短暂排队，超过期限仍未轮到时返回503。
+ * 所有准入、释放和排队操作都在事件循环线程执行，统计由主线程按原子变量发布
+ */
+
+#ifndef ADAPTIVE_LIMIT_H
+#define ADAPTIVE_LIMIT_H
+
+#include <stdint.h>
+
+#include "config.h"
+#include "event_loop.h"
+
+// 拒绝请求时建议客户端等待的秒数
+#define ADAPTIVE_LIMIT_RETRY_AFTER_SEC 1
+
+// 准入结果
+typedef enum {
+    LIMIT_ADMITTED,     // 可以处理
+    LIMIT_QUEUED,       // 已排队，轮到时调用admit，超时调用expire
+    LIMIT_REJECTED      // 超过限制，应返回503
+} limit_decision_t;
+
+// 请求持有的并发槽位，内嵌在连接中，全零表示未持有
+typedef struct {
+    int held;                   // 持有Worker槽位
+    int route_held;             // 持有路由槽位
+    int route_index;            // 路由下标
+    uint32_t generation;        // 路由限制的配置代数，重新加载后旧槽位不再归还
+    int dropped;                // 请求失败（上游错误），作为拥塞信号
+    uint64_t start_ns;          // 准入时间(CLOCK_MONOTONIC纳秒)，排队时间不计入延迟
+} limit_token_t;
+
+// 排队等待Worker槽位的请求，内嵌在连接中
+typedef struct limit_waiter {
+    struct limit_waiter *prev;
+    struct limit_waiter *next;
+    limit_token_t *token;       // 轮到时写入的槽位
+    uint64_t deadline_ns;       // 排队期限(CLOCK_MONOTONIC纳秒)
+    int queued;                 // 是否在队列中
+    void (*admit)(void *arg);   // 轮到时调用，此时token已持有槽位
+    void (*expire)(void *arg);  // 超时或路由限制已满时调用，应返回503
+    void *arg;
+} limit_waiter_t;
+
+/**
+ * 启动本Worker的并发限制（创建排队定时器）
+ *
+ * @param worker_id Worker槽位
+ * @param loop Worker事件循环
+ * @param config 配置
+ * @return 成功返回0，定时器创建失败返回-1（仍可限制，但不排队）
+ */
+int adaptive_limit_init(int worker_id, event_loop_t *loop, const config_t *config);
+
+/**
+ * 应用新的限制配置（重新加载配置时调用，可在主线程调用）；路由限制在事件循环线程下一次准入时重置
+ *
+ * @param config 配置
+ */
+void adaptive_limit_configure(const config_t *config);
+
+/**
+ * 为路由匹配后的请求申请并发槽位（事件循环线程调用）
+ *
+ * @param route_index 路由下标
+ * @param token 输出的槽位
+ * @param waiter 排队用的等待项，NULL表示不排队；admit、expire和arg需事先设置
+ * @return 准入结果
+ */
+limit_decision_t adaptive_limit_acquire(int route_index, limit_token_t *token, limit_waiter_t *waiter);
+
+/**
+ * 请求完成后归还槽位并按延迟调整限制，未持有时不做任何事（事件循环线程调用）
+ *
+ * @param token 槽位，归还后清零
+ */
+void adaptive_limit_release(limit_token_t *token);
+
+/**
+ * 从队列中移除等待项，未排队时不做任何事（连接销毁时调用）
+ *
+ * @param waiter 等待项
+ */
+void adaptive_limit_cancel(limit_waiter_t *waiter);
+
+/**
+ * 发布当前限制、并发数和计数到共享内存（Worker每秒调用）
+ */
+void adaptive_limit_publish(void);
+
+/**
+ * 关闭排队定时器并输出统计（Worker退出前调用）
+ */
+void adaptive_limit_stop(void);
+
+#endif /* ADAPTIVE_LIMIT_H */
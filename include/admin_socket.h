@@ -0,0 +1,110 @@
+/**
+ * 管理套接字模块头文件
+ * Master进程在Unix域套接字上提供文本命令接口，用于运行时查看统计信息和调整参数，
+ * 需要Worker执行的命令通过共享内存命令邮箱转发；等待Worker确认期间Master事件循环照常运行，
+ * 命令按到达顺序逐条执行，收齐确认或超时后再应答客户端；
+ * 客户端描述符为非阻塞并注册到Master事件循环，读命令和写应答都不会阻塞Master，读写期限由同一定时器检查
+ *
+ * 协议：客户端连接后发送一行命令，服务端返回文本结果后关闭连接
+ *   help                               显示命令列表
+ *   stats                              汇总统计信息
+ *   workers                            列出Worker及事件循环延迟
+ *   locks                              各Worker的锁竞争统计（需开启lock_profiling）
+ *   cache dump|clear                   输出（到Worker日志）或清空文件缓存
+ *   alloc reset                        重置Worker的分配统计，重新计算每请求分配量
+ *   log_level <debug|info|warn|error>  修改Master和所有Worker的日志级别
+ *   set <诊断项> <on|off>              开关lock_profiling、alloc_accounting、route_cpu_stats
+ *   drain <worker_id>                  排空指定Worker，退出后由Master补齐
+ */
+
+#ifndef ADMIN_SOCKET_H
+#define ADMIN_SOCKET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 单条命令最大长度
+#define ADMIN_COMMAND_MAX_LEN 256
+
+// 单次响应最大长度
+#define ADMIN_RESPONSE_MAX_LEN (64 * 1024)
+
+/**
+ * 创建并监听管理套接字（Master调用）
+ * @param path 套接字路径，会删除同名的残留文件
+ * @return 成功返回0，失败返回-1
+ */
+int admin_socket_open(const char *path);
+
+/**
+ * 关闭管理套接字并删除套接字文件（Master调用）
+ */
+void admin_socket_close(void);
+
+/**
+ * 关闭继承的管理套接字描述符但不删除文件（Worker启动时调用）
+ */
+void admin_socket_close_inherited(void);
+
+/**
+ * 获取管理套接字的监听描述符，供Master事件循环注册可读事件
+ * @return 监听描述符，未打开时返回-1
+ */
+int admin_socket_fd(void);
+
+/**
+ * 客户端描述符的事件注册回调（由Master提供）
+ * @param op EPOLL_CTL_ADD、EPOLL_CTL_MOD或EPOLL_CTL_DEL
+ * @param fd 客户端描述符
+ * @param events 关注的epoll事件
+ * @return 成功返回0，失败返回-1
+ */
+typedef int (*admin_watch_fn)(int op, int fd, uint32_t events);
+
+/**
+ * 设置客户端描述符注册到Master事件循环的方式，未设置时不接受客户端
+ * @param watch 注册回调
+ */
+void admin_socket_set_watch(admin_watch_fn watch);
+
+/**
+ * 接受所有等待中的管理客户端并注册到Master事件循环（监听描述符可读时由Master调用）
+ */
+void admin_socket_accept(void);
+
+/**
+ * 处理客户端描述符事件：读取命令行，读完后排队执行；或继续发送应答（客户端描述符就绪时由Master调用）
+ * @param fd 客户端描述符
+ * @param events 就绪的epoll事件
+ */
+void admin_socket_client_event(int fd, uint32_t events);
+
+/**
+ * 获取等待Worker确认用的定时器描述符，供Master事件循环注册可读事件
+ * @return 定时器描述符，未打开时返回-1
+ */
+int admin_socket_timer_fd(void);
+
+/**
+ * 检查客户端读写期限，以及正在等待的命令是否已收齐Worker确认或超时，是则应答并继续执行排队的命令（定时器可读时由Master调用）
+ */
+void admin_socket_on_timer(void);
+
+/**
+ * 执行一条管理命令，需要Worker确认时在此等待（最多2秒）
+ * @param command 命令文本
+ * @param response 输出缓冲区
+ * @param size 缓冲区大小
+ * @return 写入的字节数
+ */
+size_t admin_execute_command(const char *command, char *response, size_t size);
+
+/**
+ * 作为客户端发送命令并将结果输出到标准输出（x-server -a）
+ * @param path 套接字路径
+ * @param command 命令文本
+ * @return 成功返回0，失败返回-1
+ */
+int admin_socket_send_command(const char *path, const char *command);
+
+#endif /* ADMIN_SOCKET_H */
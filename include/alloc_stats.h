@@ -0,0 +1,129 @@
+/**
+ * 内存分配统计模块头文件
+ * 按子系统标签统计分配次数、分配字节数以及每请求分配量
+ *
+ * 两种模式：
+ *   运行时模式：配置 alloc_accounting on 后统计分配次数/字节数与每请求分配量，
+ *              关闭时每次分配仅多一次原子读
+ *   构建模式：  使用 make alloc-accounting 编译（定义ALLOC_ACCOUNTING），始终统计，
+ *              并额外通过malloc_usable_size维护各标签的存活字节数；
+ *              每个带标签的块记录在归属表中，释放时计入分配它的标签，未带标签的块（如realpath、getline的结果）不计入
+ *
+ * 用法：在源文件的所有#include之后定义所属标签再包含本头文件，
+ * 该文件中的malloc/calloc/realloc/strdup/free调用即被记入对应标签
+ *   #define ALLOC_TAG ALLOC_TAG_PARSER
+ *   #include "../include/alloc_stats.h"
+ * 运行时模式下释放操作计入执行释放的子系统
+ */
+
+#ifndef ALLOC_STATS_H
+#define ALLOC_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+// 分配标签
+typedef enum {
+    ALLOC_TAG_PARSER = 0,   // HTTP解析
+    ALLOC_TAG_PROXY,        // 反向代理
+    ALLOC_TAG_AUTH,         // 认证
+    ALLOC_TAG_FILEIO,       // 文件I/O
+    ALLOC_TAG_LOGGER,       // 日志
+    ALLOC_TAG_CONNECTION,   // 连接管理
+    ALLOC_TAG_MAX
+} alloc_tag_t;
+
+// 单个标签的统计快照
+typedef struct alloc_tag_stats {
+    uint64_t allocations;           // 分配次数
+    uint64_t frees;                 // 释放次数
+    uint64_t bytes_allocated;       // 累计分配字节数（请求大小）
+    int64_t live_bytes;             // 存活字节数（仅构建模式）
+    uint64_t request_allocations;   // 请求处理期间的分配次数
+    uint64_t request_bytes;         // 请求处理期间的分配字节数
+    double allocations_per_request; // 平均每请求分配次数
+    double bytes_per_request;       // 平均每请求分配字节数
+} alloc_tag_stats_t;
+
+// 全部标签的统计快照
+typedef struct alloc_stats_snapshot {
+    int enabled;                            // 是否正在统计
+    int live_tracking;                      // 是否维护存活字节数（构建模式）
+    uint64_t requests;                      // 已统计的请求数
+    alloc_tag_stats_t tags[ALLOC_TAG_MAX];  // 各标签统计
+} alloc_stats_snapshot_t;
+
+// 运行时开关（内部使用，请通过alloc_stats_enable修改）
+extern atomic_int g_alloc_stats_enabled;
+
+#ifdef ALLOC_ACCOUNTING
+#define ALLOC_STATS_ACTIVE() 1
+#else
+#define ALLOC_STATS_ACTIVE() \
+    __builtin_expect(atomic_load_explicit(&g_alloc_stats_enabled, memory_order_relaxed), 0)
+#endif
+
+/**
+ * 带标签的分配函数（通常通过ALLOC_TAG宏间接调用）
+ */
+void *alloc_stats_malloc(alloc_tag_t tag, size_t size);
+void *alloc_stats_calloc(alloc_tag_t tag, size_t count, size_t size);
+void *alloc_stats_realloc(alloc_tag_t tag, void *ptr, size_t size);
+char *alloc_stats_strdup(alloc_tag_t tag, const char *str);
+void alloc_stats_free(alloc_tag_t tag, void *ptr);
+
+/**
+ * 启用或禁用运行时统计（构建模式下始终启用）
+ * @param enabled 非0启用，0禁用
+ */
+void alloc_stats_enable(int enabled);
+
+/**
+ * 标记当前线程开始处理一个请求
+ */
+void alloc_stats_request_begin(void);
+
+/**
+ * 标记当前线程结束处理请求
+ * 未完成的请求（如等待更多数据）的分配量仍会累加，由最终完成的请求分摊
+ * @param completed 请求是否已处理完成，完成时计入请求数
+ */
+void alloc_stats_request_end(int completed);
+
+/**
+ * 获取统计快照
+ * @param snapshot 输出快照
+ */
+void alloc_stats_get(alloc_stats_snapshot_t *snapshot);
+
+/**
+ * 重置统计数据（存活字节数不重置）
+ */
+void alloc_stats_reset(void);
+
+/**
+ * 打印分配统计信息
+ */
+void alloc_stats_print(void);
+
+/**
+ * 获取标签名称
+ * @param tag 标签
+ * @return 名称字符串
+ */
+const char *alloc_tag_name(alloc_tag_t tag);
+
+#endif /* ALLOC_STATS_H */
+
+// 按文件标签重定向分配函数（放在include guard之外，使每个源文件各自生效）
+#if defined(ALLOC_TAG) && !defined(ALLOC_STATS_IMPLEMENTATION) && !defined(ALLOC_STATS_TAGGED)
+#define ALLOC_STATS_TAGGED
+#define malloc(size)        alloc_stats_malloc(ALLOC_TAG, (size))
+#define calloc(count, size) alloc_stats_calloc(ALLOC_TAG, (count), (size))
+#define realloc(ptr, size)  alloc_stats_realloc(ALLOC_TAG, (ptr), (size))
+#define strdup(str)         alloc_stats_strdup(ALLOC_TAG, (str))
+#define free(ptr)           alloc_stats_free(ALLOC_TAG, (ptr))
+#endif
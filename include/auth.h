@@ -7,6 +7,7 @@
 
 #include "../include/http.h"
 #include "../include/config.h"
+#include "../include/config_snapshot.h"
 
 // 认证结果结构体
 typedef struct {
@@ -27,10 +28,11 @@ char *get_auth_token(http_request_t *request);
  * 
  * @param request HTTP请求
  * @param route 匹配的路由
+ * @param snapshot 本请求使用的配置快照
  * @param result 认证结果
  * @return 验证通过返回1，失败返回0
  */
-int validate_request(http_request_t *request, route_t *route, auth_result_t *result);
+int validate_request(http_request_t *request, route_t *route, const config_snapshot_t *snapshot, auth_result_t *result);
 
 /**
  * 验证token是否有效（用于简单token认证）
@@ -28,6 +28,19 @@ typedef enum {
     AUTH_OAUTH      // OAuth认证
 } auth_type_t;
 
+// 路由优先级，极端资源压力下低优先级路由直接返回503
+typedef enum {
+    ROUTE_PRIORITY_NORMAL,  // 普通
+    ROUTE_PRIORITY_LOW      // 低优先级
+} route_priority_t;
+
+// 自适应并发限制算法
+typedef enum {
+    LIMIT_ALGORITHM_OFF,        // 不限制
+    LIMIT_ALGORITHM_GRADIENT,   // 梯度算法：按空载延迟与最近延迟的比值调整
+    LIMIT_ALGORITHM_AIMD        // 延迟翻倍或上游失败时乘性减小，否则加性增长
+} limit_algorithm_t;
+
 // 路由配置结构体
 typedef struct {
     route_type_t type;
@@ -37,6 +50,7 @@ typedef struct {
     char local_path[MAX_PATH_LEN];      // 本地路径（静态文件模式）
     char charset[MAX_CHARSET_LEN];      // 字符集
     auth_type_t auth_type;              // 认证类型
+    route_priority_t priority;          // 优先级
 } route_t;
 
 // 日志配置结构体
@@ -46,6 +60,15 @@ typedef struct {
     int log_level;                      // 日志级别
 } log_config_t;
 
+// 配置文件中显式设置的项（explicit_settings位），自动调优只调整未设置的项
+#define CONFIG_SET_WORKER_PROCESSES         (1u << 0)
+#define CONFIG_SET_WORKER_CONNECTIONS       (1u << 1)
+#define CONFIG_SET_WORKER_RLIMIT_NOFILE     (1u << 2)
+#define CONFIG_SET_MEMORY_POOL_SIZE         (1u << 3)
+#define CONFIG_SET_FILE_CACHE_SIZE          (1u << 4)
+#define CONFIG_SET_CLIENT_HEADER_BUFFER     (1u << 5)
+#define CONFIG_SET_CLIENT_BODY_BUFFER       (1u << 6)
+
 // 主配置结构体
 typedef struct {
     int worker_processes;               // Worker进程数量
@@ -103,6 +126,56 @@ typedef struct {
     int use_thread_pool;                // 是否启用线程池
     int thread_pool_size;               // 线程池大小
     int thread_pool_queue_size;         // 线程池队列大小
+    
+    // 诊断配置
+    int lock_profiling;                 // 是否启用锁竞争分析
+    int perf_counters;                  // 是否启用硬件性能计数器采样
+    int alloc_accounting;               // 是否启用按子系统的内存分配统计
+    int route_cpu_stats;                // 是否启用按路由的CPU时间统计
+    
+    // 管理配置
+    char admin_socket[MAX_PATH_LEN];    // 管理Unix套接字路径，为空表示不启用
+    
+    // CPU放置配置
+    char worker_cpu_affinity[MAX_PATH_LEN]; // Worker CPU绑定：auto、auto <掩码>或每个Worker一个掩码，为空表示不绑定
+    
+    // 看门狗配置
+    int worker_watchdog_timeout;        // Worker事件循环心跳超时(秒)，超时后Master替换该Worker，0表示不检测
+    
+    // 动态Worker数量
+    int worker_scaling;                 // 是否按负载在[min, max]内自动调整Worker数量
+    int worker_scaling_min;             // 最少Worker数量
+    int worker_scaling_max;             // 最多Worker数量，0表示worker_processes
+    
+    // 预热配置
+    int static_preload_size;            // Master在fork前预加载的静态文件总大小(MB)，0表示不预加载
+    
+    // 负载均衡配置
+    int connection_handoff;             // Worker连接数比最空闲的Worker多出此值时把空闲连接转交过去，0表示不转交
+    
+    // 线程模型
+    int worker_single_thread;           // Worker只用一个线程：事件循环在主线程运行，清理任务由定时器执行，内部锁为空操作
+    
+    // 文件缓存
+    size_t file_cache_size;             // 每个Worker的文件缓存大小（字节）
+    
+    // 自动调优
+    int auto_tune;                      // 按cgroup配额、内存上限和RLIMIT_NOFILE调整未显式设置的Worker、连接、内存和缓冲区配置
+    unsigned int explicit_settings;     // 配置文件中显式设置的项（CONFIG_SET_*）
+    
+    // 资源压力（PSI）
+    int pressure_monitor;               // Master每秒读取PSI并通过共享内存通知Worker收缩缓存、降低诊断开销、拒绝低优先级路由
+    int pressure_memory_threshold;      // 内存压力阈值：some avg10百分比
+    int pressure_cpu_threshold;         // CPU压力阈值：some avg10百分比
+    int pressure_io_threshold;          // IO压力阈值：some avg10百分比
+    int pressure_critical_threshold;    // 极端压力阈值：任一资源some avg10百分比（内存full avg10达到内存阈值同样视为极端）
+    
+    // 自适应并发限制
+    limit_algorithm_t concurrency_limit; // 限制算法：off、gradient或aimd
+    int concurrency_limit_min;          // 并发限制下限
+    int concurrency_limit_max;          // 并发限制上限，0表示worker_connections
+    int concurrency_limit_per_route;    // 每条路由另有一个并发限制
+    int concurrency_queue_timeout;      // 超过Worker限制的请求最多排队的毫秒数，0表示直接返回503
 } config_t;
 
 /**
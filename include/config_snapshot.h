@@ -0,0 +1,109 @@
+/**
+ * 配置快照模块头文件（RCU风格热重载）
+ * Worker中的配置以只读快照发布：每个请求开始时取得当前快照的引用，处理期间一直使用它；
+ * 重载时在主线程构建新快照（配置副本、OAuth应用表）后原子替换，新请求立即使用新快照。
+ * 旧快照在所有读线程离开发布前的纪元后交出"当前"引用，最后一个请求释放后回收，
+ * 重载不断开连接也不清空缓存
+ *
+ * Master在fork前也发布一份快照（含编译后的路由表和预解析的上游地址），Worker启动时直接采用继承的快照，
+ * 对它不做引用计数，其内存页保持与Master共享
+ */
+
+#ifndef CONFIG_SNAPSHOT_H
+#define CONFIG_SNAPSHOT_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "config.h"
+#include "oauth.h"
+#include "proxy.h"
+
+// 读线程槽位数量，超出的线程走互斥锁慢路径
+#define CONFIG_SNAPSHOT_MAX_READERS 64
+
+// 编译后的路由项
+typedef struct route_match {
+    int index;                              // config->routes下标
+    size_t prefix_len;                      // 路径前缀长度
+} route_match_t;
+
+// 配置快照，发布后只读
+typedef struct config_snapshot {
+    config_t *config;                       // 配置副本
+    api_auth_config_t **auth_apps;          // OAuth应用表（config/api_auth.conf），加载失败为NULL
+    int auth_app_count;                     // OAuth应用数量
+    route_match_t *routes;                  // 按前缀长度降序排列的路由表，第一个匹配即最长前缀
+    upstream_addr_t *upstreams;             // 按路由下标的预解析上游地址，非代理路由未解析
+    uint64_t generation;                    // 发布序号，从1开始
+
+    atomic_int refs;                        // 引用计数，"当前快照"身份本身持有一个
+    uint64_t retire_epoch;                  // 被替换时的纪元
+    struct config_snapshot *retired_next;   // 待回收链表
+} config_snapshot_t;
+
+/**
+ * 发布新的配置快照，在Worker主线程调用（初始化和每次重载）
+ * 构建派生状态后原子替换当前快照，旧快照进入待回收链表
+ * @param config 新配置，所有权转移给快照（失败时也会释放）
+ * @return 成功返回0，失败返回-1（当前快照不变）
+ */
+int config_snapshot_publish(config_t *config);
+
+/**
+ * 采用fork前由Master发布的快照（Worker初始化时调用），之后对它的取得和释放不修改引用计数
+ * @return 继承快照的配置，没有继承的快照时返回NULL
+ */
+config_t *config_snapshot_inherit(void);
+
+/**
+ * 按最长路径前缀查找路由
+ * @param snapshot 配置快照
+ * @param path 请求路径
+ * @return 匹配的路由，没有匹配返回NULL
+ */
+route_t *config_snapshot_find_route(const config_snapshot_t *snapshot, const char *path);
+
+/**
+ * 取得路由的预解析上游地址
+ * @param snapshot 配置快照
+ * @param route 快照中的路由
+ * @return 上游地址，未解析时addr_len为0
+ */
+const upstream_addr_t *config_snapshot_upstream(const config_snapshot_t *snapshot, const route_t *route);
+
+/**
+ * 取得当前快照的引用，请求处理开始时调用，可在任意线程调用
+ * @return 快照指针，尚未发布时返回NULL
+ */
+config_snapshot_t *config_snapshot_acquire(void);
+
+/**
+ * 为已持有的快照增加一个引用，请求交给其他线程继续处理时调用，由接手的一方释放
+ * @param snapshot 调用者持有引用的快照指针，可为NULL
+ */
+void config_snapshot_retain(config_snapshot_t *snapshot);
+
+/**
+ * 释放config_snapshot_acquire取得的引用，最后一个引用释放时回收快照
+ * @param snapshot 快照指针，可为NULL
+ */
+void config_snapshot_release(config_snapshot_t *snapshot);
+
+/**
+ * 回收已没有读线程可能看到的旧快照，在Worker主循环中定期调用
+ * @return 本次交出当前引用的旧快照数
+ */
+int config_snapshot_reclaim(void);
+
+/**
+ * 当前快照的发布序号
+ * @return 发布序号，尚未发布返回0
+ */
+uint64_t config_snapshot_generation(void);
+
+/**
+ * 释放全部快照，读线程（事件循环）停止后调用
+ */
+void config_snapshot_shutdown(void);
+
+#endif /* CONFIG_SNAPSHOT_H */
@@ -14,6 +14,11 @@
  */
 int validate_and_optimize_config(config_t *config);
 
+/**
+ * 打印最近一次自动调优的资源限制、选定的值及其依据（-t时调用）
+ */
+void print_auto_tune_report(void);
+
 /**
  * 打印配置摘要
  * @param config 配置结构体指针
@@ -5,6 +5,8 @@
 #ifndef CONNECTION_H
 #define CONNECTION_H
 
+#include <time.h>
+#include <netinet/in.h>
 #include "event_loop.h"
 #include "event_loop.h"
 #include "config.h"
@@ -13,6 +15,13 @@
 // 连接结构体（不透明类型）
 typedef struct connection connection_t;
 
+// 转交给其他Worker的连接状态，随套接字一起发送
+typedef struct {
+    struct sockaddr_in addr;    // 客户端地址
+    time_t last_activity;       // 最近活动时间
+    int keep_alive;             // 是否为keep-alive连接
+} connection_transfer_t;
+
 /**
  * 初始化连接管理模块
  * 
@@ -38,22 +47,20 @@ int compress_connection_pool(void);
  * 
  * @param fd 连接套接字
  * @param loop 事件循环
- * @param config 服务器配置
  * @param client_addr 客户端地址（可选，如果为NULL则使用getpeername获取）
  * @return 连接指针，失败返回NULL
  */
-connection_t *connection_create(int fd, event_loop_t *loop, config_t *config, struct sockaddr_in *client_addr);
+connection_t *connection_create(int fd, event_loop_t *loop, struct sockaddr_in *client_addr);
 
 /**
  * 创建连接（增强版事件循环版本）
  * 
  * @param fd 连接套接字
  * @param loop 增强版事件循环
- * @param config 服务器配置
  * @param client_addr 客户端地址（可选，如果为NULL则使用getpeername获取）
  * @return 连接指针，失败返回NULL
  */
-connection_t *connection_create_enhanced(int fd, event_loop_t *loop, config_t *config, struct sockaddr_in *client_addr);
+connection_t *connection_create_enhanced(int fd, event_loop_t *loop, struct sockaddr_in *client_addr);
 
 /**
  * 销毁连接
@@ -62,6 +69,39 @@ connection_t *connection_create_enhanced(int fd, event_loop_t *loop, config_t *c
  */
 void connection_destroy(connection_t *conn);
 
+/**
+ * 收集请求之间的空闲连接（缓冲区中没有未处理的请求数据和待发送的响应，不在连接池中，对端未关闭），仅在事件循环线程调用
+ * 
+ * @param conns 输出连接数组
+ * @param max 最多收集的连接数
+ * @return 收集到的连接数
+ */
+int connection_collect_idle(connection_t **conns, int max);
+
+/**
+ * 导出连接状态用于转交
+ * 
+ * @param conn 连接指针
+ * @param state 输出连接状态
+ * @return 连接套接字
+ */
+int connection_export(connection_t *conn, connection_transfer_t *state);
+
+/**
+ * 套接字已交给其他Worker后释放本地连接（关闭本进程的描述符副本，不关闭TCP连接）
+ * 
+ * @param conn 连接指针
+ */
+void connection_release_transferred(connection_t *conn);
+
+/**
+ * 恢复从其他Worker接收的连接状态
+ * 
+ * @param conn 用接收的套接字新建的连接
+ * @param state 连接状态
+ */
+void connection_import(connection_t *conn, const connection_transfer_t *state);
+
 /**
  * 接受新连接的回调函数
  * 
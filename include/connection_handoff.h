@@ -0,0 +1,62 @@
+/**
+ * 跨Worker连接转交模块头文件
+ * Master在fork之前为每个Worker槽位创建一对Unix数据报套接字，Worker通过SCM_RIGHTS把
+ * 请求之间的空闲连接（已接受但尚未收到数据，或keep-alive请求之间）连同状态交给负载最低的Worker
+ *
+ * 每个Worker的事件循环每秒比较自己的连接数与共享内存中其他Worker发布的连接数，
+ * 比最空闲的Worker多出connection_handoff个以上时，把差值的一半空闲连接转交过去
+ */
+
+#ifndef CONNECTION_HANDOFF_H
+#define CONNECTION_HANDOFF_H
+
+#include "event_loop.h"
+
+// 每秒最多转交的连接数
+#define CONNECTION_HANDOFF_BATCH 64
+
+/**
+ * 创建各Worker槽位的转交套接字（Master在创建Worker之前调用）
+ *
+ * @return 成功返回0，失败返回-1（不转交连接，服务不受影响）
+ */
+int connection_handoff_init(void);
+
+/**
+ * 关闭转交套接字（Master退出时调用）
+ */
+void connection_handoff_cleanup(void);
+
+/**
+ * 关闭排队等待某个槽位的连接（Master在该槽位的Worker退出且不再补齐时调用），
+ * 避免客户端连接滞留在无人读取的套接字中
+ *
+ * @param worker_id Worker槽位
+ * @return 关闭的连接数
+ */
+int connection_handoff_discard(int worker_id);
+
+/**
+ * Worker启动转交：保留本槽位的接收端和其他槽位的发送端，在事件循环中注册接收端与每秒均衡定时器
+ * 须在event_loop_start之前调用
+ *
+ * @param worker_id Worker槽位
+ * @param loop Worker事件循环
+ * @param threshold 触发转交的连接数差值，0表示只接收不转出
+ * @return 成功返回0，失败返回-1
+ */
+int connection_handoff_start(int worker_id, event_loop_t *loop, int threshold);
+
+/**
+ * 修改触发转交的连接数差值（Worker重载配置时调用，任意线程）
+ *
+ * @param threshold 连接数差值，0表示不转出
+ */
+void connection_handoff_set_threshold(int threshold);
+
+/**
+ * 停止转交并输出转出/接收的连接数（Worker在事件循环停止后调用）
+ */
+void connection_handoff_stop(void);
+
+#endif /* CONNECTION_HANDOFF_H */
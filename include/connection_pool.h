@@ -49,6 +49,7 @@ typedef struct {
     int enable_connection_reuse;     // 是否启用连接复用
     int enable_connection_pooling;   // 是否启用连接池
     int pool_cleanup_interval;       // 池清理间隔（秒）
+    int external_cleanup;            // 不创建清理线程，由调用者每隔pool_cleanup_interval调用connection_pool_cleanup_idle
 } connection_pool_config_t;
 
 // 连接池结构体
@@ -75,13 +76,12 @@ void connection_pool_destroy(connection_pool_t *pool);
  * @param pool 连接池指针
  * @param fd 连接套接字
  * @param loop 事件循环
- * @param config 服务器配置
  * @param client_addr 客户端地址
  * @return 连接指针，失败返回NULL
  */
 connection_t *connection_pool_get_connection(connection_pool_t *pool, int fd, 
                                            void *loop, int is_enhanced_loop,
-                                           config_t *config, struct sockaddr_in *client_addr);
+                                           struct sockaddr_in *client_addr);
 
 /**
  * 将连接归还到连接池
@@ -91,6 +91,15 @@ connection_t *connection_pool_get_connection(connection_pool_t *pool, int fd,
  */
 void connection_pool_return_connection(connection_pool_t *pool, connection_t *conn);
 
+/**
+ * 从池中移除连接但不销毁（连接销毁时调用，避免连接数组残留已释放的连接）
+ * 
+ * @param pool 连接池指针
+ * @param conn 连接指针
+ * @return 连接在池中返回1，否则返回0
+ */
+int connection_pool_remove_connection(connection_pool_t *pool, connection_t *conn);
+
 /**
  * 关闭连接（从池中移除）
  * 
@@ -122,7 +131,7 @@ void connection_pool_reset_stats(connection_pool_t *pool);
 void connection_pool_print_stats(connection_pool_t *pool);
 
 /**
- * 清理空闲连接
+ * 清理空闲连接（会销毁连接，应在连接所属事件循环的线程调用）
  * 
  * @param pool 连接池指针
  * @return 清理的连接数
@@ -0,0 +1,60 @@
+/**
+ * CPU亲和性与NUMA放置模块头文件
+ * 按worker_cpu_affinity配置把每个Worker进程（及其之后创建的辅助线程）绑定到CPU，
+ * 并把内存分配策略设为所在NUMA节点优先，使连接池、内存池和缓存在本地节点首次触碰
+ *
+ * 配置格式（与nginx一致）：
+ *   worker_cpu_affinity auto;               按NUMA节点轮流放置，每个Worker一个CPU，
+ *                                           先用物理核心再用超线程
+ *   worker_cpu_affinity auto 11110000;      auto，但只使用掩码中的CPU
+ *   worker_cpu_affinity 0001 0010 0100;     每个Worker一个二进制掩码，最右位为CPU0，
+ *                                           Worker多于掩码时循环使用
+ */
+
+#ifndef CPU_AFFINITY_H
+#define CPU_AFFINITY_H
+
+#include <sched.h>
+
+// 配置字符串最大长度
+#define CPU_AFFINITY_SPEC_MAX_LEN 512
+
+/**
+ * 检查worker_cpu_affinity配置的语法
+ * @param spec 配置值，空字符串表示不绑定
+ * @return 合法返回0，非法返回-1
+ */
+int cpu_affinity_validate(const char *spec);
+
+/**
+ * 计算指定Worker的CPU集合与NUMA节点
+ * auto模式以当前进程允许的CPU（cpuset/cgroup限制后）为候选
+ * @param spec 配置值
+ * @param worker_id Worker编号
+ * @param worker_count Worker总数
+ * @param set 输出的CPU集合
+ * @param node 输出的NUMA节点，CPU跨多个节点或无NUMA信息时为-1
+ * @return 成功返回0，未配置返回1，配置非法或没有可用CPU返回-1
+ */
+int cpu_affinity_worker_set(const char *spec, int worker_id, int worker_count, cpu_set_t *set, int *node);
+
+/**
+ * 绑定当前Worker进程并设置本地节点优先的内存策略
+ * 必须在创建线程和内存池之前调用，之后创建的线程继承同一CPU集合
+ * @param spec 配置值
+ * @param worker_id Worker编号
+ * @param worker_count Worker总数
+ * @return 成功或未配置返回0，失败返回-1（Worker不绑定继续运行）
+ */
+int cpu_affinity_apply(const char *spec, int worker_id, int worker_count);
+
+/**
+ * 把CPU集合格式化为列表（如 "0-3,8"）
+ * @param set CPU集合
+ * @param buf 输出缓冲区
+ * @param size 缓冲区大小
+ * @return buf
+ */
+char *cpu_affinity_format(const cpu_set_t *set, char *buf, size_t size);
+
+#endif /* CPU_AFFINITY_H */
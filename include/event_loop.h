@@ -58,6 +58,10 @@ int event_loop_del_handler(event_loop_t *loop, int fd);
 // 启动事件循环
 int event_loop_start(event_loop_t *loop);
 
+// 在调用线程中运行事件循环，直到event_loop_stop被调用（通常由某个回调调用）后返回
+// 与event_loop_start二选一，用于单线程Worker
+int event_loop_run(event_loop_t *loop);
+
 // 停止事件循环
 void event_loop_stop(event_loop_t *loop);
 
@@ -70,6 +74,17 @@ int event_loop_is_stopped(event_loop_t *loop);
 // 获取基本统计信息
 void event_loop_get_stats(event_loop_t *loop, int *handler_count, int *active_handlers);
 
+// 获取自上次调用以来最长的一次事件分发耗时（微秒），即事件循环延迟，读取后清零
+uint64_t event_loop_take_max_lag_us(event_loop_t *loop);
+
+// 获取自上次调用以来事件分发耗时占墙钟时间的比例（0-1），即事件循环利用率，读取后重新计时
+// 只应在一个线程中调用
+double event_loop_take_utilization(event_loop_t *loop);
+
+// 设置心跳字段（通常位于共享内存），事件循环线程每次迭代开始时写入CLOCK_MONOTONIC毫秒时间并递增迭代次数
+// 须在event_loop_start之前调用，传NULL关闭
+void event_loop_set_heartbeat(event_loop_t *loop, uint64_t *heartbeat_ms, uint64_t *iterations);
+
 // 获取详细统计信息
 void event_loop_get_detailed_stats(event_loop_t *loop, event_loop_detailed_stats_t *stats);
 
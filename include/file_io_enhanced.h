@@ -10,6 +10,7 @@
 #include <sys/stat.h>
 #include <pthread.h>
 #include <stdatomic.h>
+#include "lock_profiler.h"
 
 // 文件缓存项
 typedef struct file_cache_item {
@@ -29,7 +30,7 @@ typedef struct file_cache_manager {
     size_t bucket_count;           // 桶数量
     size_t max_size;               // 最大缓存大小
     size_t current_size;           // 当前缓存大小
-    pthread_mutex_t mutex;         // 互斥锁
+    profiled_mutex_t mutex;        // 互斥锁
     pthread_t cleanup_thread;      // 清理线程
     atomic_int stop_cleanup;       // 停止清理标志
 } file_cache_manager_t;
@@ -81,6 +82,7 @@ typedef struct file_io_config {
     int enable_async;              // 是否启用异步I/O
     int enable_sendfile;           // 是否启用sendfile
     int cache_cleanup_interval;    // 缓存清理间隔(秒)
+    int external_cleanup;          // 不创建清理线程，由调用者每隔cache_cleanup_interval调用file_io_enhanced_cleanup_expired
     size_t read_buffer_size;       // 读取缓冲区大小
     size_t write_buffer_size;      // 写入缓冲区大小
 } file_io_config_t;
@@ -114,24 +116,43 @@ int file_io_enhanced_read_file_async(const char *file_path,
                                     int (*callback)(void *data, size_t size, void *arg),
                                     void *arg);
 
-// 从缓存获取文件
+// 从缓存获取文件，命中时持有缓存项引用，使用完毕后需调用file_io_enhanced_release_cached
 void *file_io_enhanced_get_from_cache(const char *file_path, size_t *size);
 
+// 释放file_io_enhanced_get_from_cache持有的缓存项引用
+void file_io_enhanced_release_cached(const char *file_path);
+
 // 将文件添加到缓存
 int file_io_enhanced_add_to_cache(const char *file_path, const void *data, size_t size);
 
 // 从缓存移除文件
 void file_io_enhanced_remove_from_cache(const char *file_path);
 
-// 清空缓存
+// 清空缓存（正在发送的缓存项仅标记为无效，稍后释放）
 void file_io_enhanced_clear_cache(void);
 
+// 释放超过1小时未访问且未在发送的缓存项，返回释放的数量
+size_t file_io_enhanced_cleanup_expired(void);
+
+// 修改缓存容量，超出时按访问时间从旧到新释放未在发送的缓存项，返回释放的字节数
+size_t file_io_enhanced_set_cache_limit(size_t max_bytes);
+
+// 将所有缓存项输出到日志，返回缓存项数量
+size_t file_io_enhanced_dump_cache(void);
+
 // 预加载文件到缓存
 int file_io_enhanced_preload_file(const char *file_path);
 
 // 批量预加载文件
 int file_io_enhanced_preload_files(const char **file_paths, int count);
 
+// 构建只读静态文件预加载表（Master在fork前调用，Worker通过写时复制共享）
+// 遍历各目录下不超过1MB的常规文件，从小到大载入直到budget字节；重复调用替换旧表，返回预加载文件数
+int file_io_enhanced_build_preload(const char **dirs, int count, size_t budget);
+
+// 释放预加载表，已运行的Worker保留各自继承的映射
+void file_io_enhanced_free_preload(void);
+
 // 获取文件信息（缓存友好）
 int file_io_enhanced_get_file_info(const char *file_path, struct stat *st);
 
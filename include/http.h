@@ -82,6 +82,17 @@ const char *http_method_str(http_method_t method);
  */
 void send_http_error(int client_sock, int status_code, const char *message, const char *charset);
 
+/**
+ * 发送带Retry-After头的HTTP错误响应（过载时返回503）
+ * 
+ * @param client_sock 客户端套接字
+ * @param status_code 状态码
+ * @param message 错误消息
+ * @param charset 字符集编码
+ * @param retry_after 建议客户端重试的秒数，0表示不发送Retry-After
+ */
+void send_http_error_retry(int client_sock, int status_code, const char *message, const char *charset, int retry_after);
+
 /**
  * 获取请求头的值
  * 
@@ -0,0 +1,166 @@
+/**
+ * 锁竞争分析模块头文件
+ * 对内部互斥锁进行统一封装，按锁名称统计获取次数、竞争次数以及等待/持有时间分布
+ * 未启用时仅多一次原子读，开销可以忽略
+ * 进程进入单线程模式后所有锁操作变为空操作
+ */
+
+#ifndef LOCK_PROFILER_H
+#define LOCK_PROFILER_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+// 直方图桶数量（按纳秒取log2分桶，覆盖1ns ~ 4s）
+#define LOCK_PROFILER_HIST_BUCKETS 32
+
+// 最多可跟踪的锁名称数量（同名锁合并统计）
+#define LOCK_PROFILER_MAX_LOCKS 64
+
+// 锁名称最大长度
+#define LOCK_PROFILER_NAME_LEN 48
+
+// 单个命名锁的统计数据
+typedef struct lock_profile {
+    char name[LOCK_PROFILER_NAME_LEN];                          // 锁名称
+    atomic_uint_fast64_t acquisitions;                          // 获取次数
+    atomic_uint_fast64_t contended;                             // 发生竞争的获取次数
+    atomic_uint_fast64_t total_wait_ns;                         // 总等待时间(纳秒)
+    atomic_uint_fast64_t total_hold_ns;                         // 总持有时间(纳秒)
+    atomic_uint_fast64_t max_wait_ns;                           // 最大等待时间(纳秒)
+    atomic_uint_fast64_t max_hold_ns;                           // 最大持有时间(纳秒)
+    atomic_uint_fast64_t wait_hist[LOCK_PROFILER_HIST_BUCKETS]; // 等待时间直方图
+    atomic_uint_fast64_t hold_hist[LOCK_PROFILER_HIST_BUCKETS]; // 持有时间直方图
+} lock_profile_t;
+
+// 带名称的互斥锁
+typedef struct profiled_mutex {
+    pthread_mutex_t mutex;                  // 底层互斥锁
+    const char *name;                       // 锁名称（需为静态字符串）
+    _Atomic(lock_profile_t *) profile;      // 统计槽位（首次分析时延迟绑定）
+    uint64_t acquired_ns;                   // 获取时间戳，仅由持有者读写，0表示未计时
+} profiled_mutex_t;
+
+// 锁统计快照（供统计输出使用）
+typedef struct lock_profile_stats {
+    char name[LOCK_PROFILER_NAME_LEN];
+    uint64_t acquisitions;
+    uint64_t contended;
+    uint64_t total_wait_ns;
+    uint64_t total_hold_ns;
+    uint64_t max_wait_ns;
+    uint64_t max_hold_ns;
+    uint64_t wait_p50_ns;
+    uint64_t wait_p99_ns;
+    uint64_t hold_p50_ns;
+    uint64_t hold_p99_ns;
+    uint64_t wait_hist[LOCK_PROFILER_HIST_BUCKETS];
+    uint64_t hold_hist[LOCK_PROFILER_HIST_BUCKETS];
+} lock_profile_stats_t;
+
+// 静态初始化器
+#define PROFILED_MUTEX_INITIALIZER(lock_name) \
+    { PTHREAD_MUTEX_INITIALIZER, (lock_name), NULL, 0 }
+
+// 全局分析开关（内部使用，请通过lock_profiler_enable修改）
+extern atomic_int g_lock_profiler_enabled;
+
+// 单线程模式标志（内部使用，请通过lock_elision_enable设置），开启后不再改变
+extern int g_lock_elision;
+
+// 慢路径实现（内部使用）
+int lock_profiler_lock_slow(profiled_mutex_t *m);
+void lock_profiler_unlock_slow(profiled_mutex_t *m);
+
+/**
+ * 初始化带名称的互斥锁
+ * @param m 锁指针
+ * @param name 锁名称（需为静态字符串），同名锁合并统计
+ * @return 成功返回0，失败返回pthread错误码
+ */
+int profiled_mutex_init(profiled_mutex_t *m, const char *name);
+
+/**
+ * 销毁互斥锁
+ * @param m 锁指针
+ * @return 成功返回0，失败返回pthread错误码
+ */
+int profiled_mutex_destroy(profiled_mutex_t *m);
+
+/**
+ * 加锁
+ * @param m 锁指针
+ * @return 成功返回0，失败返回pthread错误码
+ */
+static inline int profiled_mutex_lock(profiled_mutex_t *m) {
+    if (__builtin_expect(g_lock_elision, 0)) {
+        return 0;
+    }
+    if (__builtin_expect(!atomic_load_explicit(&g_lock_profiler_enabled, memory_order_relaxed), 1)) {
+        return pthread_mutex_lock(&m->mutex);
+    }
+    return lock_profiler_lock_slow(m);
+}
+
+/**
+ * 解锁
+ * @param m 锁指针
+ * @return 成功返回0，失败返回pthread错误码
+ */
+static inline int profiled_mutex_unlock(profiled_mutex_t *m) {
+    if (__builtin_expect(g_lock_elision, 0)) {
+        return 0;
+    }
+    if (__builtin_expect(m->acquired_ns != 0, 0)) {
+        lock_profiler_unlock_slow(m);
+    }
+    return pthread_mutex_unlock(&m->mutex);
+}
+
+/**
+ * 进入单线程模式：此后profiled锁和事件循环内部锁都不再加锁，不可撤销
+ * 须在没有线程持有锁时调用，进程中还有其他线程时拒绝开启
+ * @return 成功返回0，进程不是单线程时返回-1
+ */
+int lock_elision_enable(void);
+
+/**
+ * 查询是否处于单线程模式
+ * @return 是返回1，否则返回0
+ */
+static inline int lock_elision_active(void) {
+    return g_lock_elision;
+}
+
+/**
+ * 启用或禁用锁竞争分析
+ * @param enabled 非0启用，0禁用
+ */
+void lock_profiler_enable(int enabled);
+
+/**
+ * 查询锁竞争分析是否启用
+ * @return 启用返回1，否则返回0
+ */
+int lock_profiler_is_enabled(void);
+
+/**
+ * 获取所有命名锁的统计快照
+ * @param stats 输出数组
+ * @param max_count 数组容量
+ * @return 实际写入的条目数
+ */
+int lock_profiler_get_stats(lock_profile_stats_t *stats, int max_count);
+
+/**
+ * 重置所有锁统计数据
+ */
+void lock_profiler_reset_stats(void);
+
+/**
+ * 打印锁竞争统计信息
+ */
+void lock_profiler_print_stats(void);
+
+#endif /* LOCK_PROFILER_H */
@@ -59,5 +59,7 @@ void logger_flush(void);                        // 强制刷新缓冲区
 void logger_check_idle_flush(void);             // 检查并刷新空闲缓冲区
 void logger_get_stats(logger_stats_t *stats);   // 获取性能统计
 void logger_reset_stats(void);                  // 重置统计信息
+int logger_set_level(int level);                // 运行时修改日志级别，成功返回0
+int logger_get_level(void);                     // 获取当前日志级别
 
 #endif // LOGGER_H
\ No newline at end of file
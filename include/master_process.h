@@ -10,6 +10,10 @@
 #include <signal.h>
 #include "config.h"
 
+// 二进制升级时传给新Master的环境变量：继承的监听套接字描述符与旧Master的PID
+#define LISTEN_FDS_ENV "X_SERVER_LISTEN_FDS"
+#define OLD_MASTER_ENV "X_SERVER_OLD_MASTER"
+
 // Master进程状态
 typedef enum {
     MASTER_STARTING,
@@ -22,10 +26,15 @@ typedef enum {
 // Worker进程信息
 typedef struct worker_process {
     pid_t pid;
+    int worker_id;              // 共享内存统计槽位
+
     int status;
     time_t start_time;
-    time_t last_heartbeat;
+    time_t last_heartbeat;      // 最近一次观察到事件循环心跳推进的时间
+    time_t kill_time;           // 看门狗判定卡死并发出终止信号的时间，0表示正常
+    int retiring;               // 自动缩容时被要求排空退出，退出后不补充
     int respawn_count;
+    int pidfd;                  // 在Master事件循环中等待Worker退出的pidfd，内核不支持时为-1
     struct worker_process *next;
 } worker_process_t;
 
@@ -43,6 +52,14 @@ typedef struct master_context {
     time_t start_time;
     int total_workers_spawned;
     int config_reload_count;
+    int hung_workers_replaced;  // 看门狗替换的卡死Worker数量
+    int workers_scaled_up;      // 自动扩容增加的Worker数量
+    int workers_scaled_down;    // 自动缩容排空的Worker数量
+    
+    // 二进制升级
+    pid_t new_master_pid;       // 升级中由本进程启动的新Master，0表示未在升级
+    pid_t old_master_pid;       // 本进程作为新Master启动时的旧Master，交接后为0
+    int handed_off;             // 已把监听套接字交给新Master，退出时保留共享内存
 } master_context_t;
 
 /**
@@ -91,6 +108,14 @@ void shutdown_workers_gracefully(void);
  */
 void terminate_workers_forcefully(void);
 
+/**
+ * 开始二进制升级：执行新的可执行文件并把监听套接字传给它，
+ * 新Master启动Worker后通知本进程，本进程的Worker优雅退出
+ * 
+ * @return 成功启动新Master返回0，失败返回-1
+ */
+int start_binary_upgrade(void);
+
 /**
  * 获取Master进程统计信息
  * 
@@ -8,6 +8,11 @@
 #include "../include/http.h"
 #include "../include/config.h"
 
+// API认证配置文件，随配置快照一起加载
+#define API_AUTH_CONFIG_FILE "config/api_auth.conf"
+
+struct config_snapshot;
+
 // API认证配置结构体
 typedef struct {
     char *app_key;             // 应用密钥
@@ -49,9 +54,10 @@ int is_url_allowed(api_auth_config_t *config, const char *url);
  * 
  * @param request HTTP请求
  * @param route 匹配的路由
+ * @param snapshot 本请求使用的配置快照，提供OAuth应用表
  * @return 验证通过返回1，失败返回0
  */
-int validate_oauth(http_request_t *request, route_t *route);
+int validate_oauth(http_request_t *request, route_t *route, const struct config_snapshot *snapshot);
 
 /**
  * 获取最后一次OAuth验证失败的错误信息
@@ -75,18 +81,4 @@ void free_oauth_error_message(const char *error_message);
  */
 void free_api_auth_config(api_auth_config_t **configs, int count);
 
-/**
- * 初始化OAuth配置，在服务器启动时调用
- * 
- * @return 成功返回0，失败返回-1
- */
-int init_oauth_config();
-
-/**
- * 重新加载OAuth配置，可以通过-s reload参数触发
- * 
- * @return 成功返回0，失败返回-1
- */
-int reload_oauth_config();
-
 #endif /* OAUTH_H */
@@ -0,0 +1,74 @@
+/**
+ * 硬件性能计数器模块头文件
+ * 基于perf_event_open为每个Worker进程采集cycles、instructions、cache-misses、
+ * branch-misses以及上下文切换次数，内核拒绝访问时自动降级
+ */
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdint.h>
+
+// 计数器类型
+typedef enum {
+    PERF_COUNTER_CYCLES = 0,        // CPU周期
+    PERF_COUNTER_INSTRUCTIONS,      // 指令数
+    PERF_COUNTER_CACHE_MISSES,      // 缓存未命中
+    PERF_COUNTER_BRANCH_MISSES,     // 分支预测失败
+    PERF_COUNTER_CONTEXT_SWITCHES,  // 上下文切换
+    PERF_COUNTER_MAX
+} perf_counter_type_t;
+
+// 单次采样结果（相对上次采样的增量）
+typedef struct perf_counters_sample {
+    uint64_t delta[PERF_COUNTER_MAX];   // 各计数器增量
+    uint64_t requests;                  // 采样区间内处理的请求数
+    double interval_sec;                // 采样区间长度(秒)
+    double ipc;                         // 每周期指令数
+    double cache_misses_per_request;    // 每请求缓存未命中数
+    double branch_misses_per_request;   // 每请求分支预测失败数
+    double context_switches_per_sec;    // 每秒上下文切换次数
+    unsigned int valid_mask;            // 有效计数器位图（1 << perf_counter_type_t）
+} perf_counters_sample_t;
+
+// 计数器组
+typedef struct perf_counters {
+    int fds[PERF_COUNTER_MAX];          // 计数器文件描述符，-1表示不可用
+    uint64_t last_values[PERF_COUNTER_MAX]; // 上次读取的累计值
+    uint64_t last_requests;             // 上次采样时的累计请求数
+    uint64_t last_sample_ns;            // 上次采样时间(纳秒)
+    int open_count;                     // 成功打开的计数器数量
+    perf_counters_sample_t last_sample; // 最近一次采样结果
+} perf_counters_t;
+
+/**
+ * 为当前进程打开性能计数器（包括之后创建的线程）
+ * 必须在创建事件循环线程之前调用
+ * @param pc 计数器组
+ * @return 成功打开的计数器数量，0表示内核不允许或平台不支持
+ */
+int perf_counters_open(perf_counters_t *pc);
+
+/**
+ * 采样所有计数器并计算增量指标
+ * @param pc 计数器组
+ * @param total_requests 当前累计请求数
+ * @param sample 输出采样结果，可为NULL
+ * @return 成功返回0，无可用计数器返回-1
+ */
+int perf_counters_sample(perf_counters_t *pc, uint64_t total_requests, perf_counters_sample_t *sample);
+
+/**
+ * 关闭所有计数器
+ * @param pc 计数器组
+ */
+void perf_counters_close(perf_counters_t *pc);
+
+/**
+ * 获取计数器名称
+ * @param type 计数器类型
+ * @return 名称字符串
+ */
+const char *perf_counter_name(perf_counter_type_t type);
+
+#endif /* PERF_COUNTERS_H */
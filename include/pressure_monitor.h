@@ -0,0 +1,64 @@
+/**
+ * 资源压力（PSI）监控模块头文件
+ * Master每秒读取/proc/pressure/{memory,cpu,io}（在cgroup中优先读取所在cgroup的*.pressure），
+ * 按最近10秒平均值与阈值比较，通过共享内存中的标志位通知Worker：
+ * 内存压力时收缩文件缓存和缓冲池，CPU压力时暂停诊断统计并把调试日志降为INFO，
+ * IO压力时把调试日志降为INFO，极端压力时低优先级路由直接返回503；压力消失后恢复原状
+ */
+
+#ifndef PRESSURE_MONITOR_H
+#define PRESSURE_MONITOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+
+// 拒绝低优先级请求时建议客户端等待的秒数（PSI平均窗口）
+#define PRESSURE_RETRY_AFTER_SEC 10
+
+/**
+ * 按配置打开PSI文件并设置阈值（Master启动和重新加载配置时调用，可重复调用）
+ *
+ * @param config 配置
+ * @return 成功或未启用返回0，没有可读的PSI文件返回-1
+ */
+int pressure_monitor_init(const config_t *config);
+
+/**
+ * 读取PSI、更新并发布压力标志（Master定时器每秒调用）
+ */
+void pressure_monitor_check(void);
+
+/**
+ * 关闭PSI文件并清除压力标志
+ */
+void pressure_monitor_cleanup(void);
+
+/**
+ * 启动Worker端压力响应
+ *
+ * @param worker_id Worker槽位
+ * @param cache_limit 正常情况下的文件缓存容量（字节）
+ */
+void pressure_worker_start(int worker_id, size_t cache_limit);
+
+/**
+ * 按共享内存中的压力标志调整本Worker并发布响应计数（Worker每秒调用）
+ */
+void pressure_worker_update(void);
+
+/**
+ * 极端压力下是否拒绝该路由的请求，拒绝时计数（事件循环线程调用）
+ *
+ * @param route 匹配的路由
+ * @return 应返回503时返回1，否则返回0
+ */
+int pressure_shed_request(const route_t *route);
+
+/**
+ * 发布并输出压力响应统计（Worker退出前调用）
+ */
+void pressure_worker_stop(void);
+
+#endif /* PRESSURE_MONITOR_H */
@@ -43,6 +43,25 @@ int check_server_running(int port);
  */
 void release_pid_file(void);
 
+/**
+ * 进入守护进程模式（fork）后重新加锁PID文件并写入当前PID
+ * @return 0表示成功，-1表示失败
+ */
+int refresh_pid_file(void);
+
+/**
+ * 二进制升级：把本进程持有锁的PID文件改名为 <PID文件>.oldbin，
+ * 让新Master可以创建自己的PID文件，文件锁随描述符保留
+ * @return 0表示成功，-1表示失败
+ */
+int rename_pid_file_oldbin(void);
+
+/**
+ * 新二进制启动失败时把 .oldbin 改回原PID文件名
+ * @return 0表示成功，-1表示失败
+ */
+int restore_pid_file_oldbin(void);
+
 /**
  * 发送信号给运行中的服务器实例
  * @param port 服务器端口号
@@ -53,6 +72,7 @@ int send_signal_to_running_server(int port, int signal);
 
 /**
  * 全面的服务器启动前检查
+ * 从旧Master继承监听套接字（二进制升级）时跳过端口占用检查，只创建PID文件
  * @param port 服务器端口号
  * @return 0表示检查通过，-1表示检查失败
  */
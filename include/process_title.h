@@ -21,4 +21,10 @@ int init_process_title(int argc, char **argv, char **envp);
  */
 void setproctitle(const char *fmt, ...);
 
+/**
+ * 获取启动时保存的命令行参数副本（二进制升级时用于重新执行）
+ * @return 以NULL结尾的参数数组，未初始化返回NULL
+ */
+char **get_saved_argv(void);
+
 #endif // PROCESS_TITLE_H
\ No newline at end of file
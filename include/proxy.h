@@ -5,19 +5,38 @@
 #ifndef PROXY_H
 #define PROXY_H
 
+#include <sys/socket.h>
 #include "http.h"
 #include "config.h"
 
+// 预解析的上游地址，随配置快照构建（Master在fork前解析，Worker继承）
+typedef struct upstream_addr {
+    struct sockaddr_storage addr;
+    socklen_t addr_len;                 // 0表示未解析，请求时再解析
+} upstream_addr_t;
+
+/**
+ * 解析上游地址（取第一个结果）
+ *
+ * @param host 上游主机
+ * @param port 上游端口
+ * @param upstream 输出地址，失败时addr_len为0
+ * @return 成功返回0，失败返回-1
+ */
+int proxy_resolve_upstream(const char *host, int port, upstream_addr_t *upstream);
+
 /**
  * 将请求转发到目标服务器
  * 
  * @param client_sock 客户端套接字
  * @param request HTTP请求
  * @param route 匹配的路由
+ * @param upstream 预解析的上游地址，为NULL或未解析时现场解析，连接失败时也会重新解析
  * @param status_code 指向状态码的指针，用于返回实际的HTTP状态码
  * @param response_size 指向响应大小的指针，用于返回响应包体大小
  * @return 成功返回0，失败返回非0值
  */
-int proxy_request(int client_sock, http_request_t *request, route_t *route, int *status_code, size_t *response_size);
+int proxy_request(int client_sock, http_request_t *request, route_t *route, const upstream_addr_t *upstream,
+                  int *status_code, size_t *response_size);
 
 #endif /* PROXY_H */
\ No newline at end of file
@@ -0,0 +1,52 @@
+/**
+ * 运行资源限制检测模块头文件
+ * 读取进程实际可用的CPU（在线CPU、CPU亲和性、cgroup v1/v2 CPU配额）、内存（物理内存、cgroup内存上限）
+ * 与文件描述符限制（RLIMIT_NOFILE），容器中sysconf返回的是宿主机的数值
+ */
+
+#ifndef RESOURCE_LIMITS_H
+#define RESOURCE_LIMITS_H
+
+#include <stddef.h>
+#include <sys/resource.h>
+
+#include "config.h"
+
+// 资源限制
+typedef struct {
+    int online_cpus;                    // 在线CPU数（sysconf）
+    int allowed_cpus;                   // CPU亲和性允许的CPU数
+    double cpu_quota;                   // cgroup CPU配额（CPU个数），0表示不限制
+    size_t physical_memory;             // 物理内存字节数
+    size_t memory_limit;                // cgroup内存上限字节数，0表示不限制
+    rlim_t nofile_soft;                 // RLIMIT_NOFILE软限制
+    rlim_t nofile_hard;                 // RLIMIT_NOFILE硬限制
+    int cgroup_version;                 // 0表示未检测到cgroup，1或2
+    char cgroup_dir[MAX_PATH_LEN];      // 本进程所在的cgroup v2目录（混合模式下为unified层级），没有时为空
+} resource_limits_t;
+
+/**
+ * 检测当前进程的资源限制
+ *
+ * @param limits 输出的资源限制
+ * @return 成功返回0，失败返回-1（无法读取的项按不限制处理）
+ */
+int resource_limits_detect(resource_limits_t *limits);
+
+/**
+ * 实际可用的CPU个数：在线CPU、亲和性与cgroup配额中的最小值
+ *
+ * @param limits 资源限制
+ * @return CPU个数，配额可以是小数
+ */
+double resource_limits_cpus(const resource_limits_t *limits);
+
+/**
+ * 实际可用的内存：物理内存与cgroup上限中的较小值
+ *
+ * @param limits 资源限制
+ * @return 字节数
+ */
+size_t resource_limits_memory(const resource_limits_t *limits);
+
+#endif /* RESOURCE_LIMITS_H */
@@ -0,0 +1,85 @@
+/**
+ * 路由CPU时间统计模块头文件
+ * 基于CLOCK_THREAD_CPUTIME_ID统计每个Worker中各路由处理请求消耗的CPU时间，
+ * 导出CPU秒数与每请求CPU时间，用于路由容量评估和配置变更后的回归定位
+ */
+
+#ifndef ROUTE_STATS_H
+#define ROUTE_STATS_H
+
+#include <stdint.h>
+#include "config.h"
+
+// 统计槽位数量：每条路由一个槽位，最后一个槽位统计未匹配路由的请求（解析失败、404等）
+#define ROUTE_STATS_SLOTS (MAX_ROUTES + 1)
+#define ROUTE_STATS_UNMATCHED MAX_ROUTES
+
+// 单条路由的统计快照
+typedef struct route_cpu_stats {
+    char path_prefix[MAX_PATH_PREFIX_LEN];  // 路由前缀，未匹配槽位为"(unmatched)"
+    uint64_t requests;                      // 请求数
+    uint64_t cpu_ns;                        // 累计CPU时间(纳秒)
+    uint64_t max_cpu_ns;                    // 单请求最大CPU时间(纳秒)
+    double cpu_seconds;                     // 累计CPU秒数
+    double cpu_us_per_request;              // 平均每请求CPU时间(微秒)
+} route_cpu_stats_t;
+
+/**
+ * 启用或禁用路由CPU时间统计
+ * @param enabled 非0启用，0禁用
+ */
+void route_stats_enable(int enabled);
+
+/**
+ * 查询路由CPU时间统计是否启用
+ * @return 启用返回1，否则返回0
+ */
+int route_stats_is_enabled(void);
+
+/**
+ * 根据配置同步路由名称，路由前缀发生变化的槽位会被清零
+ * 在Worker启动和重新加载配置时调用
+ * @param config 当前配置
+ */
+void route_stats_set_routes(const config_t *config);
+
+/**
+ * 读取当前线程已消耗的CPU时间
+ * @return CPU时间(纳秒)，未启用时返回0
+ */
+uint64_t route_stats_thread_cpu_ns(void);
+
+/**
+ * 记录一次请求的CPU时间
+ * @param route_index 路由下标，ROUTE_STATS_UNMATCHED表示未匹配路由
+ * @param cpu_ns 本次请求消耗的CPU时间(纳秒)
+ */
+void route_stats_record(int route_index, uint64_t cpu_ns);
+
+/**
+ * 获取统计快照（仅包含有请求的槽位）
+ * @param stats 输出数组
+ * @param max_count 数组容量
+ * @return 实际写入的条目数
+ */
+int route_stats_get(route_cpu_stats_t *stats, int max_count);
+
+/**
+ * 读取指定槽位的累计值
+ * @param slot 槽位下标
+ * @param requests 输出请求数
+ * @param cpu_ns 输出累计CPU时间(纳秒)
+ */
+void route_stats_get_slot(int slot, uint64_t *requests, uint64_t *cpu_ns);
+
+/**
+ * 重置统计数据
+ */
+void route_stats_reset(void);
+
+/**
+ * 打印路由CPU时间统计
+ */
+void route_stats_print(void);
+
+#endif /* ROUTE_STATS_H */
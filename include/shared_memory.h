@@ -1,6 +1,8 @@
 /**
  * 共享内存管理模块
  * 用于Master进程和Worker进程之间的数据共享
+ * Master在fork之前创建一块匿名MAP_SHARED映射，Worker通过fork继承，同一主机上的多个实例互不影响；
+ * 每个Worker槽位只有一个写者，读者通过顺序锁获得一致的快照，发布统计不需要系统调用
  */
 
 #ifndef SHARED_MEMORY_H
@@ -9,11 +11,71 @@
 #include <sys/types.h>
 #include <stdint.h>
 #include "config.h"
+#include "alloc_stats.h"
+#include "route_stats.h"
+#include "lock_profiler.h"
 
-// 共享内存段标识
-#define SHM_CONFIG_KEY    0x12345678
-#define SHM_STATS_KEY     0x12345679
-#define SHM_WORKERS_KEY   0x1234567A
+// 共享区域布局版本，区域头部或各段结构变化时递增
+#define SHM_LAYOUT_VERSION  5
+#define SHM_MAGIC           0x58535652  // "XSVR"
+
+// Worker统计槽位数量
+#define SHM_MAX_WORKERS     32
+
+// 每个Worker发布的命名锁数量上限
+#define SHM_LOCK_SLOTS      32
+
+// Master通过管理接口下发给Worker的命令
+typedef enum {
+    WORKER_CMD_NONE = 0,
+    WORKER_CMD_SET_LOG_LEVEL,       // 修改日志级别，参数为日志级别
+    WORKER_CMD_SET_DIAGNOSTIC,      // 开关诊断统计，参数为 (开关 << 8) | worker_diagnostic_t
+    WORKER_CMD_CACHE_DUMP,          // 输出文件缓存内容到日志，结果为缓存项数量
+    WORKER_CMD_CACHE_CLEAR,         // 清空文件缓存
+    WORKER_CMD_DRAIN,               // 停止接受新连接，处理完现有连接后退出
+    WORKER_CMD_ALLOC_RESET          // 重置分配统计，开始新的每请求统计窗口
+} worker_command_t;
+
+// 可在运行时开关的诊断统计
+typedef enum {
+    WORKER_DIAG_LOCK_PROFILING = 0, // 锁竞争分析
+    WORKER_DIAG_ALLOC_ACCOUNTING,   // 内存分配统计
+    WORKER_DIAG_ROUTE_CPU_STATS     // 路由CPU时间统计
+} worker_diagnostic_t;
+
+// 资源压力标志（Master按PSI设置，Worker据此调整）
+#define PRESSURE_MEMORY     0x01    // 内存压力：收缩文件缓存和缓冲池
+#define PRESSURE_CPU        0x02    // CPU压力：暂停诊断统计，调试日志降为INFO
+#define PRESSURE_IO         0x04    // IO压力：调试日志降为INFO
+#define PRESSURE_CRITICAL   0x08    // 极端压力：低优先级路由返回503
+#define PRESSURE_KINDS      4
+
+// 资源压力状态，由Master写入
+typedef struct shared_pressure {
+    uint32_t seq;                   // 顺序锁序号，Master写入时为奇数
+    uint32_t flags;                 // PRESSURE_*位组合，Worker无锁读取
+    double memory_some;             // 最近10秒至少一个任务等待内存的时间占比（%）
+    double memory_full;             // 最近10秒所有任务都在等待内存的时间占比（%）
+    double cpu_some;                // 最近10秒至少一个任务等待CPU的时间占比（%）
+    double io_some;                 // 最近10秒至少一个任务等待IO的时间占比（%）
+    uint64_t raised[PRESSURE_KINDS];// 各标志置位次数（下标为标志位序号）
+    time_t since;                   // 当前标志组合开始时间
+} shared_pressure_t;
+
+// 单个命名锁的竞争统计，由Worker按lock_profiler快照发布
+typedef struct shared_lock_stats {
+    char name[LOCK_PROFILER_NAME_LEN];  // 锁名称
+    uint64_t acquisitions;          // 获取次数
+    uint64_t contended;             // 发生竞争的获取次数
+    uint64_t wait_avg_ns;           // 平均等待时间(纳秒)
+    uint64_t wait_p50_ns;           // 等待时间P50上界(纳秒)
+    uint64_t wait_p99_ns;           // 等待时间P99上界(纳秒)
+    uint64_t wait_max_ns;           // 最大等待时间(纳秒)
+    uint64_t hold_avg_ns;           // 平均持有时间(纳秒)
+    uint64_t hold_p50_ns;           // 持有时间P50上界(纳秒)
+    uint64_t hold_p99_ns;           // 持有时间P99上界(纳秒)
+    uint64_t hold_max_ns;           // 最大持有时间(纳秒)
+} shared_lock_stats_t;
 
 // 共享统计信息结构
 typedef struct shared_stats {
@@ -24,9 +86,11 @@ typedef struct shared_stats {
     uint32_t total_connections;     // 总连接数
     time_t start_time;              // 服务器启动时间
     uint32_t worker_count;          // Worker进程数量
+    shared_pressure_t pressure;     // 资源压力状态
     
-    // 每个Worker的统计信息
+    // 每个Worker的统计信息，每个槽位独占缓存行，由该Worker单独写入
     struct {
+        uint32_t seq;                       // 统计字段的顺序锁序号，奇数表示正在写入
         pid_t pid;
         uint64_t requests;
         uint64_t bytes_sent;
@@ -34,25 +98,93 @@ typedef struct shared_stats {
         uint32_t active_connections;
         time_t start_time;
         time_t last_update;
-    } workers[32];  // 最多支持32个Worker进程
+        
+        // 硬件性能计数器指标（最近一秒）
+        double ipc;                         // 每周期指令数
+        double cache_misses_per_request;    // 每请求缓存未命中数
+        double branch_misses_per_request;   // 每请求分支预测失败数
+        double context_switches_per_sec;    // 每秒上下文切换次数
+        
+        // 内存分配统计（按子系统标签）
+        double allocs_per_request[ALLOC_TAG_MAX];   // 每请求分配次数
+        double alloc_bytes_per_request[ALLOC_TAG_MAX]; // 每请求分配字节数
+        int64_t alloc_live_bytes[ALLOC_TAG_MAX];    // 存活字节数（仅make alloc-accounting构建）
+        
+        // 路由CPU时间统计（下标与路由配置一致，最后一个槽位为未匹配路由）
+        uint64_t route_requests[ROUTE_STATS_SLOTS]; // 各路由请求数
+        uint64_t route_cpu_ns[ROUTE_STATS_SLOTS];   // 各路由累计CPU时间(纳秒)
+        
+        // 运行状态
+        uint64_t loop_lag_us;               // 最近一秒内最长事件分发耗时(微秒)
+        uint64_t loop_lag_peak_us;          // 启动以来最长事件分发耗时(微秒)
+        double loop_utilization;            // 最近一秒事件分发耗时占比（0-1），自动扩缩容依据
+        int draining;                       // 是否正在排空连接
+        
+        // 心跳（事件循环线程每次迭代无锁写入，Master据此检测卡死的Worker）
+        uint64_t heartbeat_ms;              // 最近一次迭代开始时间(CLOCK_MONOTONIC毫秒)，循环启动前为0
+        uint64_t loop_iterations;           // 事件循环迭代次数
+        
+        // 文件缓存
+        uint64_t cache_bytes;               // 缓存占用字节数
+        uint64_t cache_max_bytes;           // 缓存容量
+        uint64_t cache_hits;                // 缓存命中数
+        uint64_t cache_misses;              // 缓存未命中数
+        
+        // 资源压力响应
+        uint64_t pressure_reactions;        // 执行的压力响应次数
+        uint64_t shed_requests;             // 极端压力下拒绝的低优先级请求数
+        
+        // 自适应并发限制
+        uint32_t concurrency_limit;         // 当前Worker并发限制，0表示未启用
+        uint32_t concurrency_inflight;      // 正在处理的请求数
+        uint32_t concurrency_waiting;       // 排队等待的请求数
+        uint64_t limit_rejected;            // 超过限制直接返回503的请求数
+        uint64_t limit_queued;              // 进入队列的请求数
+        uint64_t limit_expired;             // 排队超时返回503的请求数
+        
+        // 锁竞争分析（lock_profiling开启时发布，启动以来累计）
+        uint32_t lock_count;                // 有效条目数
+        shared_lock_stats_t locks[SHM_LOCK_SLOTS];  // 按锁名称注册顺序
+        
+        // 管理命令邮箱（command_seq != command_ack 表示有待处理命令）
+        uint32_t command_lock;              // 邮箱顺序锁序号，Master写入命令时为奇数
+        uint32_t command_seq;               // 命令序号，由Master递增
+        int command;                        // worker_command_t
+        int command_arg;                    // 命令参数
+        uint32_t command_ack;               // Worker已完成的命令序号
+        int command_result;                 // 命令执行结果
+    } __attribute__((aligned(64))) workers[SHM_MAX_WORKERS];
 } shared_stats_t;
 
 // 共享配置信息结构
 typedef struct shared_config {
+    uint32_t seq;                   // 顺序锁序号，Master写入时为奇数
     int version;                    // 配置版本号
     time_t update_time;            // 配置更新时间
     config_t config;               // 实际配置数据
 } shared_config_t;
 
+// 共享区域头部，位于映射起始处，记录布局版本和各段位置
+typedef struct shared_region {
+    uint32_t magic;                 // SHM_MAGIC
+    uint32_t layout_version;        // SHM_LAYOUT_VERSION
+    uint64_t size;                  // 映射总大小（按页对齐）
+    uint64_t config_offset;         // shared_config_t段偏移
+    uint64_t config_size;           // shared_config_t段大小
+    uint64_t stats_offset;          // shared_stats_t段偏移
+    uint64_t stats_size;            // shared_stats_t段大小
+    uint32_t worker_slots;          // Worker槽位数量
+} shared_region_t;
+
 /**
- * 初始化共享内存
+ * 初始化共享内存（Master在创建Worker之前调用），按各段大小计算并创建匿名共享映射
  * 
  * @return 成功返回0，失败返回-1
  */
 int init_shared_memory(void);
 
 /**
- * 清理共享内存
+ * 清理共享内存（解除映射，Worker仍持有各自的映射直到退出）
  */
 void cleanup_shared_memory(void);
 
@@ -87,7 +219,189 @@ int update_worker_stats(int worker_id, pid_t pid, uint64_t requests,
                        uint32_t active_connections);
 
 /**
- * 获取共享统计信息
+ * 更新Worker进程硬件性能计数器指标
+ * 
+ * @param worker_id Worker进程ID
+ * @param ipc 每周期指令数
+ * @param cache_misses_per_request 每请求缓存未命中数
+ * @param branch_misses_per_request 每请求分支预测失败数
+ * @param context_switches_per_sec 每秒上下文切换次数
+ * @return 成功返回0，失败返回-1
+ */
+int update_worker_perf_stats(int worker_id, double ipc, double cache_misses_per_request,
+                             double branch_misses_per_request, double context_switches_per_sec);
+
+/**
+ * 更新Worker进程内存分配统计
+ * 
+ * @param worker_id Worker进程ID
+ * @param snapshot 分配统计快照
+ * @return 成功返回0，失败返回-1
+ */
+int update_worker_alloc_stats(int worker_id, const alloc_stats_snapshot_t *snapshot);
+
+/**
+ * 更新Worker进程路由CPU时间统计（读取本进程route_stats累计值）
+ * 
+ * @param worker_id Worker进程ID
+ * @return 成功返回0，失败返回-1
+ */
+int update_worker_route_stats(int worker_id);
+
+/**
+ * 更新Worker进程锁竞争统计（读取本进程lock_profiler累计值，超出SHM_LOCK_SLOTS的锁不发布）
+ * 
+ * @param worker_id Worker进程ID
+ * @return 成功返回0，失败返回-1
+ */
+int update_worker_lock_stats(int worker_id);
+
+/**
+ * 更新Worker进程运行状态与文件缓存统计
+ * 
+ * @param worker_id Worker进程ID
+ * @param loop_lag_us 最近一秒内最长事件分发耗时(微秒)
+ * @param loop_utilization 最近一秒事件分发耗时占比（0-1）
+ * @param draining 是否正在排空连接
+ * @param cache_bytes 缓存占用字节数
+ * @param cache_max_bytes 缓存容量
+ * @param cache_hits 缓存命中数
+ * @param cache_misses 缓存未命中数
+ * @return 成功返回0，失败返回-1
+ */
+int update_worker_runtime_stats(int worker_id, uint64_t loop_lag_us, double loop_utilization, int draining,
+                                uint64_t cache_bytes, uint64_t cache_max_bytes,
+                                uint64_t cache_hits, uint64_t cache_misses);
+
+/**
+ * 更新Worker进程资源压力响应计数
+ * 
+ * @param worker_id Worker进程ID
+ * @param reactions 执行的压力响应次数
+ * @param shed_requests 拒绝的低优先级请求数
+ * @return 成功返回0，失败返回-1
+ */
+int update_worker_pressure_stats(int worker_id, uint64_t reactions, uint64_t shed_requests);
+
+/**
+ * 更新Worker进程自适应并发限制统计
+ * 
+ * @param worker_id Worker进程ID
+ * @param limit 当前并发限制，0表示未启用
+ * @param inflight 正在处理的请求数
+ * @param waiting 排队等待的请求数
+ * @param rejected 超过限制直接返回503的请求数
+ * @param queued 进入队列的请求数
+ * @param expired 排队超时返回503的请求数
+ * @return 成功返回0，失败返回-1
+ */
+int update_worker_limit_stats(int worker_id, uint32_t limit, uint32_t inflight, uint32_t waiting,
+                              uint64_t rejected, uint64_t queued, uint64_t expired);
+
+/**
+ * 发布资源压力状态（仅Master调用）
+ * 
+ * @param pressure 压力状态，seq字段被忽略
+ * @return 成功返回0，失败返回-1
+ */
+int update_shared_pressure(const shared_pressure_t *pressure);
+
+/**
+ * 读取资源压力标志（Worker调用），无锁读取
+ * 
+ * @return PRESSURE_*位组合，共享内存不可用时返回0
+ */
+uint32_t get_shared_pressure_flags(void);
+
+/**
+ * 向Worker下发管理命令（仅Master主线程调用），覆盖尚未处理的旧命令
+ * 
+ * @param worker_id Worker进程ID
+ * @param command 命令
+ * @param arg 命令参数
+ * @param seq 输出命令序号，用于等待执行结果
+ * @return 成功返回0，失败返回-1
+ */
+int post_worker_command(int worker_id, worker_command_t command, int arg, uint32_t *seq);
+
+/**
+ * 等待Worker执行完命令（Master调用）
+ * 
+ * @param worker_id Worker进程ID
+ * @param seq post_worker_command返回的命令序号
+ * @param timeout_ms 超时时间(毫秒)，0表示只检查一次不等待
+ * @param result 输出命令执行结果，可为NULL
+ * @return 成功返回0，超时返回-1
+ */
+int wait_worker_command(int worker_id, uint32_t seq, int timeout_ms, int *result);
+
+/**
+ * 获取待处理的管理命令（Worker调用），无锁读取
+ * 
+ * @param worker_id Worker进程ID
+ * @param seq 输出命令序号
+ * @param command 输出命令
+ * @param arg 输出命令参数
+ * @return 有待处理命令返回1，没有返回0
+ */
+int fetch_worker_command(int worker_id, uint32_t *seq, worker_command_t *command, int *arg);
+
+/**
+ * 确认命令执行完成（Worker调用）
+ * 
+ * @param worker_id Worker进程ID
+ * @param seq 命令序号
+ * @param result 执行结果
+ * @return 成功返回0，失败返回-1
+ */
+int ack_worker_command(int worker_id, uint32_t seq, int result);
+
+/**
+ * 重置Worker槽位的运行状态与心跳并丢弃遗留命令（Master创建Worker前和新Worker启动时调用）
+ * 
+ * @param worker_id Worker进程ID
+ * @return 成功返回0，失败返回-1
+ */
+int reset_worker_slot(int worker_id);
+
+/**
+ * 把已退出Worker的请求数和字节数计入Master侧累计值并清空槽位，槽位被复用后总计不会倒退（仅Master回收Worker时调用）
+ * 
+ * @param worker_id Worker进程ID
+ * @return 成功返回0，失败返回-1
+ */
+int retire_worker_slot(int worker_id);
+
+/**
+ * 获取Worker槽位心跳字段的地址（Worker调用），交给事件循环线程每次迭代无锁写入
+ * 
+ * @param worker_id Worker进程ID
+ * @param heartbeat_ms 输出心跳时间字段地址
+ * @param loop_iterations 输出迭代次数字段地址
+ * @return 成功返回0，失败返回-1
+ */
+int get_worker_heartbeat_slot(int worker_id, uint64_t **heartbeat_ms, uint64_t **loop_iterations);
+
+/**
+ * 读取Worker心跳（Master调用），无锁读取
+ * 
+ * @param worker_id Worker进程ID
+ * @param heartbeat_ms 输出最近一次心跳时间(CLOCK_MONOTONIC毫秒)，尚未开始为0
+ * @param loop_iterations 输出事件循环迭代次数
+ * @return 成功返回0，失败返回-1
+ */
+int read_worker_heartbeat(int worker_id, uint64_t *heartbeat_ms, uint64_t *loop_iterations);
+
+/**
+ * 复制共享统计信息，每个Worker槽位通过顺序锁读取一致的快照，并汇总全局计数
+ * 
+ * @param out 输出
+ * @return 成功返回0，失败返回-1
+ */
+int copy_shared_stats(shared_stats_t *out);
+
+/**
+ * 获取共享统计信息（直接读取，单个字段可能与其他字段不一致，需要一致快照时使用copy_shared_stats）
  * 
  * @return 统计信息指针，失败返回NULL
  */
@@ -1,10 +1,17 @@
 /**
  * 线程池头文件
+ * 工作窃取线程池：每个线程一个Chase-Lev双端队列，外部线程提交的任务进入全局有界注入队列，
+ * 空闲线程先取自己的队列，再取注入队列，最后从其他线程的队列尾部窃取
+ *
+ * 完成通道把任务完成后的回调送回提交任务的事件循环：完成的任务压入无锁栈，
+ * 栈由空变非空时写一次eventfd，事件循环线程按提交顺序执行回调，提交与完成路径上都没有锁
  */
 
 #ifndef THREAD_POOL_H
 #define THREAD_POOL_H
 
+#include "event_loop.h"
+
 // 线程池错误码
 typedef enum {
     THREAD_POOL_SUCCESS = 0,       // 成功
@@ -15,21 +22,28 @@ typedef enum {
     THREAD_POOL_THREAD_FAILURE     // 线程操作失败
 } thread_pool_error_t;
 
+// 每个线程本地双端队列的容量，满时任务进入注入队列
+#define THREAD_POOL_DEQUE_SIZE 256
+
 // 线程池结构体（不透明类型）
 typedef struct thread_pool thread_pool_t;
 
+// 完成通道结构体（不透明类型）
+typedef struct offload_channel offload_channel_t;
+
 /**
  * 创建线程池
- * 
+ *
  * @param thread_count 线程数量
- * @param queue_size 任务队列大小
+ * @param queue_size 注入队列大小（向上取整为2的幂）
  * @return 线程池指针，失败返回NULL
  */
 thread_pool_t *thread_pool_create(int thread_count, int queue_size);
 
 /**
  * 添加任务到线程池
- * 
+ * 池内线程提交的任务进入该线程自己的队列，其他线程提交的进入注入队列
+ *
  * @param pool 线程池指针
  * @param function 任务函数
  * @param argument 任务参数
@@ -37,13 +51,84 @@ thread_pool_t *thread_pool_create(int thread_count, int queue_size);
  */
 int thread_pool_add(thread_pool_t *pool, void (*function)(void *), void *argument);
 
+/**
+ * 提交任务，完成后在通道所属的事件循环线程中调用completion
+ * 只能在通道所属的事件循环线程中调用
+ *
+ * @param pool 线程池指针，为NULL时在当前线程执行任务，完成回调仍由事件循环异步执行
+ * @param channel 完成通道
+ * @param function 任务函数（池内线程执行）
+ * @param argument 任务与完成回调的参数
+ * @param completion 完成回调（事件循环线程执行），可为NULL
+ * @return 成功返回0，失败返回错误码（任务未执行，完成回调不会被调用）
+ */
+int thread_pool_submit(thread_pool_t *pool, offload_channel_t *channel,
+                       void (*function)(void *), void *argument, void (*completion)(void *));
+
 /**
  * 销毁线程池
- * 
+ *
  * @param pool 线程池指针
- * @param flags 标志位，0表示等待所有任务完成，非0表示立即关闭
+ * @param flags 标志位，0表示等待所有任务完成，非0表示执行中的任务结束后立即关闭，丢弃排队的任务
  * @return 成功返回0，失败返回错误码
  */
 int thread_pool_destroy(thread_pool_t *pool, int flags);
 
-#endif /* THREAD_POOL_H */
\ No newline at end of file
+/**
+ * 创建完成通道并把eventfd注册到事件循环
+ *
+ * @param loop 执行完成回调的事件循环
+ * @return 通道指针，失败返回NULL
+ */
+offload_channel_t *offload_channel_create(event_loop_t *loop);
+
+/**
+ * 在当前线程执行通道中已送达的完成回调（事件循环停止、线程池销毁之后调用）
+ *
+ * @param channel 完成通道
+ * @return 执行的回调数
+ */
+int offload_channel_flush(offload_channel_t *channel);
+
+/**
+ * 销毁完成通道（须先销毁向它提交任务的线程池并执行offload_channel_flush）
+ *
+ * @param channel 完成通道
+ */
+void offload_channel_destroy(offload_channel_t *channel);
+
+/**
+ * 初始化当前进程的卸载线程池与完成通道（Worker在事件循环启动之前调用）
+ *
+ * @param loop 执行完成回调的事件循环
+ * @param thread_count 线程数量，0表示不创建线程，任务在提交线程中执行
+ * @param queue_size 注入队列大小
+ * @return 成功返回0，失败返回-1
+ */
+int offload_init(event_loop_t *loop, int thread_count, int queue_size);
+
+/**
+ * 把阻塞操作（磁盘读取、DNS、代理转发、耗时的加解密）交给线程池执行，
+ * 完成后在事件循环线程中调用completion_cb（只能在事件循环线程中调用）
+ *
+ * @param fn 任务函数
+ * @param arg 任务与完成回调的参数
+ * @param completion_cb 完成回调，可为NULL
+ * @return 成功返回0，失败返回错误码（任务未执行，调用者应自行同步处理）
+ */
+int offload(void (*fn)(void *), void *arg, void (*completion_cb)(void *));
+
+/**
+ * 是否有线程池线程执行卸载的任务
+ *
+ * @return 有返回1，没有（未启用或单线程Worker）返回0
+ */
+int offload_available(void);
+
+/**
+ * 停止卸载：等待所有任务完成，在当前线程执行剩余的完成回调，释放线程池与通道
+ * （事件循环线程结束之后、事件循环和连接销毁之前调用）
+ */
+void offload_shutdown(void);
+
+#endif /* THREAD_POOL_H */
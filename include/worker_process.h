@@ -99,4 +99,9 @@ void decrement_connection_count_safe(void);
  */
 connection_pool_t *get_worker_connection_pool(void);
 
+/**
+ * 尽快在事件循环线程执行一次空闲连接池清理（可在主线程调用，如内存压力时）
+ */
+void worker_schedule_pool_cleanup(void);
+
 #endif /* WORKER_PROCESS_H */
\ No newline at end of file
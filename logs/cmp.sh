@@ -0,0 +1,15 @@
+#!/bin/bash
+# usage: cmp.sh conf port
+conf=$1; port=$2
+bin/x-server -f -p $port -c $conf > /dev/null 2>&1 &
+M=$!; sleep 1.5
+W=$(pgrep -P $M)
+cpu() { t=0; for w in $W; do s=($(cut -d' ' -f14,15 /proc/$w/stat)); t=$((t+s[0]+s[1])); done; echo $t; }
+req() { bin/x-server -c $conf -a workers | sed -n 's/.*requests=\([0-9]*\).*/\1/p' | awk "{s+=\$1} END {print s}"; }
+c0=$(cpu); r0=$(req)
+tools/bin/x-loadgen -c 64 -d 8 127.0.0.1:$port/index.html 2>&1 | grep -E "Throughput|Errors" | tr '\n' ' '
+sleep 1.2
+c1=$(cpu); r1=$(req)
+hz=$(getconf CLK_TCK)
+echo; echo "requests=$((r1-r0)) cpu_ticks=$((c1-c0)) us_per_req=$(awk -v c=$((c1-c0)) -v h=$hz -v r=$((r1-r0)) "BEGIN{printf \"%.2f\", c*1e6/h/r}")"
+kill -TERM $M; wait $M 2>/dev/null
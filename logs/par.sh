@@ -0,0 +1,8 @@
+#!/bin/bash
+# usage: par.sh port n
+port=$1; n=$2
+s=$(date +%s.%N)
+for i in $(seq $n); do curl -s -o /dev/null -w "%{http_code}\n" 127.0.0.1:$port/api/v2/x$i & done | sort | uniq -c
+wait
+e=$(date +%s.%N)
+awk -v s=$s -v e=$e 'BEGIN{printf "wall=%.2fs\n", e-s}'
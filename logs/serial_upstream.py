@@ -0,0 +1,9 @@
+import http.server, socketserver, time, sys
+class H(http.server.BaseHTTPRequestHandler):
+    def do_GET(self):
+        time.sleep(0.02)
+        body=b"slow ok\n"
+        self.send_response(200); self.send_header("Content-Length",str(len(body))); self.end_headers(); self.wfile.write(body)
+    def log_message(self,*a): pass
+class S(http.server.HTTPServer): daemon_threads=True; request_queue_size=256
+S(("127.0.0.1",int(sys.argv[1])),H).serve_forever()
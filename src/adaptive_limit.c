@@ -0,0 +1,460 @@
+/**
+ * Adaptive Concurrency Limit Implementation
+ * Per-Worker (and optionally per-route) limits on requests in flight, moved by observed latency.
+ * Requests over the limit are answered 503 right after parsing or wait briefly for a Worker slot
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <sys/timerfd.h>
+
+#include "../include/adaptive_limit.h"
+#include "../include/shared_memory.h"
+#include "../include/logger.h"
+
+// Limit a fresh limiter starts from, clamped to the configured range
+#define LIMIT_INITIAL 20
+
+// Requests per latency window; each full window moves the limit once
+#define LIMIT_WINDOW_SAMPLES 10
+
+// Weight of a window in the long-term latency average
+#define LIMIT_LONG_RTT_ALPHA 0.05
+
+// Gradient: the no-load latency is re-probed this often (in windows) so a slower upstream becomes the new normal
+#define GRADIENT_PROBE_WINDOWS 100
+
+// Gradient: latency growth over no-load tolerated before the limit shrinks, and how far each window moves it
+#define GRADIENT_TOLERANCE 1.5
+#define GRADIENT_MIN 0.5
+#define GRADIENT_SMOOTHING 0.2
+
+// AIMD: window latency over this multiple of the long-term average counts as congestion
+#define AIMD_LATENCY_RATIO 2.0
+#define AIMD_BACKOFF 0.9
+
+typedef struct {
+    double limit;                   // Requests allowed in flight
+    double long_rtt_ns;             // Long-term latency average, 0 until the first window
+    uint64_t min_rtt_ns;            // Lowest latency since the last probe, the no-load estimate
+    int windows_since_probe;
+    uint64_t window_sum_ns;
+    uint64_t window_min_ns;
+    int window_count;
+    int window_drops;
+    int window_max_inflight;        // Demand seen in the window, growth needs the limit to be used
+    int inflight;
+} limiter_t;
+
+// Settings, written by whichever thread reloads the configuration
+static atomic_int g_algorithm = LIMIT_ALGORITHM_OFF;
+static atomic_int g_min = 1;
+static atomic_int g_max = 1;
+static atomic_int g_queue_timeout_ms = 0;
+static atomic_int g_per_route = 0;
+static atomic_uint g_config_generation = 0;
+
+// Event loop thread state
+static int g_worker_id = -1;
+static int g_timer_fd = -1;
+static uint32_t g_applied_generation = 0;
+static limiter_t g_worker;
+static limiter_t g_routes[MAX_ROUTES];
+static uint32_t g_route_generation = 0;
+static limit_waiter_t *g_queue_head = NULL;
+static limit_waiter_t *g_queue_tail = NULL;
+static int g_queue_length = 0;
+
+// Read by the publisher
+static atomic_uint g_pub_limit = 0;
+static atomic_uint g_pub_inflight = 0;
+static atomic_uint g_pub_waiting = 0;
+static atomic_uint_fast64_t g_rejected = 0;
+static atomic_uint_fast64_t g_queued = 0;
+static atomic_uint_fast64_t g_expired = 0;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static double clamp_limit(double limit) {
+    double min = atomic_load(&g_min);
+    double max = atomic_load(&g_max);
+    return limit < min ? min : (limit > max ? max : limit);
+}
+
+// Whole requests allowed in flight
+static int limiter_capacity(const limiter_t *l) {
+    return (int)l->limit;
+}
+
+static void publish_state(void) {
+    int enabled = atomic_load(&g_algorithm) != LIMIT_ALGORITHM_OFF;
+    atomic_store_explicit(&g_pub_limit, enabled ? (unsigned int)limiter_capacity(&g_worker) : 0, memory_order_relaxed);
+    atomic_store_explicit(&g_pub_inflight, (unsigned int)g_worker.inflight, memory_order_relaxed);
+    atomic_store_explicit(&g_pub_waiting, (unsigned int)g_queue_length, memory_order_relaxed);
+}
+
+// Pick up a reload: keep the Worker limit within the new range, start route limits over
+static void sync_config(void) {
+    uint32_t generation = atomic_load(&g_config_generation);
+    if (generation == g_applied_generation) {
+        return;
+    }
+    g_applied_generation = generation;
+
+    g_worker.limit = g_worker.limit > 0 ? clamp_limit(g_worker.limit) : clamp_limit(LIMIT_INITIAL);
+    // Route indices may now name other routes, slots taken before stay with the old generation
+    for (int i = 0; i < MAX_ROUTES; i++) {
+        memset(&g_routes[i], 0, sizeof(g_routes[i]));
+        g_routes[i].limit = clamp_limit(LIMIT_INITIAL);
+    }
+    g_route_generation++;
+    publish_state();
+}
+
+// Feed one request latency, move the limit once a window is full
+static void limiter_sample(limiter_t *l, uint64_t rtt_ns, int dropped) {
+    l->window_sum_ns += rtt_ns;
+    if (l->window_count == 0 || rtt_ns < l->window_min_ns) {
+        l->window_min_ns = rtt_ns;
+    }
+    l->window_count++;
+    if (dropped) {
+        l->window_drops++;
+    }
+    if (l->window_count < LIMIT_WINDOW_SAMPLES) {
+        return;
+    }
+
+    double short_rtt = (double)l->window_sum_ns / l->window_count;
+    int drops = l->window_drops;
+    int demand = l->window_max_inflight;
+    l->window_sum_ns = 0;
+    l->window_count = 0;
+    l->window_drops = 0;
+    l->window_max_inflight = l->inflight;
+
+    if (short_rtt <= 0) {
+        return;
+    }
+    double long_rtt = l->long_rtt_ns > 0 ? l->long_rtt_ns : short_rtt;
+    l->long_rtt_ns = long_rtt + (short_rtt - long_rtt) * LIMIT_LONG_RTT_ALPHA;
+    if (l->min_rtt_ns == 0 || l->window_min_ns < l->min_rtt_ns || ++l->windows_since_probe >= GRADIENT_PROBE_WINDOWS) {
+        l->min_rtt_ns = l->window_min_ns > 0 ? l->window_min_ns : 1;
+        l->windows_since_probe = 0;
+    }
+
+    double limit = l->limit;
+    if (atomic_load(&g_algorithm) == LIMIT_ALGORITHM_AIMD) {
+        if (drops > 0 || short_rtt > AIMD_LATENCY_RATIO * long_rtt) {
+            limit *= AIMD_BACKOFF;
+        } else if (demand * 2 >= limiter_capacity(l)) {
+            limit += 1;
+        }
+    } else {
+        // Below half the limit latency says nothing about the limit
+        if (demand * 2 < limiter_capacity(l)) {
+            return;
+        }
+        double gradient = GRADIENT_TOLERANCE * (double)l->min_rtt_ns / short_rtt;
+        gradient = gradient < GRADIENT_MIN ? GRADIENT_MIN : (gradient > 1.0 ? 1.0 : gradient);
+        double target = limit * gradient + sqrt(limit);
+        limit = limit * (1 - GRADIENT_SMOOTHING) + target * GRADIENT_SMOOTHING;
+    }
+    l->limit = clamp_limit(limit);
+}
+
+static limiter_t *route_limiter(int route_index, uint32_t generation) {
+    if (!atomic_load(&g_per_route) || route_index < 0 || route_index >= MAX_ROUTES ||
+        generation != g_route_generation) {
+        return NULL;
+    }
+    return &g_routes[route_index];
+}
+
+static void limiter_enter(limiter_t *l) {
+    l->inflight++;
+    if (l->inflight > l->window_max_inflight) {
+        l->window_max_inflight = l->inflight;
+    }
+}
+
+static void take_slot(limit_token_t *token, limiter_t *route) {
+    token->held = 1;
+    token->dropped = 0;
+    token->start_ns = now_ns();
+    limiter_enter(&g_worker);
+    if (route != NULL) {
+        token->route_held = 1;
+        limiter_enter(route);
+    }
+    publish_state();
+}
+
+// Schedule the queue timer at an absolute CLOCK_MONOTONIC time, 1 fires at once
+static void arm_timer(uint64_t when_ns) {
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = (time_t)(when_ns / 1000000000ULL);
+    spec.it_value.tv_nsec = (long)(when_ns % 1000000000ULL);
+    if (timerfd_settime(g_timer_fd, TFD_TIMER_ABSTIME, &spec, NULL) != 0) {
+        log_warn("Failed to arm concurrency queue timer: %s", strerror(errno));
+    }
+}
+
+static void queue_unlink(limit_waiter_t *waiter) {
+    if (waiter->prev != NULL) {
+        waiter->prev->next = waiter->next;
+    } else {
+        g_queue_head = waiter->next;
+    }
+    if (waiter->next != NULL) {
+        waiter->next->prev = waiter->prev;
+    } else {
+        g_queue_tail = waiter->prev;
+    }
+    waiter->prev = waiter->next = NULL;
+    waiter->queued = 0;
+    g_queue_length--;
+}
+
+static void queue_append(limit_waiter_t *waiter) {
+    waiter->prev = g_queue_tail;
+    waiter->next = NULL;
+    if (g_queue_tail != NULL) {
+        g_queue_tail->next = waiter;
+    } else {
+        g_queue_head = waiter;
+    }
+    g_queue_tail = waiter;
+    waiter->queued = 1;
+    g_queue_length++;
+}
+
+// Admit waiters while there is room, then answer those past their deadline
+static void queue_timer_callback(int fd, void *arg) {
+    (void)arg;
+    uint64_t expirations;
+    if (read(fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+        log_debug("Concurrency queue timer read failed: %s", strerror(errno));
+    }
+    sync_config();
+
+    int enabled = atomic_load(&g_algorithm) != LIMIT_ALGORITHM_OFF;
+    while (g_queue_head != NULL && (!enabled || g_worker.inflight < limiter_capacity(&g_worker))) {
+        limit_waiter_t *waiter = g_queue_head;
+        queue_unlink(waiter);
+
+        // Waiters hold no route slot, a route that filled up meanwhile still turns them away
+        limit_token_t *token = waiter->token;
+        limiter_t *route = enabled ? route_limiter(token->route_index, token->generation) : NULL;
+        if (route != NULL && route->inflight >= limiter_capacity(route)) {
+            atomic_fetch_add_explicit(&g_expired, 1, memory_order_relaxed);
+            publish_state();
+            waiter->expire(waiter->arg);
+            continue;
+        }
+        if (enabled) {
+            take_slot(token, route);
+        } else {
+            publish_state();
+        }
+        waiter->admit(waiter->arg);
+    }
+
+    uint64_t now = now_ns();
+    while (g_queue_head != NULL && g_queue_head->deadline_ns <= now) {
+        limit_waiter_t *waiter = g_queue_head;
+        queue_unlink(waiter);
+        atomic_fetch_add_explicit(&g_expired, 1, memory_order_relaxed);
+        publish_state();
+        waiter->expire(waiter->arg);
+    }
+
+    if (g_queue_head != NULL) {
+        arm_timer(g_queue_head->deadline_ns);
+    }
+}
+
+/**
+ * Start limiting this Worker
+ */
+int adaptive_limit_init(int worker_id, event_loop_t *loop, const config_t *config) {
+    g_worker_id = worker_id;
+    adaptive_limit_configure(config);
+    memset(&g_worker, 0, sizeof(g_worker));
+    sync_config();
+
+    if (atomic_load(&g_algorithm) != LIMIT_ALGORITHM_OFF) {
+        log_info("Worker process %d concurrency limit: %s, %d-%d, initial %d, queue timeout %d ms%s", getpid(),
+                 atomic_load(&g_algorithm) == LIMIT_ALGORITHM_AIMD ? "aimd" : "gradient",
+                 atomic_load(&g_min), atomic_load(&g_max), limiter_capacity(&g_worker),
+                 atomic_load(&g_queue_timeout_ms), atomic_load(&g_per_route) ? ", per route" : "");
+    }
+
+    // Created even when off, a reload may turn queueing on
+    g_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (g_timer_fd < 0) {
+        log_warn("Worker process %d Failed to create concurrency queue timer: %s", getpid(), strerror(errno));
+        return -1;
+    }
+    if (event_loop_add_handler(loop, g_timer_fd, EVENT_READ, queue_timer_callback, NULL, NULL) != 0) {
+        log_warn("Worker process %d Failed to add concurrency queue timer, requests over the limit are rejected", getpid());
+        close(g_timer_fd);
+        g_timer_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Apply limit settings
+ */
+void adaptive_limit_configure(const config_t *config) {
+    int max = config->concurrency_limit_max > 0 ? config->concurrency_limit_max : config->worker_connections;
+    int min = config->concurrency_limit_min < max ? config->concurrency_limit_min : max;
+
+    atomic_store(&g_algorithm, config->concurrency_limit);
+    atomic_store(&g_min, min > 0 ? min : 1);
+    atomic_store(&g_max, max > 0 ? max : 1);
+    atomic_store(&g_queue_timeout_ms, config->concurrency_queue_timeout);
+    atomic_store(&g_per_route, config->concurrency_limit_per_route);
+    atomic_fetch_add(&g_config_generation, 1);
+}
+
+/**
+ * Take a slot for a routed request
+ */
+limit_decision_t adaptive_limit_acquire(int route_index, limit_token_t *token, limit_waiter_t *waiter) {
+    if (atomic_load_explicit(&g_algorithm, memory_order_relaxed) == LIMIT_ALGORITHM_OFF) {
+        return LIMIT_ADMITTED;
+    }
+    sync_config();
+
+    memset(token, 0, sizeof(*token));
+    token->route_index = route_index;
+    token->generation = g_route_generation;
+
+    // A full route answers at once, queueing only covers the Worker limit
+    limiter_t *route = route_limiter(route_index, g_route_generation);
+    if (route != NULL && route->inflight >= limiter_capacity(route)) {
+        atomic_fetch_add_explicit(&g_rejected, 1, memory_order_relaxed);
+        return LIMIT_REJECTED;
+    }
+
+    // Earlier waiters go first
+    if (g_worker.inflight < limiter_capacity(&g_worker) && g_queue_head == NULL) {
+        take_slot(token, route);
+        return LIMIT_ADMITTED;
+    }
+
+    int timeout_ms = atomic_load(&g_queue_timeout_ms);
+    if (waiter != NULL && timeout_ms > 0 && g_timer_fd >= 0 && g_queue_length < limiter_capacity(&g_worker)) {
+        waiter->token = token;
+        waiter->deadline_ns = now_ns() + (uint64_t)timeout_ms * 1000000ULL;
+        queue_append(waiter);
+        if (g_queue_head == waiter) {
+            arm_timer(waiter->deadline_ns);
+        }
+        atomic_fetch_add_explicit(&g_queued, 1, memory_order_relaxed);
+        publish_state();
+        return LIMIT_QUEUED;
+    }
+
+    atomic_fetch_add_explicit(&g_rejected, 1, memory_order_relaxed);
+    return LIMIT_REJECTED;
+}
+
+/**
+ * Return a slot and learn from the request latency
+ */
+void adaptive_limit_release(limit_token_t *token) {
+    if (!token->held) {
+        return;
+    }
+    sync_config();
+
+    uint64_t rtt_ns = now_ns() - token->start_ns;
+    if (g_worker.inflight > 0) {
+        g_worker.inflight--;
+    }
+    limiter_sample(&g_worker, rtt_ns, token->dropped);
+
+    limiter_t *route = token->route_held ? route_limiter(token->route_index, token->generation) : NULL;
+    if (route != NULL) {
+        if (route->inflight > 0) {
+            route->inflight--;
+        }
+        limiter_sample(route, rtt_ns, token->dropped);
+    }
+    memset(token, 0, sizeof(*token));
+    publish_state();
+
+    // Admitted from the timer rather than here, the completion may be running deep in a request
+    if (g_queue_head != NULL) {
+        arm_timer(1);
+    }
+}
+
+/**
+ * Drop a waiter whose connection is going away
+ */
+void adaptive_limit_cancel(limit_waiter_t *waiter) {
+    if (!waiter->queued) {
+        return;
+    }
+    queue_unlink(waiter);
+    if (g_queue_head == NULL && g_timer_fd >= 0) {
+        struct itimerspec disarm;
+        memset(&disarm, 0, sizeof(disarm));
+        timerfd_settime(g_timer_fd, 0, &disarm, NULL);
+    }
+    publish_state();
+}
+
+/**
+ * Publish the limit and counters
+ */
+void adaptive_limit_publish(void) {
+    if (g_worker_id < 0) {
+        return;
+    }
+    update_worker_limit_stats(g_worker_id, atomic_load_explicit(&g_pub_limit, memory_order_relaxed),
+                              atomic_load_explicit(&g_pub_inflight, memory_order_relaxed),
+                              atomic_load_explicit(&g_pub_waiting, memory_order_relaxed),
+                              atomic_load(&g_rejected), atomic_load(&g_queued), atomic_load(&g_expired));
+}
+
+/**
+ * Stop limiting and report the totals
+ */
+void adaptive_limit_stop(void) {
+    if (g_worker_id < 0) {
+        return;
+    }
+
+    adaptive_limit_publish();
+    if (g_timer_fd >= 0) {
+        close(g_timer_fd);
+        g_timer_fd = -1;
+    }
+
+    uint64_t rejected = atomic_load(&g_rejected);
+    uint64_t queued = atomic_load(&g_queued);
+    uint64_t expired = atomic_load(&g_expired);
+    if (rejected > 0 || queued > 0) {
+        log_info("Worker process %d concurrency limit: final limit %d, %lu rejected, %lu queued, %lu expired in queue",
+                 getpid(), limiter_capacity(&g_worker), (unsigned long)rejected, (unsigned long)queued,
+                 (unsigned long)expired);
+    }
+    g_worker_id = -1;
+}
@@ -0,0 +1,957 @@
+/**
+ * Admin Socket Module Implementation
+ * Line-based command interface served by the Master on a Unix-domain socket
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+
+#include "../include/admin_socket.h"
+#include "../include/master_process.h"
+#include "../include/shared_memory.h"
+#include "../include/logger.h"
+
+// How long a command waits for all Workers to acknowledge
+#define ADMIN_RELAY_TIMEOUT_MS 2000
+
+// How often a command waiting for Workers checks their acknowledgements
+#define ADMIN_RELAY_POLL_MS 10
+
+// How long a client may take to send its command
+#define ADMIN_READ_TIMEOUT_MS 1000
+
+// How long a client may take to read its response
+#define ADMIN_WRITE_TIMEOUT_MS 1000
+
+// Most clients connected at once, further connections are closed unanswered
+#define ADMIN_MAX_CLIENTS 64
+
+// Most Workers a single command is relayed to
+#define ADMIN_RELAY_MAX 32
+
+// Worker acknowledgements a relayed command waits for
+typedef struct admin_relay {
+    worker_command_t command;
+    int count;
+    int ids[ADMIN_RELAY_MAX];
+    pid_t pids[ADMIN_RELAY_MAX];
+    uint32_t seqs[ADMIN_RELAY_MAX];
+    int acked[ADMIN_RELAY_MAX];
+    int results[ADMIN_RELAY_MAX];
+    uint64_t deadline;
+} admin_relay_t;
+
+// Response buffer with bounded appends
+typedef struct admin_output {
+    char *data;
+    size_t size;
+    size_t len;
+    admin_relay_t *relay;       // Acks are recorded here and reported later; NULL waits for them in place
+} admin_output_t;
+
+// Where a client is: reading and writing clients are on the I/O list and watched by the
+// Master epoll, queued ones wait their turn to run
+typedef enum {
+    ADMIN_CLIENT_READING,
+    ADMIN_CLIENT_QUEUED,
+    ADMIN_CLIENT_WRITING
+} admin_client_state_t;
+
+// Admin client whose command is queued or waiting for Workers. Commands run one at a time in
+// arrival order: posting a newer command would overwrite a Worker mailbox still in flight.
+typedef struct admin_client {
+    int fd;
+    admin_client_state_t state;
+    int watched;                // Registered in the Master epoll
+    uint64_t deadline;          // Read or write deadline, enforced by the relay timer
+    char command[ADMIN_COMMAND_MAX_LEN];
+    size_t command_len;
+    size_t written;
+    admin_output_t out;
+    admin_relay_t relay;
+    struct admin_client *next;
+} admin_client_t;
+
+static int g_admin_fd = -1;
+static char g_admin_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+
+// Polls the acknowledgements of the command at the head of the queue from the Master event loop
+static int g_relay_timer_fd = -1;
+static admin_client_t *g_clients = NULL;
+static admin_client_t *g_clients_tail = NULL;
+static int g_relay_waiting = 0;
+static int g_timer_armed = 0;
+
+// Clients reading their command or writing their response
+static admin_client_t *g_io_clients = NULL;
+static int g_client_count = 0;
+
+// Registers client descriptors in the Master event loop
+static admin_watch_fn g_watch = NULL;
+
+static void out_printf(admin_output_t *out, const char *format, ...) {
+    if (out->len + 1 >= out->size) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(out->data + out->len, out->size - out->len, format, args);
+    va_end(args);
+
+    if (n > 0) {
+        out->len += (size_t)n < out->size - out->len ? (size_t)n : out->size - out->len - 1;
+    }
+}
+
+static uint64_t admin_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+}
+
+/**
+ * Create and listen on the admin socket
+ */
+int admin_socket_open(const char *path) {
+    struct sockaddr_un addr;
+
+    if (path == NULL || path[0] == '\0') {
+        return -1;
+    }
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        log_error("Admin socket path too long: %s", path);
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        log_error("Failed to create admin socket: %s", strerror(errno));
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+    // A stale socket file from a crashed instance would make bind fail
+    unlink(path);
+
+    // Only the owner may connect, admin commands can drain workers
+    mode_t old_umask = umask(0177);
+    int ret = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(old_umask);
+
+    if (ret < 0) {
+        log_error("Failed to bind admin socket %s: %s", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    if (listen(fd, 16) < 0) {
+        log_error("Failed to listen on admin socket %s: %s", path, strerror(errno));
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+
+    g_relay_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (g_relay_timer_fd < 0) {
+        log_error("Failed to create admin relay timer: %s", strerror(errno));
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+
+    g_admin_fd = fd;
+    strncpy(g_admin_path, path, sizeof(g_admin_path) - 1);
+    log_info("Admin socket listening on %s", path);
+    return 0;
+}
+
+// Drop all clients without an answer, their connections just close. Nothing is removed from
+// the epoll set: in a Worker it is still the Master's, in the Master it is already closed.
+static void drop_clients(void) {
+    admin_client_t *lists[2] = {g_clients, g_io_clients};
+
+    for (int i = 0; i < 2; i++) {
+        while (lists[i] != NULL) {
+            admin_client_t *client = lists[i];
+            lists[i] = client->next;
+            close(client->fd);
+            free(client->out.data);
+            free(client);
+        }
+    }
+    g_clients = NULL;
+    g_clients_tail = NULL;
+    g_io_clients = NULL;
+    g_client_count = 0;
+    g_relay_waiting = 0;
+    g_timer_armed = 0;
+
+    if (g_relay_timer_fd >= 0) {
+        close(g_relay_timer_fd);
+        g_relay_timer_fd = -1;
+    }
+}
+
+/**
+ * Close the admin socket and remove its file
+ */
+void admin_socket_close(void) {
+    if (g_admin_fd < 0) {
+        return;
+    }
+
+    drop_clients();
+    close(g_admin_fd);
+    g_admin_fd = -1;
+    unlink(g_admin_path);
+    g_admin_path[0] = '\0';
+}
+
+/**
+ * Close the descriptors inherited by a Worker, leaving the file to the Master
+ */
+void admin_socket_close_inherited(void) {
+    // A client held open by a Worker would never see the Master's answer end
+    drop_clients();
+    if (g_admin_fd >= 0) {
+        close(g_admin_fd);
+        g_admin_fd = -1;
+    }
+}
+
+// Check the outstanding acknowledgements without waiting, 1 once all have arrived
+static int relay_poll(admin_relay_t *relay) {
+    int pending = 0;
+
+    for (int i = 0; i < relay->count; i++) {
+        if (!relay->acked[i]) {
+            relay->acked[i] = wait_worker_command(relay->ids[i], relay->seqs[i], 0, &relay->results[i]) == 0;
+            pending += !relay->acked[i];
+        }
+    }
+    return pending == 0;
+}
+
+// Report each Worker's acknowledgement, or its timeout
+static void relay_report(admin_output_t *out, const admin_relay_t *relay) {
+    for (int i = 0; i < relay->count; i++) {
+        if (!relay->acked[i]) {
+            out_printf(out, "worker %d pid=%d: timeout\n", relay->ids[i], relay->pids[i]);
+        } else if (relay->results[i] < 0) {
+            out_printf(out, "worker %d pid=%d: failed\n", relay->ids[i], relay->pids[i]);
+        } else if (relay->command == WORKER_CMD_CACHE_DUMP) {
+            out_printf(out, "worker %d pid=%d: %d entries written to log\n", relay->ids[i], relay->pids[i],
+                       relay->results[i]);
+        } else if (relay->command == WORKER_CMD_DRAIN) {
+            log_info("Admin socket: draining Worker %d (PID %d)", relay->ids[i], relay->pids[i]);
+            out_printf(out, "worker %d pid=%d: draining, a replacement starts after it exits\n",
+                       relay->ids[i], relay->pids[i]);
+        } else {
+            out_printf(out, "worker %d pid=%d: ok\n", relay->ids[i], relay->pids[i]);
+        }
+    }
+}
+
+// Post a command to one Worker, or every live Worker when worker_id is -1
+static void relay_to_workers(admin_output_t *out, worker_command_t command, int arg, int worker_id) {
+    master_context_t *ctx = get_master_context();
+    admin_relay_t local;
+    admin_relay_t *relay = out->relay != NULL ? out->relay : &local;
+
+    memset(relay, 0, sizeof(*relay));
+    relay->command = command;
+
+    for (worker_process_t *w = ctx->workers; w != NULL && relay->count < ADMIN_RELAY_MAX; w = w->next) {
+        if (worker_id >= 0 && w->worker_id != worker_id) {
+            continue;
+        }
+        if (post_worker_command(w->worker_id, command, arg, &relay->seqs[relay->count]) == 0) {
+            relay->ids[relay->count] = w->worker_id;
+            relay->pids[relay->count] = w->pid;
+            relay->count++;
+        } else {
+            out_printf(out, "worker %d pid=%d: post failed\n", w->worker_id, w->pid);
+        }
+    }
+    relay->deadline = admin_now_ms() + ADMIN_RELAY_TIMEOUT_MS;
+
+    // The admin socket reports once the acks are in; a direct caller has no loop to come back to
+    if (out->relay == NULL) {
+        while (!relay_poll(relay) && admin_now_ms() < relay->deadline) {
+            usleep(ADMIN_RELAY_POLL_MS * 1000);
+        }
+        relay_report(out, relay);
+    }
+}
+
+static void cmd_help(admin_output_t *out) {
+    out_printf(out,
+               "help                               show this list\n"
+               "stats                              aggregated server statistics\n"
+               "workers                            list workers with event loop lag\n"
+               "cache dump|clear                   dump file cache to worker logs, or clear it\n"
+               "locks                              per-lock contention of the workers while lock_profiling is on\n"
+               "alloc reset                        restart the per-request allocation counts of the workers\n"
+               "log_level <debug|info|warn|error>  change log level of master and workers\n"
+               "set <name> <on|off>                toggle lock_profiling, alloc_accounting or route_cpu_stats\n"
+               "drain <worker_id>                  stop accepting, finish connections, exit and respawn\n");
+}
+
+static void cmd_stats(admin_output_t *out) {
+    master_context_t *ctx = get_master_context();
+    shared_stats_t *stats = malloc(sizeof(shared_stats_t));
+
+    if (stats == NULL || copy_shared_stats(stats) != 0) {
+        free(stats);
+        out_printf(out, "error: shared statistics unavailable\n");
+        return;
+    }
+
+    int live = 0;
+    for (worker_process_t *w = ctx->workers; w != NULL; w = w->next) {
+        live++;
+    }
+
+    out_printf(out, "uptime_sec %ld\n", (long)(time(NULL) - ctx->start_time));
+    out_printf(out, "workers %d/%d\n", live, ctx->worker_count);
+    out_printf(out, "workers_spawned %d\n", ctx->total_workers_spawned);
+    out_printf(out, "config_reloads %d\n", ctx->config_reload_count);
+    out_printf(out, "hung_workers_replaced %d\n", ctx->hung_workers_replaced);
+    out_printf(out, "workers_scaled_up %d\n", ctx->workers_scaled_up);
+    out_printf(out, "workers_scaled_down %d\n", ctx->workers_scaled_down);
+    out_printf(out, "log_level %d\n", logger_get_level());
+    out_printf(out, "requests %lu\n", stats->total_requests);
+    out_printf(out, "bytes_sent %lu\n", stats->total_bytes_sent);
+    out_printf(out, "bytes_received %lu\n", stats->total_bytes_received);
+    out_printf(out, "active_connections %u\n", stats->active_connections);
+    // PSI flags the Master published, reactions are counted per Worker in "workers"
+    static const char *pressure_names[PRESSURE_KINDS] = {"memory", "cpu", "io", "critical"};
+    char flags[64] = "";
+    for (int i = 0; i < PRESSURE_KINDS; i++) {
+        if (stats->pressure.flags & (1U << i)) {
+            size_t len = strlen(flags);
+            snprintf(flags + len, sizeof(flags) - len, "%s%s", len ? "," : "", pressure_names[i]);
+        }
+    }
+    out_printf(out, "pressure flags=%s memory_some=%.2f memory_full=%.2f cpu_some=%.2f io_some=%.2f\n",
+               flags[0] ? flags : "none", stats->pressure.memory_some, stats->pressure.memory_full,
+               stats->pressure.cpu_some, stats->pressure.io_some);
+    out_printf(out, "pressure_raised memory=%lu cpu=%lu io=%lu critical=%lu\n",
+               stats->pressure.raised[0], stats->pressure.raised[1],
+               stats->pressure.raised[2], stats->pressure.raised[3]);
+
+    // Per-route CPU cost summed over live Workers
+    for (int slot = 0; slot < ROUTE_STATS_SLOTS; slot++) {
+        uint64_t requests = 0, cpu_ns = 0;
+        for (worker_process_t *w = ctx->workers; w != NULL; w = w->next) {
+            requests += stats->workers[w->worker_id].route_requests[slot];
+            cpu_ns += stats->workers[w->worker_id].route_cpu_ns[slot];
+        }
+        if (requests == 0) {
+            continue;
+        }
+
+        const char *name = slot == ROUTE_STATS_UNMATCHED ? "(unmatched)" :
+                           slot < ctx->config->route_count ? ctx->config->routes[slot].path_prefix : "(removed)";
+        out_printf(out, "route %s requests=%lu cpu_seconds=%.6f cpu_us_per_request=%.1f\n",
+                   name, requests, (double)cpu_ns / 1e9, (double)cpu_ns / 1e3 / (double)requests);
+    }
+
+    // Allocation rates averaged over Workers that publish them
+    for (int tag = 0; tag < ALLOC_TAG_MAX; tag++) {
+        double allocs = 0, bytes = 0;
+        int64_t live_bytes = 0;
+        int reporting = 0;
+        for (worker_process_t *w = ctx->workers; w != NULL; w = w->next) {
+            if (stats->workers[w->worker_id].allocs_per_request[tag] > 0 ||
+                stats->workers[w->worker_id].alloc_live_bytes[tag] != 0) {
+                allocs += stats->workers[w->worker_id].allocs_per_request[tag];
+                bytes += stats->workers[w->worker_id].alloc_bytes_per_request[tag];
+                live_bytes += stats->workers[w->worker_id].alloc_live_bytes[tag];
+                reporting++;
+            }
+        }
+        if (reporting == 0) {
+            continue;
+        }
+        out_printf(out, "alloc %s allocs_per_request=%.2f bytes_per_request=%.1f live_bytes=%ld\n",
+                   alloc_tag_name((alloc_tag_t)tag), allocs / reporting, bytes / reporting, (long)live_bytes);
+    }
+
+    free(stats);
+}
+
+static void cmd_workers(admin_output_t *out) {
+    master_context_t *ctx = get_master_context();
+    shared_stats_t *stats = malloc(sizeof(shared_stats_t));
+
+    if (stats == NULL || copy_shared_stats(stats) != 0) {
+        free(stats);
+        out_printf(out, "error: shared statistics unavailable\n");
+        return;
+    }
+
+    time_t now = time(NULL);
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t now_ms = (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+    for (worker_process_t *w = ctx->workers; w != NULL; w = w->next) {
+        int id = w->worker_id;
+        out_printf(out, "worker %d pid=%d state=%s uptime_sec=%ld requests=%lu active_connections=%u "
+                   "loop_lag_ms=%.3f loop_lag_peak_ms=%.3f ipc=%.2f stats_age_sec=%ld heartbeat_age_ms=%ld "
+                   "loop_utilization=%.2f pressure_reactions=%lu shed_requests=%lu concurrency_limit=%u inflight=%u "
+                   "waiting=%u limit_rejected=%lu limit_queued=%lu limit_expired=%lu\n",
+                   id, w->pid, w->kill_time ? "hung" : w->retiring ? "retiring" :
+                   stats->workers[id].draining ? "draining" : "running",
+                   (long)(now - w->start_time), stats->workers[id].requests,
+                   stats->workers[id].active_connections,
+                   (double)stats->workers[id].loop_lag_us / 1e3,
+                   (double)stats->workers[id].loop_lag_peak_us / 1e3,
+                   stats->workers[id].ipc,
+                   stats->workers[id].last_update ? (long)(now - stats->workers[id].last_update) : -1L,
+                   stats->workers[id].heartbeat_ms ? (long)(now_ms - stats->workers[id].heartbeat_ms) : -1L,
+                   stats->workers[id].loop_utilization,
+                   stats->workers[id].pressure_reactions, stats->workers[id].shed_requests,
+                   stats->workers[id].concurrency_limit, stats->workers[id].concurrency_inflight,
+                   stats->workers[id].concurrency_waiting, stats->workers[id].limit_rejected,
+                   stats->workers[id].limit_queued, stats->workers[id].limit_expired);
+    }
+
+    free(stats);
+}
+
+static void cmd_locks(admin_output_t *out) {
+    master_context_t *ctx = get_master_context();
+    shared_stats_t *stats = malloc(sizeof(shared_stats_t));
+
+    if (stats == NULL || copy_shared_stats(stats) != 0) {
+        free(stats);
+        out_printf(out, "error: shared statistics unavailable\n");
+        return;
+    }
+
+    // Counters are cumulative since the Worker started, published once per second
+    int printed = 0;
+    for (worker_process_t *w = ctx->workers; w != NULL; w = w->next) {
+        int id = w->worker_id;
+        uint32_t count = stats->workers[id].lock_count;
+        if (count > SHM_LOCK_SLOTS) {
+            count = SHM_LOCK_SLOTS;
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            const shared_lock_stats_t *l = &stats->workers[id].locks[i];
+            if (l->acquisitions == 0) {
+                continue;
+            }
+            out_printf(out, "worker %d pid=%d lock %.*s acq=%lu contended=%lu (%.2f%%) "
+                       "wait[avg=%luns p50<=%luns p99<=%luns max=%luns] "
+                       "hold[avg=%luns p50<=%luns p99<=%luns max=%luns]\n",
+                       id, w->pid, LOCK_PROFILER_NAME_LEN, l->name, l->acquisitions, l->contended,
+                       (double)l->contended * 100.0 / (double)l->acquisitions,
+                       l->wait_avg_ns, l->wait_p50_ns, l->wait_p99_ns, l->wait_max_ns,
+                       l->hold_avg_ns, l->hold_p50_ns, l->hold_p99_ns, l->hold_max_ns);
+            printed++;
+        }
+    }
+    if (printed == 0 && ctx->config->worker_single_thread) {
+        out_printf(out, "no lock statistics, internal locks are disabled by worker_single_thread\n");
+    } else if (printed == 0) {
+        out_printf(out, "no lock statistics, enable them with: set lock_profiling on\n");
+    }
+
+    free(stats);
+}
+
+static void cmd_cache(admin_output_t *out, const char *action) {
+    if (action != NULL && strcmp(action, "dump") == 0) {
+        relay_to_workers(out, WORKER_CMD_CACHE_DUMP, 0, -1);
+    } else if (action != NULL && strcmp(action, "clear") == 0) {
+        relay_to_workers(out, WORKER_CMD_CACHE_CLEAR, 0, -1);
+    } else {
+        out_printf(out, "error: usage: cache dump|clear\n");
+    }
+}
+
+static void cmd_alloc(admin_output_t *out, const char *action) {
+    if (action != NULL && strcmp(action, "reset") == 0) {
+        relay_to_workers(out, WORKER_CMD_ALLOC_RESET, 0, -1);
+    } else {
+        out_printf(out, "error: usage: alloc reset\n");
+    }
+}
+
+static void cmd_log_level(admin_output_t *out, const char *value) {
+    static const char *names[] = {"debug", "info", "warn", "error"};
+    int level = -1;
+
+    if (value != NULL) {
+        for (int i = 0; i < 4; i++) {
+            if (strcasecmp(value, names[i]) == 0) {
+                level = i;
+            }
+        }
+        if (level < 0 && value[0] >= '0' && value[0] <= '3' && value[1] == '\0') {
+            level = value[0] - '0';
+        }
+    }
+
+    if (level < 0) {
+        out_printf(out, "error: usage: log_level debug|info|warn|error\n");
+        return;
+    }
+
+    logger_set_level(level);
+    log_warn("Admin socket: log level set to %s", names[level]);
+    out_printf(out, "master: ok\n");
+    relay_to_workers(out, WORKER_CMD_SET_LOG_LEVEL, level, -1);
+}
+
+static void cmd_set(admin_output_t *out, const char *name, const char *value) {
+    int diagnostic;
+
+    if (name == NULL || value == NULL || (strcmp(value, "on") != 0 && strcmp(value, "off") != 0)) {
+        out_printf(out, "error: usage: set lock_profiling|alloc_accounting|route_cpu_stats on|off\n");
+        return;
+    }
+
+    if (strcmp(name, "lock_profiling") == 0) {
+        diagnostic = WORKER_DIAG_LOCK_PROFILING;
+    } else if (strcmp(name, "alloc_accounting") == 0) {
+        diagnostic = WORKER_DIAG_ALLOC_ACCOUNTING;
+    } else if (strcmp(name, "route_cpu_stats") == 0) {
+        diagnostic = WORKER_DIAG_ROUTE_CPU_STATS;
+    } else {
+        out_printf(out, "error: unknown setting %s\n", name);
+        return;
+    }
+
+    int enabled = strcmp(value, "on") == 0;
+    log_info("Admin socket: %s set to %s until next reload", name, value);
+    relay_to_workers(out, WORKER_CMD_SET_DIAGNOSTIC, (enabled << 8) | diagnostic, -1);
+}
+
+static void cmd_drain(admin_output_t *out, const char *value) {
+    master_context_t *ctx = get_master_context();
+    char *end = NULL;
+    long id = value ? strtol(value, &end, 10) : -1;
+
+    if (value == NULL || *end != '\0' || id < 0) {
+        out_printf(out, "error: usage: drain <worker_id>\n");
+        return;
+    }
+
+    for (worker_process_t *w = ctx->workers; w != NULL; w = w->next) {
+        if (w->worker_id == id) {
+            relay_to_workers(out, WORKER_CMD_DRAIN, 0, w->worker_id);
+            return;
+        }
+    }
+
+    out_printf(out, "error: no worker with id %ld\n", id);
+}
+
+// Run one command into out; relayed commands leave their acks in out->relay when it is set
+static void execute_command(admin_output_t *out, const char *command) {
+    char line[ADMIN_COMMAND_MAX_LEN];
+    char *save = NULL;
+
+    strncpy(line, command ? command : "", sizeof(line) - 1);
+    line[sizeof(line) - 1] = '\0';
+
+    char *verb = strtok_r(line, " \t\r\n", &save);
+    char *arg1 = verb ? strtok_r(NULL, " \t\r\n", &save) : NULL;
+    char *arg2 = arg1 ? strtok_r(NULL, " \t\r\n", &save) : NULL;
+
+    if (verb == NULL || strcmp(verb, "help") == 0) {
+        cmd_help(out);
+    } else if (strcmp(verb, "stats") == 0) {
+        cmd_stats(out);
+    } else if (strcmp(verb, "workers") == 0) {
+        cmd_workers(out);
+    } else if (strcmp(verb, "locks") == 0) {
+        cmd_locks(out);
+    } else if (strcmp(verb, "cache") == 0) {
+        cmd_cache(out, arg1);
+    } else if (strcmp(verb, "alloc") == 0) {
+        cmd_alloc(out, arg1);
+    } else if (strcmp(verb, "log_level") == 0) {
+        cmd_log_level(out, arg1);
+    } else if (strcmp(verb, "set") == 0) {
+        cmd_set(out, arg1, arg2);
+    } else if (strcmp(verb, "drain") == 0) {
+        cmd_drain(out, arg1);
+    } else {
+        out_printf(out, "error: unknown command %s, try help\n", verb);
+    }
+}
+
+/**
+ * Execute one admin command, waiting in place for any Worker acknowledgements
+ */
+size_t admin_execute_command(const char *command, char *response, size_t size) {
+    admin_output_t out = {response, size, 0, NULL};
+
+    if (response == NULL || size == 0) {
+        return 0;
+    }
+    response[0] = '\0';
+
+    execute_command(&out, command);
+    return out.len;
+}
+
+// Arm the relay timer while a command waits for Workers or a client has a deadline
+static void update_timer(void) {
+    int want = g_relay_waiting || g_io_clients != NULL;
+    if (want == g_timer_armed) {
+        return;
+    }
+
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (want) {
+        spec.it_interval.tv_nsec = ADMIN_RELAY_POLL_MS * 1000000L;
+        spec.it_value = spec.it_interval;
+    }
+    if (timerfd_settime(g_relay_timer_fd, 0, &spec, NULL) == 0) {
+        g_timer_armed = want;
+    }
+}
+
+// Change the client's Master epoll registration, events 0 removes it
+static int watch_client(admin_client_t *client, uint32_t events) {
+    int op = events == 0 ? EPOLL_CTL_DEL : client->watched ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+
+    if ((events == 0 && !client->watched) || g_watch == NULL) {
+        return events == 0 ? 0 : -1;
+    }
+    if (g_watch(op, client->fd, events) != 0) {
+        return -1;
+    }
+    client->watched = events != 0;
+    return 0;
+}
+
+static void unlink_io_client(admin_client_t *client) {
+    for (admin_client_t **p = &g_io_clients; *p != NULL; p = &(*p)->next) {
+        if (*p == client) {
+            *p = client->next;
+            client->next = NULL;
+            return;
+        }
+    }
+}
+
+// Close a client on the I/O list
+static void free_io_client(admin_client_t *client) {
+    unlink_io_client(client);
+    watch_client(client, 0);
+    close(client->fd);
+    free(client->out.data);
+    free(client);
+    g_client_count--;
+}
+
+// Send what the socket takes without blocking, the rest goes out on EPOLLOUT
+static void client_write(admin_client_t *client) {
+    while (client->written < client->out.len) {
+        ssize_t n = write(client->fd, client->out.data + client->written, client->out.len - client->written);
+        if (n > 0) {
+            client->written += (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && watch_client(client, EPOLLOUT) == 0) {
+            return;
+        }
+        break;
+    }
+
+    free_io_client(client);
+}
+
+// Move the answered client from the queue to the I/O list and start sending its response
+static void finish_client(admin_client_t *client) {
+    relay_report(&client->out, &client->relay);
+
+    client->state = ADMIN_CLIENT_WRITING;
+    client->deadline = admin_now_ms() + ADMIN_WRITE_TIMEOUT_MS;
+    client->next = g_io_clients;
+    g_io_clients = client;
+    client_write(client);
+}
+
+// Run queued commands in order until one has to wait for Workers
+static void run_clients(void) {
+    g_relay_waiting = 0;
+
+    while (g_clients != NULL) {
+        admin_client_t *client = g_clients;
+
+        if (client->out.data == NULL) {
+            client->out.data = malloc(ADMIN_RESPONSE_MAX_LEN);
+            if (client->out.data != NULL) {
+                client->out.size = ADMIN_RESPONSE_MAX_LEN;
+                client->out.data[0] = '\0';
+                client->out.relay = &client->relay;
+                execute_command(&client->out, client->command);
+            }
+        }
+
+        if (client->out.data != NULL && !relay_poll(&client->relay) && admin_now_ms() < client->relay.deadline) {
+            g_relay_waiting = 1;
+            break;
+        }
+
+        g_clients = client->next;
+        if (g_clients == NULL) {
+            g_clients_tail = NULL;
+        }
+        client->next = NULL;
+        if (client->out.data != NULL) {
+            finish_client(client);
+        } else {
+            close(client->fd);
+            free(client);
+            g_client_count--;
+        }
+    }
+
+    update_timer();
+}
+
+// The command line is complete: queue it behind a command still waiting for Workers
+static void queue_client(admin_client_t *client) {
+    unlink_io_client(client);
+    watch_client(client, 0);
+    client->command[client->command_len] = '\0';
+    client->state = ADMIN_CLIENT_QUEUED;
+
+    int idle = g_clients == NULL;
+    if (g_clients_tail != NULL) {
+        g_clients_tail->next = client;
+    } else {
+        g_clients = client;
+    }
+    g_clients_tail = client;
+    if (idle) {
+        run_clients();
+    }
+}
+
+// Read what has arrived of the command line, it ends at a newline, EOF or a full buffer
+static void client_read(admin_client_t *client) {
+    size_t size = sizeof(client->command) - 1;
+
+    while (client->command_len < size && memchr(client->command, '\n', client->command_len) == NULL) {
+        ssize_t n = read(client->fd, client->command + client->command_len, size - client->command_len);
+        if (n > 0) {
+            client->command_len += (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        if (n < 0) {
+            free_io_client(client);
+            return;
+        }
+        break;
+    }
+
+    queue_client(client);
+}
+
+/**
+ * Listening descriptor for the Master event loop
+ */
+int admin_socket_fd(void) {
+    return g_admin_fd;
+}
+
+/**
+ * Set how client descriptors are registered in the Master event loop
+ */
+void admin_socket_set_watch(admin_watch_fn watch) {
+    g_watch = watch;
+}
+
+/**
+ * Accept the admin clients waiting on the listening socket, their commands are read from the event loop
+ */
+void admin_socket_accept(void) {
+    int rejected = 0;
+
+    if (g_admin_fd < 0) {
+        return;
+    }
+
+    for (;;) {
+        int client_fd = accept4(g_admin_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                log_warn("Admin socket accept failed: %s", strerror(errno));
+            }
+            break;
+        }
+
+        if (g_client_count >= ADMIN_MAX_CLIENTS) {
+            close(client_fd);
+            rejected++;
+            continue;
+        }
+
+        admin_client_t *client = calloc(1, sizeof(admin_client_t));
+        if (client == NULL) {
+            close(client_fd);
+            continue;
+        }
+        client->fd = client_fd;
+        client->state = ADMIN_CLIENT_READING;
+        client->deadline = admin_now_ms() + ADMIN_READ_TIMEOUT_MS;
+        if (watch_client(client, EPOLLIN) != 0) {
+            close(client_fd);
+            free(client);
+            continue;
+        }
+        client->next = g_io_clients;
+        g_io_clients = client;
+        g_client_count++;
+    }
+
+    if (rejected > 0) {
+        log_warn("Admin socket: %d clients connected, closed %d new connections", g_client_count, rejected);
+    }
+    update_timer();
+}
+
+/**
+ * Read a client's command or send its response, whichever it is waiting for
+ */
+void admin_socket_client_event(int fd, uint32_t events) {
+    (void)events;
+
+    for (admin_client_t *client = g_io_clients; client != NULL; client = client->next) {
+        if (client->fd != fd) {
+            continue;
+        }
+        if (client->state == ADMIN_CLIENT_READING) {
+            client_read(client);
+        } else {
+            client_write(client);
+        }
+        break;
+    }
+
+    update_timer();
+}
+
+/**
+ * Relay timer descriptor for the Master event loop
+ */
+int admin_socket_timer_fd(void) {
+    return g_relay_timer_fd;
+}
+
+/**
+ * Enforce client deadlines and answer the command waiting for Workers once their acks are in or its deadline passed
+ */
+void admin_socket_on_timer(void) {
+    uint64_t expirations;
+    while (read(g_relay_timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+    }
+
+    uint64_t now = admin_now_ms();
+    admin_client_t *client = g_io_clients;
+    while (client != NULL) {
+        admin_client_t *next = client->next;
+        if (now >= client->deadline) {
+            if (client->state == ADMIN_CLIENT_READING) {
+                // A slow client gets the command that arrived in time, as a partial line
+                queue_client(client);
+            } else {
+                free_io_client(client);
+            }
+        }
+        client = next;
+    }
+
+    run_clients();
+}
+
+/**
+ * Client side: send a command and print the response
+ */
+int admin_socket_send_command(const char *path, const char *command) {
+    struct sockaddr_un addr;
+
+    if (path == NULL || path[0] == '\0') {
+        fprintf(stderr, "Admin socket is not configured (set admin_socket in the config file)\n");
+        return -1;
+    }
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Admin socket path too long: %s\n", path);
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to create socket: %s\n", strerror(errno));
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        fprintf(stderr, "Failed to connect to admin socket %s: %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    char line[ADMIN_COMMAND_MAX_LEN];
+    int n = snprintf(line, sizeof(line), "%s\n", command);
+    if (n < 0 || (size_t)n >= sizeof(line) || write(fd, line, (size_t)n) != n) {
+        fprintf(stderr, "Failed to send admin command\n");
+        close(fd);
+        return -1;
+    }
+    shutdown(fd, SHUT_WR);
+
+    char buffer[4096];
+    ssize_t r;
+    int is_error = 0;
+    int first = 1;
+    while ((r = read(fd, buffer, sizeof(buffer))) > 0) {
+        if (first && r >= 6 && strncmp(buffer, "error:", 6) == 0) {
+            is_error = 1;
+        }
+        first = 0;
+        fwrite(buffer, 1, (size_t)r, stdout);
+    }
+
+    close(fd);
+    return is_error ? -1 : 0;
+}
@@ -0,0 +1,357 @@
+/**
+ * Allocation Accounting Implementation
+ * Per-subsystem allocation counters, per-request allocation totals and live-bytes gauges
+ */
+
+#define ALLOC_STATS_IMPLEMENTATION
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <pthread.h>
+
+#include "../include/alloc_stats.h"
+#include "../include/logger.h"
+
+// Runtime accounting switch, ignored when built with ALLOC_ACCOUNTING
+atomic_int g_alloc_stats_enabled = 0;
+
+// Per-tag counters, updated with relaxed atomics from any thread
+typedef struct alloc_tag_counters {
+    atomic_uint_fast64_t allocations;
+    atomic_uint_fast64_t frees;
+    atomic_uint_fast64_t bytes_allocated;
+    atomic_int_fast64_t live_bytes;
+    atomic_uint_fast64_t request_allocations;
+    atomic_uint_fast64_t request_bytes;
+} alloc_tag_counters_t;
+
+static alloc_tag_counters_t g_tag_counters[ALLOC_TAG_MAX];
+static atomic_uint_fast64_t g_requests = 0;
+
+// Set while the current thread is handling a request
+static __thread int tls_in_request = 0;
+
+static const char *g_tag_names[ALLOC_TAG_MAX] = {
+    "parser",
+    "proxy",
+    "auth",
+    "fileio",
+    "logger",
+    "connection"
+};
+
+#ifdef ALLOC_ACCOUNTING
+// Owner map of live tagged blocks: a free debits the tag that allocated the block, and blocks
+// from untagged code (realpath, getline) are not debited at all. Buckets share striped locks.
+#define ALLOC_OWNER_BUCKET_BITS 18
+#define ALLOC_OWNER_LOCKS       64
+
+typedef struct alloc_owner {
+    void *ptr;
+    size_t usable;
+    alloc_tag_t tag;
+    struct alloc_owner *next;
+} alloc_owner_t;
+
+static alloc_owner_t *g_owner_buckets[1 << ALLOC_OWNER_BUCKET_BITS];
+static pthread_mutex_t g_owner_locks[ALLOC_OWNER_LOCKS] = {
+    [0 ... ALLOC_OWNER_LOCKS - 1] = PTHREAD_MUTEX_INITIALIZER
+};
+
+static inline size_t owner_bucket(const void *ptr) {
+    return (size_t)(((uintptr_t)ptr >> 4) * 0x9E3779B97F4A7C15ULL >> (64 - ALLOC_OWNER_BUCKET_BITS));
+}
+
+// Remember which tag owns a block; a stale entry left by an untagged free of the same address is reused
+static void owner_insert(void *ptr, alloc_tag_t tag, size_t usable) {
+    size_t bucket = owner_bucket(ptr);
+    pthread_mutex_t *lock = &g_owner_locks[bucket % ALLOC_OWNER_LOCKS];
+
+    pthread_mutex_lock(lock);
+    alloc_owner_t *owner = g_owner_buckets[bucket];
+    while (owner != NULL && owner->ptr != ptr) {
+        owner = owner->next;
+    }
+    if (owner == NULL) {
+        owner = malloc(sizeof(*owner));
+        if (owner == NULL) {
+            pthread_mutex_unlock(lock);
+            return;
+        }
+        owner->ptr = ptr;
+        owner->next = g_owner_buckets[bucket];
+        g_owner_buckets[bucket] = owner;
+    }
+    owner->tag = tag;
+    owner->usable = usable;
+    pthread_mutex_unlock(lock);
+}
+
+// Forget a block, returning 0 when no tagged allocation owns it
+static int owner_remove(void *ptr, alloc_tag_t *tag, size_t *usable) {
+    size_t bucket = owner_bucket(ptr);
+    pthread_mutex_t *lock = &g_owner_locks[bucket % ALLOC_OWNER_LOCKS];
+    alloc_owner_t *owner = NULL;
+
+    pthread_mutex_lock(lock);
+    for (alloc_owner_t **link = &g_owner_buckets[bucket]; *link != NULL; link = &(*link)->next) {
+        if ((*link)->ptr == ptr) {
+            owner = *link;
+            *link = owner->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(lock);
+
+    if (owner == NULL) {
+        return 0;
+    }
+    *tag = owner->tag;
+    *usable = owner->usable;
+    free(owner);
+    return 1;
+}
+
+// Debit a freed block from the tag that allocated it
+static void debit_owner(void *ptr) {
+    alloc_tag_t tag;
+    size_t usable;
+
+    if (owner_remove(ptr, &tag, &usable)) {
+        atomic_fetch_add_explicit(&g_tag_counters[tag].frees, 1, memory_order_relaxed);
+        atomic_fetch_sub_explicit(&g_tag_counters[tag].live_bytes, (int64_t)usable, memory_order_relaxed);
+    }
+}
+#endif
+
+const char *alloc_tag_name(alloc_tag_t tag) {
+    if ((int)tag < 0 || tag >= ALLOC_TAG_MAX) {
+        return "unknown";
+    }
+    return g_tag_names[tag];
+}
+
+// Record a successful allocation of `size` requested bytes
+static inline void record_alloc(alloc_tag_t tag, void *ptr, size_t size) {
+    alloc_tag_counters_t *c = &g_tag_counters[tag];
+
+    atomic_fetch_add_explicit(&c->allocations, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&c->bytes_allocated, size, memory_order_relaxed);
+    if (tls_in_request) {
+        atomic_fetch_add_explicit(&c->request_allocations, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&c->request_bytes, size, memory_order_relaxed);
+    }
+
+#ifdef ALLOC_ACCOUNTING
+    size_t usable = malloc_usable_size(ptr);
+    owner_insert(ptr, tag, usable);
+    atomic_fetch_add_explicit(&c->live_bytes, (int64_t)usable, memory_order_relaxed);
+#else
+    (void)ptr;
+#endif
+}
+
+// Record a free; must be called before the memory is released
+static inline void record_free(alloc_tag_t tag, void *ptr) {
+#ifdef ALLOC_ACCOUNTING
+    // Charged to the allocating tag, not the caller's
+    (void)tag;
+    debit_owner(ptr);
+#else
+    (void)ptr;
+    atomic_fetch_add_explicit(&g_tag_counters[tag].frees, 1, memory_order_relaxed);
+#endif
+}
+
+/**
+ * Tagged malloc
+ */
+void *alloc_stats_malloc(alloc_tag_t tag, size_t size) {
+    void *ptr = malloc(size);
+    if (ptr && ALLOC_STATS_ACTIVE()) {
+        record_alloc(tag, ptr, size);
+    }
+    return ptr;
+}
+
+/**
+ * Tagged calloc
+ */
+void *alloc_stats_calloc(alloc_tag_t tag, size_t count, size_t size) {
+    void *ptr = calloc(count, size);
+    if (ptr && ALLOC_STATS_ACTIVE()) {
+        record_alloc(tag, ptr, count * size);
+    }
+    return ptr;
+}
+
+/**
+ * Tagged realloc, counted as a free of the old block plus a new allocation
+ */
+void *alloc_stats_realloc(alloc_tag_t tag, void *ptr, size_t size) {
+    if (!ALLOC_STATS_ACTIVE()) {
+        return realloc(ptr, size);
+    }
+
+#ifdef ALLOC_ACCOUNTING
+    // Taken out of the owner map first: once realloc moves the block another thread may get its address
+    alloc_tag_t old_tag = tag;
+    size_t old_usable = 0;
+    int owned = ptr ? owner_remove(ptr, &old_tag, &old_usable) : 0;
+#endif
+
+    void *new_ptr = realloc(ptr, size);
+    if (new_ptr == NULL) {
+#ifdef ALLOC_ACCOUNTING
+        if (owned) {
+            owner_insert(ptr, old_tag, old_usable);
+        }
+#endif
+        return NULL;
+    }
+
+#ifdef ALLOC_ACCOUNTING
+    if (owned) {
+        atomic_fetch_add_explicit(&g_tag_counters[old_tag].frees, 1, memory_order_relaxed);
+        atomic_fetch_sub_explicit(&g_tag_counters[old_tag].live_bytes, (int64_t)old_usable, memory_order_relaxed);
+    }
+#else
+    if (ptr) {
+        atomic_fetch_add_explicit(&g_tag_counters[tag].frees, 1, memory_order_relaxed);
+    }
+#endif
+    record_alloc(tag, new_ptr, size);
+    return new_ptr;
+}
+
+/**
+ * Tagged strdup
+ */
+char *alloc_stats_strdup(alloc_tag_t tag, const char *str) {
+    char *copy = strdup(str);
+    if (copy && ALLOC_STATS_ACTIVE()) {
+        record_alloc(tag, copy, strlen(copy) + 1);
+    }
+    return copy;
+}
+
+/**
+ * Tagged free
+ */
+void alloc_stats_free(alloc_tag_t tag, void *ptr) {
+    if (ptr && ALLOC_STATS_ACTIVE()) {
+        record_free(tag, ptr);
+    }
+    free(ptr);
+}
+
+/**
+ * Enable or disable runtime accounting
+ */
+void alloc_stats_enable(int enabled) {
+#ifdef ALLOC_ACCOUNTING
+    (void)enabled;
+    atomic_store(&g_alloc_stats_enabled, 1);
+#else
+    int previous = atomic_exchange(&g_alloc_stats_enabled, enabled ? 1 : 0);
+    if (previous != (enabled ? 1 : 0)) {
+        log_info("Allocation accounting %s", enabled ? "enabled" : "disabled");
+    }
+#endif
+}
+
+/**
+ * Mark the start of request handling on this thread
+ */
+void alloc_stats_request_begin(void) {
+    tls_in_request = ALLOC_STATS_ACTIVE() ? 1 : 0;
+}
+
+/**
+ * Mark the end of request handling on this thread
+ */
+void alloc_stats_request_end(int completed) {
+    if (tls_in_request && completed) {
+        atomic_fetch_add_explicit(&g_requests, 1, memory_order_relaxed);
+    }
+    tls_in_request = 0;
+}
+
+/**
+ * Get statistics snapshot
+ */
+void alloc_stats_get(alloc_stats_snapshot_t *snapshot) {
+    if (snapshot == NULL) {
+        return;
+    }
+
+    memset(snapshot, 0, sizeof(*snapshot));
+    snapshot->enabled = ALLOC_STATS_ACTIVE() ? 1 : 0;
+#ifdef ALLOC_ACCOUNTING
+    snapshot->live_tracking = 1;
+#endif
+    snapshot->requests = atomic_load(&g_requests);
+
+    for (int i = 0; i < ALLOC_TAG_MAX; i++) {
+        alloc_tag_counters_t *c = &g_tag_counters[i];
+        alloc_tag_stats_t *out = &snapshot->tags[i];
+
+        out->allocations = atomic_load(&c->allocations);
+        out->frees = atomic_load(&c->frees);
+        out->bytes_allocated = atomic_load(&c->bytes_allocated);
+        out->live_bytes = atomic_load(&c->live_bytes);
+        out->request_allocations = atomic_load(&c->request_allocations);
+        out->request_bytes = atomic_load(&c->request_bytes);
+        if (snapshot->requests > 0) {
+            out->allocations_per_request = (double)out->request_allocations / (double)snapshot->requests;
+            out->bytes_per_request = (double)out->request_bytes / (double)snapshot->requests;
+        }
+    }
+}
+
+/**
+ * Reset statistics; live bytes are kept since the blocks are still allocated
+ */
+void alloc_stats_reset(void) {
+    for (int i = 0; i < ALLOC_TAG_MAX; i++) {
+        alloc_tag_counters_t *c = &g_tag_counters[i];
+        atomic_store(&c->allocations, 0);
+        atomic_store(&c->frees, 0);
+        atomic_store(&c->bytes_allocated, 0);
+        atomic_store(&c->request_allocations, 0);
+        atomic_store(&c->request_bytes, 0);
+    }
+    atomic_store(&g_requests, 0);
+}
+
+/**
+ * Print allocation statistics
+ */
+void alloc_stats_print(void) {
+    alloc_stats_snapshot_t snapshot;
+
+    if (!ALLOC_STATS_ACTIVE()) {
+        return;
+    }
+
+    // Snapshot first: logging below allocates under the logger tag
+    alloc_stats_get(&snapshot);
+
+    log_info("=== Allocation Statistics (PID %d, %lu requests) ===", getpid(), snapshot.requests);
+    for (int i = 0; i < ALLOC_TAG_MAX; i++) {
+        alloc_tag_stats_t *t = &snapshot.tags[i];
+        if (snapshot.live_tracking) {
+            log_info("%-12s allocs=%lu frees=%lu bytes=%lu per_request[allocs=%.2f bytes=%.1f] live=%ld",
+                     alloc_tag_name((alloc_tag_t)i), t->allocations, t->frees, t->bytes_allocated,
+                     t->allocations_per_request, t->bytes_per_request, (long)t->live_bytes);
+        } else {
+            log_info("%-12s allocs=%lu frees=%lu bytes=%lu per_request[allocs=%.2f bytes=%.1f]",
+                     alloc_tag_name((alloc_tag_t)i), t->allocations, t->frees, t->bytes_allocated,
+                     t->allocations_per_request, t->bytes_per_request);
+        }
+    }
+    log_info("==================================================");
+}
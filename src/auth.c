@@ -11,6 +11,10 @@
 #include "../include/oauth.h"
 #include "../include/logger.h"
 
+// Allocations in this file are accounted to the auth subsystem
+#define ALLOC_TAG ALLOC_TAG_AUTH
+#include "../include/alloc_stats.h"
+
 // Get authentication token from HTTP request
 char *get_auth_token(http_request_t *request) {
     // Try to get token from Authorization header
@@ -47,7 +51,7 @@ char *get_auth_token(http_request_t *request) {
 }
 
 // Validate if request is valid
-int validate_request(http_request_t *request, route_t *route, auth_result_t *result) {
+int validate_request(http_request_t *request, route_t *route, const config_snapshot_t *snapshot, auth_result_t *result) {
     // Initialize authentication result
     result->success = 0;
     strcpy(result->error_message, "");
@@ -62,7 +66,7 @@ int validate_request(http_request_t *request, route_t *route, auth_result_t *res
         case AUTH_OAUTH:
             // Use OAuth authentication
             {
-                int oauth_result = validate_oauth(request, route);
+                int oauth_result = validate_oauth(request, route, snapshot);
                 if (!oauth_result) {
                     const char *error_msg = get_oauth_error_message();
                     strcpy(result->error_message, error_msg);
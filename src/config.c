@@ -12,6 +12,7 @@
 #include <unistd.h>
 
 #include "../include/config.h"
+#include "../include/cpu_affinity.h"
 #include "../include/logger.h"
 
 // Get CPU core count
@@ -69,7 +70,7 @@ static void parse_route_line(const char *line, route_t *route) {
     char *token = strtok(line_copy, " \t");
     int field = 0;
     
-    while (token != NULL && field < 5) {
+    while (token != NULL && field < 6) {
         switch (field) {
             case 0: // Route type
                 if (strcmp(token, "static") == 0) {
@@ -149,6 +150,14 @@ static void parse_route_line(const char *line, route_t *route) {
                 strncpy(route->charset, token, sizeof(route->charset) - 1);
                 route->charset[sizeof(route->charset) - 1] = '\0';
                 break;
+                
+            case 5: // Priority
+                if (strcmp(token, "low") == 0) {
+                    route->priority = ROUTE_PRIORITY_LOW;
+                } else if (strcmp(token, "normal") != 0) {
+                    log_warn("Unknown route priority: %s, using default value normal", token);
+                }
+                break;
         }
         
         token = strtok(NULL, " \t");
@@ -215,6 +224,34 @@ config_t *load_config(const char *filename) {
     config->thread_pool_size = 4;  // 4 threads per process, avoid excessive thread competition
     config->thread_pool_queue_size = 2000;  // Thread pool queue size
     
+    // Diagnostics - lock profiling and hardware counters are off by default
+    config->lock_profiling = 0;
+    config->perf_counters = 0;
+    config->alloc_accounting = 0;
+    config->route_cpu_stats = 0;
+    config->admin_socket[0] = '\0';
+    config->worker_cpu_affinity[0] = '\0';
+    config->worker_watchdog_timeout = 60;  // Above proxy connect + read timeouts, proxying blocks the loop
+    config->worker_scaling = 0;
+    config->worker_scaling_min = 1;
+    config->worker_scaling_max = 0;  // worker_processes
+    config->static_preload_size = 16;  // Small static files served from memory shared by all Workers
+    config->connection_handoff = 0;
+    config->worker_single_thread = 0;
+    config->file_cache_size = 100 * 1024 * 1024;  // 100MB file cache per Worker
+    config->auto_tune = 1;  // Size unset settings to the container's CPU, memory and descriptor limits
+    config->explicit_settings = 0;
+    config->pressure_monitor = 1;  // React to PSI stalls, sheds only routes marked low
+    config->pressure_memory_threshold = 10;
+    config->pressure_cpu_threshold = 50;
+    config->pressure_io_threshold = 30;
+    config->pressure_critical_threshold = 80;
+    config->concurrency_limit = LIMIT_ALGORITHM_OFF;  // worker_connections alone bounds concurrency
+    config->concurrency_limit_min = 4;
+    config->concurrency_limit_max = 0;  // worker_connections
+    config->concurrency_limit_per_route = 0;
+    config->concurrency_queue_timeout = 0;  // Reject over the limit at once
+    
     // Event loop optimization - multi-process 10K concurrency core optimization
     config->event_loop_max_events = 50000;  // 50K events per process, total 500K events
     config->event_loop_timeout = 5;  // Event loop timeout (milliseconds)
@@ -272,7 +309,7 @@ config_t *load_config(const char *filename) {
         
         // Check if it's a route configuration line
         if (strncmp(trimmed, "route ", 6) == 0) {
-            // Parse route configuration: route <type> <path> <target> [auth] [charset]
+            // Parse route configuration: route <type> <path> <target> [auth] [charset] [priority]
             if (config->route_count < MAX_ROUTES) {
                 parse_route_line(trimmed + 6, &config->routes[config->route_count]);
                 config->route_count++;
@@ -296,19 +333,102 @@ config_t *load_config(const char *filename) {
                 config->worker_processes = get_cpu_count();  // Auto-detect CPU core count
             } else {
                 config->worker_processes = atoi(value);
+                config->explicit_settings |= CONFIG_SET_WORKER_PROCESSES;
+            }
+        }
+        else if (strcmp(key, "worker_cpu_affinity") == 0) {
+            // Takes the rest of the line: "auto", "auto <mask>" or one mask per Worker
+            char *rest = semicolon ? NULL : strtok(NULL, ";");
+            int len = snprintf(config->worker_cpu_affinity, sizeof(config->worker_cpu_affinity), "%s%s%s",
+                               value, rest ? " " : "", rest ? rest : "");
+            if (len < 0 || (size_t)len >= sizeof(config->worker_cpu_affinity)) {
+                log_error("worker_cpu_affinity value too long");
+                config->worker_cpu_affinity[0] = '\0';
+            }
+        }
+        else if (strcmp(key, "worker_watchdog_timeout") == 0) {
+            config->worker_watchdog_timeout = atoi(value);
+        }
+        else if (strcmp(key, "worker_scaling") == 0) {
+            config->worker_scaling = (strcmp(value, "on") == 0);
+        }
+        else if (strcmp(key, "worker_scaling_min") == 0) {
+            config->worker_scaling_min = atoi(value);
+        }
+        else if (strcmp(key, "worker_scaling_max") == 0) {
+            config->worker_scaling_max = atoi(value);
+        }
+        else if (strcmp(key, "static_preload_size") == 0) {
+            config->static_preload_size = atoi(value);
+        }
+        else if (strcmp(key, "connection_handoff") == 0) {
+            config->connection_handoff = atoi(value);
+        }
+        else if (strcmp(key, "worker_single_thread") == 0) {
+            config->worker_single_thread = (strcmp(value, "on") == 0);
+        }
+        else if (strcmp(key, "auto_tune") == 0) {
+            config->auto_tune = (strcmp(value, "on") == 0);
+        }
+        else if (strcmp(key, "pressure_monitor") == 0) {
+            config->pressure_monitor = (strcmp(value, "on") == 0);
+        }
+        else if (strcmp(key, "pressure_memory_threshold") == 0) {
+            config->pressure_memory_threshold = atoi(value);
+        }
+        else if (strcmp(key, "pressure_cpu_threshold") == 0) {
+            config->pressure_cpu_threshold = atoi(value);
+        }
+        else if (strcmp(key, "pressure_io_threshold") == 0) {
+            config->pressure_io_threshold = atoi(value);
+        }
+        else if (strcmp(key, "pressure_critical_threshold") == 0) {
+            config->pressure_critical_threshold = atoi(value);
+        }
+        else if (strcmp(key, "concurrency_limit") == 0) {
+            if (strcmp(value, "gradient") == 0) {
+                config->concurrency_limit = LIMIT_ALGORITHM_GRADIENT;
+            } else if (strcmp(value, "aimd") == 0) {
+                config->concurrency_limit = LIMIT_ALGORITHM_AIMD;
+            } else {
+                if (strcmp(value, "off") != 0) {
+                    log_warn("Unknown concurrency limit algorithm: %s, using default value off", value);
+                }
+                config->concurrency_limit = LIMIT_ALGORITHM_OFF;
+            }
+        }
+        else if (strcmp(key, "concurrency_limit_min") == 0) {
+            config->concurrency_limit_min = atoi(value);
+        }
+        else if (strcmp(key, "concurrency_limit_max") == 0) {
+            config->concurrency_limit_max = atoi(value);
+        }
+        else if (strcmp(key, "concurrency_limit_per_route") == 0) {
+            config->concurrency_limit_per_route = (strcmp(value, "on") == 0);
+        }
+        else if (strcmp(key, "concurrency_queue_timeout") == 0) {
+            config->concurrency_queue_timeout = atoi(value);
+        }
+        else if (strcmp(key, "file_cache_size") == 0) {
+            config->file_cache_size = parse_size_value(value);
+            if (config->file_cache_size == 0) {
+                config->file_cache_size = 100 * 1024 * 1024;  // Default 100MB
             }
+            config->explicit_settings |= CONFIG_SET_FILE_CACHE_SIZE;
         }
         else if (strcmp(key, "worker_connections") == 0) {
             config->worker_connections = atoi(value);
             if (config->worker_connections <= 0) {
                 config->worker_connections = 1024;
             }
+            config->explicit_settings |= CONFIG_SET_WORKER_CONNECTIONS;
         }
         else if (strcmp(key, "worker_rlimit_nofile") == 0) {
             config->worker_rlimit_nofile = atoi(value);
             if (config->worker_rlimit_nofile <= 0) {
                 config->worker_rlimit_nofile = 65535;
             }
+            config->explicit_settings |= CONFIG_SET_WORKER_RLIMIT_NOFILE;
         }
         else if (strcmp(key, "listen_port") == 0) {
             config->listen_port = atoi(value);
@@ -345,6 +465,7 @@ config_t *load_config(const char *filename) {
             if (config->client_header_buffer_size <= 0) {
                 config->client_header_buffer_size = 1024;  // Default 1KB
             }
+            config->explicit_settings |= CONFIG_SET_CLIENT_HEADER_BUFFER;
         }
         else if (strcmp(key, "large_client_header_buffers") == 0) {
             config->large_client_header_buffers = parse_size_value(value);
@@ -373,6 +494,7 @@ config_t *load_config(const char *filename) {
             if (config->memory_pool_size <= 0) {
                 config->memory_pool_size = 524288000;  // Default 500MB
             }
+            config->explicit_settings |= CONFIG_SET_MEMORY_POOL_SIZE;
         }
         else if (strcmp(key, "memory_block_size") == 0) {
             config->memory_block_size = parse_size_value(value);
@@ -431,11 +553,32 @@ config_t *load_config(const char *filename) {
                 config->thread_pool_queue_size = 5000;  // Default 5000
             }
         }
+        else if (strcmp(key, "lock_profiling") == 0) {
+            config->lock_profiling = (strcmp(value, "on") == 0) ? 1 : 0;
+        }
+        else if (strcmp(key, "perf_counters") == 0) {
+            config->perf_counters = (strcmp(value, "on") == 0) ? 1 : 0;
+        }
+        else if (strcmp(key, "alloc_accounting") == 0) {
+            config->alloc_accounting = (strcmp(value, "on") == 0) ? 1 : 0;
+        }
+        else if (strcmp(key, "route_cpu_stats") == 0) {
+            config->route_cpu_stats = (strcmp(value, "on") == 0) ? 1 : 0;
+        }
+        else if (strcmp(key, "admin_socket") == 0) {
+            if (strlen(value) >= sizeof(config->admin_socket)) {
+                log_error("Admin socket path too long: %s", value);
+            } else {
+                strncpy(config->admin_socket, value, sizeof(config->admin_socket) - 1);
+                config->admin_socket[sizeof(config->admin_socket) - 1] = '\0';
+            }
+        }
         else if (strcmp(key, "client_body_buffer_size") == 0) {
             config->client_body_buffer_size = parse_size_value(value);
             if (config->client_body_buffer_size <= 0) {
                 config->client_body_buffer_size = 16384;  // Default 16KB
             }
+            config->explicit_settings |= CONFIG_SET_CLIENT_BODY_BUFFER;
         }
         else if (strcmp(key, "client_header_timeout") == 0) {
             config->client_header_timeout = atoi(value);
@@ -554,6 +697,65 @@ int validate_config(config_t *config) {
         config->log_config.log_path[MAX_LOG_PATH_LEN - 1] = '\0';
     }
     
+    if (cpu_affinity_validate(config->worker_cpu_affinity) != 0) {
+        log_error("Invalid worker_cpu_affinity: %s", config->worker_cpu_affinity);
+        return 0;
+    }
+    
+    if (config->worker_watchdog_timeout < 0) {
+        log_error("Invalid worker_watchdog_timeout: %d", config->worker_watchdog_timeout);
+        return 0;
+    }
+    if (config->worker_watchdog_timeout > 0 &&
+        config->worker_watchdog_timeout <= config->proxy_connect_timeout + config->proxy_read_timeout) {
+        // A slow upstream legitimately holds the loop for up to connect + read timeout
+        log_warn("worker_watchdog_timeout %d is not above proxy_connect_timeout + proxy_read_timeout (%d), "
+                 "Workers waiting on slow upstreams may be replaced",
+                 config->worker_watchdog_timeout, config->proxy_connect_timeout + config->proxy_read_timeout);
+    }
+    
+    if (config->worker_scaling) {
+        // Worker statistics slots in shared memory bound the Worker count
+        int max_workers = config->worker_scaling_max > 0 ? config->worker_scaling_max : config->worker_processes;
+        if (config->worker_scaling_min < 1 || max_workers > 32 || config->worker_scaling_min > max_workers) {
+            log_error("Invalid worker scaling range: %d-%d (should be within 1-32)",
+                      config->worker_scaling_min, max_workers);
+            return 0;
+        }
+    }
+    
+    if (config->static_preload_size < 0 || config->static_preload_size > 4096) {
+        log_error("Invalid static_preload_size: %d MB (should be within 0-4096)", config->static_preload_size);
+        return 0;
+    }
+    
+    if (config->connection_handoff < 0) {
+        log_error("Invalid connection_handoff: %d", config->connection_handoff);
+        return 0;
+    }
+    
+    if (config->pressure_memory_threshold <= 0 || config->pressure_memory_threshold > 100 ||
+        config->pressure_cpu_threshold <= 0 || config->pressure_cpu_threshold > 100 ||
+        config->pressure_io_threshold <= 0 || config->pressure_io_threshold > 100 ||
+        config->pressure_critical_threshold <= 0 || config->pressure_critical_threshold > 100) {
+        log_error("Invalid pressure thresholds: %d/%d/%d/%d (should be within 1-100)",
+                  config->pressure_memory_threshold, config->pressure_cpu_threshold,
+                  config->pressure_io_threshold, config->pressure_critical_threshold);
+        return 0;
+    }
+    
+    if (config->concurrency_limit_min <= 0 || config->concurrency_limit_max < 0 ||
+        (config->concurrency_limit_max > 0 && config->concurrency_limit_max < config->concurrency_limit_min)) {
+        log_error("Invalid concurrency limit range: %d-%d (min should be positive and not above max, max 0 means worker_connections)",
+                  config->concurrency_limit_min, config->concurrency_limit_max);
+        return 0;
+    }
+    
+    if (config->concurrency_queue_timeout < 0 || config->concurrency_queue_timeout > 60000) {
+        log_error("Invalid concurrency_queue_timeout: %d ms (should be within 0-60000)", config->concurrency_queue_timeout);
+        return 0;
+    }
+    
     // Validate performance configuration
     if (config->worker_connections <= 0) {
         log_error("Invalid worker connections: %d", config->worker_connections);
@@ -684,6 +886,34 @@ config_t *get_default_config(void) {
     config->thread_pool_size = 4;  // 4 threads per process, avoid excessive thread competition
     config->thread_pool_queue_size = 2000;  // Thread pool queue size
     
+    // Diagnostics - lock profiling and hardware counters are off by default
+    config->lock_profiling = 0;
+    config->perf_counters = 0;
+    config->alloc_accounting = 0;
+    config->route_cpu_stats = 0;
+    config->admin_socket[0] = '\0';
+    config->worker_cpu_affinity[0] = '\0';
+    config->worker_watchdog_timeout = 60;  // Above proxy connect + read timeouts, proxying blocks the loop
+    config->worker_scaling = 0;
+    config->worker_scaling_min = 1;
+    config->worker_scaling_max = 0;  // worker_processes
+    config->static_preload_size = 16;  // Small static files served from memory shared by all Workers
+    config->connection_handoff = 0;
+    config->worker_single_thread = 0;
+    config->file_cache_size = 100 * 1024 * 1024;  // 100MB file cache per Worker
+    config->auto_tune = 1;  // Size unset settings to the container's CPU, memory and descriptor limits
+    config->explicit_settings = 0;
+    config->pressure_monitor = 1;  // React to PSI stalls, sheds only routes marked low
+    config->pressure_memory_threshold = 10;
+    config->pressure_cpu_threshold = 50;
+    config->pressure_io_threshold = 30;
+    config->pressure_critical_threshold = 80;
+    config->concurrency_limit = LIMIT_ALGORITHM_OFF;  // worker_connections alone bounds concurrency
+    config->concurrency_limit_min = 4;
+    config->concurrency_limit_max = 0;  // worker_connections
+    config->concurrency_limit_per_route = 0;
+    config->concurrency_queue_timeout = 0;  // Reject over the limit at once
+    
     // Event loop optimization - multi-process 10K concurrency core optimization
     config->event_loop_max_events = 20000;  // 20K events per process, total 200K events
     config->event_loop_timeout = 10;  // Event loop timeout (milliseconds)
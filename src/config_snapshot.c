@@ -0,0 +1,301 @@
+/**
+ * Configuration Snapshot Implementation
+ * Epoch-based publication of reference-counted, read-only configuration snapshots
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "../include/config_snapshot.h"
+#include "../include/logger.h"
+
+// A reader slot holds the epoch a thread observed while loading the current pointer, 0 when idle.
+// Padded to a cache line so readers on different threads do not share one.
+typedef struct reader_slot {
+    atomic_uint_fast64_t epoch;
+    char padding[64 - sizeof(atomic_uint_fast64_t)];
+} reader_slot_t;
+
+static reader_slot_t g_readers[CONFIG_SNAPSHOT_MAX_READERS];
+static atomic_int g_reader_count = 0;
+static __thread int t_reader_slot = -1;
+
+static _Atomic(config_snapshot_t *) g_current = NULL;
+static atomic_uint_fast64_t g_epoch = 1;
+static uint64_t g_generation = 0;
+
+// Snapshot the Master published before fork, never reference counted or freed in this process
+static config_snapshot_t *g_inherited = NULL;
+
+// Serializes publishers and the slow path of threads without a reader slot
+static pthread_mutex_t g_writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static config_snapshot_t *g_retired = NULL;
+
+// Free a snapshot and its derived state
+static void snapshot_free(config_snapshot_t *snapshot) {
+    if (snapshot->auth_apps != NULL) {
+        free_api_auth_config(snapshot->auth_apps, snapshot->auth_app_count);
+    }
+    free(snapshot->routes);
+    free(snapshot->upstreams);
+    free_config(snapshot->config);
+    free(snapshot);
+}
+
+// Longer prefixes first, configuration order among equal lengths
+static int route_match_compare(const void *a, const void *b) {
+    const route_match_t *x = a;
+    const route_match_t *y = b;
+    if (x->prefix_len != y->prefix_len) {
+        return x->prefix_len > y->prefix_len ? -1 : 1;
+    }
+    return x->index - y->index;
+}
+
+// Compile the route table and resolve proxy upstreams
+static int snapshot_build_routes(config_snapshot_t *snapshot) {
+    config_t *config = snapshot->config;
+    int count = config->route_count > 0 ? config->route_count : 1;
+
+    snapshot->routes = calloc((size_t)count, sizeof(route_match_t));
+    snapshot->upstreams = calloc((size_t)count, sizeof(upstream_addr_t));
+    if (snapshot->routes == NULL || snapshot->upstreams == NULL) {
+        return -1;
+    }
+
+    for (int i = 0; i < config->route_count; i++) {
+        snapshot->routes[i].index = i;
+        snapshot->routes[i].prefix_len = strlen(config->routes[i].path_prefix);
+        if (config->routes[i].type == ROUTE_PROXY) {
+            proxy_resolve_upstream(config->routes[i].target_host, config->routes[i].target_port,
+                                   &snapshot->upstreams[i]);
+        }
+    }
+    qsort(snapshot->routes, (size_t)config->route_count, sizeof(route_match_t), route_match_compare);
+    return 0;
+}
+
+// Claim a reader slot for the calling thread on first use
+static reader_slot_t *reader_slot(void) {
+    if (t_reader_slot < 0) {
+        int slot = atomic_fetch_add(&g_reader_count, 1);
+        if (slot >= CONFIG_SNAPSHOT_MAX_READERS) {
+            atomic_fetch_sub(&g_reader_count, 1);
+            return NULL;
+        }
+        t_reader_slot = slot;
+    }
+    return &g_readers[t_reader_slot];
+}
+
+/**
+ * Publish a new configuration snapshot
+ */
+int config_snapshot_publish(config_t *config) {
+    if (config == NULL) {
+        return -1;
+    }
+
+    config_snapshot_t *snapshot = calloc(1, sizeof(config_snapshot_t));
+    if (snapshot == NULL) {
+        log_error("Failed to allocate configuration snapshot");
+        free_config(config);
+        return -1;
+    }
+    snapshot->config = config;
+    atomic_init(&snapshot->refs, 1);
+
+    if (snapshot_build_routes(snapshot) != 0) {
+        log_error("Failed to build route table for configuration snapshot");
+        snapshot_free(snapshot);
+        return -1;
+    }
+
+    // Derived state is built here, off the request path
+    snapshot->auth_apps = load_api_auth_config(API_AUTH_CONFIG_FILE, &snapshot->auth_app_count);
+    if (snapshot->auth_apps == NULL) {
+        snapshot->auth_app_count = 0;
+        log_warn("OAuth application table %s not loaded, OAuth routes will reject requests", API_AUTH_CONFIG_FILE);
+    }
+
+    pthread_mutex_lock(&g_writer_mutex);
+    snapshot->generation = ++g_generation;
+    config_snapshot_t *old = atomic_exchange(&g_current, snapshot);
+    if (old != NULL) {
+        // Readers that load the pointer from now on see an epoch past this one
+        old->retire_epoch = atomic_fetch_add(&g_epoch, 1) + 1;
+        old->retired_next = g_retired;
+        g_retired = old;
+    }
+    pthread_mutex_unlock(&g_writer_mutex);
+
+    log_info("Configuration snapshot %lu published, %d routes, %d OAuth applications",
+             (unsigned long)snapshot->generation, config->route_count, snapshot->auth_app_count);
+
+    config_snapshot_reclaim();
+    return 0;
+}
+
+/**
+ * Adopt the snapshot published by the Master before fork
+ */
+config_t *config_snapshot_inherit(void) {
+    g_inherited = atomic_load(&g_current);
+    return g_inherited != NULL ? g_inherited->config : NULL;
+}
+
+/**
+ * Longest-prefix route lookup on the compiled table
+ */
+route_t *config_snapshot_find_route(const config_snapshot_t *snapshot, const char *path) {
+    if (snapshot == NULL || path == NULL) {
+        return NULL;
+    }
+
+    for (int i = 0; i < snapshot->config->route_count; i++) {
+        const route_match_t *match = &snapshot->routes[i];
+        route_t *route = &snapshot->config->routes[match->index];
+        if (strncmp(path, route->path_prefix, match->prefix_len) == 0) {
+            return route;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Pre-resolved upstream address of a route
+ */
+const upstream_addr_t *config_snapshot_upstream(const config_snapshot_t *snapshot, const route_t *route) {
+    return &snapshot->upstreams[route - snapshot->config->routes];
+}
+
+/**
+ * Acquire a reference to the current snapshot
+ */
+config_snapshot_t *config_snapshot_acquire(void) {
+    reader_slot_t *slot = reader_slot();
+    config_snapshot_t *snapshot;
+
+    if (slot == NULL) {
+        pthread_mutex_lock(&g_writer_mutex);
+        snapshot = atomic_load(&g_current);
+        if (snapshot != NULL && snapshot != g_inherited) {
+            atomic_fetch_add(&snapshot->refs, 1);
+        }
+        pthread_mutex_unlock(&g_writer_mutex);
+        return snapshot;
+    }
+
+    // Announce the epoch before loading the pointer, the publisher will not drop
+    // a snapshot retired after this epoch until the slot is idle again
+    atomic_store(&slot->epoch, atomic_load(&g_epoch));
+    snapshot = atomic_load(&g_current);
+    if (snapshot != NULL && snapshot != g_inherited) {
+        atomic_fetch_add(&snapshot->refs, 1);
+    }
+    atomic_store(&slot->epoch, 0);
+
+    return snapshot;
+}
+
+/**
+ * Take another reference to a snapshot the caller already holds
+ */
+void config_snapshot_retain(config_snapshot_t *snapshot) {
+    if (snapshot == NULL || snapshot == g_inherited) {
+        return;
+    }
+    atomic_fetch_add(&snapshot->refs, 1);
+}
+
+/**
+ * Release a snapshot reference
+ */
+void config_snapshot_release(config_snapshot_t *snapshot) {
+    // The inherited snapshot outlives every request, writing its count would un-share the page
+    if (snapshot == NULL || snapshot == g_inherited) {
+        return;
+    }
+    if (atomic_fetch_sub(&snapshot->refs, 1) == 1) {
+        log_debug("Configuration snapshot %lu freed", (unsigned long)snapshot->generation);
+        snapshot_free(snapshot);
+    }
+}
+
+/**
+ * Drop the current-snapshot reference of retired snapshots no reader can still be loading
+ */
+int config_snapshot_reclaim(void) {
+    int reclaimed = 0;
+
+    pthread_mutex_lock(&g_writer_mutex);
+
+    // Oldest epoch any reader is inside, 0 when all are idle
+    uint64_t min_epoch = 0;
+    int readers = atomic_load(&g_reader_count);
+    if (readers > CONFIG_SNAPSHOT_MAX_READERS) {
+        readers = CONFIG_SNAPSHOT_MAX_READERS;
+    }
+    for (int i = 0; i < readers; i++) {
+        uint64_t epoch = atomic_load(&g_readers[i].epoch);
+        if (epoch != 0 && (min_epoch == 0 || epoch < min_epoch)) {
+            min_epoch = epoch;
+        }
+    }
+
+    config_snapshot_t **link = &g_retired;
+    config_snapshot_t *ready = NULL;
+    while (*link != NULL) {
+        config_snapshot_t *snapshot = *link;
+        if (min_epoch == 0 || min_epoch >= snapshot->retire_epoch) {
+            *link = snapshot->retired_next;
+            snapshot->retired_next = ready;
+            ready = snapshot;
+        } else {
+            link = &snapshot->retired_next;
+        }
+    }
+
+    pthread_mutex_unlock(&g_writer_mutex);
+
+    // In-flight requests keep their own references, the last one frees the snapshot
+    while (ready != NULL) {
+        config_snapshot_t *next = ready->retired_next;
+        config_snapshot_release(ready);
+        ready = next;
+        reclaimed++;
+    }
+
+    return reclaimed;
+}
+
+/**
+ * Generation of the current snapshot
+ */
+uint64_t config_snapshot_generation(void) {
+    config_snapshot_t *snapshot = atomic_load(&g_current);
+    return snapshot != NULL ? snapshot->generation : 0;
+}
+
+/**
+ * Free all snapshots once no reader thread runs
+ */
+void config_snapshot_shutdown(void) {
+    config_snapshot_t *current = atomic_exchange(&g_current, NULL);
+
+    config_snapshot_reclaim();
+    config_snapshot_release(current);
+
+    pthread_mutex_lock(&g_writer_mutex);
+    config_snapshot_t *retired = g_retired;
+    g_retired = NULL;
+    pthread_mutex_unlock(&g_writer_mutex);
+
+    while (retired != NULL) {
+        config_snapshot_t *next = retired->retired_next;
+        config_snapshot_release(retired);
+        retired = next;
+    }
+}
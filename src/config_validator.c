@@ -4,6 +4,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/stat.h>
@@ -11,17 +12,210 @@
 
 #include "../include/config.h"
 #include "../include/config_defaults.h"
+#include "../include/config_validator.h"
+#include "../include/resource_limits.h"
+#include "../include/shared_memory.h"
 #include "../include/error_handling.h"
 #include "../include/logger.h"
 
+// Descriptors a Worker keeps besides client and upstream sockets: logs, listen/epoll/event fds,
+// handoff sockets and files being served
+#define TUNE_FD_RESERVE 256
+
+// Shares of the usable memory, split evenly between Workers
+#define TUNE_CONNECTION_MEMORY_SHARE 0.50
+#define TUNE_POOL_MEMORY_SHARE       0.25
+#define TUNE_CACHE_MEMORY_SHARE      0.10
+
+// Below this much memory per Worker the buffers drop to their small sizes
+#define TUNE_SMALL_WORKER_MEMORY (512UL * 1024 * 1024)
+
+// Fixed per-connection state besides the header buffer: read/write buffers, connection and request
+#define TUNE_CONNECTION_BASE_BYTES (2 * 8192 + 2048)
+
+#define TUNE_MIN_WORKER_CONNECTIONS 64
+#define TUNE_MAX_WORKER_CONNECTIONS 65536
+#define TUNE_MIN_MEMORY_POOL_SIZE   (16UL * 1024 * 1024)
+#define TUNE_MIN_FILE_CACHE_SIZE    (4UL * 1024 * 1024)
+#define DEFAULT_FILE_CACHE_SIZE     (100UL * 1024 * 1024)
+
+// Decisions of the last auto-tune pass, printed by -t
+#define TUNE_MAX_NOTES 16
+static char g_tune_notes[TUNE_MAX_NOTES][256];
+static int g_tune_note_count = 0;
+
+// Record and log one auto-tune decision
+static void tune_note(const char *format, ...) {
+    if (g_tune_note_count >= TUNE_MAX_NOTES) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    vsnprintf(g_tune_notes[g_tune_note_count], sizeof(g_tune_notes[0]), format, args);
+    va_end(args);
+    log_info("Auto-tune: %s", g_tune_notes[g_tune_note_count]);
+    g_tune_note_count++;
+}
+
+static double mb(size_t bytes) {
+    return (double)bytes / (1024 * 1024);
+}
+
+// Size the settings the config file left unset to the limits this process really runs under
+static void auto_tune_config(config_t *config, const resource_limits_t *limits) {
+    unsigned int set = config->explicit_settings;
+    g_tune_note_count = 0;
+    
+    double cpus = resource_limits_cpus(limits);
+    size_t memory = resource_limits_memory(limits);
+    
+    char quota[32] = "none";
+    if (limits->cpu_quota > 0) {
+        snprintf(quota, sizeof(quota), "%.2f CPUs", limits->cpu_quota);
+    }
+    char memory_limit[32] = "none";
+    if (limits->memory_limit > 0) {
+        snprintf(memory_limit, sizeof(memory_limit), "%.0f MB", mb(limits->memory_limit));
+    }
+    tune_note("limits: %d CPUs online, %d allowed, cgroup v%d quota %s; %.0f MB RAM, cgroup limit %s; "
+              "RLIMIT_NOFILE %lu/%lu",
+              limits->online_cpus, limits->allowed_cpus, limits->cgroup_version, quota,
+              mb(limits->physical_memory), memory_limit,
+              (unsigned long)limits->nofile_soft, (unsigned long)limits->nofile_hard);
+    
+    if (!config->auto_tune) {
+        tune_note("auto_tune off, configured values are used as they are");
+        return;
+    }
+    
+    // Workers: one per usable CPU, a fractional quota rounds to the nearest whole CPU
+    if (set & CONFIG_SET_WORKER_PROCESSES) {
+        tune_note("worker_processes %d (set in config)", config->worker_processes);
+    } else {
+        int workers = (int)(cpus + 0.5);
+        if (workers < 1) {
+            workers = 1;
+        }
+        if (workers > SHM_MAX_WORKERS) {
+            workers = SHM_MAX_WORKERS;
+        }
+        config->worker_processes = workers;
+        tune_note("worker_processes %d (%.2f usable CPUs: min of online, affinity and cgroup quota)", workers, cpus);
+    }
+    
+    int workers = config->worker_processes > 0 ? config->worker_processes : 1;
+    size_t worker_memory = memory / (size_t)workers;
+    
+    // Descriptors: the hard limit unless configured, the Master raises the soft limit to it before forking
+    if (set & CONFIG_SET_WORKER_RLIMIT_NOFILE) {
+        if (limits->nofile_hard != RLIM_INFINITY && (rlim_t)config->worker_rlimit_nofile > limits->nofile_hard) {
+            tune_note("worker_rlimit_nofile %d (set in config; the Master clamps it to the RLIMIT_NOFILE hard limit %lu)",
+                      config->worker_rlimit_nofile, (unsigned long)limits->nofile_hard);
+        } else {
+            tune_note("worker_rlimit_nofile %d (set in config)", config->worker_rlimit_nofile);
+        }
+    } else {
+        rlim_t nofile = limits->nofile_hard;
+        if (nofile == RLIM_INFINITY || nofile > (rlim_t)DEFAULT_WORKER_RLIMIT_NOFILE) {
+            nofile = DEFAULT_WORKER_RLIMIT_NOFILE;
+        }
+        config->worker_rlimit_nofile = (int)nofile;
+        tune_note("worker_rlimit_nofile %d (RLIMIT_NOFILE hard limit)", config->worker_rlimit_nofile);
+    }
+    
+    // Buffers: small sizes when each Worker has little memory
+    int small = worker_memory < TUNE_SMALL_WORKER_MEMORY;
+    if (!(set & CONFIG_SET_CLIENT_HEADER_BUFFER) && small && config->client_header_buffer_size > 4 * 1024) {
+        config->client_header_buffer_size = 4 * 1024;
+    }
+    if (!(set & CONFIG_SET_CLIENT_BODY_BUFFER) && small && config->client_body_buffer_size > 64 * 1024) {
+        config->client_body_buffer_size = 64 * 1024;
+    }
+    if (small && config->proxy_buffer_size > 8 * 1024) {
+        config->proxy_buffer_size = 8 * 1024;
+    }
+    tune_note("client_header_buffer_size %dk, client_body_buffer_size %dk, proxy_buffer_size %dk "
+              "(%.0f MB per Worker, %s)",
+              config->client_header_buffer_size / 1024, config->client_body_buffer_size / 1024,
+              config->proxy_buffer_size / 1024, mb(worker_memory),
+              small ? "below 512 MB: small buffers" : "defaults kept");
+    
+    // Connections: what the descriptors allow (two per proxied request) and what half the memory holds
+    int has_proxy = 0;
+    for (int i = 0; i < config->route_count; i++) {
+        if (config->routes[i].type == ROUTE_PROXY) {
+            has_proxy = 1;
+        }
+    }
+    int fds_per_connection = has_proxy ? 2 : 1;
+    // What a Worker can really open: apply_rlimit_nofile() clamps the configured value to the hard limit
+    long nofile = config->worker_rlimit_nofile;
+    if (limits->nofile_hard != RLIM_INFINITY && (rlim_t)nofile > limits->nofile_hard) {
+        nofile = (long)limits->nofile_hard;
+    }
+    long by_fds = (nofile - TUNE_FD_RESERVE) / fds_per_connection;
+    size_t per_connection = TUNE_CONNECTION_BASE_BYTES + (size_t)config->client_header_buffer_size +
+                            (has_proxy ? (size_t)config->proxy_buffer_size : 0);
+    long by_memory = (long)((double)worker_memory * TUNE_CONNECTION_MEMORY_SHARE / (double)per_connection);
+    
+    if (set & CONFIG_SET_WORKER_CONNECTIONS) {
+        tune_note("worker_connections %d (set in config; descriptors allow %ld, memory %ld)",
+                  config->worker_connections, by_fds, by_memory);
+    } else {
+        long connections = by_fds < by_memory ? by_fds : by_memory;
+        if (connections > TUNE_MAX_WORKER_CONNECTIONS) {
+            connections = TUNE_MAX_WORKER_CONNECTIONS;
+        }
+        if (connections < TUNE_MIN_WORKER_CONNECTIONS) {
+            connections = TUNE_MIN_WORKER_CONNECTIONS;
+        }
+        config->worker_connections = (int)connections;
+        tune_note("worker_connections %d (descriptors: (%ld - %d reserved) / %d per connection = %ld; "
+                  "memory: 50%% of %.0f MB / %zu bytes per connection = %ld)",
+                  config->worker_connections, nofile, TUNE_FD_RESERVE,
+                  fds_per_connection, by_fds, mb(worker_memory), per_connection, by_memory);
+    }
+    
+    // Memory pool and file cache: fixed shares of each Worker's memory, never above the defaults
+    if (set & CONFIG_SET_MEMORY_POOL_SIZE) {
+        tune_note("memory_pool_size %.0fm (set in config)", mb(config->memory_pool_size));
+    } else {
+        size_t pool = (size_t)((double)worker_memory * TUNE_POOL_MEMORY_SHARE);
+        if (pool > DEFAULT_MEMORY_POOL_SIZE) {
+            pool = DEFAULT_MEMORY_POOL_SIZE;
+        }
+        if (pool < TUNE_MIN_MEMORY_POOL_SIZE) {
+            pool = TUNE_MIN_MEMORY_POOL_SIZE;
+        }
+        config->memory_pool_size = pool;
+        tune_note("memory_pool_size %.0fm (25%% of %.0f MB per Worker, at most %.0fm)",
+                  mb(pool), mb(worker_memory), mb(DEFAULT_MEMORY_POOL_SIZE));
+    }
+    
+    if (set & CONFIG_SET_FILE_CACHE_SIZE) {
+        tune_note("file_cache_size %.0fm (set in config)", mb(config->file_cache_size));
+    } else {
+        size_t cache = (size_t)((double)worker_memory * TUNE_CACHE_MEMORY_SHARE);
+        if (cache > DEFAULT_FILE_CACHE_SIZE) {
+            cache = DEFAULT_FILE_CACHE_SIZE;
+        }
+        if (cache < TUNE_MIN_FILE_CACHE_SIZE) {
+            cache = TUNE_MIN_FILE_CACHE_SIZE;
+        }
+        config->file_cache_size = cache;
+        tune_note("file_cache_size %.0fm (10%% of %.0f MB per Worker, at most %.0fm)",
+                  mb(cache), mb(worker_memory), mb(DEFAULT_FILE_CACHE_SIZE));
+    }
+}
+
 // Validate and optimize Worker processes configuration
-static int validate_worker_processes(config_t *config) {
+static int validate_worker_processes(config_t *config, const resource_limits_t *limits) {
     CHECK_NULL_RETURN(config, -1);
     
-    // Get system CPU core count
-    long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    // Usable CPUs, not the host's: a container quota is what the Workers share
+    long cpu_count = (long)(resource_limits_cpus(limits) + 0.5);
     if (cpu_count <= 0) {
-        cpu_count = DEFAULT_WORKER_PROCESSES_FALLBACK;
+        cpu_count = 1;
     }
     
     // If configured as 0 or negative, use CPU core count
@@ -83,7 +277,7 @@ static int validate_connection_config(config_t *config) {
 }
 
 // Validate and optimize memory configuration
-static int validate_memory_config(config_t *config) {
+static int validate_memory_config(config_t *config, const resource_limits_t *limits) {
     CHECK_NULL_RETURN(config, -1);
     
     // Validate memory pool size
@@ -92,11 +286,10 @@ static int validate_memory_config(config_t *config) {
         log_info("Using default memory pool size: %zu bytes", config->memory_pool_size);
     }
     
-    // Check system available memory
+    // Check available memory, the cgroup limit when there is one
     long page_size = sysconf(_SC_PAGESIZE);
-    long num_pages = sysconf(_SC_PHYS_PAGES);
-    if (page_size > 0 && num_pages > 0) {
-        size_t total_memory = (size_t)page_size * (size_t)num_pages;
+    size_t total_memory = resource_limits_memory(limits);
+    if (total_memory > 0) {
         size_t total_pool_memory = config->memory_pool_size * config->worker_processes;
         
         if (total_pool_memory > total_memory / 2) {
@@ -286,8 +479,13 @@ int validate_and_optimize_config(config_t *config) {
     
     log_info("Starting configuration validation and optimization...");
     
+    // Unset settings follow the CPU quota, memory limit and descriptor limit first, the checks below see the result
+    resource_limits_t limits;
+    resource_limits_detect(&limits);
+    auto_tune_config(config, &limits);
+    
     // Validate each configuration module
-    if (validate_worker_processes(config) != 0) {
+    if (validate_worker_processes(config, &limits) != 0) {
         log_error("Worker process configuration validation failed");
         return -1;
     }
@@ -297,7 +495,7 @@ int validate_and_optimize_config(config_t *config) {
         return -1;
     }
     
-    if (validate_memory_config(config) != 0) {
+    if (validate_memory_config(config, &limits) != 0) {
         log_error("Memory configuration validation failed");
         return -1;
     }
@@ -326,6 +524,17 @@ int validate_and_optimize_config(config_t *config) {
     return 0;
 }
 
+// Print the decisions of the last auto-tune pass
+void print_auto_tune_report(void) {
+    if (g_tune_note_count == 0) {
+        return;
+    }
+    printf("Auto-tuning:\n");
+    for (int i = 0; i < g_tune_note_count; i++) {
+        printf("  %s\n", g_tune_notes[i]);
+    }
+}
+
 // Print configuration summary
 void print_config_summary(const config_t *config) {
     if (!config) return;
@@ -26,10 +26,25 @@
 #include "../include/memory_pool.h"
 #include "../include/worker_process.h"
 #include "../include/connection_limit.h"
+#include "../include/route_stats.h"
+#include "../include/config_snapshot.h"
+#include "../include/thread_pool.h"
+#include "../include/pressure_monitor.h"
+#include "../include/adaptive_limit.h"
+
+// Allocations in this file are accounted to the connection subsystem
+#define ALLOC_TAG ALLOC_TAG_CONNECTION
+#include "../include/alloc_stats.h"
 
 #define BUFFER_SIZE 8192
 #define CONNECTION_POOL_SIZE (1024 * 1024 * 10)  // 10MB connection memory pool
 
+// process_request() result: the request continues on the offload pool, the connection is no longer the caller's
+#define REQUEST_OFFLOADED 2
+
+// process_request() result: the request waits for a concurrency slot, off the event loop until admitted or expired
+#define REQUEST_QUEUED 3
+
 // Thread-safe IP address conversion function
 static char *safe_inet_ntoa(struct in_addr addr) {
     static __thread char ip_str[INET_ADDRSTRLEN];
@@ -43,11 +58,13 @@ static char *safe_inet_ntoa(struct in_addr addr) {
 // Connection memory pool
 static memory_pool_t *connection_pool = NULL;
 
+// Connections of this process, walked when handing idle ones to another Worker
+static connection_t *live_connections = NULL;
+
 // Connection structure
 struct connection {
     int fd;                     // Connection socket
     event_loop_t *loop;         // Unified event loop
-    config_t *config;           // Server configuration
     char *read_buffer;          // Read buffer
     size_t read_size;           // Read buffer size
     size_t read_pos;            // Read buffer position
@@ -59,13 +76,34 @@ struct connection {
     time_t last_activity;       // Last activity time
     int timeout;                // Timeout (seconds)
     struct sockaddr_in addr;    // Client address
+    int pooled;                 // Parked in the idle connection pool after the peer side ended
+    struct connection *live_prev; // Live connection list, touched only by the event loop thread
+    struct connection *live_next;
+    struct proxy_offload *offload; // Proxy request running on the offload pool, NULL otherwise
+    limit_token_t limit;        // Concurrency slot of the request being served
+    limit_waiter_t limit_wait;  // Queue entry while waiting for a slot
 };
 
+// Proxy request handed to the offload pool; the connection is off the event loop until the completion runs
+typedef struct proxy_offload {
+    connection_t *conn;
+    config_snapshot_t *snapshot;    // Reference held until the completion
+    route_t *route;
+    int route_index;
+    int result;                     // Written by the pool thread
+    int status_code;
+    size_t response_size;
+    uint64_t pool_cpu_ns;
+    uint64_t loop_cpu_ns;           // Written by the loop thread before the completion can run
+} proxy_offload_t;
+
 // Forward declarations
 void connection_read_callback(int fd, void *arg);
 void connection_write_callback(int fd, void *arg);
-static connection_t *connection_create_internal(int fd, config_t *config, struct sockaddr_in *client_addr);
+static connection_t *connection_create_internal(int fd, struct sockaddr_in *client_addr);
 static void connection_destroy_internal(connection_t *conn);
+static void connection_limit_admit(void *arg);
+static void connection_limit_expire(void *arg);
 
 // Initialize connection management module
 int init_connection_manager(size_t pool_size) {
@@ -101,12 +139,12 @@ void cleanup_connection_manager(void) {
 }
 
 // Create connection (unified event loop version)
-connection_t *connection_create(int fd, event_loop_t *loop, config_t *config, struct sockaddr_in *client_addr) {
-    if (fd < 0 || loop == NULL || config == NULL) {
+connection_t *connection_create(int fd, event_loop_t *loop, struct sockaddr_in *client_addr) {
+    if (fd < 0 || loop == NULL) {
         return NULL;
     }
     
-    connection_t *conn = connection_create_internal(fd, config, client_addr);
+    connection_t *conn = connection_create_internal(fd, client_addr);
     if (conn == NULL) {
         return NULL;
     }
@@ -125,13 +163,13 @@ connection_t *connection_create(int fd, event_loop_t *loop, config_t *config, st
 }
 
 // Create connection (compatibility function)
-connection_t *connection_create_enhanced(int fd, event_loop_t *loop, config_t *config, struct sockaddr_in *client_addr) {
+connection_t *connection_create_enhanced(int fd, event_loop_t *loop, struct sockaddr_in *client_addr) {
     // Now uniformly use the standard connection_create function
-    return connection_create(fd, loop, config, client_addr);
+    return connection_create(fd, loop, client_addr);
 }
 
 // Internal connection creation function
-static connection_t *connection_create_internal(int fd, config_t *config, struct sockaddr_in *client_addr) {
+static connection_t *connection_create_internal(int fd, struct sockaddr_in *client_addr) {
     
     // Ensure connection memory pool is initialized
     if (connection_pool == NULL) {
@@ -151,9 +189,11 @@ static connection_t *connection_create_internal(int fd, config_t *config, struct
     // Initialize connection
     memset(conn, 0, sizeof(connection_t));
     conn->fd = fd;
-    conn->config = config;
     conn->last_activity = time(NULL);
     conn->timeout = 30;  // Default 30 second timeout
+    conn->limit_wait.admit = connection_limit_admit;
+    conn->limit_wait.expire = connection_limit_expire;
+    conn->limit_wait.arg = conn;
     
     // Allocate read buffer from memory pool
     conn->read_buffer = (char *)pool_malloc(connection_pool, BUFFER_SIZE);
@@ -176,6 +216,12 @@ static connection_t *connection_create_internal(int fd, config_t *config, struct
     conn->write_size = BUFFER_SIZE;
     conn->write_pos = 0;
     
+    conn->live_next = live_connections;
+    if (live_connections != NULL) {
+        live_connections->live_prev = conn;
+    }
+    live_connections = conn;
+    
     // Set client address
     if (client_addr != NULL) {
         conn->addr = *client_addr;
@@ -195,11 +241,18 @@ void connection_destroy(connection_t *conn) {
     connection_pool_t *pool = get_worker_connection_pool();
     
     if (pool && conn->keep_alive) {
-        // Try to return to connection pool
+        // Try to return to connection pool; cleared so closing it from the pool destroys it
+        conn->keep_alive = 0;
+        conn->pooled = 1;
         connection_pool_return_connection(pool, conn);
         return;
     }
     
+    // Stop tracking in the pool, otherwise the slot leaks and the pool eventually refuses connections
+    if (pool) {
+        connection_pool_remove_connection(pool, conn);
+    }
+    
     // Destroy connection directly
     connection_destroy_internal(conn);
 }
@@ -210,6 +263,13 @@ static void connection_destroy_internal(connection_t *conn) {
         return;
     }
     
+    // A request still waiting or holding a concurrency slot ends here
+    adaptive_limit_cancel(&conn->limit_wait);
+    if (conn->limit.held) {
+        conn->limit.dropped = 1;
+        adaptive_limit_release(&conn->limit);
+    }
+    
     // Release connection limit count
     if (conn->fd >= 0) {
         char client_ip[INET_ADDRSTRLEN];
@@ -237,6 +297,15 @@ static void connection_destroy_internal(connection_t *conn) {
         worker_ctx->active_connections--;
     }
     
+    if (conn->live_prev != NULL) {
+        conn->live_prev->live_next = conn->live_next;
+    } else if (live_connections == conn) {
+        live_connections = conn->live_next;
+    }
+    if (conn->live_next != NULL) {
+        conn->live_next->live_prev = conn->live_prev;
+    }
+    
     // Free HTTP request resources
     free_http_request(&conn->request);
     
@@ -254,6 +323,48 @@ static void connection_destroy_internal(connection_t *conn) {
     pool_free(connection_pool, conn);
 }
 
+// Collect connections between requests: nothing buffered in either direction, not pooled, peer still there
+int connection_collect_idle(connection_t **conns, int max) {
+    int count = 0;
+    
+    for (connection_t *conn = live_connections; conn != NULL && count < max; conn = conn->live_next) {
+        if (conn->fd < 0 || conn->pooled || conn->read_pos != 0 || conn->write_pos != 0 || conn->offload != NULL) {
+            continue;
+        }
+        
+        // A peer that already closed or reset leaves EOF or an error; the receiver would only close it
+        char byte;
+        ssize_t peeked = recv(conn->fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+        if (peeked == 0 || (peeked < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+            continue;
+        }
+        conns[count++] = conn;
+    }
+    return count;
+}
+
+// Export the state another Worker needs to continue the connection
+int connection_export(connection_t *conn, connection_transfer_t *state) {
+    memset(state, 0, sizeof(*state));
+    state->addr = conn->addr;
+    state->last_activity = conn->last_activity;
+    state->keep_alive = conn->keep_alive;
+    return conn->fd;
+}
+
+// Drop the local side of a connection whose socket now belongs to another Worker
+void connection_release_transferred(connection_t *conn) {
+    // Not a keep-alive return: the pool must not keep this connection
+    conn->keep_alive = 0;
+    connection_destroy(conn);
+}
+
+// Continue a connection received from another Worker
+void connection_import(connection_t *conn, const connection_transfer_t *state) {
+    conn->last_activity = state->last_activity;
+    conn->keep_alive = state->keep_alive;
+}
+
 // Expand buffer
 static int expand_buffer(char **buffer, size_t *size, size_t new_size) {
     // Use memory pool to allocate new buffer
@@ -371,10 +482,83 @@ static int connection_write(connection_t *conn) {
     return n;
 }
 
-// Handle HTTP request
-static int handle_request(connection_t *conn) {
+// Pool thread: forward the request upstream, blocking in connect and the response relay
+static void proxy_offload_run(void *arg) {
+    proxy_offload_t *job = (proxy_offload_t *)arg;
+    uint64_t cpu_start = route_stats_thread_cpu_ns();
+    
+    alloc_stats_request_begin();
+    job->result = proxy_request(job->conn->fd, &job->conn->request, job->route,
+                                config_snapshot_upstream(job->snapshot, job->route),
+                                &job->status_code, &job->response_size);
+    alloc_stats_request_end(0);
+    
+    if (cpu_start != 0) {
+        job->pool_cpu_ns = route_stats_thread_cpu_ns() - cpu_start;
+    }
+}
+
+// Event loop thread: log and account the offloaded request, then close the connection
+static void proxy_offload_complete(void *arg) {
+    proxy_offload_t *job = (proxy_offload_t *)arg;
+    connection_t *conn = job->conn;
+    
+    if (job->result != 0) {
+        log_error("Proxy request failed");
+    }
+    int status_code = job->status_code ? job->status_code : (job->result != 0 ? 502 : 200);
+    log_access(safe_inet_ntoa(conn->addr.sin_addr), http_method_str(conn->request.method), conn->request.path,
+               status_code, job->response_size, get_header_value(&conn->request, "User-Agent"));
+    
+    if (job->pool_cpu_ns != 0 || job->loop_cpu_ns != 0) {
+        route_stats_record(job->route_index, job->loop_cpu_ns + job->pool_cpu_ns);
+    }
+    config_snapshot_release(job->snapshot);
+    
+    // Upstream failures count as congestion
+    conn->limit.dropped = job->result != 0;
+    adaptive_limit_release(&conn->limit);
+    
+    // Short connections: the request is done either way
+    conn->offload = NULL;
+    conn->keep_alive = 0;
+    connection_destroy(conn);
+    free(job);
+}
+
+// Hand a proxy request to the offload pool; -1 leaves it to the caller
+static int proxy_offload_submit(connection_t *conn, config_snapshot_t *snapshot, route_t *route, int route_index) {
+    if (!offload_available()) {
+        return -1;
+    }
+    
+    proxy_offload_t *job = (proxy_offload_t *)calloc(1, sizeof(proxy_offload_t));
+    if (job == NULL) {
+        return -1;
+    }
+    job->conn = conn;
+    job->snapshot = snapshot;
+    job->route = route;
+    job->route_index = route_index;
+    
+    config_snapshot_retain(snapshot);
+    if (offload(proxy_offload_run, job, proxy_offload_complete) != 0) {
+        // Queue full, the caller serves it on the loop
+        config_snapshot_release(snapshot);
+        free(job);
+        return -1;
+    }
+    
+    // The pool thread owns the socket until the completion, which can only run after this callback returns
+    event_loop_del_handler(conn->loop, conn->fd);
+    conn->offload = job;
+    return 0;
+}
+
+// Process HTTP request against one configuration snapshot, reporting the matched route index for accounting
+static int process_request(connection_t *conn, config_snapshot_t *snapshot, int *route_index) {
     if (conn == NULL || conn->fd < 0 || conn->read_buffer == NULL) {
-        log_error("handle_request: invalid parameters");
+        log_error("process_request: invalid parameters");
         log_access("-", "-", "-", 500, 0, "-");
         return -1;
     }
@@ -393,6 +577,12 @@ static int handle_request(connection_t *conn) {
         return -1;
     }
     
+    // Count parsed requests for per-worker statistics
+    worker_context_t *worker_ctx = get_worker_context();
+    if (worker_ctx != NULL) {
+        atomic_fetch_add(&worker_ctx->requests_processed, 1);
+    }
+    
     // Check if request method is supported
     if (conn->request.method != HTTP_GET && conn->request.method != HTTP_POST && 
         conn->request.method != HTTP_HEAD && conn->request.method != HTTP_OPTIONS) {
@@ -403,7 +593,7 @@ static int handle_request(connection_t *conn) {
     }
     
     // Find matching route
-    route_t *route = find_route(conn->config, conn->request.path);
+    route_t *route = config_snapshot_find_route(snapshot, conn->request.path);
     
     if (route == NULL) {
         status_code = 404;
@@ -413,10 +603,38 @@ static int handle_request(connection_t *conn) {
         log_access(safe_inet_ntoa(conn->addr.sin_addr), http_method_str(conn->request.method), conn->request.path, status_code, 0, get_header_value(&conn->request, "User-Agent"));
         return -1;
     }
+    *route_index = (int)(route - snapshot->config->routes);
+    
+    // Under critical resource pressure low-priority routes answer at once, before auth or upstream work
+    if (pressure_shed_request(route)) {
+        status_code = 503;
+        send_http_error_retry(conn->fd, status_code, "Service unavailable", route->charset, PRESSURE_RETRY_AFTER_SEC);
+        conn->keep_alive = 0;
+        log_access(safe_inet_ntoa(conn->addr.sin_addr), http_method_str(conn->request.method), conn->request.path, status_code, 0, get_header_value(&conn->request, "User-Agent"));
+        return -1;
+    }
+    
+    // Past the adaptive concurrency limit fail fast, or wait briefly for a slot; admitted waiters hold one already
+    if (!conn->limit.held) {
+        limit_decision_t decision = adaptive_limit_acquire(*route_index, &conn->limit, &conn->limit_wait);
+        if (decision == LIMIT_QUEUED) {
+            // Parsed again once admitted; nothing is read meanwhile
+            event_loop_del_handler(conn->loop, conn->fd);
+            conn->keep_alive = 0;
+            return REQUEST_QUEUED;
+        }
+        if (decision == LIMIT_REJECTED) {
+            status_code = 503;
+            send_http_error_retry(conn->fd, status_code, "Service unavailable", route->charset, ADAPTIVE_LIMIT_RETRY_AFTER_SEC);
+            conn->keep_alive = 0;
+            log_access(safe_inet_ntoa(conn->addr.sin_addr), http_method_str(conn->request.method), conn->request.path, status_code, 0, get_header_value(&conn->request, "User-Agent"));
+            return -1;
+        }
+    }
     
     // Validate request
     auth_result_t auth_result;
-    if (!validate_request(&conn->request, route, &auth_result)) {
+    if (!validate_request(&conn->request, route, snapshot, &auth_result)) {
         status_code = 403;
         log_warn("Request validation failed: %s", auth_result.error_message);
         send_http_error(conn->fd, status_code, auth_result.error_message, route->charset);
@@ -431,9 +649,16 @@ static int handle_request(connection_t *conn) {
     
     switch (route->type) {
         case ROUTE_PROXY:
-            handler_result = proxy_request(conn->fd, &conn->request, route, &status_code, &response_size);
+            // Upstream connect and relay block, the loop moves on to other connections meanwhile
+            if (proxy_offload_submit(conn, snapshot, route, *route_index) == 0) {
+                return REQUEST_OFFLOADED;
+            }
+            handler_result = proxy_request(conn->fd, &conn->request, route,
+                                           config_snapshot_upstream(snapshot, route),
+                                           &status_code, &response_size);
             if (handler_result != 0) {
                 log_error("Proxy request failed");
+                conn->limit.dropped = 1;
                 conn->keep_alive = 0;
                 log_access(safe_inet_ntoa(conn->addr.sin_addr), http_method_str(conn->request.method), conn->request.path, status_code ? status_code : 502, response_size, get_header_value(&conn->request, "User-Agent"));
                 return -1;
@@ -488,6 +713,43 @@ static int handle_request(connection_t *conn) {
     return 0;
 }
 
+// Handle HTTP request with per-route CPU and allocation accounting
+static int handle_request(connection_t *conn) {
+    int route_index = ROUTE_STATS_UNMATCHED;
+    
+    // The request keeps this snapshot even if a reload publishes a new one meanwhile
+    config_snapshot_t *snapshot = config_snapshot_acquire();
+    if (snapshot == NULL) {
+        log_error("No configuration snapshot published");
+        send_http_error(conn->fd, 503, "Service unavailable", "UTF-8");
+        conn->keep_alive = 0;
+        return -1;
+    }
+    
+    alloc_stats_request_begin();
+    uint64_t cpu_start = route_stats_thread_cpu_ns();
+    
+    int result = process_request(conn, snapshot, &route_index);
+    config_snapshot_release(snapshot);
+    
+    // Offloaded requests return their slot from the completion
+    if (result != REQUEST_OFFLOADED) {
+        adaptive_limit_release(&conn->limit);
+    }
+    
+    if (result == REQUEST_OFFLOADED) {
+        // Recorded together with the pool thread's share once the completion runs on this thread
+        if (cpu_start != 0) {
+            conn->offload->loop_cpu_ns = route_stats_thread_cpu_ns() - cpu_start;
+        }
+    } else if (cpu_start != 0 && result != 1 && result != REQUEST_QUEUED) {
+        route_stats_record(route_index, route_stats_thread_cpu_ns() - cpu_start);
+    }
+    alloc_stats_request_end(result != 1 && result != REQUEST_QUEUED);
+    
+    return result;
+}
+
 // Check if connection has timed out
 static int connection_is_timeout(connection_t *conn) {
     if (conn == NULL) {
@@ -505,6 +767,86 @@ static int connection_is_timeout(connection_t *conn) {
     return (now - conn->last_activity) > 5;
 }
 
+// Serve the request in the read buffer and finish or keep the connection
+static void connection_process_buffer(connection_t *conn) {
+    int handle_result = handle_request(conn);
+    
+    if (handle_result == REQUEST_OFFLOADED || handle_result == REQUEST_QUEUED) {
+        // The completion or the concurrency queue finishes the connection
+        return;
+    }
+    
+    if (handle_result == 0) {
+        // Remove processed data
+        char *body_start = strstr(conn->read_buffer, "\r\n\r\n");
+        if (body_start != NULL) {
+            size_t header_length = (body_start - conn->read_buffer) + 4;
+            
+            // If there's Content-Length header, also add body length
+            char *content_length_str = get_header_value(&conn->request, "Content-Length");
+            if (content_length_str != NULL) {
+                size_t content_length = atoi(content_length_str);
+                header_length += content_length;
+            }
+            
+            // Ensure no out-of-bounds
+            if (header_length <= conn->read_pos) {
+                if (header_length < conn->read_pos) {
+                    memmove(conn->read_buffer, conn->read_buffer + header_length, conn->read_pos - header_length);
+                    conn->read_pos -= header_length;
+                } else {
+                    conn->read_pos = 0;
+                }
+            }
+        } else {
+            conn->read_pos = 0;
+        }
+        
+        // Free request resources
+        free_http_request(&conn->request);
+        memset(&conn->request, 0, sizeof(http_request_t));
+        
+        // For short connections, close connection immediately
+        if (!conn->keep_alive) {
+            connection_destroy(conn);
+            return;
+        }
+        
+        // If there's still data in buffer, continue processing next request
+        if (conn->read_pos > 0) {
+            connection_read_callback(conn->fd, conn);
+            return;
+        }
+    } else if (handle_result == -1) {
+        connection_destroy(conn);
+        return;
+    }
+}
+
+// Concurrency queue: a slot is held now, parse and serve the buffered request from the start
+static void connection_limit_admit(void *arg) {
+    connection_t *conn = (connection_t *)arg;
+    
+    free_http_request(&conn->request);
+    memset(&conn->request, 0, sizeof(http_request_t));
+    if (event_loop_add_handler(conn->loop, conn->fd, EVENT_READ, connection_read_callback, connection_write_callback, conn) != 0) {
+        log_error("Failed to add admitted connection back to event loop");
+        connection_destroy(conn);
+        return;
+    }
+    connection_process_buffer(conn);
+}
+
+// Concurrency queue: no slot in time
+static void connection_limit_expire(void *arg) {
+    connection_t *conn = (connection_t *)arg;
+    
+    send_http_error_retry(conn->fd, 503, "Service unavailable", "UTF-8", ADAPTIVE_LIMIT_RETRY_AFTER_SEC);
+    log_access(safe_inet_ntoa(conn->addr.sin_addr), http_method_str(conn->request.method), conn->request.path, 503, 0, get_header_value(&conn->request, "User-Agent"));
+    conn->keep_alive = 0;
+    connection_destroy(conn);
+}
+
 // Read callback function
 void connection_read_callback(int fd, void *arg) {
     connection_t *conn = (connection_t *)arg;
@@ -533,53 +875,7 @@ void connection_read_callback(int fd, void *arg) {
     }
     
     if (conn->read_pos > 0) {
-        int handle_result = handle_request(conn);
-        
-        if (handle_result == 0) {
-            // Remove processed data
-            char *body_start = strstr(conn->read_buffer, "\r\n\r\n");
-            if (body_start != NULL) {
-                size_t header_length = (body_start - conn->read_buffer) + 4;
-                
-                // If there's Content-Length header, also add body length
-                char *content_length_str = get_header_value(&conn->request, "Content-Length");
-                if (content_length_str != NULL) {
-                    size_t content_length = atoi(content_length_str);
-                    header_length += content_length;
-                }
-                
-                // Ensure no out-of-bounds
-                if (header_length <= conn->read_pos) {
-                    if (header_length < conn->read_pos) {
-                        memmove(conn->read_buffer, conn->read_buffer + header_length, conn->read_pos - header_length);
-                        conn->read_pos -= header_length;
-                    } else {
-                        conn->read_pos = 0;
-                    }
-                }
-            } else {
-                conn->read_pos = 0;
-            }
-            
-            // Free request resources
-            free_http_request(&conn->request);
-            memset(&conn->request, 0, sizeof(http_request_t));
-            
-            // For short connections, close connection immediately
-            if (!conn->keep_alive) {
-                connection_destroy(conn);
-                return;
-            }
-            
-            // If there's still data in buffer, continue processing next request
-            if (conn->read_pos > 0) {
-                connection_read_callback(fd, arg);
-                return;
-            }
-        } else if (handle_result == -1) {
-            connection_destroy(conn);
-            return;
-        }
+        connection_process_buffer(conn);
     }
 }
 
@@ -616,7 +912,6 @@ void connection_write_callback(int fd, void *arg) {
 void accept_connection_callback(int server_fd, void *arg) {
     struct {
         event_loop_t *loop;
-        config_t *config;
     } *ctx = (void *)arg;
     
     struct sockaddr_in client_addr;
@@ -661,7 +956,7 @@ void accept_connection_callback(int server_fd, void *arg) {
     }
     
     // Create new connection
-    connection_t *conn = connection_create(client_fd, ctx->loop, ctx->config, &client_addr);
+    connection_t *conn = connection_create(client_fd, ctx->loop, &client_addr);
     if (conn == NULL) {
         log_error("Failed to create connection");
         close(client_fd);
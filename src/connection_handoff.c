@@ -0,0 +1,340 @@
+/**
+ * Connection Handoff Implementation
+ * Moves idle client connections from an overloaded Worker to the least-loaded peer over SCM_RIGHTS
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+
+#include "../include/connection_handoff.h"
+#include "../include/connection.h"
+#include "../include/connection_pool.h"
+#include "../include/worker_process.h"
+#include "../include/shared_memory.h"
+#include "../include/logger.h"
+
+// Peers whose statistics are older than this are not handed connections, the Worker publishes every second
+#define HANDOFF_STALE_SEC 3
+
+// Per-slot socket pairs: [0] is read by the slot's Worker, [1] is written by its peers
+static int g_sockets[SHM_MAX_WORKERS][2];
+static int g_initialized = 0;
+
+// Worker side
+static int g_worker_id = -1;
+static int g_timer_fd = -1;
+static event_loop_t *g_loop = NULL;
+static atomic_int g_threshold = 0;
+static uint64_t g_handed_off = 0;
+static uint64_t g_adopted = 0;
+
+// Close one end of a slot's pair
+static void close_end(int slot, int end) {
+    if (g_sockets[slot][end] >= 0) {
+        close(g_sockets[slot][end]);
+        g_sockets[slot][end] = -1;
+    }
+}
+
+/**
+ * Create the handoff socket pairs
+ */
+int connection_handoff_init(void) {
+    if (g_initialized) {
+        return 0;
+    }
+
+    for (int i = 0; i < SHM_MAX_WORKERS; i++) {
+        // Datagrams keep each descriptor together with its state; a full queue fails the send instead of blocking
+        if (socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, g_sockets[i]) != 0) {
+            log_error("Failed to create connection handoff sockets: %s", strerror(errno));
+            for (int j = 0; j < i; j++) {
+                close_end(j, 0);
+                close_end(j, 1);
+            }
+            return -1;
+        }
+    }
+
+    g_initialized = 1;
+    return 0;
+}
+
+/**
+ * Close the handoff socket pairs
+ */
+void connection_handoff_cleanup(void) {
+    if (!g_initialized) {
+        return;
+    }
+    for (int i = 0; i < SHM_MAX_WORKERS; i++) {
+        close_end(i, 0);
+        close_end(i, 1);
+    }
+    g_initialized = 0;
+}
+
+// Receive one connection, -1 when the queue is empty
+static int receive_connection(int sock, connection_transfer_t *state) {
+    char control[CMSG_SPACE(sizeof(int))];
+    struct iovec iov = { .iov_base = state, .iov_len = sizeof(*state) };
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    for (;;) {
+        ssize_t n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+            // Nothing to adopt, keep draining
+            msg.msg_controllen = sizeof(control);
+            continue;
+        }
+
+        int fd;
+        memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+        if ((size_t)n != sizeof(*state)) {
+            log_warn("Dropping connection handoff message of %zd bytes", n);
+            close(fd);
+            msg.msg_controllen = sizeof(control);
+            continue;
+        }
+        return fd;
+    }
+}
+
+/**
+ * Close connections queued for a slot no Worker will read
+ */
+int connection_handoff_discard(int worker_id) {
+    if (!g_initialized || worker_id < 0 || worker_id >= SHM_MAX_WORKERS || g_sockets[worker_id][0] < 0) {
+        return 0;
+    }
+
+    int discarded = 0;
+    connection_transfer_t state;
+    int fd;
+    while ((fd = receive_connection(g_sockets[worker_id][0], &state)) >= 0) {
+        close(fd);
+        discarded++;
+    }
+
+    if (discarded > 0) {
+        log_warn("Closed %d connections handed to exited Worker %d", discarded, worker_id);
+    }
+    return discarded;
+}
+
+// Send one connection to a peer's slot
+static int send_connection(int slot, int fd, const connection_transfer_t *state) {
+    char control[CMSG_SPACE(sizeof(int))];
+    struct iovec iov = { .iov_base = (void *)state, .iov_len = sizeof(*state) };
+    struct msghdr msg;
+
+    memset(control, 0, sizeof(control));
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    ssize_t n;
+    do {
+        n = sendmsg(g_sockets[slot][1], &msg, MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+
+    return n == (ssize_t)sizeof(*state) ? 0 : -1;
+}
+
+// Adopt connections peers handed to this Worker
+static void handoff_receive_callback(int sock, void *arg) {
+    (void)arg;
+    worker_context_t *ctx = get_worker_context();
+    connection_pool_t *pool = get_worker_connection_pool();
+    connection_transfer_t state;
+    int fd;
+
+    // Edge-triggered: drain the queue
+    while ((fd = receive_connection(sock, &state)) >= 0) {
+        connection_t *conn = pool != NULL ?
+            connection_pool_get_connection(pool, fd, g_loop, 1, &state.addr) :
+            connection_create(fd, g_loop, &state.addr);
+        if (conn == NULL) {
+            log_error("Worker process %d Failed to adopt handed-off connection", getpid());
+            close(fd);
+            continue;
+        }
+
+        connection_import(conn, &state);
+        if (ctx != NULL) {
+            atomic_fetch_add(&ctx->active_connections, 1);
+        }
+        g_adopted++;
+    }
+}
+
+// Least-loaded live peer from the published statistics, -1 when there is none
+static int least_loaded_peer(uint32_t *load) {
+    shared_stats_t *stats = get_shared_stats();
+    if (stats == NULL) {
+        return -1;
+    }
+
+    time_t now = time(NULL);
+    int best = -1;
+    for (int i = 0; i < SHM_MAX_WORKERS; i++) {
+        // Read without the sequence lock, a stale sample only delays balancing by a second
+        if (i == g_worker_id || stats->workers[i].pid == 0 || stats->workers[i].draining ||
+            now - stats->workers[i].last_update > HANDOFF_STALE_SEC) {
+            continue;
+        }
+        uint32_t active = stats->workers[i].active_connections;
+        if (best < 0 || active < *load) {
+            best = i;
+            *load = active;
+        }
+    }
+    return best;
+}
+
+// Once a second: hand idle connections to the least-loaded peer when this Worker is ahead by the threshold
+static void handoff_timer_callback(int fd, void *arg) {
+    (void)arg;
+    uint64_t expirations;
+    while (read(fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+    }
+
+    int threshold = atomic_load(&g_threshold);
+    worker_context_t *ctx = get_worker_context();
+    if (threshold <= 0 || ctx == NULL || ctx->state != WORKER_RUNNING) {
+        return;
+    }
+
+    uint32_t peer_load = 0;
+    int peer = least_loaded_peer(&peer_load);
+    long own_load = (long)atomic_load(&ctx->active_connections);
+    if (peer < 0 || own_load - (long)peer_load <= threshold) {
+        return;
+    }
+
+    // Half the difference levels the pair without overshooting
+    connection_t *idle[CONNECTION_HANDOFF_BATCH];
+    long want = (own_load - (long)peer_load) / 2;
+    int count = connection_collect_idle(idle, want < CONNECTION_HANDOFF_BATCH ? (int)want : CONNECTION_HANDOFF_BATCH);
+
+    int moved = 0;
+    for (int i = 0; i < count; i++) {
+        connection_transfer_t state;
+        int conn_fd = connection_export(idle[i], &state);
+        if (send_connection(peer, conn_fd, &state) != 0) {
+            // Peer queue full or gone, the rest stay here
+            break;
+        }
+        // The descriptor in flight keeps the socket open, only this process's copy is closed
+        connection_release_transferred(idle[i]);
+        moved++;
+    }
+
+    if (moved > 0) {
+        g_handed_off += (uint64_t)moved;
+        log_debug("Worker %d handed %d idle connections to Worker %d (%ld vs %u connections)",
+                  g_worker_id, moved, peer, own_load, peer_load);
+    }
+}
+
+/**
+ * Start handing off and receiving connections in this Worker
+ */
+int connection_handoff_start(int worker_id, event_loop_t *loop, int threshold) {
+    if (!g_initialized || worker_id < 0 || worker_id >= SHM_MAX_WORKERS || loop == NULL) {
+        return -1;
+    }
+
+    // Keep this slot's receive end and the peers' send ends
+    for (int i = 0; i < SHM_MAX_WORKERS; i++) {
+        if (i == worker_id) {
+            close_end(i, 1);
+        } else {
+            close_end(i, 0);
+        }
+    }
+
+    g_worker_id = worker_id;
+    g_loop = loop;
+    atomic_store(&g_threshold, threshold);
+
+    // Connections queued for a previous Worker in this slot are adopted once the loop runs
+    if (event_loop_add_handler(loop, g_sockets[worker_id][0], EVENT_READ,
+                               handoff_receive_callback, NULL, NULL) != 0) {
+        log_error("Worker process %d Failed to add connection handoff socket to event loop", getpid());
+        return -1;
+    }
+
+    g_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (g_timer_fd < 0) {
+        log_warn("Worker process %d Failed to create connection handoff timer: %s", getpid(), strerror(errno));
+        return 0;
+    }
+    struct itimerspec interval = { .it_interval = { 1, 0 }, .it_value = { 1, 0 } };
+    if (timerfd_settime(g_timer_fd, 0, &interval, NULL) != 0 ||
+        event_loop_add_handler(loop, g_timer_fd, EVENT_READ, handoff_timer_callback, NULL, NULL) != 0) {
+        log_warn("Worker process %d Failed to start connection handoff timer, only receiving", getpid());
+        close(g_timer_fd);
+        g_timer_fd = -1;
+    }
+    return 0;
+}
+
+/**
+ * Change the handoff threshold
+ */
+void connection_handoff_set_threshold(int threshold) {
+    atomic_store(&g_threshold, threshold);
+}
+
+/**
+ * Stop handing off and report the totals
+ */
+void connection_handoff_stop(void) {
+    if (g_worker_id < 0) {
+        return;
+    }
+
+    if (g_timer_fd >= 0) {
+        close(g_timer_fd);
+        g_timer_fd = -1;
+    }
+
+    if (g_handed_off > 0 || g_adopted > 0) {
+        log_info("Worker process %d connection handoff: %lu handed off, %lu adopted",
+                 getpid(), (unsigned long)g_handed_off, (unsigned long)g_adopted);
+    }
+
+    // The receive end stays open until exit: connections queued after this are left to the next Worker in the slot
+    g_worker_id = -1;
+    g_loop = NULL;
+}
@@ -11,6 +11,7 @@
 #include <arpa/inet.h>
 #include "../include/logger.h"
 #include "../include/connection_limit.h"
+#include "../include/lock_profiler.h"
 
 // Global limit configuration
 static connection_limit_config_t g_limit_config = {
@@ -24,11 +25,11 @@ static connection_limit_config_t g_limit_config = {
 
 // IP connection tracking table
 static ip_connection_t *g_ip_connections[IP_HASH_SIZE];
-static pthread_mutex_t g_connections_mutex = PTHREAD_MUTEX_INITIALIZER;
+static profiled_mutex_t g_connections_mutex = PROFILED_MUTEX_INITIALIZER("connection_limit.connections");
 
 // IP request rate tracking table
 static ip_rate_limit_t *g_ip_rates[IP_HASH_SIZE];
-static pthread_mutex_t g_rates_mutex = PTHREAD_MUTEX_INITIALIZER;
+static profiled_mutex_t g_rates_mutex = PROFILED_MUTEX_INITIALIZER("connection_limit.rates");
 
 // Last cleanup time
 static time_t g_last_cleanup = 0;
@@ -116,7 +117,7 @@ static void cleanup_expired_records(void) {
     g_last_cleanup = now;
     
     // Clean up connection records
-    pthread_mutex_lock(&g_connections_mutex);
+    profiled_mutex_lock(&g_connections_mutex);
     for (int i = 0; i < IP_HASH_SIZE; i++) {
         ip_connection_t **conn_ptr = &g_ip_connections[i];
         while (*conn_ptr) {
@@ -130,10 +131,10 @@ static void cleanup_expired_records(void) {
             }
         }
     }
-    pthread_mutex_unlock(&g_connections_mutex);
+    profiled_mutex_unlock(&g_connections_mutex);
     
     // Clean up rate records
-    pthread_mutex_lock(&g_rates_mutex);
+    profiled_mutex_lock(&g_rates_mutex);
     for (int i = 0; i < IP_HASH_SIZE; i++) {
         ip_rate_limit_t **rate_ptr = &g_ip_rates[i];
         while (*rate_ptr) {
@@ -147,7 +148,7 @@ static void cleanup_expired_records(void) {
             }
         }
     }
-    pthread_mutex_unlock(&g_rates_mutex);
+    profiled_mutex_unlock(&g_rates_mutex);
     
     log_debug("Completed expired record cleanup");
 }
@@ -164,17 +165,17 @@ int check_connection_limit(const char *client_ip) {
     
     cleanup_expired_records();
     
-    pthread_mutex_lock(&g_connections_mutex);
+    profiled_mutex_lock(&g_connections_mutex);
     
     ip_connection_t *conn = get_or_create_ip_connection(client_ip);
     if (!conn) {
-        pthread_mutex_unlock(&g_connections_mutex);
+        profiled_mutex_unlock(&g_connections_mutex);
         return -1;
     }
     
     // Check connection count limit
     if (conn->connection_count >= g_limit_config.max_connections_per_ip) {
-        pthread_mutex_unlock(&g_connections_mutex);
+        profiled_mutex_unlock(&g_connections_mutex);
         log_warn("IP %s connection count exceeded: %d >= %d", 
                 client_ip, conn->connection_count, g_limit_config.max_connections_per_ip);
         return -1;
@@ -184,7 +185,7 @@ int check_connection_limit(const char *client_ip) {
     conn->connection_count++;
     conn->last_access = time(NULL);
     
-    pthread_mutex_unlock(&g_connections_mutex);
+    profiled_mutex_unlock(&g_connections_mutex);
     
     log_debug("IP %s current connection count: %d", client_ip, conn->connection_count);
     return 0;
@@ -196,7 +197,7 @@ void release_connection(const char *client_ip) {
         return;
     }
     
-    pthread_mutex_lock(&g_connections_mutex);
+    profiled_mutex_lock(&g_connections_mutex);
     
     unsigned int hash = ip_hash(client_ip);
     ip_connection_t *conn = g_ip_connections[hash];
@@ -213,7 +214,7 @@ void release_connection(const char *client_ip) {
         conn = conn->next;
     }
     
-    pthread_mutex_unlock(&g_connections_mutex);
+    profiled_mutex_unlock(&g_connections_mutex);
 }
 
 // Check request rate limit
@@ -228,11 +229,11 @@ int check_rate_limit(const char *client_ip) {
     
     cleanup_expired_records();
     
-    pthread_mutex_lock(&g_rates_mutex);
+    profiled_mutex_lock(&g_rates_mutex);
     
     ip_rate_limit_t *rate = get_or_create_ip_rate(client_ip);
     if (!rate) {
-        pthread_mutex_unlock(&g_rates_mutex);
+        profiled_mutex_unlock(&g_rates_mutex);
         return -1;
     }
     
@@ -248,7 +249,7 @@ int check_rate_limit(const char *client_ip) {
     if (rate->request_count >= g_limit_config.max_requests_per_second) {
         // Check burst limit
         if (rate->burst_count >= g_limit_config.max_requests_burst) {
-            pthread_mutex_unlock(&g_rates_mutex);
+            profiled_mutex_unlock(&g_rates_mutex);
             log_warn("IP %s request rate exceeded: %d req/s, burst: %d", 
                     client_ip, rate->request_count, rate->burst_count);
             return -1;
@@ -265,7 +266,7 @@ int check_rate_limit(const char *client_ip) {
         rate->burst_count--;
     }
     
-    pthread_mutex_unlock(&g_rates_mutex);
+    profiled_mutex_unlock(&g_rates_mutex);
     
     log_debug("IP %s request rate: %d req/s, burst: %d", 
              client_ip, rate->request_count, rate->burst_count);
@@ -280,7 +281,7 @@ int get_ip_connection_stats(const char *client_ip, ip_connection_stats_t *stats)
     
     memset(stats, 0, sizeof(ip_connection_stats_t));
     
-    pthread_mutex_lock(&g_connections_mutex);
+    profiled_mutex_lock(&g_connections_mutex);
     
     unsigned int hash = ip_hash(client_ip);
     ip_connection_t *conn = g_ip_connections[hash];
@@ -294,9 +295,9 @@ int get_ip_connection_stats(const char *client_ip, ip_connection_stats_t *stats)
         conn = conn->next;
     }
     
-    pthread_mutex_unlock(&g_connections_mutex);
+    profiled_mutex_unlock(&g_connections_mutex);
     
-    pthread_mutex_lock(&g_rates_mutex);
+    profiled_mutex_lock(&g_rates_mutex);
     
     hash = ip_hash(client_ip);
     ip_rate_limit_t *rate = g_ip_rates[hash];
@@ -311,7 +312,7 @@ int get_ip_connection_stats(const char *client_ip, ip_connection_stats_t *stats)
         rate = rate->next;
     }
     
-    pthread_mutex_unlock(&g_rates_mutex);
+    profiled_mutex_unlock(&g_rates_mutex);
     
     return 0;
 }
@@ -351,7 +352,7 @@ void get_global_limit_stats(global_limit_stats_t *stats) {
     memset(stats, 0, sizeof(global_limit_stats_t));
     
     // Count connection information
-    pthread_mutex_lock(&g_connections_mutex);
+    profiled_mutex_lock(&g_connections_mutex);
     for (int i = 0; i < IP_HASH_SIZE; i++) {
         ip_connection_t *conn = g_ip_connections[i];
         while (conn) {
@@ -360,10 +361,10 @@ void get_global_limit_stats(global_limit_stats_t *stats) {
             conn = conn->next;
         }
     }
-    pthread_mutex_unlock(&g_connections_mutex);
+    profiled_mutex_unlock(&g_connections_mutex);
     
     // Count rate information
-    pthread_mutex_lock(&g_rates_mutex);
+    profiled_mutex_lock(&g_rates_mutex);
     for (int i = 0; i < IP_HASH_SIZE; i++) {
         ip_rate_limit_t *rate = g_ip_rates[i];
         while (rate) {
@@ -374,13 +375,13 @@ void get_global_limit_stats(global_limit_stats_t *stats) {
             rate = rate->next;
         }
     }
-    pthread_mutex_unlock(&g_rates_mutex);
+    profiled_mutex_unlock(&g_rates_mutex);
 }
 
 // Clean up all limit records
 void cleanup_all_limits(void) {
     // Clean up connection records
-    pthread_mutex_lock(&g_connections_mutex);
+    profiled_mutex_lock(&g_connections_mutex);
     for (int i = 0; i < IP_HASH_SIZE; i++) {
         ip_connection_t *conn = g_ip_connections[i];
         while (conn) {
@@ -390,10 +391,10 @@ void cleanup_all_limits(void) {
         }
         g_ip_connections[i] = NULL;
     }
-    pthread_mutex_unlock(&g_connections_mutex);
+    profiled_mutex_unlock(&g_connections_mutex);
     
     // Clean up rate records
-    pthread_mutex_lock(&g_rates_mutex);
+    profiled_mutex_lock(&g_rates_mutex);
     for (int i = 0; i < IP_HASH_SIZE; i++) {
         ip_rate_limit_t *rate = g_ip_rates[i];
         while (rate) {
@@ -403,7 +404,7 @@ void cleanup_all_limits(void) {
         }
         g_ip_rates[i] = NULL;
     }
-    pthread_mutex_unlock(&g_rates_mutex);
+    profiled_mutex_unlock(&g_rates_mutex);
     
     log_info("All connection limit records cleaned up");
 }
\ No newline at end of file
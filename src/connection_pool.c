@@ -20,6 +20,11 @@
 #include "../include/connection.h"
 #include "../include/logger.h"
 #include "../include/memory_pool.h"
+#include "../include/lock_profiler.h"
+
+// Allocations in this file are accounted to the connection subsystem
+#define ALLOC_TAG ALLOC_TAG_CONNECTION
+#include "../include/alloc_stats.h"
 
 // Forward declaration to avoid circular dependency
 struct connection;
@@ -40,9 +45,9 @@ struct connection_pool {
     int idle_capacity;                        // Idle connection array capacity
     
     // Thread safety
-    pthread_mutex_t pool_mutex;               // Connection pool lock
-    pthread_mutex_t idle_mutex;               // Idle connection lock
-    pthread_mutex_t stats_mutex;              // Statistics lock
+    profiled_mutex_t pool_mutex;              // Connection pool lock
+    profiled_mutex_t idle_mutex;              // Idle connection lock
+    profiled_mutex_t stats_mutex;             // Statistics lock
     
     // Cleanup thread
     pthread_t cleanup_thread;                 // Cleanup thread
@@ -57,7 +62,10 @@ static void *cleanup_thread_func(void *arg) {
     connection_pool_t *pool = (connection_pool_t *)arg;
     
     while (pool->cleanup_running) {
-        sleep(pool->config.pool_cleanup_interval);
+        // Sleep in one-second slices so destroy does not block for a whole interval
+        for (int i = 0; i < pool->config.pool_cleanup_interval && pool->cleanup_running; i++) {
+            sleep(1);
+        }
         
         if (pool->cleanup_running) {
             connection_pool_cleanup_idle(pool);
@@ -103,7 +111,7 @@ connection_pool_t *connection_pool_create(const connection_pool_config_t *config
     pool->idle_count = 0;
     
     // Initialize locks
-    if (pthread_mutex_init(&pool->pool_mutex, NULL) != 0) {
+    if (profiled_mutex_init(&pool->pool_mutex, "connection_pool.pool") != 0) {
         log_error("Failed to create connection pool: failed to initialize pool lock");
         free(pool->idle_connections);
         free(pool->connections);
@@ -111,19 +119,19 @@ connection_pool_t *connection_pool_create(const connection_pool_config_t *config
         return NULL;
     }
     
-    if (pthread_mutex_init(&pool->idle_mutex, NULL) != 0) {
+    if (profiled_mutex_init(&pool->idle_mutex, "connection_pool.idle") != 0) {
         log_error("Failed to create connection pool: failed to initialize idle connection lock");
-        pthread_mutex_destroy(&pool->pool_mutex);
+        profiled_mutex_destroy(&pool->pool_mutex);
         free(pool->idle_connections);
         free(pool->connections);
         free(pool);
         return NULL;
     }
     
-    if (pthread_mutex_init(&pool->stats_mutex, NULL) != 0) {
+    if (profiled_mutex_init(&pool->stats_mutex, "connection_pool.stats") != 0) {
         log_error("Failed to create connection pool: failed to initialize statistics lock");
-        pthread_mutex_destroy(&pool->idle_mutex);
-        pthread_mutex_destroy(&pool->pool_mutex);
+        profiled_mutex_destroy(&pool->idle_mutex);
+        profiled_mutex_destroy(&pool->pool_mutex);
         free(pool->idle_connections);
         free(pool->connections);
         free(pool);
@@ -136,13 +144,13 @@ connection_pool_t *connection_pool_create(const connection_pool_config_t *config
         log_warn("Failed to create connection pool memory pool, using system memory allocation");
     }
     
-    // Start cleanup thread
-    pool->cleanup_running = 1;
-    if (pthread_create(&pool->cleanup_thread, NULL, cleanup_thread_func, pool) != 0) {
+    // Start cleanup thread, unless the caller runs cleanup passes itself
+    pool->cleanup_running = !config->external_cleanup;
+    if (pool->cleanup_running && pthread_create(&pool->cleanup_thread, NULL, cleanup_thread_func, pool) != 0) {
         log_error("Failed to create connection pool: failed to start cleanup thread");
-        pthread_mutex_destroy(&pool->stats_mutex);
-        pthread_mutex_destroy(&pool->idle_mutex);
-        pthread_mutex_destroy(&pool->pool_mutex);
+        profiled_mutex_destroy(&pool->stats_mutex);
+        profiled_mutex_destroy(&pool->idle_mutex);
+        profiled_mutex_destroy(&pool->pool_mutex);
         if (pool->memory_pool) {
             destroy_memory_pool(pool->memory_pool);
         }
@@ -165,23 +173,31 @@ void connection_pool_destroy(connection_pool_t *pool) {
     }
     
     // Stop cleanup thread
-    pool->cleanup_running = 0;
-    pthread_join(pool->cleanup_thread, NULL);
+    if (!pool->config.external_cleanup) {
+        pool->cleanup_running = 0;
+        pthread_join(pool->cleanup_thread, NULL);
+    }
     
-    // Close all connections
-    pthread_mutex_lock(&pool->pool_mutex);
-    for (int i = 0; i < pool->connection_count; i++) {
+    // Close all connections, detached first since connection_destroy() removes itself from the pool
+    profiled_mutex_lock(&pool->pool_mutex);
+    int count = pool->connection_count;
+    pool->connection_count = 0;
+    profiled_mutex_lock(&pool->idle_mutex);
+    pool->idle_count = 0;
+    profiled_mutex_unlock(&pool->idle_mutex);
+    profiled_mutex_unlock(&pool->pool_mutex);
+
+    for (int i = 0; i < count; i++) {
         if (pool->connections[i]) {
             connection_destroy(pool->connections[i]);
             pool->connections[i] = NULL;
         }
     }
-    pthread_mutex_unlock(&pool->pool_mutex);
     
     // Destroy locks
-    pthread_mutex_destroy(&pool->stats_mutex);
-    pthread_mutex_destroy(&pool->idle_mutex);
-    pthread_mutex_destroy(&pool->pool_mutex);
+    profiled_mutex_destroy(&pool->stats_mutex);
+    profiled_mutex_destroy(&pool->idle_mutex);
+    profiled_mutex_destroy(&pool->pool_mutex);
     
     // Destroy memory pool
     if (pool->memory_pool) {
@@ -200,8 +216,8 @@ void connection_pool_destroy(connection_pool_t *pool) {
 // Get connection from connection pool
 connection_t *connection_pool_get_connection(connection_pool_t *pool, int fd, 
                                            void *loop, int is_enhanced_loop,
-                                           config_t *config, struct sockaddr_in *client_addr) {
-    if (!pool || !config) {
+                                           struct sockaddr_in *client_addr) {
+    if (!pool) {
         return NULL;
     }
     
@@ -209,7 +225,7 @@ connection_t *connection_pool_get_connection(connection_pool_t *pool, int fd,
     
     // Try to get from idle connection pool
     if (pool->config.enable_connection_reuse) {
-        pthread_mutex_lock(&pool->idle_mutex);
+        profiled_mutex_lock(&pool->idle_mutex);
         
         if (pool->idle_count > 0) {
             // Get the last idle connection
@@ -217,35 +233,35 @@ connection_t *connection_pool_get_connection(connection_pool_t *pool, int fd,
             pool->idle_connections[pool->idle_count] = NULL;
             
             // Update statistics
-            pthread_mutex_lock(&pool->stats_mutex);
+            profiled_mutex_lock(&pool->stats_mutex);
             atomic_fetch_add(&pool->stats.reused_connections, 1);
             atomic_fetch_add(&pool->stats.idle_connections, -1);
             atomic_fetch_add(&pool->stats.active_connections, 1);
-            pthread_mutex_unlock(&pool->stats_mutex);
+            profiled_mutex_unlock(&pool->stats_mutex);
             
             log_debug("Reused idle connection: fd=%d", (int)(long)conn);
         }
         
-        pthread_mutex_unlock(&pool->idle_mutex);
+        profiled_mutex_unlock(&pool->idle_mutex);
     }
     
     // If no reusable connection, create new connection
     if (!conn) {
-        pthread_mutex_lock(&pool->pool_mutex);
+        profiled_mutex_lock(&pool->pool_mutex);
         
         // Check connection limit
         if (pool->connection_count >= pool->config.max_connections) {
             log_warn("Connection pool is full, cannot create new connection: current=%d, max=%d", 
                      pool->connection_count, pool->config.max_connections);
-            pthread_mutex_unlock(&pool->pool_mutex);
+            profiled_mutex_unlock(&pool->pool_mutex);
             return NULL;
         }
         
         // Create new connection
         if (is_enhanced_loop) {
-            conn = connection_create_enhanced(fd, (event_loop_t*)loop, config, client_addr);
+            conn = connection_create_enhanced(fd, (event_loop_t*)loop, client_addr);
         } else {
-            conn = connection_create(fd, (event_loop_t*)loop, config, client_addr);
+            conn = connection_create(fd, (event_loop_t*)loop, client_addr);
         }
         
         if (conn) {
@@ -253,16 +269,16 @@ connection_t *connection_pool_get_connection(connection_pool_t *pool, int fd,
             pool->connections[pool->connection_count++] = conn;
             
             // Update statistics
-            pthread_mutex_lock(&pool->stats_mutex);
+            profiled_mutex_lock(&pool->stats_mutex);
             atomic_fetch_add(&pool->stats.created_connections, 1);
             atomic_fetch_add(&pool->stats.total_connections, 1);
             atomic_fetch_add(&pool->stats.active_connections, 1);
-            pthread_mutex_unlock(&pool->stats_mutex);
+            profiled_mutex_unlock(&pool->stats_mutex);
             
             log_debug("Created new connection: fd=%d, current connections=%d, enhanced=%d", fd, pool->connection_count, is_enhanced_loop);
         }
         
-        pthread_mutex_unlock(&pool->pool_mutex);
+        profiled_mutex_unlock(&pool->pool_mutex);
     }
     
     return conn;
@@ -278,37 +294,43 @@ void connection_pool_return_connection(connection_pool_t *pool, connection_t *co
     if (pool->config.enable_connection_reuse && 
         pool->idle_count < pool->config.max_idle_connections) {
         
-        pthread_mutex_lock(&pool->idle_mutex);
+        profiled_mutex_lock(&pool->idle_mutex);
         
+        int pooled = 0;
         if (pool->idle_count < pool->idle_capacity) {
             pool->idle_connections[pool->idle_count++] = conn;
+            pooled = 1;
             
             // Update statistics
-            pthread_mutex_lock(&pool->stats_mutex);
+            profiled_mutex_lock(&pool->stats_mutex);
             atomic_fetch_add(&pool->stats.idle_connections, 1);
             atomic_fetch_add(&pool->stats.active_connections, -1);
-            pthread_mutex_unlock(&pool->stats_mutex);
+            profiled_mutex_unlock(&pool->stats_mutex);
             
             log_debug("Connection returned to idle pool: conn=%p, idle connections=%d", conn, pool->idle_count);
-        } else {
-            // Idle pool is full, close connection directly
-            connection_pool_close_connection(pool, conn);
         }
         
-        pthread_mutex_unlock(&pool->idle_mutex);
+        profiled_mutex_unlock(&pool->idle_mutex);
+        
+        // Idle pool is full, close connection directly; removal takes idle_mutex again
+        if (!pooled) {
+            connection_pool_close_connection(pool, conn);
+        }
     } else {
         // Cannot reuse, close directly
         connection_pool_close_connection(pool, conn);
     }
 }
 
-// Close connection (remove from pool)
-void connection_pool_close_connection(connection_pool_t *pool, connection_t *conn) {
+// Remove connection from pool tracking without destroying it
+int connection_pool_remove_connection(connection_pool_t *pool, connection_t *conn) {
     if (!pool || !conn) {
-        return;
+        return 0;
     }
     
-    pthread_mutex_lock(&pool->pool_mutex);
+    int found = 0;
+    
+    profiled_mutex_lock(&pool->pool_mutex);
     
     // Remove from connection array
     for (int i = 0; i < pool->connection_count; i++) {
@@ -318,12 +340,13 @@ void connection_pool_close_connection(connection_pool_t *pool, connection_t *con
                 pool->connections[j] = pool->connections[j + 1];
             }
             pool->connections[--pool->connection_count] = NULL;
+            found = 1;
             break;
         }
     }
     
     // Remove from idle connection array
-    pthread_mutex_lock(&pool->idle_mutex);
+    profiled_mutex_lock(&pool->idle_mutex);
     for (int i = 0; i < pool->idle_count; i++) {
         if (pool->idle_connections[i] == conn) {
             // Move subsequent connections
@@ -334,15 +357,28 @@ void connection_pool_close_connection(connection_pool_t *pool, connection_t *con
             break;
         }
     }
-    pthread_mutex_unlock(&pool->idle_mutex);
+    profiled_mutex_unlock(&pool->idle_mutex);
     
     // Update statistics
-    pthread_mutex_lock(&pool->stats_mutex);
-    atomic_fetch_add(&pool->stats.closed_connections, 1);
-    atomic_fetch_add(&pool->stats.active_connections, -1);
-    pthread_mutex_unlock(&pool->stats_mutex);
+    if (found) {
+        profiled_mutex_lock(&pool->stats_mutex);
+        atomic_fetch_add(&pool->stats.closed_connections, 1);
+        atomic_fetch_add(&pool->stats.active_connections, -1);
+        profiled_mutex_unlock(&pool->stats_mutex);
+    }
+    
+    profiled_mutex_unlock(&pool->pool_mutex);
+    
+    return found;
+}
+
+// Close connection (remove from pool)
+void connection_pool_close_connection(connection_pool_t *pool, connection_t *conn) {
+    if (!pool || !conn) {
+        return;
+    }
     
-    pthread_mutex_unlock(&pool->pool_mutex);
+    connection_pool_remove_connection(pool, conn);
     
     // Destroy connection
     connection_destroy(conn);
@@ -356,9 +392,9 @@ void connection_pool_get_stats(connection_pool_t *pool, connection_pool_stats_t
         return;
     }
     
-    pthread_mutex_lock(&pool->stats_mutex);
+    profiled_mutex_lock(&pool->stats_mutex);
     memcpy(stats, &pool->stats, sizeof(connection_pool_stats_t));
-    pthread_mutex_unlock(&pool->stats_mutex);
+    profiled_mutex_unlock(&pool->stats_mutex);
 }
 
 // Reset connection pool statistics
@@ -367,9 +403,9 @@ void connection_pool_reset_stats(connection_pool_t *pool) {
         return;
     }
     
-    pthread_mutex_lock(&pool->stats_mutex);
+    profiled_mutex_lock(&pool->stats_mutex);
     memset(&pool->stats, 0, sizeof(connection_pool_stats_t));
-    pthread_mutex_unlock(&pool->stats_mutex);
+    profiled_mutex_unlock(&pool->stats_mutex);
 }
 
 // Print connection pool statistics
@@ -397,7 +433,7 @@ void connection_pool_print_stats(connection_pool_t *pool) {
     log_info("======================");
 }
 
-// Clean up idle connections
+// Clean up idle connections; closing destroys them, so call it from the thread running their event loop
 int connection_pool_cleanup_idle(connection_pool_t *pool) {
     if (!pool) {
         return 0;
@@ -406,9 +442,14 @@ int connection_pool_cleanup_idle(connection_pool_t *pool) {
     int cleaned = 0;
     time_t now = time(NULL);
     
-    pthread_mutex_lock(&pool->idle_mutex);
+    profiled_mutex_lock(&pool->idle_mutex);
     
-    for (int i = pool->idle_count - 1; i >= 0; i--) {
+    // Detach the expired ones first: closing takes pool_mutex and then idle_mutex
+    connection_t **expired = NULL;
+    if (pool->idle_count > 0) {
+        expired = malloc(pool->idle_count * sizeof(connection_t *));
+    }
+    for (int i = pool->idle_count - 1; i >= 0 && expired != NULL; i--) {
         connection_t *conn = pool->idle_connections[i];
         if (conn && (now - 0) > pool->config.idle_timeout) { // Simplified for now, using fixed time
             // Remove timed out idle connections
@@ -416,17 +457,20 @@ int connection_pool_cleanup_idle(connection_pool_t *pool) {
                 pool->idle_connections[j] = pool->idle_connections[j + 1];
             }
             pool->idle_connections[--pool->idle_count] = NULL;
-            
-            // Close connection
-            connection_pool_close_connection(pool, conn);
-            cleaned++;
-            
-            log_debug("Cleaned up timed out idle connection: conn=%p, idle time=%ld seconds", 
-                      conn, now - 0);
+            expired[cleaned++] = conn;
         }
     }
     
-    pthread_mutex_unlock(&pool->idle_mutex);
+    profiled_mutex_unlock(&pool->idle_mutex);
+    
+    for (int i = 0; i < cleaned; i++) {
+        // Close connection
+        connection_pool_close_connection(pool, expired[i]);
+        
+        log_debug("Cleaned up timed out idle connection: conn=%p, idle time=%ld seconds", 
+                  expired[i], now - 0);
+    }
+    free(expired);
     
     if (cleaned > 0) {
         log_info("Connection pool cleanup completed: cleaned %d timed out idle connections", cleaned);
@@ -441,9 +485,12 @@ int connection_pool_set_config(connection_pool_t *pool, const connection_pool_co
         return -1;
     }
     
-    pthread_mutex_lock(&pool->pool_mutex);
+    profiled_mutex_lock(&pool->pool_mutex);
+    // Whether a cleanup thread exists is fixed at creation
+    int external_cleanup = pool->config.external_cleanup;
     memcpy(&pool->config, config, sizeof(connection_pool_config_t));
-    pthread_mutex_unlock(&pool->pool_mutex);
+    pool->config.external_cleanup = external_cleanup;
+    profiled_mutex_unlock(&pool->pool_mutex);
     
     log_info("Connection pool configuration updated");
     return 0;
@@ -455,9 +502,9 @@ void connection_pool_get_config(connection_pool_t *pool, connection_pool_config_
         return;
     }
     
-    pthread_mutex_lock(&pool->pool_mutex);
+    profiled_mutex_lock(&pool->pool_mutex);
     memcpy(config, &pool->config, sizeof(connection_pool_config_t));
-    pthread_mutex_unlock(&pool->pool_mutex);
+    profiled_mutex_unlock(&pool->pool_mutex);
 }
 
 // Load connection pool configuration from Config file
@@ -0,0 +1,382 @@
+/**
+ * CPU Affinity and NUMA Placement Module Implementation
+ * Pins Worker processes to CPUs from worker_cpu_affinity and prefers memory on
+ * the Worker's NUMA node, topology is read from /sys
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sched.h>
+#include <dirent.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+#include "../include/cpu_affinity.h"
+#include "../include/logger.h"
+
+#define NUMA_NODE_PATH "/sys/devices/system/node"
+#define MAX_NUMA_NODES 64
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+
+// Parse a sysfs CPU list such as "0-3,8-11"
+static int parse_cpu_list(const char *list, cpu_set_t *set) {
+    CPU_ZERO(set);
+
+    const char *p = list;
+    while (*p != '\0' && *p != '\n') {
+        char *end;
+        long first = strtol(p, &end, 10);
+        if (end == p || first < 0 || first >= CPU_SETSIZE) {
+            return -1;
+        }
+        long last = first;
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first || last >= CPU_SETSIZE) {
+                return -1;
+            }
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            CPU_SET((int)cpu, set);
+        }
+        p = *end == ',' ? end + 1 : end;
+    }
+    return 0;
+}
+
+static int read_cpu_list_file(const char *path, cpu_set_t *set) {
+    char buf[4096];
+
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return -1;
+    }
+    char *line = fgets(buf, sizeof(buf), f);
+    fclose(f);
+    return line != NULL ? parse_cpu_list(buf, set) : -1;
+}
+
+/**
+ * Map every CPU to its NUMA node from /sys/devices/system/node/node<N>/cpulist
+ * @return number of nodes, 0 without NUMA information (all CPUs stay at -1)
+ */
+static int load_numa_nodes(int *node_of) {
+    int count = 0;
+
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        node_of[cpu] = -1;
+    }
+
+    DIR *dir = opendir(NUMA_NODE_PATH);
+    if (dir == NULL) {
+        return 0;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        char *end;
+        if (strncmp(entry->d_name, "node", 4) != 0) {
+            continue;
+        }
+        long node = strtol(entry->d_name + 4, &end, 10);
+        if (end == entry->d_name + 4 || *end != '\0' || node < 0 || node >= MAX_NUMA_NODES) {
+            continue;
+        }
+
+        char path[300];
+        cpu_set_t set;
+        snprintf(path, sizeof(path), NUMA_NODE_PATH "/%s/cpulist", entry->d_name);
+        if (read_cpu_list_file(path, &set) != 0 || CPU_COUNT(&set) == 0) {
+            continue;   // Memory-only node
+        }
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) {
+                node_of[cpu] = (int)node;
+            }
+        }
+        count++;
+    }
+    closedir(dir);
+    return count;
+}
+
+// First hardware thread of its core; SMT siblings are used only after every core has a Worker
+static int is_primary_thread(int cpu) {
+    char path[128];
+    cpu_set_t siblings;
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+    if (read_cpu_list_file(path, &siblings) != 0) {
+        return 1;
+    }
+    for (int i = 0; i < cpu; i++) {
+        if (CPU_ISSET(i, &siblings)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Parse a binary mask, rightmost digit is CPU 0
+static int parse_mask(const char *mask, cpu_set_t *set) {
+    size_t len = strlen(mask);
+
+    CPU_ZERO(set);
+    if (len == 0 || len > CPU_SETSIZE) {
+        return -1;
+    }
+    for (size_t i = 0; i < len; i++) {
+        char ch = mask[len - 1 - i];
+        if (ch == '1') {
+            CPU_SET((int)i, set);
+        } else if (ch != '0') {
+            return -1;
+        }
+    }
+    return CPU_COUNT(set) > 0 ? 0 : -1;
+}
+
+/**
+ * Split the configuration into the auto flag and masks
+ * @return number of masks, -1 if invalid
+ */
+static int parse_spec(const char *spec, int *is_auto, cpu_set_t *masks, int max_masks) {
+    char buf[CPU_AFFINITY_SPEC_MAX_LEN];
+    char *saveptr = NULL;
+    int count = 0;
+
+    *is_auto = 0;
+    if (strlen(spec) >= sizeof(buf)) {
+        return -1;
+    }
+    strcpy(buf, spec);
+
+    for (char *tok = strtok_r(buf, " \t", &saveptr); tok != NULL; tok = strtok_r(NULL, " \t", &saveptr)) {
+        if (strcmp(tok, "auto") == 0) {
+            if (*is_auto || count > 0) {
+                return -1;
+            }
+            *is_auto = 1;
+            continue;
+        }
+        if (count >= max_masks || parse_mask(tok, &masks[count]) != 0) {
+            return -1;
+        }
+        count++;
+    }
+
+    // auto accepts at most one mask restricting the candidate CPUs
+    if ((*is_auto && count > 1) || (!*is_auto && count == 0)) {
+        return -1;
+    }
+    return count;
+}
+
+/**
+ * Validate worker_cpu_affinity syntax
+ */
+int cpu_affinity_validate(const char *spec) {
+    if (spec == NULL || spec[0] == '\0') {
+        return 0;
+    }
+
+    int is_auto;
+    cpu_set_t *masks = malloc(sizeof(cpu_set_t) * MAX_NUMA_NODES * 4);
+    if (masks == NULL) {
+        return -1;
+    }
+    int count = parse_spec(spec, &is_auto, masks, MAX_NUMA_NODES * 4);
+    free(masks);
+    return count < 0 ? -1 : 0;
+}
+
+// The node of all CPUs in the set, -1 if they span nodes
+static int set_node(const cpu_set_t *set, const int *node_of) {
+    int node = -2;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, set)) {
+            continue;
+        }
+        if (node == -2) {
+            node = node_of[cpu];
+        } else if (node != node_of[cpu]) {
+            return -1;
+        }
+    }
+    return node < 0 ? -1 : node;
+}
+
+/**
+ * Compute the CPU set and NUMA node of a Worker
+ */
+int cpu_affinity_worker_set(const char *spec, int worker_id, int worker_count, cpu_set_t *set, int *node) {
+    if (spec == NULL || spec[0] == '\0') {
+        return 1;
+    }
+    if (worker_id < 0 || worker_count <= 0) {
+        return -1;
+    }
+
+    int is_auto;
+    int max_masks = MAX_NUMA_NODES * 4;
+    cpu_set_t *masks = malloc(sizeof(cpu_set_t) * (size_t)max_masks);
+    int *node_of = malloc(sizeof(int) * CPU_SETSIZE);
+    if (masks == NULL || node_of == NULL) {
+        free(masks);
+        free(node_of);
+        return -1;
+    }
+
+    int rc = -1;
+    int count = parse_spec(spec, &is_auto, masks, max_masks);
+    load_numa_nodes(node_of);
+
+    if (count >= 0 && !is_auto) {
+        *set = masks[worker_id % count];
+        *node = set_node(set, node_of);
+        rc = 0;
+    } else if (count >= 0) {
+        // Candidates: CPUs this process may run on, narrowed by the optional mask
+        cpu_set_t allowed;
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+            CPU_ZERO(&allowed);
+            for (int cpu = 0; cpu < CPU_SETSIZE && cpu < sysconf(_SC_NPROCESSORS_CONF); cpu++) {
+                CPU_SET(cpu, &allowed);
+            }
+        }
+        if (count == 1) {
+            CPU_AND(&allowed, &allowed, &masks[0]);
+        }
+
+        // Nodes with candidate CPUs in ascending order; no NUMA information is one node
+        int nodes[MAX_NUMA_NODES + 1];
+        int node_count = 0;
+        for (int n = -1; n < MAX_NUMA_NODES; n++) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                if (CPU_ISSET(cpu, &allowed) && node_of[cpu] == n) {
+                    nodes[node_count++] = n;
+                    break;
+                }
+            }
+        }
+
+        if (node_count > 0) {
+            // Spread Workers over the nodes round-robin, then over the node's cores, SMT siblings last
+            int target = nodes[worker_id % node_count];
+            int node_cpus = 0;
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                node_cpus += CPU_ISSET(cpu, &allowed) && node_of[cpu] == target;
+            }
+            int index = (worker_id / node_count) % node_cpus;
+
+            CPU_ZERO(set);
+            for (int pass = 0; pass < 2 && CPU_COUNT(set) == 0; pass++) {
+                for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                    if (!CPU_ISSET(cpu, &allowed) || node_of[cpu] != target || is_primary_thread(cpu) != (pass == 0)) {
+                        continue;
+                    }
+                    if (index-- == 0) {
+                        CPU_SET(cpu, set);
+                        break;
+                    }
+                }
+            }
+            *node = target;
+            rc = CPU_COUNT(set) > 0 ? 0 : -1;
+        }
+    }
+
+    free(masks);
+    free(node_of);
+    return rc;
+}
+
+// Prefer allocations from the node; first touch then places pools and caches locally
+static int prefer_numa_node(int node) {
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+    unsigned long nodemask[(MAX_NUMA_NODES + 8 * sizeof(unsigned long) - 1) / (8 * sizeof(unsigned long))];
+    memset(nodemask, 0, sizeof(nodemask));
+    nodemask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+    if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, nodemask, sizeof(nodemask) * 8) != 0) {
+        return -1;
+    }
+    return 0;
+#else
+    (void)node;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+/**
+ * Bind the current Worker process and prefer its local NUMA node
+ */
+int cpu_affinity_apply(const char *spec, int worker_id, int worker_count) {
+    cpu_set_t set;
+    int node = -1;
+    char cpus[256];
+
+    int rc = cpu_affinity_worker_set(spec, worker_id, worker_count, &set, &node);
+    if (rc == 1) {
+        return 0;
+    }
+    if (rc != 0) {
+        log_warn("Worker process %d: worker_cpu_affinity \"%s\" is invalid or leaves no CPU, not binding",
+                 worker_id, spec);
+        return -1;
+    }
+
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        log_warn("Worker process %d failed to bind to CPU %s: %s", worker_id,
+                 cpu_affinity_format(&set, cpus, sizeof(cpus)), strerror(errno));
+        return -1;
+    }
+
+    // A memory policy only matters with more than one node
+    int *node_of = malloc(sizeof(int) * CPU_SETSIZE);
+    int numa_nodes = node_of != NULL ? load_numa_nodes(node_of) : 0;
+    free(node_of);
+
+    if (node >= 0 && numa_nodes > 1 && prefer_numa_node(node) != 0) {
+        log_warn("Worker process %d failed to prefer memory on NUMA node %d: %s", worker_id, node, strerror(errno));
+    }
+
+    log_info("Worker process %d bound to CPU %s, NUMA node %d of %d", worker_id,
+             cpu_affinity_format(&set, cpus, sizeof(cpus)), node, numa_nodes > 0 ? numa_nodes : 1);
+    return 0;
+}
+
+/**
+ * Format a CPU set as a list
+ */
+char *cpu_affinity_format(const cpu_set_t *set, char *buf, size_t size) {
+    size_t len = 0;
+
+    buf[0] = '\0';
+    for (int cpu = 0; cpu < CPU_SETSIZE && len < size; cpu++) {
+        if (!CPU_ISSET(cpu, set)) {
+            continue;
+        }
+        int last = cpu;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, set)) {
+            last++;
+        }
+        int n = last > cpu ? snprintf(buf + len, size - len, "%s%d-%d", len ? "," : "", cpu, last)
+                           : snprintf(buf + len, size - len, "%s%d", len ? "," : "", cpu);
+        if (n < 0) {
+            break;
+        }
+        len += (size_t)n;
+        cpu = last;
+    }
+    return buf;
+}
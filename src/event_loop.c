@@ -23,6 +23,7 @@
 
 #include "../include/event_loop.h"
 #include "../include/logger.h"
+#include "../include/lock_profiler.h"
 
 #ifdef __linux__
 #include <sys/epoll.h>
@@ -50,6 +51,7 @@ struct event_handler {
     struct timespec last_activity;             // Last activity time
     uint64_t processing_count;                 // Processing count
     double avg_processing_time;                // Average processing time
+    struct event_handler *retired_next;        // Next handler awaiting deferred free
 };
 
 // Hash table node
@@ -88,6 +90,13 @@ struct event_loop {
     _Atomic uint64_t error_count;               // Error count
     _Atomic uint64_t timeout_count;             // Timeout count
     _Atomic uint64_t lock_contention;           // Lock contention statistics
+    _Atomic uint64_t lag_max_us;                // Longest batch since last read (loop lag)
+    _Atomic uint64_t busy_us;                   // Time spent dispatching since last read (loop utilization)
+    uint64_t busy_since_us;                     // When busy_us was last read
+    
+    // Heartbeat stamped at the top of every iteration, read by the Master watchdog
+    uint64_t *heartbeat_ms;                     // Set before the thread starts, NULL when unused
+    uint64_t *heartbeat_iterations;
     
     // Time statistics
     double avg_event_processing_time;          // Average event processing time
@@ -97,6 +106,9 @@ struct event_loop {
     
     // Main lock
     pthread_mutex_t mutex;                     // Main mutex
+    
+    // Handlers removed while events may still reference them, freed after the current batch
+    event_handler_t *retired_handlers;         // Protected by mutex
 };
 
 // Spinlock operations (optimized version)
@@ -106,6 +118,10 @@ static inline void spinlock_init(spinlock_t *lock) {
 }
 
 static inline void spinlock_lock(spinlock_t *lock) {
+    if (lock_elision_active()) {
+        return;
+    }
+    
     int expected = 0;
     int spin_count = 0;
     
@@ -135,7 +151,34 @@ static inline void spinlock_lock(spinlock_t *lock) {
 }
 
 static inline void spinlock_unlock(spinlock_t *lock) {
-    atomic_store(&lock->locked, 0);
+    if (!lock_elision_active()) {
+        atomic_store(&lock->locked, 0);
+    }
+}
+
+// Handler table segment and main locks, no-ops in a single-threaded process
+static inline void table_lock(event_loop_t *loop, unsigned int index) {
+    if (!lock_elision_active()) {
+        pthread_rwlock_wrlock(&loop->rwlocks[index]);
+    }
+}
+
+static inline void table_unlock(event_loop_t *loop, unsigned int index) {
+    if (!lock_elision_active()) {
+        pthread_rwlock_unlock(&loop->rwlocks[index]);
+    }
+}
+
+static inline void loop_lock(event_loop_t *loop) {
+    if (!lock_elision_active()) {
+        pthread_mutex_lock(&loop->mutex);
+    }
+}
+
+static inline void loop_unlock(event_loop_t *loop) {
+    if (!lock_elision_active()) {
+        pthread_mutex_unlock(&loop->mutex);
+    }
 }
 
 // Get current time (microseconds)
@@ -162,7 +205,7 @@ static unsigned int get_table_index(event_loop_t *loop, int fd) {
 static void add_handler_to_table(event_loop_t *loop, int fd, event_handler_t *handler) {
     unsigned int index = get_table_index(loop, fd);
     
-    pthread_rwlock_wrlock(&loop->rwlocks[index]);
+    table_lock(loop, index);
     
     handler_node_t *node = malloc(sizeof(handler_node_t));
     if (node) {
@@ -175,14 +218,14 @@ static void add_handler_to_table(event_loop_t *loop, int fd, event_handler_t *ha
         atomic_fetch_add(&loop->active_handlers, 1);
     }
     
-    pthread_rwlock_unlock(&loop->rwlocks[index]);
+    table_unlock(loop, index);
 }
 
 // Remove handler from hash table
 static event_handler_t *remove_handler_from_table(event_loop_t *loop, int fd) {
     unsigned int index = get_table_index(loop, fd);
     
-    pthread_rwlock_wrlock(&loop->rwlocks[index]);
+    table_lock(loop, index);
     
     handler_node_t **current = &loop->handler_table[index];
     event_handler_t *handler = NULL;
@@ -203,10 +246,51 @@ static event_handler_t *remove_handler_from_table(event_loop_t *loop, int fd) {
         current = &(*current)->next;
     }
     
-    pthread_rwlock_unlock(&loop->rwlocks[index]);
+    table_unlock(loop, index);
     return handler;
 }
 
+// Replace the handler stored for fd, returning the previous one
+static event_handler_t *replace_handler_in_table(event_loop_t *loop, int fd, event_handler_t *handler) {
+    unsigned int index = get_table_index(loop, fd);
+    event_handler_t *old_handler = NULL;
+    
+    table_lock(loop, index);
+    
+    for (handler_node_t *node = loop->handler_table[index]; node; node = node->next) {
+        if (node->fd == fd) {
+            old_handler = node->handler;
+            node->handler = handler;
+            break;
+        }
+    }
+    
+    table_unlock(loop, index);
+    return old_handler;
+}
+
+// Queue a handler for deferred free (caller holds loop->mutex).
+// The event thread may still hold a pointer to it in the current epoll batch.
+static void retire_handler(event_loop_t *loop, event_handler_t *handler) {
+    atomic_store(&handler->active, 0);
+    handler->retired_next = loop->retired_handlers;
+    loop->retired_handlers = handler;
+}
+
+// Free handlers retired up to now (event thread only, between batches)
+static void free_retired_handlers(event_loop_t *loop) {
+    loop_lock(loop);
+    event_handler_t *handler = loop->retired_handlers;
+    loop->retired_handlers = NULL;
+    loop_unlock(loop);
+    
+    while (handler) {
+        event_handler_t *next = handler->retired_next;
+        free(handler);
+        handler = next;
+    }
+}
+
 // Set file descriptor to non-blocking mode
 static int set_nonblocking(int fd) {
     int flags = fcntl(fd, F_GETFL, 0);
@@ -245,6 +329,11 @@ event_loop_t *event_loop_create(int max_events) {
     atomic_init(&loop->error_count, 0);
     atomic_init(&loop->timeout_count, 0);
     atomic_init(&loop->lock_contention, 0);
+    atomic_init(&loop->lag_max_us, 0);
+    atomic_init(&loop->busy_us, 0);
+    loop->busy_since_us = get_time_us();
+    loop->heartbeat_ms = NULL;
+    loop->heartbeat_iterations = NULL;
     
     // Initialize time statistics
     loop->avg_event_processing_time = 0.0;
@@ -397,6 +486,9 @@ void event_loop_destroy(event_loop_t *loop) {
         }
     }
     
+    // Free handlers still awaiting deferred release
+    free_retired_handlers(loop);
+    
     // Clean up read-write lock array
     if (loop->rwlocks) {
         for (int i = 0; i < loop->table_size; i++) {
@@ -460,7 +552,7 @@ int event_loop_add_handler(event_loop_t *loop, int fd, int events,
     handler->avg_processing_time = 0.0;
     clock_gettime(CLOCK_MONOTONIC, &handler->last_activity);
     
-    pthread_mutex_lock(&loop->mutex);
+    loop_lock(loop);
     
     // Add to hash table
     add_handler_to_table(loop, fd, handler);
@@ -481,7 +573,7 @@ int event_loop_add_handler(event_loop_t *loop, int fd, int events,
     if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
         log_error("Failed to add event handler: %s", strerror(errno));
         remove_handler_from_table(loop, fd);
-        pthread_mutex_unlock(&loop->mutex);
+        loop_unlock(loop);
         free(handler);
         return -1;
     }
@@ -501,13 +593,13 @@ int event_loop_add_handler(event_loop_t *loop, int fd, int events,
     if (kevent(loop->kqueue_fd, ev, n, NULL, 0, NULL) == -1) {
         log_error("Failed to add event handler: %s", strerror(errno));
         remove_handler_from_table(loop, fd);
-        pthread_mutex_unlock(&loop->mutex);
+        loop_unlock(loop);
         free(handler);
         return -1;
     }
 #endif
     
-    pthread_mutex_unlock(&loop->mutex);
+    loop_unlock(loop);
     
     log_debug("Event handler added successfully: fd=%d, events=%d", fd, events);
     return 0;
@@ -520,7 +612,7 @@ int event_loop_mod_handler(event_loop_t *loop, int fd, int events,
         return -1;
     }
     
-    pthread_mutex_lock(&loop->mutex);
+    loop_lock(loop);
     
 #ifdef __linux__
     struct epoll_event ev;
@@ -537,7 +629,7 @@ int event_loop_mod_handler(event_loop_t *loop, int fd, int events,
     event_handler_t *handler = malloc(sizeof(event_handler_t));
     if (!handler) {
         log_error("Failed to allocate event handler memory");
-        pthread_mutex_unlock(&loop->mutex);
+        loop_unlock(loop);
         return -1;
     }
     
@@ -552,20 +644,29 @@ int event_loop_mod_handler(event_loop_t *loop, int fd, int events,
     handler->avg_processing_time = 0.0;
     clock_gettime(CLOCK_MONOTONIC, &handler->last_activity);
     
+    handler->retired_next = NULL;
     ev.data.ptr = handler;
     
-    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, fd, &ev) == -1) {
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, fd, &ev) == 0) {
+        // epoll now points at the new handler, retire the one it replaces
+        event_handler_t *old_handler = replace_handler_in_table(loop, fd, handler);
+        if (old_handler) {
+            retire_handler(loop, old_handler);
+        } else {
+            add_handler_to_table(loop, fd, handler);
+        }
+    } else {
         if (errno == ENOENT) {
             if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
                 log_error("Failed to add event handler: %s", strerror(errno));
-                pthread_mutex_unlock(&loop->mutex);
+                loop_unlock(loop);
                 free(handler);
                 return -1;
             }
             add_handler_to_table(loop, fd, handler);
         } else {
             log_error("Failed to modify event handler: %s", strerror(errno));
-            pthread_mutex_unlock(&loop->mutex);
+            loop_unlock(loop);
             free(handler);
             return -1;
         }
@@ -581,7 +682,7 @@ int event_loop_mod_handler(event_loop_t *loop, int fd, int events,
     event_handler_t *handler = malloc(sizeof(event_handler_t));
     if (!handler) {
         log_error("Failed to allocate event handler memory");
-        pthread_mutex_unlock(&loop->mutex);
+        loop_unlock(loop);
         return -1;
     }
     
@@ -606,13 +707,13 @@ int event_loop_mod_handler(event_loop_t *loop, int fd, int events,
     
     if (kevent(loop->kqueue_fd, ev, n, NULL, 0, NULL) == -1) {
         log_error("Failed to modify event handler: %s", strerror(errno));
-        pthread_mutex_unlock(&loop->mutex);
+        loop_unlock(loop);
         free(handler);
         return -1;
     }
 #endif
     
-    pthread_mutex_unlock(&loop->mutex);
+    loop_unlock(loop);
     
     log_debug("Event handler modified successfully: fd=%d, events=%d", fd, events);
     return 0;
@@ -624,7 +725,7 @@ int event_loop_del_handler(event_loop_t *loop, int fd) {
         return -1;
     }
     
-    pthread_mutex_lock(&loop->mutex);
+    loop_lock(loop);
     
     event_handler_t *handler_to_free = remove_handler_from_table(loop, fd);
     
@@ -632,7 +733,7 @@ int event_loop_del_handler(event_loop_t *loop, int fd) {
     if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, fd, NULL) == -1) {
         if (errno != ENOENT) {
             log_error("Failed to delete event handler: %s", strerror(errno));
-            pthread_mutex_unlock(&loop->mutex);
+            loop_unlock(loop);
             return -1;
         }
     }
@@ -643,13 +744,13 @@ int event_loop_del_handler(event_loop_t *loop, int fd) {
     kevent(loop->kqueue_fd, ev, 2, NULL, 0, NULL);
 #endif
     
-    pthread_mutex_unlock(&loop->mutex);
-    
     if (handler_to_free) {
-        free(handler_to_free);
+        retire_handler(loop, handler_to_free);
         log_debug("Event handler deleted successfully: fd=%d", fd);
     }
     
+    loop_unlock(loop);
+    
     return 0;
 }
 
@@ -666,9 +767,17 @@ static void *event_loop_thread(void *arg) {
     sigaddset(&set, SIGQUIT);
     pthread_sigmask(SIG_UNBLOCK, &set, NULL);
     
+    uint64_t iterations = 0;
+    
     while (!atomic_load(&loop->stop)) {
         uint64_t loop_start = get_time_us();
         
+        // A callback that never returns stops the heartbeat, so a stuck loop shows up as a stale stamp
+        if (loop->heartbeat_ms != NULL) {
+            __atomic_store_n(loop->heartbeat_ms, loop_start / 1000, __ATOMIC_RELAXED);
+            __atomic_store_n(loop->heartbeat_iterations, ++iterations, __ATOMIC_RELAXED);
+        }
+        
 #ifdef __linux__
         int nfds = epoll_wait(loop->epoll_fd, loop->events, loop->max_events, loop->timeout_ms);
         
@@ -686,6 +795,8 @@ static void *event_loop_thread(void *arg) {
             continue;
         }
         
+        uint64_t batch_start = get_time_us();
+        
         // Batch process events
         for (int i = 0; i < nfds && !atomic_load(&loop->stop); i++) {
             event_handler_t *handler = (event_handler_t *)loop->events[i].data.ptr;
@@ -712,7 +823,7 @@ static void *event_loop_thread(void *arg) {
             }
             
             // Check if handler is still valid
-            if (handler->fd != fd) {
+            if (handler->fd != fd || !atomic_load(&handler->active)) {
                 atomic_fetch_sub(&handler->ref_count, 1);
                 continue;
             }
@@ -745,6 +856,8 @@ static void *event_loop_thread(void *arg) {
             continue;
         }
         
+        uint64_t batch_start = get_time_us();
+        
         // Batch process events
         for (int i = 0; i < nfds && !atomic_load(&loop->stop); i++) {
             event_handler_t *handler = (event_handler_t *)loop->events[i].udata;
@@ -762,7 +875,7 @@ static void *event_loop_thread(void *arg) {
             }
             
             // Check if handler is still valid
-            if (handler->fd != fd) {
+            if (handler->fd != fd || !atomic_load(&handler->active)) {
                 atomic_fetch_sub(&handler->ref_count, 1);
                 continue;
             }
@@ -776,10 +889,22 @@ static void *event_loop_thread(void *arg) {
         }
 #endif
         
+        // Handlers deleted during this batch are no longer referenced
+        if (loop->retired_handlers) {
+            free_retired_handlers(loop);
+        }
+        
         // Update statistics
         uint64_t loop_end = get_time_us();
         uint64_t processing_time = loop_end - loop_start;
         
+        // Time spent dispatching is how long a newly ready event can wait for the loop
+        uint64_t batch_time = loop_end - batch_start;
+        if (batch_time > atomic_load_explicit(&loop->lag_max_us, memory_order_relaxed)) {
+            atomic_store_explicit(&loop->lag_max_us, batch_time, memory_order_relaxed);
+        }
+        atomic_fetch_add_explicit(&loop->busy_us, batch_time, memory_order_relaxed);
+        
         atomic_fetch_add(&loop->total_events_processed, nfds);
         if (nfds > loop->batch_size) {
             atomic_fetch_add(&loop->batch_events_processed, nfds);
@@ -823,6 +948,16 @@ int event_loop_start(event_loop_t *loop) {
     return 0;
 }
 
+// Run unified event loop on the calling thread until stopped
+int event_loop_run(event_loop_t *loop) {
+    if (!loop) {
+        return -1;
+    }
+    
+    event_loop_thread(loop);
+    return 0;
+}
+
 // Stop unified event loop
 void event_loop_stop(event_loop_t *loop) {
     if (!loop) {
@@ -875,6 +1010,44 @@ void event_loop_get_stats(event_loop_t *loop, int *handler_count, int *active_ha
     }
 }
 
+// Take the longest dispatch batch since the previous call
+uint64_t event_loop_take_max_lag_us(event_loop_t *loop) {
+    if (!loop) {
+        return 0;
+    }
+    
+    return atomic_exchange(&loop->lag_max_us, 0);
+}
+
+// Get the fraction of time spent dispatching since the last call
+double event_loop_take_utilization(event_loop_t *loop) {
+    if (!loop) {
+        return 0.0;
+    }
+    
+    uint64_t now = get_time_us();
+    uint64_t busy = atomic_exchange(&loop->busy_us, 0);
+    uint64_t elapsed = now - loop->busy_since_us;
+    loop->busy_since_us = now;
+    
+    if (elapsed == 0) {
+        return 0.0;
+    }
+    // A batch still running at the last read is counted in full when it ends
+    double utilization = (double)busy / (double)elapsed;
+    return utilization > 1.0 ? 1.0 : utilization;
+}
+
+// Set heartbeat fields
+void event_loop_set_heartbeat(event_loop_t *loop, uint64_t *heartbeat_ms, uint64_t *iterations) {
+    if (!loop) {
+        return;
+    }
+    
+    loop->heartbeat_ms = (heartbeat_ms != NULL && iterations != NULL) ? heartbeat_ms : NULL;
+    loop->heartbeat_iterations = iterations;
+}
+
 // Get detailed statistics
 void event_loop_get_detailed_stats(event_loop_t *loop, event_loop_detailed_stats_t *stats) {
     if (!loop || !stats) {
@@ -13,12 +13,17 @@
 #include <errno.h>
 #include <time.h>
 #include <sys/socket.h>
+#include <limits.h>
 
 #include "../include/file_handler.h"
 #include "../include/http.h"
 #include "../include/config.h"
 #include "../include/file_io_enhanced.h"
 
+// Allocations in this file are accounted to the fileio subsystem
+#define ALLOC_TAG ALLOC_TAG_FILEIO
+#include "../include/alloc_stats.h"
+
 #define BUFFER_SIZE 8192
 #define MAX_PATH_LENGTH 1024
 
@@ -387,8 +392,8 @@ int handle_local_file(int client_sock, http_request_t *request, route_t *route,
     snprintf(file_path, sizeof(file_path), "%s/%s", route->local_path, relative_path);
     
     // Ensure file path doesn't exceed local path scope (prevent path traversal)
-    char real_file_path[MAX_PATH_LENGTH];
-    char real_local_path[MAX_PATH_LENGTH];
+    char real_file_path[PATH_MAX];  // realpath() requires PATH_MAX bytes
+    char real_local_path[PATH_MAX];
     
     if (realpath(file_path, real_file_path) == NULL || 
         realpath(route->local_path, real_local_path) == NULL) {
@@ -399,8 +404,11 @@ int handle_local_file(int client_sock, http_request_t *request, route_t *route,
         return -1;
     }
     
-    // Check if file path is within local path scope
-    if (strncmp(real_file_path, real_local_path, strlen(real_local_path)) != 0) {
+    // Check if file path is within local path scope; a sibling sharing the prefix (/srv/www2 for /srv/www) is not
+    size_t local_len = strlen(real_local_path);
+    if (strncmp(real_file_path, real_local_path, local_len) != 0 ||
+        (real_file_path[local_len] != '/' && real_file_path[local_len] != '\0' &&
+         (local_len == 0 || real_local_path[local_len - 1] != '/'))) {
         const char *error_msg = "Access denied";
         send_http_error(client_sock, 403, error_msg, route->charset);
         if (status_code) *status_code = 403;
@@ -421,8 +429,9 @@ int handle_local_file(int client_sock, http_request_t *request, route_t *route,
     // If it's a directory, send directory listing or find index file
     if (S_ISDIR(file_stat.st_mode)) {
         // Try to find index file
-        char index_path[MAX_PATH_LENGTH];
-        snprintf(index_path, sizeof(index_path), "%s/index.html", file_path);
+        // Canonical paths match the keys of the static preload table
+        char index_path[PATH_MAX + 16];
+        snprintf(index_path, sizeof(index_path), "%s/index.html", real_file_path);
         
         if (access(index_path, F_OK) == 0) {
             // Found index file, send it
@@ -436,7 +445,7 @@ int handle_local_file(int client_sock, http_request_t *request, route_t *route,
     } else {
         // It's a regular file, send file content directly
         if (status_code) *status_code = 200;
-        return send_file_content(client_sock, file_path, route->charset, response_size);
+        return send_file_content(client_sock, real_file_path, route->charset, response_size);
     }
 }
 
@@ -454,7 +463,7 @@ int sendfile_optimized(int client_sock, int file_fd, size_t file_size, size_t *s
 #if defined(__linux__)
     // Linux sendfile
     while (total_sent < file_size) {
-        n = sendfile(client_sock, file_fd, &offset, file_size - total_sent);
+        ssize_t n = sendfile(client_sock, file_fd, &offset, file_size - total_sent);
         if (n > 0) {
             total_sent += n;
         } else if (n == 0) {
@@ -5,6 +5,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
@@ -14,6 +15,8 @@
 #include <sys/socket.h>
 #include <errno.h>
 #include <time.h>
+#include <limits.h>
+#include <dirent.h>
 #include <pthread.h>
 #include <stdatomic.h>
 
@@ -26,12 +29,57 @@
 #include "../include/file_io_enhanced.h"
 #include "../include/logger.h"
 
+// Allocations in this file are accounted to the fileio subsystem
+#define ALLOC_TAG ALLOC_TAG_FILEIO
+#include "../include/alloc_stats.h"
+
 // Global variables
 static file_cache_manager_t *g_cache_manager = NULL;
 static file_io_stats_t g_stats = {0};
 static file_io_config_t g_config = {0};
 static atomic_int g_initialized = 0;
 
+// Files above this size are sent with sendfile/mmap, preloading them saves nothing
+#define PRELOAD_MAX_FILE_SIZE   (1024 * 1024)
+#define PRELOAD_MAX_FILES       65536
+#define PRELOAD_MAX_DEPTH       16
+
+// Preloaded file, offsets are relative to the table mapping
+typedef struct preload_entry {
+    size_t hash;
+    size_t path_offset;
+    size_t data_offset;
+    size_t size;
+    int64_t mtime_ns;
+} preload_entry_t;
+
+// Read-only preload table built by the Master before fork. Header, entries, slot index,
+// paths and file contents share one mapping that is write-protected once filled: Workers
+// keep no reference counts or access times in it, so the inherited pages stay shared.
+typedef struct preload_table {
+    size_t map_size;
+    size_t entry_count;
+    size_t slot_mask;
+    size_t total_bytes;
+    preload_entry_t *entries;
+    uint32_t *slots;                // entry index + 1, 0 marks an empty slot
+} preload_table_t;
+
+static preload_table_t *g_preload = NULL;
+
+// Candidate found while walking the static roots
+typedef struct preload_candidate {
+    char *path;
+    size_t size;
+    int64_t mtime_ns;
+} preload_candidate_t;
+
+typedef struct preload_list {
+    preload_candidate_t *items;
+    size_t count;
+    size_t capacity;
+} preload_list_t;
+
 // Hash function
 static size_t hash_string(const char *str) {
     size_t hash = 5381;
@@ -42,6 +90,11 @@ static size_t hash_string(const char *str) {
     return hash;
 }
 
+// Modification time in nanoseconds, compared to detect files changed after preloading
+static int64_t stat_mtime_ns(const struct stat *st) {
+    return (int64_t)st->st_mtim.tv_sec * 1000000000LL + st->st_mtim.tv_nsec;
+}
+
 // Get current timestamp (nanoseconds)
 static uint64_t get_time_ns(void) {
     struct timespec ts;
@@ -49,51 +102,61 @@ static uint64_t get_time_ns(void) {
     return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
 }
 
-// Cache cleanup thread
-static void *cache_cleanup_thread(void *arg) {
-    file_cache_manager_t *manager = (file_cache_manager_t *)arg;
-    time_t now;
+// Drop expired cache items
+static size_t cache_cleanup_pass(file_cache_manager_t *manager) {
     file_cache_item_t *item, *prev, *next;
+    size_t freed = 0;
     
-    while (!atomic_load(&manager->stop_cleanup)) {
-        pthread_mutex_lock(&manager->mutex);
-        
-        now = time(NULL);
+    profiled_mutex_lock(&manager->mutex);
+    
+    time_t now = time(NULL);
+    
+    // Iterate through all buckets
+    for (size_t i = 0; i < manager->bucket_count; i++) {
+        prev = NULL;
+        item = manager->buckets[i];
         
-        // Iterate through all buckets
-        for (size_t i = 0; i < manager->bucket_count; i++) {
-            prev = NULL;
-            item = manager->buckets[i];
+        while (item != NULL) {
+            next = item->next;
             
-            while (item != NULL) {
-                next = item->next;
-                
-                // Check if expired (not accessed for more than 1 hour)
-                if (now - item->access_time > 3600) {
-                    // Remove expired item
-                    if (prev == NULL) {
-                        manager->buckets[i] = next;
-                    } else {
-                        prev->next = next;
-                    }
-                    
-                    // Free memory
-                    free(item->path);
-                    free(item->data);
-                    manager->current_size -= item->size;
-                    free(item);
+            // Check if expired (not accessed for more than 1 hour) and not being sent
+            if (now - item->access_time > 3600 && atomic_load(&item->ref_count) <= 1) {
+                // Remove expired item
+                if (prev == NULL) {
+                    manager->buckets[i] = next;
                 } else {
-                    prev = item;
+                    prev->next = next;
                 }
                 
-                item = next;
+                // Free memory
+                free(item->path);
+                free(item->data);
+                manager->current_size -= item->size;
+                free(item);
+                freed++;
+            } else {
+                prev = item;
             }
+            
+            item = next;
         }
+    }
+    
+    profiled_mutex_unlock(&manager->mutex);
+    return freed;
+}
+
+// Cache cleanup thread
+static void *cache_cleanup_thread(void *arg) {
+    file_cache_manager_t *manager = (file_cache_manager_t *)arg;
+    
+    while (!atomic_load(&manager->stop_cleanup)) {
+        cache_cleanup_pass(manager);
         
-        pthread_mutex_unlock(&manager->mutex);
-        
-        // Wait for cleanup interval
-        sleep(g_config.cache_cleanup_interval);
+        // Wait for cleanup interval, waking every second to honor stop requests
+        for (int i = 0; i < g_config.cache_cleanup_interval && !atomic_load(&manager->stop_cleanup); i++) {
+            sleep(1);
+        }
     }
     
     return NULL;
@@ -135,12 +198,13 @@ int file_io_enhanced_init(const file_io_config_t *config) {
         return -1;
     }
     
-    pthread_mutex_init(&g_cache_manager->mutex, NULL);
+    profiled_mutex_init(&g_cache_manager->mutex, "file_cache");
     atomic_store(&g_cache_manager->stop_cleanup, 0);
     
-    // Start cleanup thread
-    if (pthread_create(&g_cache_manager->cleanup_thread, NULL, cache_cleanup_thread, g_cache_manager) != 0) {
-        pthread_mutex_destroy(&g_cache_manager->mutex);
+    // Start cleanup thread, unless the caller runs cleanup passes itself
+    if (!g_config.external_cleanup &&
+        pthread_create(&g_cache_manager->cleanup_thread, NULL, cache_cleanup_thread, g_cache_manager) != 0) {
+        profiled_mutex_destroy(&g_cache_manager->mutex);
         free(g_cache_manager->buckets);
         free(g_cache_manager);
         return -1;
@@ -163,14 +227,16 @@ void file_io_enhanced_destroy(void) {
     
     if (g_cache_manager) {
         // Stop cleanup thread
-        atomic_store(&g_cache_manager->stop_cleanup, 1);
-        pthread_join(g_cache_manager->cleanup_thread, NULL);
+        if (!g_config.external_cleanup) {
+            atomic_store(&g_cache_manager->stop_cleanup, 1);
+            pthread_join(g_cache_manager->cleanup_thread, NULL);
+        }
         
         // Clear cache
         file_io_enhanced_clear_cache();
         
         // Destroy mutex
-        pthread_mutex_destroy(&g_cache_manager->mutex);
+        profiled_mutex_destroy(&g_cache_manager->mutex);
         
         // Free memory
         free(g_cache_manager->buckets);
@@ -223,7 +289,7 @@ void *file_io_enhanced_get_from_cache(const char *file_path, size_t *size) {
     
     size_t hash = hash_string(file_path) % g_cache_manager->bucket_count;
     
-    pthread_mutex_lock(&g_cache_manager->mutex);
+    profiled_mutex_lock(&g_cache_manager->mutex);
     
     file_cache_item_t *item = g_cache_manager->buckets[hash];
     while (item != NULL) {
@@ -234,14 +300,14 @@ void *file_io_enhanced_get_from_cache(const char *file_path, size_t *size) {
             
             if (size) *size = item->size;
             
-            pthread_mutex_unlock(&g_cache_manager->mutex);
+            profiled_mutex_unlock(&g_cache_manager->mutex);
             atomic_fetch_add(&g_stats.cache_hits, 1);
             return item->data;
         }
         item = item->next;
     }
     
-    pthread_mutex_unlock(&g_cache_manager->mutex);
+    profiled_mutex_unlock(&g_cache_manager->mutex);
     atomic_fetch_add(&g_stats.cache_misses, 1);
     return NULL;
 }
@@ -259,7 +325,7 @@ int file_io_enhanced_add_to_cache(const char *file_path, const void *data, size_
     
     size_t hash = hash_string(file_path) % g_cache_manager->bucket_count;
     
-    pthread_mutex_lock(&g_cache_manager->mutex);
+    profiled_mutex_lock(&g_cache_manager->mutex);
     
     // Check if already exists
     file_cache_item_t *item = g_cache_manager->buckets[hash];
@@ -269,7 +335,7 @@ int file_io_enhanced_add_to_cache(const char *file_path, const void *data, size_
             free(item->data);
             item->data = malloc(size);
             if (!item->data) {
-                pthread_mutex_unlock(&g_cache_manager->mutex);
+                profiled_mutex_unlock(&g_cache_manager->mutex);
                 return -1;
             }
             memcpy(item->data, data, size);
@@ -278,16 +344,22 @@ int file_io_enhanced_add_to_cache(const char *file_path, const void *data, size_
             item->access_time = time(NULL);
             atomic_store(&item->is_valid, 1);
             
-            pthread_mutex_unlock(&g_cache_manager->mutex);
+            profiled_mutex_unlock(&g_cache_manager->mutex);
             return 0;
         }
         item = item->next;
     }
     
+    // A full cache keeps what it has, the file is still served from disk
+    if (g_cache_manager->current_size + size > g_cache_manager->max_size) {
+        profiled_mutex_unlock(&g_cache_manager->mutex);
+        return -1;
+    }
+    
     // Create new item
     item = malloc(sizeof(file_cache_item_t));
     if (!item) {
-        pthread_mutex_unlock(&g_cache_manager->mutex);
+        profiled_mutex_unlock(&g_cache_manager->mutex);
         return -1;
     }
     
@@ -297,7 +369,7 @@ int file_io_enhanced_add_to_cache(const char *file_path, const void *data, size_
         free(item->path);
         free(item->data);
         free(item);
-        pthread_mutex_unlock(&g_cache_manager->mutex);
+        profiled_mutex_unlock(&g_cache_manager->mutex);
         return -1;
     }
     
@@ -313,7 +385,7 @@ int file_io_enhanced_add_to_cache(const char *file_path, const void *data, size_
     g_cache_manager->buckets[hash] = item;
     g_cache_manager->current_size += size;
     
-    pthread_mutex_unlock(&g_cache_manager->mutex);
+    profiled_mutex_unlock(&g_cache_manager->mutex);
     return 0;
 }
 
@@ -325,7 +397,7 @@ void file_io_enhanced_remove_from_cache(const char *file_path) {
     
     size_t hash = hash_string(file_path) % g_cache_manager->bucket_count;
     
-    pthread_mutex_lock(&g_cache_manager->mutex);
+    profiled_mutex_lock(&g_cache_manager->mutex);
     
     file_cache_item_t *item = g_cache_manager->buckets[hash];
     file_cache_item_t *prev = NULL;
@@ -348,32 +420,135 @@ void file_io_enhanced_remove_from_cache(const char *file_path) {
         item = item->next;
     }
     
-    pthread_mutex_unlock(&g_cache_manager->mutex);
+    profiled_mutex_unlock(&g_cache_manager->mutex);
+}
+
+// Drop the reference taken by file_io_enhanced_get_from_cache
+void file_io_enhanced_release_cached(const char *file_path) {
+    if (!g_cache_manager || !file_path) {
+        return;
+    }
+    
+    size_t hash = hash_string(file_path) % g_cache_manager->bucket_count;
+    
+    profiled_mutex_lock(&g_cache_manager->mutex);
+    
+    for (file_cache_item_t *item = g_cache_manager->buckets[hash]; item != NULL; item = item->next) {
+        if (strcmp(item->path, file_path) == 0) {
+            atomic_fetch_sub(&item->ref_count, 1);
+            break;
+        }
+    }
+    
+    profiled_mutex_unlock(&g_cache_manager->mutex);
 }
 
-// Clear cache
+// Clear cache; items still being sent are invalidated and freed by a later clear or cleanup
 void file_io_enhanced_clear_cache(void) {
     if (!g_cache_manager) {
         return;
     }
     
-    pthread_mutex_lock(&g_cache_manager->mutex);
+    profiled_mutex_lock(&g_cache_manager->mutex);
     
     for (size_t i = 0; i < g_cache_manager->bucket_count; i++) {
         file_cache_item_t *item = g_cache_manager->buckets[i];
+        file_cache_item_t *prev = NULL;
         while (item != NULL) {
             file_cache_item_t *next = item->next;
-            free(item->path);
-            free(item->data);
-            free(item);
+            if (atomic_load(&item->ref_count) > 1) {
+                atomic_store(&item->is_valid, 0);
+                prev = item;
+            } else {
+                if (prev == NULL) {
+                    g_cache_manager->buckets[i] = next;
+                } else {
+                    prev->next = next;
+                }
+                g_cache_manager->current_size -= item->size;
+                free(item->path);
+                free(item->data);
+                free(item);
+            }
             item = next;
         }
-        g_cache_manager->buckets[i] = NULL;
     }
     
-    g_cache_manager->current_size = 0;
+    profiled_mutex_unlock(&g_cache_manager->mutex);
+}
+
+// Change the cache capacity, evicting least recently used items that are not being sent
+size_t file_io_enhanced_set_cache_limit(size_t max_bytes) {
+    if (!g_cache_manager) {
+        return 0;
+    }
+    
+    size_t freed = 0;
+    profiled_mutex_lock(&g_cache_manager->mutex);
+    
+    g_cache_manager->max_size = max_bytes;
+    while (g_cache_manager->current_size > max_bytes) {
+        // Oldest evictable item; pressure events are rare, a scan per eviction is fine
+        file_cache_item_t **victim = NULL;
+        for (size_t i = 0; i < g_cache_manager->bucket_count; i++) {
+            for (file_cache_item_t **link = &g_cache_manager->buckets[i]; *link != NULL; link = &(*link)->next) {
+                if (atomic_load(&(*link)->ref_count) <= 1 &&
+                    (victim == NULL || (*link)->access_time < (*victim)->access_time)) {
+                    victim = link;
+                }
+            }
+        }
+        if (victim == NULL) {
+            break;
+        }
+        
+        file_cache_item_t *item = *victim;
+        *victim = item->next;
+        g_cache_manager->current_size -= item->size;
+        freed += item->size;
+        free(item->path);
+        free(item->data);
+        free(item);
+    }
+    
+    profiled_mutex_unlock(&g_cache_manager->mutex);
+    return freed;
+}
+
+// Drop expired cache items, for callers that run cleanup without the thread
+size_t file_io_enhanced_cleanup_expired(void) {
+    if (!atomic_load(&g_initialized) || g_cache_manager == NULL) {
+        return 0;
+    }
+    return cache_cleanup_pass(g_cache_manager);
+}
+
+// Log every cache entry and return the entry count
+size_t file_io_enhanced_dump_cache(void) {
+    size_t entries = 0;
+    
+    if (!g_cache_manager) {
+        return 0;
+    }
+    
+    time_t now = time(NULL);
+    
+    profiled_mutex_lock(&g_cache_manager->mutex);
+    
+    log_info("=== File Cache Dump (PID %d) ===", getpid());
+    for (size_t i = 0; i < g_cache_manager->bucket_count; i++) {
+        for (file_cache_item_t *item = g_cache_manager->buckets[i]; item != NULL; item = item->next) {
+            log_info("%s size=%zu idle=%lds refs=%d%s", item->path, item->size,
+                     (long)(now - item->access_time), atomic_load(&item->ref_count) - 1,
+                     atomic_load(&item->is_valid) ? "" : " (invalidated)");
+            entries++;
+        }
+    }
+    log_info("%zu entries, %zu/%zu bytes", entries, g_cache_manager->current_size, g_cache_manager->max_size);
+    
+    profiled_mutex_unlock(&g_cache_manager->mutex);
     
-    pthread_mutex_unlock(&g_cache_manager->mutex);
+    return entries;
 }
 
 // Send file using sendfile
@@ -502,6 +677,49 @@ int file_io_enhanced_send_file_mmap(int client_fd, const char *file_path, size_t
     return 0;
 }
 
+// Write a memory buffer to the client, waiting out a full socket buffer
+static int write_all(int client_fd, const void *data, size_t size, size_t *sent) {
+    size_t total_sent = 0;
+    
+    while (total_sent < size) {
+        ssize_t bytes_sent = write(client_fd, (const char *)data + total_sent, size - total_sent);
+        if (bytes_sent > 0) {
+            total_sent += bytes_sent;
+        } else if (bytes_sent == 0) {
+            break;
+        } else {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                usleep(1000);
+                continue;
+            }
+            *sent = total_sent;
+            return -1;
+        }
+    }
+    
+    *sent = total_sent;
+    return 0;
+}
+
+// Find a preloaded file by canonical path
+static const preload_entry_t *preload_lookup(const char *file_path) {
+    const preload_table_t *table = g_preload;
+    
+    if (table == NULL || file_path == NULL) {
+        return NULL;
+    }
+    
+    size_t hash = hash_string(file_path);
+    for (size_t i = hash & table->slot_mask; table->slots[i] != 0; i = (i + 1) & table->slot_mask) {
+        const preload_entry_t *entry = &table->entries[table->slots[i] - 1];
+        if (entry->hash == hash && strcmp((const char *)table + entry->path_offset, file_path) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
 // Zero-copy file sending (automatically select optimal method)
 int file_io_enhanced_send_file(int client_fd, const char *file_path, size_t *sent_bytes) {
     if (!atomic_load(&g_initialized)) {
@@ -510,6 +728,28 @@ int file_io_enhanced_send_file(int client_fd, const char *file_path, size_t *sen
     
     atomic_fetch_add(&g_stats.total_requests, 1);
     
+    // Files preloaded by the Master, checked against the file on disk so edits are never masked
+    const preload_entry_t *preloaded = preload_lookup(file_path);
+    if (preloaded) {
+        struct stat st;
+        if (stat(file_path, &st) == 0 && (size_t)st.st_size == preloaded->size &&
+            stat_mtime_ns(&st) == preloaded->mtime_ns) {
+            uint64_t start_time = get_time_ns();
+            size_t total_sent = 0;
+            
+            if (write_all(client_fd, (const char *)g_preload + preloaded->data_offset, preloaded->size,
+                          &total_sent) != 0) {
+                return -1;
+            }
+            
+            if (sent_bytes) *sent_bytes = total_sent;
+            atomic_fetch_add(&g_stats.cache_hits, 1);
+            atomic_fetch_add(&g_stats.total_bytes_sent, total_sent);
+            atomic_fetch_add(&g_stats.total_send_time, get_time_ns() - start_time);
+            return 0;
+        }
+    }
+    
     // First try to get from cache
     size_t cached_size;
     void *cached_data = file_io_enhanced_get_from_cache(file_path, &cached_size);
@@ -518,22 +758,11 @@ int file_io_enhanced_send_file(int client_fd, const char *file_path, size_t *sen
         uint64_t start_time = get_time_ns();
         
         size_t total_sent = 0;
-        ssize_t bytes_sent;
+        int write_result = write_all(client_fd, cached_data, cached_size, &total_sent);
         
-        while (total_sent < cached_size) {
-            bytes_sent = write(client_fd, (char *)cached_data + total_sent, cached_size - total_sent);
-            if (bytes_sent > 0) {
-                total_sent += bytes_sent;
-            } else if (bytes_sent == 0) {
-                break;
-            } else {
-                if (errno == EINTR) continue;
-                if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                    usleep(1000);
-                    continue;
-                }
-                return -1;
-            }
+        file_io_enhanced_release_cached(file_path);
+        if (write_result != 0) {
+            return -1;
         }
         
         if (sent_bytes) *sent_bytes = total_sent;
@@ -631,18 +860,18 @@ int file_io_enhanced_is_cached(const char *file_path) {
     
     size_t hash = hash_string(file_path) % g_cache_manager->bucket_count;
     
-    pthread_mutex_lock(&g_cache_manager->mutex);
+    profiled_mutex_lock(&g_cache_manager->mutex);
     
     file_cache_item_t *item = g_cache_manager->buckets[hash];
     while (item != NULL) {
         if (strcmp(item->path, file_path) == 0 && atomic_load(&item->is_valid)) {
-            pthread_mutex_unlock(&g_cache_manager->mutex);
+            profiled_mutex_unlock(&g_cache_manager->mutex);
             return 1;
         }
         item = item->next;
     }
     
-    pthread_mutex_unlock(&g_cache_manager->mutex);
+    profiled_mutex_unlock(&g_cache_manager->mutex);
     return 0;
 }
 
@@ -662,4 +891,221 @@ int file_io_enhanced_get_file_info(const char *file_path, struct stat *st) {
     }
     
     return stat(file_path, st);
-} 
\ No newline at end of file
+}
+
+// Whether a resolved path is the root or below it; /srv/www2 is not under /srv/www
+static int path_under_root(const char *path, const char *root) {
+    size_t len = strlen(root);
+    if (strncmp(path, root, len) != 0) {
+        return 0;
+    }
+    return path[len] == '/' || path[len] == '\0' || (len > 0 && root[len - 1] == '/');
+}
+
+// Walk a static root, collecting regular files small enough to preload
+static void preload_collect(const char *root, const char *dir, int depth, preload_list_t *list) {
+    DIR *d = opendir(dir);
+    if (d == NULL) {
+        log_warn("Static preload cannot open %s: %s", dir, strerror(errno));
+        return;
+    }
+    
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL && list->count < PRELOAD_MAX_FILES) {
+        char path[PATH_MAX];
+        struct stat st;
+        
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) {
+            continue;
+        }
+        if (snprintf(path, sizeof(path), "%s/%s", dir, de->d_name) >= (int)sizeof(path) ||
+            lstat(path, &st) != 0) {
+            continue;
+        }
+        
+        if (S_ISDIR(st.st_mode)) {
+            if (depth < PRELOAD_MAX_DEPTH) {
+                preload_collect(root, path, depth + 1, list);
+            }
+            continue;
+        }
+        
+        // Symlinks are followed but must stay under the root, like the request path check
+        char real_path[PATH_MAX];
+        if (realpath(path, real_path) == NULL || !path_under_root(real_path, root) ||
+            stat(real_path, &st) != 0 || !S_ISREG(st.st_mode) ||
+            st.st_size == 0 || st.st_size > PRELOAD_MAX_FILE_SIZE) {
+            continue;
+        }
+        
+        if (list->count == list->capacity) {
+            size_t capacity = list->capacity ? list->capacity * 2 : 256;
+            preload_candidate_t *items = realloc(list->items, capacity * sizeof(preload_candidate_t));
+            if (items == NULL) {
+                break;
+            }
+            list->items = items;
+            list->capacity = capacity;
+        }
+        
+        char *copy = strdup(real_path);
+        if (copy == NULL) {
+            break;
+        }
+        list->items[list->count].path = copy;
+        list->items[list->count].size = (size_t)st.st_size;
+        list->items[list->count].mtime_ns = stat_mtime_ns(&st);
+        list->count++;
+    }
+    
+    closedir(d);
+}
+
+// Smaller files first: a fixed budget then covers the most requests
+static int preload_candidate_compare(const void *a, const void *b) {
+    const preload_candidate_t *x = a;
+    const preload_candidate_t *y = b;
+    if (x->size != y->size) {
+        return x->size < y->size ? -1 : 1;
+    }
+    return strcmp(x->path, y->path);
+}
+
+// Read a whole file into the table, failing when it changed since it was listed
+static int preload_read(const preload_candidate_t *candidate, char *data) {
+    int fd = open(candidate->path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    
+    size_t total = 0;
+    while (total < candidate->size) {
+        ssize_t n = read(fd, data + total, candidate->size - total);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        total += (size_t)n;
+    }
+    
+    struct stat st;
+    int unchanged = fstat(fd, &st) == 0 && (size_t)st.st_size == candidate->size &&
+                    stat_mtime_ns(&st) == candidate->mtime_ns;
+    close(fd);
+    
+    return total == candidate->size && unchanged ? 0 : -1;
+}
+
+// Build the read-only preload table from the static roots
+int file_io_enhanced_build_preload(const char **dirs, int count, size_t budget) {
+    preload_list_t list = {NULL, 0, 0};
+    
+    for (int i = 0; i < count && budget > 0; i++) {
+        char root[PATH_MAX];
+        if (dirs[i] == NULL || realpath(dirs[i], root) == NULL) {
+            continue;
+        }
+        preload_collect(root, root, 0, &list);
+    }
+    
+    qsort(list.items, list.count, sizeof(preload_candidate_t), preload_candidate_compare);
+    
+    // Keep the smallest files within budget, dropping paths reached through several roots
+    size_t selected = 0;
+    size_t data_bytes = 0;
+    size_t path_bytes = 0;
+    for (size_t i = 0; i < list.count; i++) {
+        preload_candidate_t *candidate = &list.items[i];
+        // Sorted by size then path, a copy of this file can only be the last one kept
+        int duplicate = selected > 0 && strcmp(list.items[selected - 1].path, candidate->path) == 0;
+        if (duplicate || data_bytes + candidate->size > budget) {
+            free(candidate->path);
+            continue;
+        }
+        data_bytes += (candidate->size + 15) & ~(size_t)15;
+        path_bytes += strlen(candidate->path) + 1;
+        list.items[selected++] = *candidate;
+    }
+    
+    preload_table_t *table = NULL;
+    if (selected > 0) {
+        size_t slot_count = 1;
+        while (slot_count < selected * 2) {
+            slot_count <<= 1;
+        }
+        
+        size_t entries_offset = (sizeof(preload_table_t) + 63) & ~(size_t)63;
+        size_t slots_offset = entries_offset + selected * sizeof(preload_entry_t);
+        size_t paths_offset = slots_offset + slot_count * sizeof(uint32_t);
+        size_t data_offset = (paths_offset + path_bytes + 63) & ~(size_t)63;
+        size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+        size_t map_size = (data_offset + data_bytes + page_size - 1) & ~(page_size - 1);
+        
+        void *map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (map == MAP_FAILED) {
+            log_error("Failed to map %zu bytes for static preload: %s", map_size, strerror(errno));
+        } else {
+            table = map;
+            table->map_size = map_size;
+            table->slot_mask = slot_count - 1;
+            table->entries = (preload_entry_t *)((char *)map + entries_offset);
+            table->slots = (uint32_t *)((char *)map + slots_offset);
+            
+            size_t path_pos = paths_offset;
+            size_t data_pos = data_offset;
+            for (size_t i = 0; i < selected; i++) {
+                preload_candidate_t *candidate = &list.items[i];
+                if (preload_read(candidate, (char *)map + data_pos) != 0) {
+                    continue;
+                }
+                
+                preload_entry_t *entry = &table->entries[table->entry_count];
+                size_t path_len = strlen(candidate->path) + 1;
+                memcpy((char *)map + path_pos, candidate->path, path_len);
+                entry->hash = hash_string(candidate->path);
+                entry->path_offset = path_pos;
+                entry->data_offset = data_pos;
+                entry->size = candidate->size;
+                entry->mtime_ns = candidate->mtime_ns;
+                
+                size_t slot = entry->hash & table->slot_mask;
+                while (table->slots[slot] != 0) {
+                    slot = (slot + 1) & table->slot_mask;
+                }
+                table->slots[slot] = (uint32_t)(table->entry_count + 1);
+                
+                table->entry_count++;
+                table->total_bytes += candidate->size;
+                path_pos += path_len;
+                data_pos += (candidate->size + 15) & ~(size_t)15;
+            }
+            
+            // Any write after this point would fault instead of silently un-sharing a page
+            mprotect(map, map_size, PROT_READ);
+        }
+    }
+    
+    for (size_t i = 0; i < selected; i++) {
+        free(list.items[i].path);
+    }
+    free(list.items);
+    
+    file_io_enhanced_free_preload();
+    g_preload = table;
+    
+    if (table == NULL) {
+        return 0;
+    }
+    log_info("Static preload: %zu files, %zu KB shared with Workers", table->entry_count, table->total_bytes / 1024);
+    return (int)table->entry_count;
+}
+
+// Drop the preload table, mappings inherited by running Workers are their own
+void file_io_enhanced_free_preload(void) {
+    if (g_preload != NULL) {
+        munmap(g_preload, g_preload->map_size);
+        g_preload = NULL;
+    }
+}
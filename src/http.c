@@ -17,6 +17,10 @@
 #include "../include/logger.h"
 #include "../include/http.h"
 
+// Allocations in this file are accounted to the parser subsystem
+#define ALLOC_TAG ALLOC_TAG_PARSER
+#include "../include/alloc_stats.h"
+
 #define MAX_REQUEST_SIZE 65536    // Increased to 64KB
 #define MAX_HEADERS 100           // Increased header count limit
 #define MAX_LINE_LENGTH 8192      // Increased line length limit
@@ -255,8 +259,14 @@ void free_http_request(http_request_t *request) {
 
 // Send nginx-style HTTP error response
 void send_http_error(int client_sock, int status_code, const char *message, const char *charset) {
+    send_http_error_retry(client_sock, status_code, message, charset, 0);
+}
+
+// Send HTTP error response, with a Retry-After header when retry_after is positive
+void send_http_error_retry(int client_sock, int status_code, const char *message, const char *charset, int retry_after) {
     char html_body[1024];
-    char response_headers[512];
+    char response_headers[640];
+    char retry_header[32] = "";
     const char *status_text;
     
     // Set status text based on status code
@@ -268,6 +278,7 @@ void send_http_error(int client_sock, int status_code, const char *message, cons
         case 405: status_text = "Method Not Allowed"; break;
         case 500: status_text = "Internal Server Error"; break;
         case 502: status_text = "Bad Gateway"; break;
+        case 503: status_text = "Service Unavailable"; break;
         default: status_text = "Error"; break;
     }
     
@@ -295,6 +306,9 @@ void send_http_error(int client_sock, int status_code, const char *message, cons
         case 502:
             safe_message = "Gateway error";
             break;
+        case 503:
+            safe_message = "Service temporarily unavailable, please retry later";
+            break;
         case 504:
             safe_message = "Gateway timeout";
             break;
@@ -339,10 +353,15 @@ void send_http_error(int client_sock, int status_code, const char *message, cons
         }
     }
     
+    if (retry_after > 0) {
+        snprintf(retry_header, sizeof(retry_header), "Retry-After: %d\r\n", retry_after);
+    }
+    
     // Build HTTP response headers - Fix CSS issue, allow inline styles
     int header_len = snprintf(response_headers, sizeof(response_headers),
         "HTTP/1.1 %d %s\r\n"
         "Server: X-Server\r\n"
+        "%s"
         "Content-Type: text/html; charset=%s\r\n"
         "Content-Length: %d\r\n"
         "Connection: close\r\n"
@@ -353,7 +372,7 @@ void send_http_error(int client_sock, int status_code, const char *message, cons
         "Referrer-Policy: strict-origin-when-cross-origin\r\n"
         "Content-Security-Policy: default-src 'self'; style-src 'self' 'unsafe-inline'\r\n"
         "\r\n",
-        status_code, status_text, charset ? charset : "UTF-8", html_len);
+        status_code, status_text, retry_header, charset ? charset : "UTF-8", html_len);
     
     // Send response headers and body separately to ensure integrity
     ssize_t bytes_written = 0;
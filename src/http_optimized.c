@@ -14,6 +14,10 @@
 #include "../include/http_optimized.h"
 #include "../include/logger.h"
 
+// Allocations in this file are accounted to the parser subsystem
+#define ALLOC_TAG ALLOC_TAG_PARSER
+#include "../include/alloc_stats.h"
+
 // Constant definitions
 #define MAX_HEADERS 100
 #define MAX_LINE_LENGTH 8192
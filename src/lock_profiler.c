@@ -0,0 +1,334 @@
+/**
+ * Lock Contention Profiler Implementation
+ * Named mutex wrapper recording acquisitions, contention and wait/hold time histograms
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/lock_profiler.h"
+#include "../include/logger.h"
+
+// Global profiling switch, checked on every lock acquisition
+atomic_int g_lock_profiler_enabled = 0;
+
+// Set once the process runs on one thread, never cleared
+int g_lock_elision = 0;
+
+// Profile slots, one per distinct lock name
+static lock_profile_t g_profiles[LOCK_PROFILER_MAX_LOCKS];
+static atomic_int g_profile_count = 0;
+
+// Protects slot registration only, never taken on the lock fast path
+static pthread_mutex_t g_registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Get monotonic time in nanoseconds
+static inline uint64_t profiler_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Map a duration to its log2 histogram bucket
+static inline int hist_bucket(uint64_t ns) {
+    if (ns == 0) {
+        return 0;
+    }
+    int bucket = 64 - __builtin_clzll(ns);
+    return bucket < LOCK_PROFILER_HIST_BUCKETS ? bucket : LOCK_PROFILER_HIST_BUCKETS - 1;
+}
+
+// Raise an atomic maximum
+static inline void update_max(atomic_uint_fast64_t *max, uint64_t value) {
+    uint64_t current = atomic_load_explicit(max, memory_order_relaxed);
+    while (value > current &&
+           !atomic_compare_exchange_weak_explicit(max, &current, value,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+// Find or create the profile slot for a lock name
+static lock_profile_t *find_or_register_profile(const char *name) {
+    const char *key = name ? name : "unnamed";
+
+    int count = atomic_load_explicit(&g_profile_count, memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        if (strcmp(g_profiles[i].name, key) == 0) {
+            return &g_profiles[i];
+        }
+    }
+
+    pthread_mutex_lock(&g_registry_mutex);
+
+    // Re-scan under the lock in case another thread registered the name
+    count = atomic_load_explicit(&g_profile_count, memory_order_relaxed);
+    for (int i = 0; i < count; i++) {
+        if (strcmp(g_profiles[i].name, key) == 0) {
+            pthread_mutex_unlock(&g_registry_mutex);
+            return &g_profiles[i];
+        }
+    }
+
+    lock_profile_t *profile = NULL;
+    if (count < LOCK_PROFILER_MAX_LOCKS) {
+        profile = &g_profiles[count];
+        strncpy(profile->name, key, LOCK_PROFILER_NAME_LEN - 1);
+        profile->name[LOCK_PROFILER_NAME_LEN - 1] = '\0';
+        atomic_store_explicit(&g_profile_count, count + 1, memory_order_release);
+    }
+
+    pthread_mutex_unlock(&g_registry_mutex);
+    return profile;
+}
+
+// Resolve (and cache) the profile slot of a mutex
+static inline lock_profile_t *get_profile(profiled_mutex_t *m) {
+    lock_profile_t *profile = atomic_load_explicit(&m->profile, memory_order_acquire);
+    if (profile == NULL) {
+        profile = find_or_register_profile(m->name);
+        atomic_store_explicit(&m->profile, profile, memory_order_release);
+    }
+    return profile;
+}
+
+/**
+ * Initialize named mutex
+ */
+int profiled_mutex_init(profiled_mutex_t *m, const char *name) {
+    if (m == NULL) {
+        return EINVAL;
+    }
+
+    m->name = name;
+    atomic_init(&m->profile, NULL);
+    m->acquired_ns = 0;
+    return pthread_mutex_init(&m->mutex, NULL);
+}
+
+/**
+ * Destroy named mutex
+ */
+int profiled_mutex_destroy(profiled_mutex_t *m) {
+    if (m == NULL) {
+        return EINVAL;
+    }
+    return pthread_mutex_destroy(&m->mutex);
+}
+
+/**
+ * Profiled lock path: detect contention with trylock, then time the wait
+ */
+int lock_profiler_lock_slow(profiled_mutex_t *m) {
+    lock_profile_t *profile = get_profile(m);
+    uint64_t wait_ns = 0;
+    int ret;
+
+    ret = pthread_mutex_trylock(&m->mutex);
+    if (ret == EBUSY) {
+        uint64_t start = profiler_now_ns();
+        ret = pthread_mutex_lock(&m->mutex);
+        wait_ns = profiler_now_ns() - start;
+        if (ret == 0 && profile) {
+            atomic_fetch_add_explicit(&profile->contended, 1, memory_order_relaxed);
+        }
+    }
+
+    if (ret != 0) {
+        return ret;
+    }
+
+    if (profile) {
+        atomic_fetch_add_explicit(&profile->acquisitions, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&profile->total_wait_ns, wait_ns, memory_order_relaxed);
+        atomic_fetch_add_explicit(&profile->wait_hist[hist_bucket(wait_ns)], 1, memory_order_relaxed);
+        update_max(&profile->max_wait_ns, wait_ns);
+        m->acquired_ns = profiler_now_ns();
+    }
+
+    return 0;
+}
+
+/**
+ * Profiled unlock path: record hold time while still owning the lock
+ */
+void lock_profiler_unlock_slow(profiled_mutex_t *m) {
+    uint64_t hold_ns = profiler_now_ns() - m->acquired_ns;
+    m->acquired_ns = 0;
+
+    lock_profile_t *profile = atomic_load_explicit(&m->profile, memory_order_acquire);
+    if (profile == NULL) {
+        return;
+    }
+
+    atomic_fetch_add_explicit(&profile->total_hold_ns, hold_ns, memory_order_relaxed);
+    atomic_fetch_add_explicit(&profile->hold_hist[hist_bucket(hold_ns)], 1, memory_order_relaxed);
+    update_max(&profile->max_hold_ns, hold_ns);
+}
+
+/**
+ * Enable or disable profiling
+ */
+void lock_profiler_enable(int enabled) {
+    int previous = atomic_exchange(&g_lock_profiler_enabled, enabled ? 1 : 0);
+    if (previous != (enabled ? 1 : 0)) {
+        log_info("Lock contention profiling %s", enabled ? "enabled" : "disabled");
+    }
+}
+
+/**
+ * Check whether profiling is enabled
+ */
+int lock_profiler_is_enabled(void) {
+    return atomic_load(&g_lock_profiler_enabled) ? 1 : 0;
+}
+
+// Number of threads in this process from /proc, -1 when unknown
+static int process_thread_count(void) {
+    FILE *fp = fopen("/proc/self/status", "r");
+    if (fp == NULL) {
+        return -1;
+    }
+    
+    char line[128];
+    int threads = -1;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (sscanf(line, "Threads: %d", &threads) == 1) {
+            break;
+        }
+    }
+    fclose(fp);
+    return threads;
+}
+
+/**
+ * Stop taking locks for the rest of the process lifetime
+ */
+int lock_elision_enable(void) {
+    // A second thread could hold or race for any of the elided locks
+    int threads = process_thread_count();
+    if (threads != 1) {
+        log_error("Cannot enter single-threaded mode: process has %d threads", threads);
+        return -1;
+    }
+    
+    g_lock_elision = 1;
+    return 0;
+}
+
+// Estimate a percentile from a log2 histogram (upper bound of the bucket)
+static uint64_t hist_percentile(const uint64_t *hist, uint64_t total, double percentile) {
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t target = (uint64_t)((double)total * percentile);
+    if (target == 0) {
+        target = 1;
+    }
+
+    uint64_t seen = 0;
+    for (int i = 0; i < LOCK_PROFILER_HIST_BUCKETS; i++) {
+        seen += hist[i];
+        if (seen >= target) {
+            return i == 0 ? 0 : (1ULL << i) - 1;
+        }
+    }
+    return (1ULL << (LOCK_PROFILER_HIST_BUCKETS - 1)) - 1;
+}
+
+/**
+ * Get statistics snapshot of all named locks
+ */
+int lock_profiler_get_stats(lock_profile_stats_t *stats, int max_count) {
+    if (stats == NULL || max_count <= 0) {
+        return 0;
+    }
+
+    int count = atomic_load_explicit(&g_profile_count, memory_order_acquire);
+    if (count > max_count) {
+        count = max_count;
+    }
+
+    for (int i = 0; i < count; i++) {
+        lock_profile_t *profile = &g_profiles[i];
+        lock_profile_stats_t *out = &stats[i];
+        uint64_t hold_total = 0;
+
+        memset(out, 0, sizeof(*out));
+        strncpy(out->name, profile->name, LOCK_PROFILER_NAME_LEN - 1);
+        out->acquisitions = atomic_load(&profile->acquisitions);
+        out->contended = atomic_load(&profile->contended);
+        out->total_wait_ns = atomic_load(&profile->total_wait_ns);
+        out->total_hold_ns = atomic_load(&profile->total_hold_ns);
+        out->max_wait_ns = atomic_load(&profile->max_wait_ns);
+        out->max_hold_ns = atomic_load(&profile->max_hold_ns);
+
+        for (int b = 0; b < LOCK_PROFILER_HIST_BUCKETS; b++) {
+            out->wait_hist[b] = atomic_load(&profile->wait_hist[b]);
+            out->hold_hist[b] = atomic_load(&profile->hold_hist[b]);
+            hold_total += out->hold_hist[b];
+        }
+
+        out->wait_p50_ns = hist_percentile(out->wait_hist, out->acquisitions, 0.50);
+        out->wait_p99_ns = hist_percentile(out->wait_hist, out->acquisitions, 0.99);
+        out->hold_p50_ns = hist_percentile(out->hold_hist, hold_total, 0.50);
+        out->hold_p99_ns = hist_percentile(out->hold_hist, hold_total, 0.99);
+    }
+
+    return count;
+}
+
+/**
+ * Reset all lock statistics
+ */
+void lock_profiler_reset_stats(void) {
+    int count = atomic_load_explicit(&g_profile_count, memory_order_acquire);
+
+    for (int i = 0; i < count; i++) {
+        lock_profile_t *profile = &g_profiles[i];
+        atomic_store(&profile->acquisitions, 0);
+        atomic_store(&profile->contended, 0);
+        atomic_store(&profile->total_wait_ns, 0);
+        atomic_store(&profile->total_hold_ns, 0);
+        atomic_store(&profile->max_wait_ns, 0);
+        atomic_store(&profile->max_hold_ns, 0);
+        for (int b = 0; b < LOCK_PROFILER_HIST_BUCKETS; b++) {
+            atomic_store(&profile->wait_hist[b], 0);
+            atomic_store(&profile->hold_hist[b], 0);
+        }
+    }
+}
+
+/**
+ * Print lock contention statistics
+ */
+void lock_profiler_print_stats(void) {
+    lock_profile_stats_t stats[LOCK_PROFILER_MAX_LOCKS];
+
+    if (!lock_profiler_is_enabled()) {
+        return;
+    }
+
+    // Snapshot first: logging below takes the logger locks, which are profiled too
+    int count = lock_profiler_get_stats(stats, LOCK_PROFILER_MAX_LOCKS);
+
+    log_info("=== Lock Contention Statistics (PID %d) ===", getpid());
+    for (int i = 0; i < count; i++) {
+        lock_profile_stats_t *s = &stats[i];
+        if (s->acquisitions == 0) {
+            continue;
+        }
+
+        double contention_rate = (double)s->contended * 100.0 / (double)s->acquisitions;
+        log_info("%-32s acq=%lu contended=%lu (%.2f%%) wait[avg=%luns p50<=%luns p99<=%luns max=%luns] "
+                 "hold[avg=%luns p50<=%luns p99<=%luns max=%luns]",
+                 s->name, s->acquisitions, s->contended, contention_rate,
+                 s->total_wait_ns / s->acquisitions, s->wait_p50_ns, s->wait_p99_ns, s->max_wait_ns,
+                 s->total_hold_ns / s->acquisitions, s->hold_p50_ns, s->hold_p99_ns, s->max_hold_ns);
+    }
+    log_info("==========================================");
+}
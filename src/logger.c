@@ -5,6 +5,7 @@
  */
 
 #include "../include/logger.h"
+#include "../include/lock_profiler.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -15,6 +16,10 @@
 #include <sys/stat.h>
 #include <pthread.h>
 
+// Allocations in this file are accounted to the logger subsystem
+#define ALLOC_TAG ALLOC_TAG_LOGGER
+#include "../include/alloc_stats.h"
+
 // TLS buffer configuration
 #define TLS_BUFFER_SIZE 8192        // 8KB thread-local buffer
 #define BATCH_FLUSH_THRESHOLD 6144  // Trigger batch flush at 6KB
@@ -43,8 +48,8 @@ typedef struct {
     time_t access_last_write_time;    // Access log last write time
     time_t server_last_flush_time;    // Server log last flush time
     time_t access_last_flush_time;    // Access log last flush time
-    pthread_mutex_t server_mutex;
-    pthread_mutex_t access_mutex;
+    profiled_mutex_t server_mutex;
+    profiled_mutex_t access_mutex;
 } global_log_buffer_t;
 
 // Extended performance statistics structure
@@ -62,14 +67,14 @@ static volatile int g_initialized = 0;
 static logger_config_t g_config;
 static FILE *g_server_log = NULL;
 static FILE *g_access_log = NULL;
-static pthread_mutex_t g_init_mutex = PTHREAD_MUTEX_INITIALIZER;
+static profiled_mutex_t g_init_mutex = PROFILED_MUTEX_INITIALIZER("logger.init");
 
 // Global shared buffer
 static global_log_buffer_t g_global_buffer = {
     .server_pos = 0,
     .access_pos = 0,
-    .server_mutex = PTHREAD_MUTEX_INITIALIZER,
-    .access_mutex = PTHREAD_MUTEX_INITIALIZER
+    .server_mutex = PROFILED_MUTEX_INITIALIZER("logger.server_buffer"),
+    .access_mutex = PROFILED_MUTEX_INITIALIZER("logger.access_buffer")
 };
 
 // Performance statistics
@@ -177,7 +182,7 @@ static void flush_tls_to_global(int is_server_log, int force_flush) {
         return;
     }
     
-    pthread_mutex_t *mutex;
+    profiled_mutex_t *mutex;
     char *global_buf;
     size_t *global_pos;
     FILE *log_file;
@@ -195,7 +200,7 @@ static void flush_tls_to_global(int is_server_log, int force_flush) {
     }
     
     // Lock for batch writing
-    pthread_mutex_lock(mutex);
+    profiled_mutex_lock(mutex);
     
     // Check global buffer space
     if (*global_pos + g_tls_buffer->write_pos >= LOGGER_BUFFER_SIZE) {
@@ -249,7 +254,7 @@ static void flush_tls_to_global(int is_server_log, int force_flush) {
         }
     }
     
-    pthread_mutex_unlock(mutex);
+    profiled_mutex_unlock(mutex);
     
     // Reset TLS buffer and update timestamp
     g_tls_buffer->write_pos = 0;
@@ -328,11 +333,11 @@ int init_logger(const char *log_path, int level, int daily_rotation) {
         return 0;
     }
     
-    pthread_mutex_lock(&g_init_mutex);
+    profiled_mutex_lock(&g_init_mutex);
     
     // Double-checked locking
     if (g_initialized) {
-        pthread_mutex_unlock(&g_init_mutex);
+        profiled_mutex_unlock(&g_init_mutex);
         return 0;
     }
     
@@ -345,7 +350,7 @@ int init_logger(const char *log_path, int level, int daily_rotation) {
     
     // Create log directory
     if (create_log_directory(g_config.log_dir) != 0) {
-        pthread_mutex_unlock(&g_init_mutex);
+        profiled_mutex_unlock(&g_init_mutex);
         return -1;
     }
     
@@ -358,19 +363,22 @@ int init_logger(const char *log_path, int level, int daily_rotation) {
     g_global_buffer.access_last_write_time = now;
     g_global_buffer.server_last_flush_time = now;
     g_global_buffer.access_last_flush_time = now;
+    profiled_mutex_init(&g_global_buffer.server_mutex, "logger.server_buffer");
+    profiled_mutex_init(&g_global_buffer.access_mutex, "logger.access_buffer");
     
     // Open log files
     char server_filename[512], access_filename[512];
     get_log_filename(server_filename, sizeof(server_filename), "server");
     get_log_filename(access_filename, sizeof(access_filename), "access");
     
-    g_server_log = fopen(server_filename, "a");
-    g_access_log = fopen(access_filename, "a");
+    // "e" = O_CLOEXEC, a binary upgrade opens its own log files
+    g_server_log = fopen(server_filename, "ae");
+    g_access_log = fopen(access_filename, "ae");
     
     if (!g_server_log || !g_access_log) {
         if (g_server_log) fclose(g_server_log);
         if (g_access_log) fclose(g_access_log);
-        pthread_mutex_unlock(&g_init_mutex);
+        profiled_mutex_unlock(&g_init_mutex);
         return -1;
     }
     
@@ -383,7 +391,7 @@ int init_logger(const char *log_path, int level, int daily_rotation) {
     
     g_initialized = 1;
     
-    pthread_mutex_unlock(&g_init_mutex);
+    profiled_mutex_unlock(&g_init_mutex);
     
     // Log initialization success
     if (g_config.level <= LOG_LEVEL_INFO) {
@@ -403,7 +411,7 @@ int update_logger_config(const char *log_path, int level, int daily_rotation) {
         return 0;  // Silent return to avoid duplicate initialization
     }
     
-    pthread_mutex_lock(&g_init_mutex);
+    profiled_mutex_lock(&g_init_mutex);
     
     // Force flush all buffers
     logger_flush();
@@ -415,7 +423,7 @@ int update_logger_config(const char *log_path, int level, int daily_rotation) {
     g_config.level = level;
     g_config.daily_rotation = daily_rotation;
     
-    pthread_mutex_unlock(&g_init_mutex);
+    profiled_mutex_unlock(&g_init_mutex);
     
     // Only output configuration update log in Master process
     if (getenv("WORKER_PROCESS_ID") == NULL && g_config.level <= LOG_LEVEL_INFO) {
@@ -425,16 +433,31 @@ int update_logger_config(const char *log_path, int level, int daily_rotation) {
     return 0;
 }
 
+// Change log level at runtime without touching files or rotation
+int logger_set_level(int level) {
+    if (level < LOG_LEVEL_DEBUG || level > LOG_LEVEL_ERROR) {
+        return -1;
+    }
+    
+    g_config.level = (log_level_t)level;
+    return 0;
+}
+
+// Get current log level
+int logger_get_level(void) {
+    return (int)g_config.level;
+}
+
 // Close logging system
 void close_logger(void) {
     if (!g_initialized) {
         return;
     }
     
-    pthread_mutex_lock(&g_init_mutex);
+    profiled_mutex_lock(&g_init_mutex);
     
     if (!g_initialized) {
-        pthread_mutex_unlock(&g_init_mutex);
+        profiled_mutex_unlock(&g_init_mutex);
         return;
     }
     
@@ -442,7 +465,7 @@ void close_logger(void) {
     logger_flush();
     
     // Flush global buffers to files
-    pthread_mutex_lock(&g_global_buffer.server_mutex);
+    profiled_mutex_lock(&g_global_buffer.server_mutex);
     if (g_global_buffer.server_pos > 0 && g_server_log) {
         size_t written = fwrite(g_global_buffer.server_buffer, 1, g_global_buffer.server_pos, g_server_log);
         if (written == g_global_buffer.server_pos) {
@@ -452,9 +475,9 @@ void close_logger(void) {
         }
         g_global_buffer.server_pos = 0;
     }
-    pthread_mutex_unlock(&g_global_buffer.server_mutex);
+    profiled_mutex_unlock(&g_global_buffer.server_mutex);
     
-    pthread_mutex_lock(&g_global_buffer.access_mutex);
+    profiled_mutex_lock(&g_global_buffer.access_mutex);
     if (g_global_buffer.access_pos > 0 && g_access_log) {
         size_t written = fwrite(g_global_buffer.access_buffer, 1, g_global_buffer.access_pos, g_access_log);
         if (written == g_global_buffer.access_pos) {
@@ -464,7 +487,7 @@ void close_logger(void) {
         }
         g_global_buffer.access_pos = 0;
     }
-    pthread_mutex_unlock(&g_global_buffer.access_mutex);
+    profiled_mutex_unlock(&g_global_buffer.access_mutex);
     
     // Close files
     if (g_server_log) {
@@ -478,7 +501,7 @@ void close_logger(void) {
     
     g_initialized = 0;
     
-    pthread_mutex_unlock(&g_init_mutex);
+    profiled_mutex_unlock(&g_init_mutex);
 }
 
 // Generic log message function
@@ -558,7 +581,7 @@ void log_access(const char *client_ip, const char *method, const char *path,
     
     if (len > 0 && len < MAX_LOG_ENTRY_SIZE) {
         // Write directly to access log global buffer to avoid TLS buffer confusion
-        pthread_mutex_lock(&g_global_buffer.access_mutex);
+        profiled_mutex_lock(&g_global_buffer.access_mutex);
         
         // Check global buffer space
         if (g_global_buffer.access_pos + len >= LOGGER_BUFFER_SIZE) {
@@ -601,7 +624,7 @@ void log_access(const char *client_ip, const char *method, const char *path,
             }
         }
         
-        pthread_mutex_unlock(&g_global_buffer.access_mutex);
+        profiled_mutex_unlock(&g_global_buffer.access_mutex);
     }
 }
 
@@ -623,7 +646,7 @@ static void flush_global_buffers_to_file(void) {
     time_t now = time(NULL);
     
     // Flush server log global buffer
-    pthread_mutex_lock(&g_global_buffer.server_mutex);
+    profiled_mutex_lock(&g_global_buffer.server_mutex);
     if (g_global_buffer.server_pos > 0 && g_server_log) {
         // Check if flush is needed (idle 5 seconds or periodic 30 seconds)
         if ((now - g_global_buffer.server_last_write_time >= IDLE_FLUSH_INTERVAL) ||
@@ -640,10 +663,10 @@ static void flush_global_buffers_to_file(void) {
             g_global_buffer.server_pos = 0;
         }
     }
-    pthread_mutex_unlock(&g_global_buffer.server_mutex);
+    profiled_mutex_unlock(&g_global_buffer.server_mutex);
     
     // Flush access log global buffer
-    pthread_mutex_lock(&g_global_buffer.access_mutex);
+    profiled_mutex_lock(&g_global_buffer.access_mutex);
     if (g_global_buffer.access_pos > 0 && g_access_log) {
         // Check if flush is needed (idle 5 seconds or periodic 30 seconds)
         if ((now - g_global_buffer.access_last_write_time >= IDLE_FLUSH_INTERVAL) ||
@@ -660,7 +683,7 @@ static void flush_global_buffers_to_file(void) {
             g_global_buffer.access_pos = 0;
         }
     }
-    pthread_mutex_unlock(&g_global_buffer.access_mutex);
+    profiled_mutex_unlock(&g_global_buffer.access_mutex);
 }
 
 // Check and flush idle buffers (called by main loop)
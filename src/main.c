@@ -16,12 +16,16 @@
 #include <getopt.h>
 #include <sys/wait.h>
 #include <errno.h>
+#include <fcntl.h>
 
 #include "../include/master_process.h"
 #include "../include/logger.h"
 #include "../include/config.h"
+#include "../include/config_validator.h"
 #include "../include/process_title.h"
 #include "../include/process_lock.h"
+#include "../include/admin_socket.h"
+#include "../include/cpu_affinity.h"
 
 #define DEFAULT_PORT 9001
 
@@ -43,6 +47,8 @@ void show_help(const char *program_name) {
     printf("                    reload: reload configuration\n");
     printf("                    stop: graceful shutdown (wait up to 10 seconds)\n");
     printf("                    quit: force terminate immediately\n");
+    printf("                    upgrade: start the current binary again and hand over the listening socket\n");
+    printf("  -a <command>    Send command to the admin socket of a running server (try: -a help)\n");
     printf("  -t              Test configuration file syntax\n");
     printf("  -v              Show version information\n");
     printf("  -h              Show this help information\n");
@@ -50,6 +56,7 @@ void show_help(const char *program_name) {
     printf("Examples:\n");
     printf("  %s -p 9001 -c config/gateway_multiprocess.conf\n", program_name);
     printf("  %s -s reload\n", program_name);
+    printf("  %s -a workers\n", program_name);
     printf("  %s -t\n", program_name);
 }
 
@@ -75,18 +82,54 @@ int test_config(const char *config_file) {
     }
     
     printf("Configuration file syntax is correct\n");
+    
+    if (validate_and_optimize_config(config) != 0) {
+        printf("Configuration file test failed: invalid settings\n");
+        free_config(config);
+        return -1;
+    }
+    print_auto_tune_report();
+    
     printf("Configuration information:\n");
     printf("  Worker processes: %d\n", config->worker_processes);
+    
+    if (config->worker_cpu_affinity[0] != '\0') {
+        if (cpu_affinity_validate(config->worker_cpu_affinity) != 0) {
+            printf("Configuration file test failed: invalid worker_cpu_affinity \"%s\"\n", config->worker_cpu_affinity);
+            free_config(config);
+            return -1;
+        }
+        printf("  CPU affinity: %s\n", config->worker_cpu_affinity);
+        for (int i = 0; i < config->worker_processes; i++) {
+            cpu_set_t set;
+            int node = -1;
+            char cpus[256];
+            if (cpu_affinity_worker_set(config->worker_cpu_affinity, i, config->worker_processes, &set, &node) != 0) {
+                printf("    worker %d -> no usable CPU, runs unbound\n", i);
+            } else {
+                cpu_set_t allowed;
+                int available = 1;
+                if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+                    CPU_AND(&allowed, &allowed, &set);
+                    available = CPU_COUNT(&allowed) > 0;
+                }
+                printf("    worker %d -> CPU %s, NUMA node %d%s\n", i, cpu_affinity_format(&set, cpus, sizeof(cpus)),
+                       node, available ? "" : " (not available to this process, runs unbound)");
+            }
+        }
+    }
+    
     printf("  Route count: %d\n", config->route_count);
     
     for (int i = 0; i < config->route_count; i++) {
         route_t *route = &config->routes[i];
+        const char *priority = route->priority == ROUTE_PRIORITY_LOW ? ", low priority" : "";
         if (route->type == ROUTE_STATIC) {
-            printf("  [%d] %s -> static files (%s)\n", 
-                   i + 1, route->path_prefix, route->local_path);
+            printf("  [%d] %s -> static files (%s%s)\n", 
+                   i + 1, route->path_prefix, route->local_path, priority);
         } else if (route->type == ROUTE_PROXY) {
-            printf("  [%d] %s -> proxy (%s:%d)\n", 
-                   i + 1, route->path_prefix, route->target_host, route->target_port);
+            printf("  [%d] %s -> proxy (%s:%d%s)\n", 
+                   i + 1, route->path_prefix, route->target_host, route->target_port, priority);
         }
     }
     
@@ -106,11 +149,18 @@ int send_signal_to_server(const char *signal_name) {
         sig = SIGTERM;
     } else if (strcmp(signal_name, "quit") == 0) {
         sig = SIGQUIT;
+    } else if (strcmp(signal_name, "upgrade") == 0) {
+        sig = SIGUSR2;
     } else {
         fprintf(stderr, "Unknown signal: %s\n", signal_name);
         return -1;
     }
     
+    // Port given with -p first
+    if (g_port > 0 && check_server_running(g_port) > 0) {
+        return send_signal_to_running_server(g_port, sig);
+    }
+    
     // Try multiple common ports to find running instances
     int common_ports[] = {9001, 8080, 3000, 8000, 9000, 0};
     
@@ -151,6 +201,7 @@ int send_signal_to_server(const char *signal_name) {
                     case SIGHUP: signal_name_str = "RELOAD"; break;
                     case SIGTERM: signal_name_str = "STOP"; break;
                     case SIGQUIT: signal_name_str = "QUIT"; break;
+                    case SIGUSR2: signal_name_str = "UPGRADE"; break;
                 }
                 printf("Sent %s signal to x-server Master process %d, graceful shutdown in progress, please wait...\n", signal_name_str, master_pid);
                 return 0;
@@ -166,6 +217,21 @@ int send_signal_to_server(const char *signal_name) {
     return -1;
 }
 
+/**
+ * Send command to running server through the admin socket
+ */
+int send_admin_command(const char *command) {
+    config_t *config = load_config(g_config_file);
+    if (config == NULL) {
+        fprintf(stderr, "Unable to load config file: %s\n", g_config_file);
+        return -1;
+    }
+    
+    int ret = admin_socket_send_command(config->admin_socket, command);
+    free_config(config);
+    return ret;
+}
+
 /**
  * Set daemon mode
  */
@@ -202,10 +268,21 @@ int daemonize(void) {
     // Keep current working directory, do not change to root directory
     // This ensures that relative path config files can be loaded correctly
     
-    // Close standard input and output
-    close(STDIN_FILENO);
-    close(STDOUT_FILENO);
-    close(STDERR_FILENO);
+    // Point standard input and output at /dev/null, closing them would let the next
+    // open() or socket() land on fd 0-2 and receive stray printf output
+    int null_fd = open("/dev/null", O_RDWR);
+    if (null_fd >= 0) {
+        dup2(null_fd, STDIN_FILENO);
+        dup2(null_fd, STDOUT_FILENO);
+        dup2(null_fd, STDERR_FILENO);
+        if (null_fd > STDERR_FILENO) {
+            close(null_fd);
+        }
+    } else {
+        close(STDIN_FILENO);
+        close(STDOUT_FILENO);
+        close(STDERR_FILENO);
+    }
     
     return 0;
 }
@@ -216,13 +293,14 @@ int daemonize(void) {
 int main(int argc, char *argv[], char *envp[]) {
     int opt;
     char *signal_name = NULL;
+    char *admin_command = NULL;
     int test_config_only = 0;
     
     // Initialize process title setting
     init_process_title(argc, argv, envp);
     
     // Parse command line arguments
-    while ((opt = getopt(argc, argv, "p:c:fs:tvh")) != -1) {
+    while ((opt = getopt(argc, argv, "p:c:fs:a:tvh")) != -1) {
         switch (opt) {
             case 'p':
                 g_port = atoi(optarg);
@@ -244,6 +322,10 @@ int main(int argc, char *argv[], char *envp[]) {
                 signal_name = optarg;
                 break;
                 
+            case 'a':
+                admin_command = optarg;
+                break;
+                
             case 't':
                 test_config_only = 1;
                 break;
@@ -268,6 +350,11 @@ int main(int argc, char *argv[], char *envp[]) {
         return send_signal_to_server(signal_name);
     }
     
+    // Handle admin commands
+    if (admin_command != NULL) {
+        return send_admin_command(admin_command) == 0 ? 0 : 1;
+    }
+    
     // Test configuration file
     if (test_config_only) {
         return test_config(g_config_file);
@@ -300,8 +387,8 @@ int main(int argc, char *argv[], char *envp[]) {
     
     // Initialize log system using config file settings
     if (init_logger(temp_config->log_config.log_path, 
-                   temp_config->log_config.log_daily, 
-                   temp_config->log_config.log_level) != 0) {
+                   temp_config->log_config.log_level, 
+                   temp_config->log_config.log_daily) != 0) {
         fprintf(stderr, "Failed to initialize log system\n");
         free_config(temp_config);
         return 1;
@@ -314,6 +401,10 @@ int main(int argc, char *argv[], char *envp[]) {
     printf("Config file: %s\n", g_config_file);
     printf("Listening port: %d\n", final_port);
     
+    // Started by the old Master of a binary upgrade: already detached, and the old Master
+    // must see this very process as its child
+    int upgraded = getenv(LISTEN_FDS_ENV) != NULL;
+    
     // Initialize Master process (before switching to daemon mode, so error messages can be displayed)
     if (master_process_init(g_config_file, final_port) != 0) {
         log_error("Master process initialization failed");
@@ -329,13 +420,15 @@ int main(int argc, char *argv[], char *envp[]) {
     
     // If not in foreground mode, switch to daemon mode
     // If in daemon mode, switch to daemon mode
-    if (g_daemon_mode) {
+    if (g_daemon_mode && !upgraded) {
         printf("Switching to daemon mode...\n");
         if (daemonize() != 0) {
             fprintf(stderr, "Failed to switch to daemon mode\n");
             close_logger();
             return 1;
         }
+        // The PID file still names the process that exited in daemonize()
+        refresh_pid_file();
     }
     
     log_info("X-Server Multi-Process Version started successfully");
@@ -9,10 +9,16 @@
 #include <signal.h>
 #include <sys/wait.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
 #include <netinet/in.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <time.h>
+#include <dirent.h>
 
 #include "../include/master_process.h"
 #include "../include/worker_process.h"
@@ -20,83 +26,271 @@
 #include "../include/logger.h"
 #include "../include/process_title.h"
 #include "../include/config.h"
+#include "../include/config_validator.h"
 #include "../include/process_lock.h"
+#include "../include/admin_socket.h"
+#include "../include/performance_monitor.h"
+#include "../include/config_snapshot.h"
+#include "../include/file_io_enhanced.h"
+#include "../include/connection_handoff.h"
+#include "../include/pressure_monitor.h"
 
 // Global Master context
 static master_context_t *g_master_ctx = NULL;
 
-// Signal handling flags
-static volatile sig_atomic_t g_reload_config = 0;
-static volatile sig_atomic_t g_shutdown_server = 0;
-static volatile sig_atomic_t g_terminate_server = 0;
-static volatile sig_atomic_t g_worker_exited = 0;
+// Seconds a Worker aborted by the watchdog may take to exit before SIGKILL
+#define WATCHDOG_KILL_GRACE 5
+
+// Auto scaling thresholds: the gap between the utilization thresholds, the sustain windows and
+// the cooldowns keep the Worker count from flapping around a steady load
+#define SCALE_UP_UTILIZATION    0.75
+#define SCALE_DOWN_UTILIZATION  0.25
+#define SCALE_UP_LAG_MS         100
+#define SCALE_UP_SUSTAIN        5
+#define SCALE_DOWN_SUSTAIN      30
+#define SCALE_UP_COOLDOWN       15
+#define SCALE_DOWN_COOLDOWN     120
+
+// Master event loop: control signals arrive on a signalfd, Worker exits on pidfds,
+// periodic work runs from timerfds. The tag in the upper half of epoll data.u64 says
+// which kind of descriptor fired, the lower half carries the descriptor itself.
+#define MASTER_EV_SIGNAL    1
+#define MASTER_EV_TIMER     2
+#define MASTER_EV_WORKER    3
+#define MASTER_EV_ADMIN     4
+#define MASTER_EV_RELAY     5
+#define MASTER_EV_ADMIN_CLIENT 6
+#define MASTER_MAX_EVENTS   32
+
+static int g_epoll_fd = -1;
+static int g_signal_fd = -1;
+
+// Signals handled through the signalfd, blocked for normal delivery in the Master
+static const int g_master_signals[] = {SIGHUP, SIGTERM, SIGINT, SIGQUIT, SIGCHLD, SIGUSR2, SIGWINCH};
+
+// Mask in effect before the Master blocked its signals, restored in every child
+static sigset_t g_saved_sigmask;
+
+static void on_health_timer(void);
+static void on_scaling_timer(void);
+static void on_pressure_timer(void);
+
+typedef struct master_timer {
+    const char *name;
+    int interval_ms;
+    void (*handler)(void);
+    int fd;
+} master_timer_t;
+
+// Health covers Worker liveness, the hang watchdog and idle log flushing,
+// scaling reads the per-second Worker statistics, pressure follows the PSI 10 second averages
+static master_timer_t g_timers[] = {
+    {"health", 500, on_health_timer, -1},
+    {"scaling", 1000, on_scaling_timer, -1},
+    {"pressure", 1000, on_pressure_timer, -1},
+};
+
+#define MASTER_TIMER_COUNT ((int)(sizeof(g_timers) / sizeof(g_timers[0])))
 
 // Forward declarations
-static void master_signal_handler(int sig);
 static int setup_master_signals(void);
 static int create_listen_socket(int port);
+static void apply_rlimit_nofile(int nofile);
+static int adopt_listen_socket(const char *fds, int port);
+static void check_upgrade_child(void);
 static void cleanup_dead_workers(void);
+static void check_hung_workers(void);
+static void configure_auto_scaling(void);
+static void adjust_worker_count(void);
+static void build_warm_state(void);
 #ifdef DEBUG
 static int respawn_worker_if_needed(worker_process_t *worker);
 #endif
 
 /**
- * Master process signal handler
+ * Set up Master process signal handling
  */
-static void master_signal_handler(int sig) {
-    switch (sig) {
-        case SIGHUP:
-            g_reload_config = 1;
-            log_info("Master process received SIGHUP signal, preparing to reload configuration");
-            break;
-            
-        case SIGTERM:
-        case SIGINT:
-            g_shutdown_server = 1;
-            log_info("Master process received SIGTERM/SIGINT signal, preparing for graceful shutdown");
-            break;
-            
-        case SIGQUIT:
-            g_terminate_server = 1;
-            log_info("Master process received SIGQUIT signal, preparing to force terminate");
-            break;
-            
-        case SIGCHLD:
-            g_worker_exited = 1;
-            break;
-            
-        default:
-            log_warn("Master process received unhandled signal: %d", sig);
-            break;
+static int setup_master_signals(void) {
+    sigset_t mask;
+    
+    // Block the control signals, they queue until the event loop reads them from the signalfd
+    sigemptyset(&mask);
+    for (size_t i = 0; i < sizeof(g_master_signals) / sizeof(g_master_signals[0]); i++) {
+        sigaddset(&mask, g_master_signals[i]);
+    }
+    if (sigprocmask(SIG_BLOCK, &mask, &g_saved_sigmask) == -1) {
+        log_error("Failed to block Master process signals: %s", strerror(errno));
+        return -1;
     }
+    
+    // Ignore SIGPIPE signal
+    signal(SIGPIPE, SIG_IGN);
+    
+    return 0;
 }
 
 /**
- * Set up Master process signal handling
+ * Add a descriptor to the Master event loop
  */
-static int setup_master_signals(void) {
-    struct sigaction sa;
+static int master_watch_fd(int fd, uint32_t tag) {
+    struct epoll_event ev;
     
-    // Set up signal handler
-    sa.sa_handler = master_signal_handler;
-    sigemptyset(&sa.sa_mask);
-    sa.sa_flags = SA_RESTART;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u64 = ((uint64_t)tag << 32) | (uint32_t)fd;
+    if (epoll_ctl(g_epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        log_error("Failed to add descriptor %d to Master event loop: %s", fd, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Add, change or remove an admin client descriptor in the Master event loop
+ */
+static int master_watch_admin_client(int op, int fd, uint32_t events) {
+    struct epoll_event ev;
     
-    if (sigaction(SIGHUP, &sa, NULL) == -1 ||
-        sigaction(SIGTERM, &sa, NULL) == -1 ||
-        sigaction(SIGINT, &sa, NULL) == -1 ||
-        sigaction(SIGQUIT, &sa, NULL) == -1 ||
-        sigaction(SIGCHLD, &sa, NULL) == -1) {
-        log_error("Failed to set up Master process signal handler: %s", strerror(errno));
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.u64 = ((uint64_t)MASTER_EV_ADMIN_CLIENT << 32) | (uint32_t)fd;
+    if (g_epoll_fd < 0 || epoll_ctl(g_epoll_fd, op, fd, &ev) != 0) {
+        log_warn("Failed to update admin client %d in Master event loop: %s", fd, strerror(errno));
         return -1;
     }
+    return 0;
+}
+
+/**
+ * Create the Master epoll instance, signalfd and timers
+ */
+static int master_event_loop_init(void) {
+    sigset_t mask;
     
-    // Ignore SIGPIPE signal
-    signal(SIGPIPE, SIG_IGN);
+    g_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (g_epoll_fd < 0) {
+        log_error("Failed to create Master epoll instance: %s", strerror(errno));
+        return -1;
+    }
+    
+    sigemptyset(&mask);
+    for (size_t i = 0; i < sizeof(g_master_signals) / sizeof(g_master_signals[0]); i++) {
+        sigaddset(&mask, g_master_signals[i]);
+    }
+    g_signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (g_signal_fd < 0) {
+        log_error("Failed to create Master signalfd: %s", strerror(errno));
+        return -1;
+    }
+    if (master_watch_fd(g_signal_fd, MASTER_EV_SIGNAL) != 0) {
+        return -1;
+    }
+    
+    for (int i = 0; i < MASTER_TIMER_COUNT; i++) {
+        struct itimerspec spec;
+        
+        g_timers[i].fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (g_timers[i].fd < 0) {
+            log_error("Failed to create Master %s timer: %s", g_timers[i].name, strerror(errno));
+            return -1;
+        }
+        spec.it_interval.tv_sec = g_timers[i].interval_ms / 1000;
+        spec.it_interval.tv_nsec = (long)(g_timers[i].interval_ms % 1000) * 1000000L;
+        spec.it_value = spec.it_interval;
+        if (timerfd_settime(g_timers[i].fd, 0, &spec, NULL) != 0 ||
+            master_watch_fd(g_timers[i].fd, MASTER_EV_TIMER) != 0) {
+            log_error("Failed to start Master %s timer: %s", g_timers[i].name, strerror(errno));
+            return -1;
+        }
+    }
+    
+    if (admin_socket_fd() >= 0) {
+        admin_socket_set_watch(master_watch_admin_client);
+        master_watch_fd(admin_socket_fd(), MASTER_EV_ADMIN);
+        master_watch_fd(admin_socket_timer_fd(), MASTER_EV_RELAY);
+    }
     
     return 0;
 }
 
+/**
+ * Close the Master event loop descriptors
+ */
+static void master_event_loop_close(void) {
+    for (int i = 0; i < MASTER_TIMER_COUNT; i++) {
+        if (g_timers[i].fd >= 0) {
+            close(g_timers[i].fd);
+            g_timers[i].fd = -1;
+        }
+    }
+    if (g_signal_fd >= 0) {
+        close(g_signal_fd);
+        g_signal_fd = -1;
+    }
+    if (g_epoll_fd >= 0) {
+        close(g_epoll_fd);
+        g_epoll_fd = -1;
+    }
+}
+
+/**
+ * Open a pidfd for a Worker and watch it, -1 when the kernel has no pidfd support
+ */
+static int watch_worker_exit(pid_t pid) {
+    int pidfd = (int)syscall(SYS_pidfd_open, pid, 0);
+    
+    if (pidfd < 0) {
+        // Worker exits are still seen through SIGCHLD
+        log_debug("pidfd_open for Worker %d failed: %s", pid, strerror(errno));
+        return -1;
+    }
+    if (g_epoll_fd >= 0 && master_watch_fd(pidfd, MASTER_EV_WORKER) != 0) {
+        close(pidfd);
+        return -1;
+    }
+    return pidfd;
+}
+
+/**
+ * Child side of fork(): drop the Master event loop and restore normal signal delivery
+ */
+static void master_release_in_child(void) {
+    // A sibling's pidfd left open here would keep it registered in the Master's epoll after exit
+    for (worker_process_t *w = g_master_ctx->workers; w != NULL; w = w->next) {
+        if (w->pidfd >= 0) {
+            close(w->pidfd);
+            w->pidfd = -1;
+        }
+    }
+    master_event_loop_close();
+    sigprocmask(SIG_SETMASK, &g_saved_sigmask, NULL);
+}
+
+/**
+ * Raise the soft descriptor limit to worker_rlimit_nofile, Workers inherit it across fork
+ */
+static void apply_rlimit_nofile(int nofile) {
+    struct rlimit rlim;
+    if (nofile <= 0 || getrlimit(RLIMIT_NOFILE, &rlim) != 0) {
+        return;
+    }
+    
+    rlim_t want = (rlim_t)nofile;
+    if (rlim.rlim_max != RLIM_INFINITY && want > rlim.rlim_max) {
+        want = rlim.rlim_max;
+    }
+    if (want == rlim.rlim_cur) {
+        return;
+    }
+    
+    rlim.rlim_cur = want;
+    if (setrlimit(RLIMIT_NOFILE, &rlim) != 0) {
+        log_warn("Failed to set RLIMIT_NOFILE to %lu: %s", (unsigned long)want, strerror(errno));
+        return;
+    }
+    log_info("RLIMIT_NOFILE soft limit set to %lu", (unsigned long)want);
+}
+
 /**
  * Create listening socket
  */
@@ -152,6 +346,40 @@ static int create_listen_socket(int port) {
     return listen_fd;
 }
 
+/**
+ * Adopt the listening socket passed by the old Master of a binary upgrade
+ */
+static int adopt_listen_socket(const char *fds, int port) {
+    char *end;
+    long fd = strtol(fds, &end, 10);
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int accepting = 0;
+    socklen_t opt_len = sizeof(accepting);
+    
+    if (end == fds || *end != '\0' || fd < 0 || fd > 65535) {
+        log_error("Invalid %s value: %s", LISTEN_FDS_ENV, fds);
+        return -1;
+    }
+    
+    // Must be a listening IPv4 socket on the configured port, not whatever the fd number happens to be
+    if (getsockname((int)fd, (struct sockaddr *)&addr, &addr_len) < 0 ||
+        getsockopt((int)fd, SOL_SOCKET, SO_ACCEPTCONN, &accepting, &opt_len) < 0) {
+        log_error("Inherited listening socket %ld is not usable: %s", fd, strerror(errno));
+        return -1;
+    }
+    if (addr.sin_family != AF_INET || !accepting || ntohs(addr.sin_port) != port) {
+        log_error("Inherited socket %ld is not listening on port %d", fd, port);
+        return -1;
+    }
+    
+    // Workers fork from this process, a later upgrade clears the flag again in its child
+    fcntl((int)fd, F_SETFD, FD_CLOEXEC);
+    
+    log_info("Adopted inherited listening socket %ld on port %d", fd, port);
+    return (int)fd;
+}
+
 /**
  * Initialize Master process
  */
@@ -196,9 +424,31 @@ int master_process_init(const char *config_file, int listen_port) {
         return -1;
     }
     
-    // Create listening socket
-    g_master_ctx->listen_fd = create_listen_socket(listen_port);
+    // Size unset settings to the container's CPU, memory and descriptor limits
+    if (validate_and_optimize_config(g_master_ctx->config) != 0) {
+        log_error("Invalid configuration: %s", config_file);
+        free_config(g_master_ctx->config);
+        free(g_master_ctx->config_file);
+        free(g_master_ctx);
+        release_pid_file();
+        return -1;
+    }
+    apply_rlimit_nofile(g_master_ctx->config->worker_rlimit_nofile);
+    
+    // Create listening socket, or take over the one of the old Master during a binary upgrade
+    const char *inherited_fds = getenv(LISTEN_FDS_ENV);
+    if (inherited_fds != NULL) {
+        const char *old_master = getenv(OLD_MASTER_ENV);
+        g_master_ctx->old_master_pid = old_master ? (pid_t)atoi(old_master) : 0;
+        g_master_ctx->listen_fd = adopt_listen_socket(inherited_fds, listen_port);
+        // Workers and later upgrades must not see the handoff variables
+        unsetenv(LISTEN_FDS_ENV);
+        unsetenv(OLD_MASTER_ENV);
+    } else {
+        g_master_ctx->listen_fd = create_listen_socket(listen_port);
+    }
     if (g_master_ctx->listen_fd < 0) {
+        release_pid_file();
         free_config(g_master_ctx->config);
         free(g_master_ctx->config_file);
         free(g_master_ctx);
@@ -215,8 +465,15 @@ int master_process_init(const char *config_file, int listen_port) {
         return -1;
     }
     
+    // Without handoff sockets Workers simply keep the connections they accepted
+    connection_handoff_init();
+    
+    // Without PSI Workers never see pressure flags and run as configured
+    pressure_monitor_init(g_master_ctx->config);
+    
     // Set up signal handling
     if (setup_master_signals() != 0) {
+        connection_handoff_cleanup();
         cleanup_shared_memory();
         close(g_master_ctx->listen_fd);
         free_config(g_master_ctx->config);
@@ -225,12 +482,21 @@ int master_process_init(const char *config_file, int listen_port) {
         return -1;
     }
     
+    // Admin socket failure is not fatal, signals still work
+    if (g_master_ctx->config->admin_socket[0] != '\0') {
+        admin_socket_open(g_master_ctx->config->admin_socket);
+    }
+    
     // Determine Worker processes count
     g_master_ctx->worker_count = g_master_ctx->config->worker_processes;
     if (g_master_ctx->worker_count <= 0) {
         g_master_ctx->worker_count = sysconf(_SC_NPROCESSORS_ONLN);
     }
     
+    configure_auto_scaling();
+    
+    build_warm_state();
+    
     log_info("Master process initialization completed, PID: %d, Worker processes: %d", 
              g_master_ctx->master_pid, g_master_ctx->worker_count);
     
@@ -241,6 +507,9 @@ int master_process_init(const char *config_file, int listen_port) {
  * Create Worker process
  */
 pid_t spawn_worker_process(int worker_id) {
+    // Clear the previous occupant's heartbeat so the watchdog times the new Worker from its start
+    reset_worker_slot(worker_id);
+    
     pid_t pid = fork();
     
     if (pid < 0) {
@@ -263,6 +532,14 @@ pid_t spawn_worker_process(int worker_id) {
         snprintf(title, sizeof(title), "x-server: worker process %d", worker_id);
         setproctitle(title);
         
+        // The admin socket belongs to the Master
+        admin_socket_close_inherited();
+        
+        // A terminal Ctrl-C or an upgrade signal sent to the process group is for the Master
+        master_release_in_child();
+        signal(SIGINT, SIG_IGN);
+        signal(SIGUSR2, SIG_IGN);
+        
         // Worker process doesn't need to reinitialize log system, directly use inherited configuration
         // Just need to simply record startup information
         log_info("Worker process %d starting, PID: %d", worker_id, getpid());
@@ -272,6 +549,9 @@ pid_t spawn_worker_process(int worker_id) {
         
         log_info("Worker process %d exited, return code: %d", worker_id, ret);
         
+        // Flush buffered Worker logs, _exit() below skips stdio cleanup
+        close_logger();
+        
         // Critical fix: Worker process must exit immediately here, cannot continue executing Master process code
         // This is the key to prevent Worker process from repeatedly executing Master process initialization logic
         _exit(ret);  // Use _exit() instead of exit() to avoid executing atexit() registered cleanup functions
@@ -286,10 +566,14 @@ pid_t spawn_worker_process(int worker_id) {
     }
     
     worker->pid = pid;
+    worker->worker_id = worker_id;
     worker->status = 1;
     worker->start_time = time(NULL);
     worker->last_heartbeat = time(NULL);
+    worker->kill_time = 0;
+    worker->retiring = 0;
     worker->respawn_count = 0;
+    worker->pidfd = watch_worker_exit(pid);
     worker->next = g_master_ctx->workers;
     g_master_ctx->workers = worker;
     
@@ -321,7 +605,18 @@ static void cleanup_dead_workers(void) {
                 prev->next = worker->next;
             }
             
+            // Its requests stay in the totals after the slot is reused
+            retire_worker_slot(worker->worker_id);
+            
+            // A retiring Worker's slot stays empty, nobody would adopt connections queued for it
+            if (worker->retiring) {
+                connection_handoff_discard(worker->worker_id);
+            }
+            
             worker_process_t *next = worker->next;
+            if (worker->pidfd >= 0) {
+                close(worker->pidfd);
+            }
             free(worker);
             worker = next;
         } else {
@@ -358,6 +653,169 @@ static int respawn_worker_if_needed(worker_process_t *worker) {
 }
 #endif
 
+/**
+ * Find the lowest Worker ID not used by a live Worker, so replacements reuse the exited Worker's stats slot
+ */
+static int find_free_worker_id(void) {
+    for (int id = 0; id < 32; id++) {
+        int used = 0;
+        for (worker_process_t *worker = g_master_ctx->workers; worker != NULL; worker = worker->next) {
+            if (worker->worker_id == id) {
+                used = 1;
+                break;
+            }
+        }
+        if (!used) {
+            return id;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Log what a stuck Worker's threads are doing, from /proc
+ */
+static void dump_worker_threads(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/task", pid);
+    
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        log_error("  cannot read %s: %s", path, strerror(errno));
+        return;
+    }
+    
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        // Task entries are thread ids
+        char *end;
+        long tid = strtol(entry->d_name, &end, 10);
+        if (entry->d_name[0] == '.' || *end != '\0' || tid <= 0) {
+            continue;
+        }
+        
+        // stat is "tid (comm) state ...", comm may contain spaces and parentheses
+        char stat[512] = "";
+        char wchan[128] = "";
+        char file[128];
+        
+        snprintf(file, sizeof(file), "/proc/%d/task/%ld/stat", pid, tid);
+        FILE *fp = fopen(file, "re");
+        if (fp != NULL) {
+            if (fgets(stat, sizeof(stat), fp) == NULL) {
+                stat[0] = '\0';
+            }
+            fclose(fp);
+        }
+        
+        snprintf(file, sizeof(file), "/proc/%d/task/%ld/wchan", pid, tid);
+        fp = fopen(file, "re");
+        if (fp != NULL) {
+            if (fgets(wchan, sizeof(wchan), fp) == NULL) {
+                wchan[0] = '\0';
+            }
+            fclose(fp);
+        }
+        
+        const char *comm = strchr(stat, '(');
+        const char *comm_end = strrchr(stat, ')');
+        char state = '?';
+        int comm_len = 0;
+        if (comm != NULL && comm_end != NULL && comm_end > comm) {
+            comm_len = (int)(comm_end - comm - 1);
+            if (comm_end[1] == ' ' && comm_end[2] != '\0') {
+                state = comm_end[2];
+            }
+            comm++;
+        } else {
+            comm = "";
+        }
+        
+        log_error("  thread %ld (%.*s) state=%c wchan=%s", tid, comm_len, comm, state,
+                  wchan[0] != '\0' ? wchan : "-");
+    }
+    
+    closedir(dir);
+}
+
+/**
+ * Replace Workers whose event loop stopped stamping its heartbeat: spawn the replacement first,
+ * then abort the stuck Worker, escalating to SIGKILL if it does not exit
+ */
+static void check_hung_workers(void) {
+    int timeout = g_master_ctx->config->worker_watchdog_timeout;
+    if (timeout <= 0 || g_master_ctx->state != MASTER_RUNNING) {
+        return;
+    }
+    
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t now_ms = (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+    time_t now = time(NULL);
+    
+    // Snapshot the list head, replacements are pushed in front of it and are not checked this pass
+    for (worker_process_t *worker = g_master_ctx->workers; worker != NULL; worker = worker->next) {
+        if (worker->kill_time != 0) {
+            if (now - worker->kill_time >= WATCHDOG_KILL_GRACE) {
+                log_error("Hung Worker process %d did not exit after SIGABRT, sending SIGKILL", worker->pid);
+                kill(worker->pid, SIGKILL);
+                worker->kill_time = now;
+            }
+            continue;
+        }
+        
+        uint64_t heartbeat_ms = 0;
+        uint64_t iterations = 0;
+        if (read_worker_heartbeat(worker->worker_id, &heartbeat_ms, &iterations) != 0) {
+            continue;
+        }
+        
+        // Before its loop starts a Worker is timed from the fork, startup counts against the timeout
+        uint64_t age_ms;
+        if (heartbeat_ms == 0) {
+            age_ms = (uint64_t)(now > worker->start_time ? now - worker->start_time : 0) * 1000;
+        } else {
+            age_ms = now_ms > heartbeat_ms ? now_ms - heartbeat_ms : 0;
+            worker->last_heartbeat = now - (time_t)(age_ms / 1000);
+        }
+        
+        if (age_ms <= (uint64_t)timeout * 1000) {
+            continue;
+        }
+        
+        // Read the slot directly: a Worker stuck inside a stats write leaves its seqlock odd,
+        // and a torn value only affects these diagnostic lines
+        shared_stats_t *stats = get_shared_stats();
+        log_error("Worker process %d (Worker ID %d) hung: no event loop heartbeat for %.1fs "
+                  "(timeout %ds), loop iterations=%lu",
+                  worker->pid, worker->worker_id, (double)age_ms / 1000.0, timeout, (unsigned long)iterations);
+        if (stats != NULL) {
+            log_error("  requests=%lu active_connections=%u loop_lag_peak_ms=%.3f draining=%d",
+                      (unsigned long)stats->workers[worker->worker_id].requests,
+                      stats->workers[worker->worker_id].active_connections,
+                      (double)stats->workers[worker->worker_id].loop_lag_peak_us / 1e3,
+                      stats->workers[worker->worker_id].draining);
+        }
+        dump_worker_threads(worker->pid);
+        
+        // Replacement first, so capacity never drops while the stuck Worker is torn down
+        int worker_id = worker->retiring ? -1 : find_free_worker_id();
+        if (worker->retiring) {
+            log_info("Hung Worker process %d was retiring, not replacing it", worker->pid);
+        } else if (worker_id < 0 || spawn_worker_process(worker_id) < 0) {
+            log_error("Failed to start replacement for hung Worker process %d, it will be replaced after exit",
+                      worker->pid);
+        }
+        
+        // SIGABRT leaves a core dump when enabled, SIGKILL follows if it is stopped or blocked
+        if (kill(worker->pid, SIGABRT) != 0 && errno != ESRCH) {
+            log_error("Failed to abort hung Worker process %d: %s", worker->pid, strerror(errno));
+        }
+        worker->kill_time = now;
+        g_master_ctx->hung_workers_replaced++;
+    }
+}
+
 /**
  * Monitor Worker process status
  */
@@ -365,19 +823,28 @@ void monitor_worker_processes(void) {
     // Clean up dead Worker processes
     cleanup_dead_workers();
     
-    // Count current active Worker processes
+    // Replace Workers whose event loop is stuck
+    check_hung_workers();
+    
+    // Count current active Worker processes, Workers being torn down by the watchdog already have a
+    // replacement and retiring Workers are surplus
     int active_workers = 0;
     worker_process_t *worker = g_master_ctx->workers;
     while (worker != NULL) {
-        active_workers++;
+        if (worker->kill_time == 0 && !worker->retiring) {
+            active_workers++;
+        }
         worker = worker->next;
     }
     
     // If Worker processes count is insufficient, start new Worker processes
     while (active_workers < g_master_ctx->worker_count && 
            g_master_ctx->state == MASTER_RUNNING) {
-        static int worker_id_counter = 0;
-        if (spawn_worker_process(worker_id_counter++) > 0) {
+        int worker_id = find_free_worker_id();
+        if (worker_id < 0) {
+            break;
+        }
+        if (spawn_worker_process(worker_id) > 0) {
             active_workers++;
         } else {
             break;
@@ -385,6 +852,94 @@ void monitor_worker_processes(void) {
     }
 }
 
+/**
+ * Load the auto scaling range from the configuration and clamp the Worker count into it
+ */
+static void configure_auto_scaling(void) {
+    config_t *config = g_master_ctx->config;
+    if (!config->worker_scaling) {
+        cleanup_performance_monitor();
+        return;
+    }
+    
+    performance_config_t scaling = {
+        .enable_auto_scaling = 1,
+        .min_workers = config->worker_scaling_min,
+        .max_workers = config->worker_scaling_max > 0 ? config->worker_scaling_max : config->worker_processes,
+        .scale_up_utilization = SCALE_UP_UTILIZATION,
+        .scale_down_utilization = SCALE_DOWN_UTILIZATION,
+        .scale_up_lag_ms = SCALE_UP_LAG_MS,
+        .scale_up_sustain = SCALE_UP_SUSTAIN,
+        .scale_down_sustain = SCALE_DOWN_SUSTAIN,
+        .scale_up_cooldown = SCALE_UP_COOLDOWN,
+        .scale_down_cooldown = SCALE_DOWN_COOLDOWN
+    };
+    if (init_performance_monitor(&scaling) != 0) {
+        return;
+    }
+    
+    if (g_master_ctx->worker_count < scaling.min_workers) {
+        g_master_ctx->worker_count = scaling.min_workers;
+    } else if (g_master_ctx->worker_count > scaling.max_workers) {
+        g_master_ctx->worker_count = scaling.max_workers;
+    }
+}
+
+/**
+ * Apply the auto scaling decision: raise the target and let the monitor spawn, or drain surplus Workers
+ */
+static void adjust_worker_count(void) {
+    int change = check_auto_scaling_needs();
+    if (change > 0) {
+        g_master_ctx->worker_count += change;
+        g_master_ctx->workers_scaled_up += change;
+    } else if (change < 0) {
+        g_master_ctx->worker_count--;
+    }
+    
+    int active_workers = 0;
+    for (worker_process_t *worker = g_master_ctx->workers; worker != NULL; worker = worker->next) {
+        if (worker->kill_time == 0 && !worker->retiring) {
+            active_workers++;
+        }
+    }
+    
+    shared_stats_t *stats = get_shared_stats();
+    while (active_workers > g_master_ctx->worker_count) {
+        // Fewest connections drains fastest, ties retire the highest ID so IDs stay compact
+        worker_process_t *victim = NULL;
+        for (worker_process_t *worker = g_master_ctx->workers; worker != NULL; worker = worker->next) {
+            if (worker->kill_time != 0 || worker->retiring) {
+                continue;
+            }
+            if (victim == NULL) {
+                victim = worker;
+                continue;
+            }
+            uint32_t conns = stats ? stats->workers[worker->worker_id].active_connections : 0;
+            uint32_t victim_conns = stats ? stats->workers[victim->worker_id].active_connections : 0;
+            if (conns < victim_conns || (conns == victim_conns && worker->worker_id > victim->worker_id)) {
+                victim = worker;
+            }
+        }
+        if (victim == NULL) {
+            break;
+        }
+        
+        // Same path as the admin drain: stop accepting, finish connections, exit
+        uint32_t seq;
+        if (post_worker_command(victim->worker_id, WORKER_CMD_DRAIN, 0, &seq) != 0 &&
+            kill(victim->pid, SIGQUIT) != 0) {
+            log_warn("Failed to retire Worker process %d: %s", victim->pid, strerror(errno));
+        }
+        victim->retiring = 1;
+        active_workers--;
+        g_master_ctx->workers_scaled_down++;
+        log_info("Retiring Worker process %d (Worker ID %d), target Worker count %d",
+                 victim->pid, victim->worker_id, g_master_ctx->worker_count);
+    }
+}
+
 /**
  * Reload configuration
  */
@@ -401,6 +956,14 @@ int reload_configuration(void) {
         return -1;
     }
     
+    if (validate_and_optimize_config(new_config) != 0) {
+        log_error("Reloaded configuration is invalid, keeping the current one");
+        free_config(new_config);
+        g_master_ctx->state = MASTER_RUNNING;
+        return -1;
+    }
+    apply_rlimit_nofile(new_config->worker_rlimit_nofile);
+    
     // Update configuration in shared memory
     if (update_shared_config(new_config) != 0) {
         log_error("Failed to update shared memory configuration");
@@ -408,6 +971,7 @@ int reload_configuration(void) {
         g_master_ctx->state = MASTER_RUNNING;
         return -1;
     }
+    pressure_monitor_init(new_config);
     
     // Send reload signal to all Worker processes
     worker_process_t *worker = g_master_ctx->workers;
@@ -424,12 +988,47 @@ int reload_configuration(void) {
     g_master_ctx->config = new_config;
     g_master_ctx->config_reload_count++;
     
+    // Workers spawned from now on inherit state built from the new configuration
+    build_warm_state();
+    
+    // A new scaling range takes effect on the next adjustment, surplus Workers drain then
+    configure_auto_scaling();
+    
     g_master_ctx->state = MASTER_RUNNING;
     
     log_info("Configuration reload completed, reload count: %d", g_master_ctx->config_reload_count);
     return 0;
 }
 
+/**
+ * Build the read-only state Workers inherit through fork: the configuration snapshot with its
+ * compiled routes, OAuth applications and resolved upstreams, and the static file preload
+ */
+static void build_warm_state(void) {
+    config_t *config = g_master_ctx->config;
+    
+    config_t *snapshot_config = duplicate_config(config);
+    if (snapshot_config == NULL || config_snapshot_publish(snapshot_config) != 0) {
+        // A stale snapshot must not reach new Workers, they build their own instead
+        log_warn("Master configuration snapshot not built, Workers will build their own");
+        config_snapshot_shutdown();
+    }
+    
+    const char *roots[MAX_ROUTES];
+    int root_count = 0;
+    for (int i = 0; i < config->route_count; i++) {
+        if (config->routes[i].type == ROUTE_STATIC && config->routes[i].local_path[0] != '\0') {
+            roots[root_count++] = config->routes[i].local_path;
+        }
+    }
+    
+    if (config->static_preload_size > 0 && root_count > 0) {
+        file_io_enhanced_build_preload(roots, root_count, (size_t)config->static_preload_size * 1024 * 1024);
+    } else {
+        file_io_enhanced_free_preload();
+    }
+}
+
 /**
  * Gracefully shutdown all Worker processes - intelligent waiting strategy
  */
@@ -563,6 +1162,88 @@ void terminate_workers_forcefully(void) {
     }
 }
 
+/**
+ * Health timer: reap and replace Workers, run the hang watchdog, flush idle logs
+ */
+static void on_health_timer(void) {
+    monitor_worker_processes();
+    logger_check_idle_flush();
+}
+
+/**
+ * Scaling timer: per-second auto scaling decision, added Workers are spawned right away
+ */
+static void on_scaling_timer(void) {
+    adjust_worker_count();
+    monitor_worker_processes();
+}
+
+/**
+ * Pressure timer: turn PSI stall averages into the flags Workers react to
+ */
+static void on_pressure_timer(void) {
+    pressure_monitor_check();
+}
+
+/**
+ * Drain the signalfd and act on each control signal
+ */
+static void handle_master_signals(void) {
+    struct signalfd_siginfo info;
+    
+    while (g_master_ctx->state == MASTER_RUNNING &&
+           read(g_signal_fd, &info, sizeof(info)) == (ssize_t)sizeof(info)) {
+        switch (info.ssi_signo) {
+            case SIGHUP:
+                log_info("Master process received SIGHUP signal, reloading configuration");
+                reload_configuration();
+                break;
+                
+            case SIGTERM:
+            case SIGINT:
+                log_info("Master process received SIGTERM/SIGINT signal, starting graceful shutdown...");
+                g_master_ctx->state = MASTER_STOPPING;
+                shutdown_workers_gracefully();
+                break;
+                
+            case SIGQUIT:
+                log_info("Master process received SIGQUIT signal, starting force terminate server...");
+                g_master_ctx->state = MASTER_STOPPING;
+                terminate_workers_forcefully();
+                break;
+                
+            case SIGCHLD:
+                // Covers the upgrade child, and Worker exits when pidfds are unavailable
+                check_upgrade_child();
+                monitor_worker_processes();
+                break;
+                
+            case SIGUSR2:
+                log_info("Master process received SIGUSR2 signal, starting binary upgrade");
+                start_binary_upgrade();
+                break;
+                
+            case SIGWINCH:
+                // The sender is checked because a terminal resize raises the same signal
+                if (g_master_ctx->new_master_pid > 0 && (pid_t)info.ssi_pid == g_master_ctx->new_master_pid) {
+                    // New Master is serving, drain our Workers and leave the socket to it
+                    g_master_ctx->state = MASTER_STOPPING;
+                    g_master_ctx->handed_off = 1;
+                    log_info("New Master %d took over, starting graceful shutdown of old Workers", 
+                             g_master_ctx->new_master_pid);
+                    shutdown_workers_gracefully();
+                } else {
+                    log_info("Ignoring SIGWINCH from process %d", (int)info.ssi_pid);
+                }
+                break;
+                
+            default:
+                log_warn("Master process received unhandled signal: %d", info.ssi_signo);
+                break;
+        }
+    }
+}
+
 /**
  * Master process main loop
  */
@@ -571,10 +1252,19 @@ int master_process_run(void) {
     setproctitle("x-server: master process");
     setproctitle("x-server: master process");
     
+    // Initialization ran before daemonize() forked
+    g_master_ctx->master_pid = getpid();
+    
     log_info("Master process starting to run, PID: %d", g_master_ctx->master_pid);
     
     g_master_ctx->state = MASTER_RUNNING;
     
+    // Workers register their pidfds as they are spawned
+    if (master_event_loop_init() != 0) {
+        master_event_loop_close();
+        return -1;
+    }
+    
     // Start initial Worker processes
     for (int i = 0; i < g_master_ctx->worker_count; i++) {
         if (spawn_worker_process(i) < 0) {
@@ -583,50 +1273,89 @@ int master_process_run(void) {
         }
     }
     
-    // Master process main loop
-    while (g_master_ctx->state != MASTER_STOPPED) {
-        // Check signal flags
-        if (g_reload_config) {
-            g_reload_config = 0;
-            reload_configuration();
+    // Binary upgrade: new Workers are accepting, let the old Master drain its own
+    if (g_master_ctx->old_master_pid > 0) {
+        if (kill(g_master_ctx->old_master_pid, SIGWINCH) != 0) {
+            log_warn("Failed to notify old Master %d: %s", g_master_ctx->old_master_pid, strerror(errno));
+        } else {
+            log_info("Workers started, asked old Master %d to shut down its Workers", g_master_ctx->old_master_pid);
         }
+        g_master_ctx->old_master_pid = 0;
+    }
+    
+    // Master process main loop, sleeps until a signal, Worker exit, timer or admin client
+    while (g_master_ctx->state == MASTER_RUNNING) {
+        struct epoll_event events[MASTER_MAX_EVENTS];
+        int n = epoll_wait(g_epoll_fd, events, MASTER_MAX_EVENTS, -1);
         
-        if (g_shutdown_server) {
-            g_shutdown_server = 0;
-            g_master_ctx->state = MASTER_STOPPING;
-            log_info("Starting graceful shutdown...");
-            shutdown_workers_gracefully();
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            log_error("Master epoll_wait failed: %s", strerror(errno));
             break;
         }
         
-        if (g_terminate_server) {
-            g_terminate_server = 0;
-            g_master_ctx->state = MASTER_STOPPING;
-            log_info("Starting force terminate server...");
-            terminate_workers_forcefully();
-            break;
+        int workers_exited = 0;
+        for (int i = 0; i < n && g_master_ctx->state == MASTER_RUNNING; i++) {
+            int fd = (int)(uint32_t)events[i].data.u64;
+            
+            switch ((uint32_t)(events[i].data.u64 >> 32)) {
+                case MASTER_EV_SIGNAL:
+                    handle_master_signals();
+                    break;
+                    
+                case MASTER_EV_TIMER:
+                    for (int t = 0; t < MASTER_TIMER_COUNT; t++) {
+                        uint64_t expirations;
+                        if (g_timers[t].fd == fd && read(fd, &expirations, sizeof(expirations)) > 0) {
+                            g_timers[t].handler();
+                        }
+                    }
+                    break;
+                    
+                case MASTER_EV_WORKER:
+                    // Exited Worker, its pidfd stays readable until reaped and closed
+                    workers_exited = 1;
+                    break;
+                    
+                case MASTER_EV_ADMIN:
+                    admin_socket_accept();
+                    break;
+                    
+                case MASTER_EV_RELAY:
+                    // Admin command waiting for Worker acknowledgements
+                    admin_socket_on_timer();
+                    break;
+                    
+                case MASTER_EV_ADMIN_CLIENT:
+                    admin_socket_client_event(fd, events[i].events);
+                    break;
+            }
         }
         
-        if (g_worker_exited) {
-            g_worker_exited = 0;
+        // Reap and respawn once per wakeup, however many Workers exited together
+        if (workers_exited && g_master_ctx->state == MASTER_RUNNING) {
             monitor_worker_processes();
         }
-        
-        // Periodically monitor Worker process status
-        monitor_worker_processes();
-        
-        // Check and flush idle log buffers
-        logger_check_idle_flush();
-        
-        // Sleep 1 second
-        sleep(1);
     }
     
+    master_event_loop_close();
     g_master_ctx->state = MASTER_STOPPED;
     
-    // Clean up resources
+    // Clean up resources, after an upgrade the admin socket path belongs to the new Master
+    if (g_master_ctx->handed_off || g_master_ctx->new_master_pid > 0) {
+        admin_socket_close_inherited();
+    } else {
+        admin_socket_close();
+    }
     close(g_master_ctx->listen_fd);
+    connection_handoff_cleanup();
+    pressure_monitor_cleanup();
     cleanup_shared_memory();
+    cleanup_performance_monitor();
+    config_snapshot_shutdown();
+    file_io_enhanced_free_preload();
     free_config(g_master_ctx->config);
     free(g_master_ctx->config_file);
     
@@ -634,6 +1363,9 @@ int master_process_run(void) {
     worker_process_t *worker = g_master_ctx->workers;
     while (worker != NULL) {
         worker_process_t *next = worker->next;
+        if (worker->pidfd >= 0) {
+            close(worker->pidfd);
+        }
         free(worker);
         worker = next;
     }
@@ -648,6 +1380,83 @@ int master_process_run(void) {
     return 0;
 }
 
+/**
+ * Start a binary upgrade: exec the binary again with the listening socket inherited
+ */
+int start_binary_upgrade(void) {
+    char **argv = get_saved_argv();
+    
+    if (g_master_ctx->new_master_pid > 0) {
+        log_warn("Binary upgrade already in progress, new Master PID: %d", g_master_ctx->new_master_pid);
+        return -1;
+    }
+    if (g_master_ctx->old_master_pid > 0) {
+        log_warn("Old Master %d has not handed over yet, upgrade refused", g_master_ctx->old_master_pid);
+        return -1;
+    }
+    if (argv == NULL || argv[0] == NULL) {
+        log_error("Command line was not saved at startup, binary upgrade unavailable");
+        return -1;
+    }
+    
+    // The new Master creates logs/x-server.PORT.pid while this process still runs
+    if (rename_pid_file_oldbin() != 0) {
+        return -1;
+    }
+    
+    pid_t pid = fork();
+    if (pid < 0) {
+        log_error("Failed to fork new Master process: %s", strerror(errno));
+        restore_pid_file_oldbin();
+        return -1;
+    }
+    
+    if (pid == 0) {
+        char value[32];
+        
+        int flags = fcntl(g_master_ctx->listen_fd, F_GETFD);
+        if (flags >= 0) {
+            fcntl(g_master_ctx->listen_fd, F_SETFD, flags & ~FD_CLOEXEC);
+        }
+        snprintf(value, sizeof(value), "%d", g_master_ctx->listen_fd);
+        setenv(LISTEN_FDS_ENV, value, 1);
+        snprintf(value, sizeof(value), "%d", (int)g_master_ctx->master_pid);
+        setenv(OLD_MASTER_ENV, value, 1);
+        
+        // The new Master blocks its signals again in its own setup
+        sigprocmask(SIG_SETMASK, &g_saved_sigmask, NULL);
+        
+        execvp(argv[0], argv);
+        
+        log_error("Failed to execute new binary %s: %s", argv[0], strerror(errno));
+        close_logger();
+        _exit(1);
+    }
+    
+    g_master_ctx->new_master_pid = pid;
+    log_info("Binary upgrade started, new Master PID: %d, waiting for its Workers", pid);
+    return 0;
+}
+
+/**
+ * Roll back when the new Master of an upgrade exits before taking over
+ */
+static void check_upgrade_child(void) {
+    int status;
+    
+    if (g_master_ctx->new_master_pid <= 0) {
+        return;
+    }
+    if (waitpid(g_master_ctx->new_master_pid, &status, WNOHANG) != g_master_ctx->new_master_pid) {
+        return;
+    }
+    
+    log_error("New Master %d exited before taking over (status: %d), keeping current binary", 
+              g_master_ctx->new_master_pid, status);
+    g_master_ctx->new_master_pid = 0;
+    restore_pid_file_oldbin();
+}
+
 /**
  * Get Master process statistics
  */
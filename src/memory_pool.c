@@ -8,17 +8,19 @@
 #include <pthread.h>
 #include <stdatomic.h>
 #include "../include/memory_pool.h"
+#include "../include/lock_profiler.h"
 #include "../include/logger.h"
 
 #define MIN_BLOCK_SIZE 64  // Minimum memory block size
 #define DEFAULT_ALIGNMENT 8  // Default memory alignment size
 #define SEGMENT_COUNT 16  // Number of segments
 #define MAX_SEGMENT_SIZE (1024 * 1024)  // Maximum size per segment
+#define BLOCK_HEADER_SIZE 16  // Back pointer to the owning block, keeps malloc alignment of the data area
 
 // Memory segment structure
 typedef struct memory_segment {
     memory_block_t *blocks;
-    pthread_mutex_t mutex;
+    profiled_mutex_t mutex;
     atomic_size_t total_size;
     atomic_size_t used_size;
     atomic_int ref_count;
@@ -37,7 +39,7 @@ typedef struct memory_pool_stats {
 // High performance memory pool structure
 struct memory_pool {
     memory_segment_t segments[SEGMENT_COUNT];
-    pthread_mutex_t global_mutex;
+    profiled_mutex_t global_mutex;
     atomic_size_t total_size;
     atomic_size_t used_size;
     atomic_int segment_count;
@@ -55,13 +57,15 @@ static memory_block_t *allocate_block(size_t size) {
         return NULL;
     }
     
-    // Allocate actual data memory
-    block->data = malloc(size);
-    if (block->data == NULL) {
+    // Allocate actual data memory, prefixed with a pointer back to the block for pool_free
+    char *raw = malloc(BLOCK_HEADER_SIZE + size);
+    if (raw == NULL) {
         log_error("Unable to allocate memory block data area");
         free(block);
         return NULL;
     }
+    *(memory_block_t **)raw = block;
+    block->data = raw + BLOCK_HEADER_SIZE;
     
     block->size = size;
     block->in_use = 0;
@@ -70,6 +74,12 @@ static memory_block_t *allocate_block(size_t size) {
     return block;
 }
 
+// Free a block and its data area
+static void free_block(memory_block_t *block) {
+    free((char *)block->data - BLOCK_HEADER_SIZE);
+    free(block);
+}
+
 // Calculate segment ID
 static size_t get_segment_id(size_t size) {
     if (size <= 256) return 0;
@@ -107,7 +117,7 @@ memory_pool_t *create_memory_pool(size_t initial_size) {
     pool->initial_size = initial_size;
     
     // Initialize global mutex
-    if (pthread_mutex_init(&pool->global_mutex, NULL) != 0) {
+    if (profiled_mutex_init(&pool->global_mutex, "memory_pool.global") != 0) {
         log_error("Unable to initialize memory pool global mutex");
         free(pool);
         return NULL;
@@ -117,13 +127,13 @@ memory_pool_t *create_memory_pool(size_t initial_size) {
     for (int i = 0; i < SEGMENT_COUNT; i++) {
         memory_segment_t *segment = &pool->segments[i];
         
-        if (pthread_mutex_init(&segment->mutex, NULL) != 0) {
+        if (profiled_mutex_init(&segment->mutex, "memory_pool.segment") != 0) {
             log_error("Unable to initialize memory pool segment mutex %d", i);
             // Clean up already initialized segments
             for (int j = 0; j < i; j++) {
-                pthread_mutex_destroy(&pool->segments[j].mutex);
+                profiled_mutex_destroy(&pool->segments[j].mutex);
             }
-            pthread_mutex_destroy(&pool->global_mutex);
+            profiled_mutex_destroy(&pool->global_mutex);
             free(pool);
             return NULL;
         }
@@ -139,7 +149,7 @@ memory_pool_t *create_memory_pool(size_t initial_size) {
     size_t segment_id = get_segment_id(initial_size);
     memory_segment_t *segment = &pool->segments[segment_id];
     
-    pthread_mutex_lock(&segment->mutex);
+    profiled_mutex_lock(&segment->mutex);
     memory_block_t *initial_block = allocate_block(initial_size);
     if (initial_block != NULL) {
         segment->blocks = initial_block;
@@ -147,15 +157,15 @@ memory_pool_t *create_memory_pool(size_t initial_size) {
         atomic_fetch_add(&pool->total_size, initial_size);
         atomic_fetch_add(&pool->segment_count, 1);
     }
-    pthread_mutex_unlock(&segment->mutex);
+    profiled_mutex_unlock(&segment->mutex);
     
     if (initial_block == NULL) {
         log_error("Unable to allocate initial memory block");
         // Clean up resources
         for (int i = 0; i < SEGMENT_COUNT; i++) {
-            pthread_mutex_destroy(&pool->segments[i].mutex);
+            profiled_mutex_destroy(&pool->segments[i].mutex);
         }
-        pthread_mutex_destroy(&pool->global_mutex);
+        profiled_mutex_destroy(&pool->global_mutex);
         free(pool);
         return NULL;
     }
@@ -184,7 +194,7 @@ void *pool_malloc(memory_pool_t *pool, size_t size) {
     
     memory_segment_t *segment = &pool->segments[segment_id];
     
-    pthread_mutex_lock(&segment->mutex);
+    profiled_mutex_lock(&segment->mutex);
     
     // Find available memory block
     memory_block_t *block = segment->blocks;
@@ -215,7 +225,7 @@ void *pool_malloc(memory_pool_t *pool, size_t size) {
         best_fit->in_use = 1;
         atomic_fetch_add(&segment->used_size, best_fit->size);
         atomic_fetch_add(&pool->used_size, best_fit->size);
-        pthread_mutex_unlock(&segment->mutex);
+        profiled_mutex_unlock(&segment->mutex);
         
         // Zero out memory block
         memset(best_fit->data, 0, best_fit->size);
@@ -227,7 +237,7 @@ void *pool_malloc(memory_pool_t *pool, size_t size) {
     memory_block_t *new_block = allocate_block(new_block_size);
     
     if (new_block == NULL) {
-        pthread_mutex_unlock(&segment->mutex);
+        profiled_mutex_unlock(&segment->mutex);
         return NULL;
     }
     
@@ -245,7 +255,7 @@ void *pool_malloc(memory_pool_t *pool, size_t size) {
     atomic_fetch_add(&segment->used_size, new_block_size);
     atomic_fetch_add(&pool->used_size, new_block_size);
     
-    pthread_mutex_unlock(&segment->mutex);
+    profiled_mutex_unlock(&segment->mutex);
     
     // Zero out memory block
     memset(new_block->data, 0, new_block_size);
@@ -258,9 +268,9 @@ void pool_free(memory_pool_t *pool, void *ptr) {
         return;
     }
     
-    // Get memory block containing the pointer
-    memory_block_t *block = (memory_block_t *)ptr;
-    if (block == NULL) {
+    // Get memory block containing the pointer from the header in front of the data area
+    memory_block_t *block = *(memory_block_t **)((char *)ptr - BLOCK_HEADER_SIZE);
+    if (block == NULL || block->data != ptr) {
         log_warn("Attempting to free null pointer or invalid pointer: %p", ptr);
         return;
     }
@@ -276,29 +286,15 @@ void pool_free(memory_pool_t *pool, void *ptr) {
 
     memory_segment_t *segment = &pool->segments[segment_id];
     
-    pthread_mutex_lock(&segment->mutex);
+    profiled_mutex_lock(&segment->mutex);
     
-    // Find corresponding memory block
-    memory_block_t *current = segment->blocks;
-    
-    while (current != NULL) {
-        if (current->data == ptr) {
-            // Found corresponding block
-            if (current->in_use) {
-                current->in_use = 0;
-                atomic_fetch_sub(&segment->used_size, current->size);
-                atomic_fetch_sub(&pool->used_size, current->size);
-            }
-            pthread_mutex_unlock(&segment->mutex);
-            return;
-        }
-        current = current->next;
+    if (block->in_use) {
+        block->in_use = 0;
+        atomic_fetch_sub(&segment->used_size, block->size);
+        atomic_fetch_sub(&pool->used_size, block->size);
     }
     
-    // No corresponding block found, may be illegal pointer
-    //log_warn("Attempting to free memory not allocated by memory pool: %p", ptr);
-    
-    pthread_mutex_unlock(&segment->mutex);
+    profiled_mutex_unlock(&segment->mutex);
 }
 
 // Destroy memory pool
@@ -307,13 +303,20 @@ void destroy_memory_pool(memory_pool_t *pool) {
         return;
     }
     
-    // Destroy all segment mutexes
+    // Free all blocks and destroy segment mutexes
     for (int i = 0; i < SEGMENT_COUNT; i++) {
-        pthread_mutex_destroy(&pool->segments[i].mutex);
+        memory_block_t *block = pool->segments[i].blocks;
+        while (block != NULL) {
+            memory_block_t *next = block->next;
+            free_block(block);
+            block = next;
+        }
+        pool->segments[i].blocks = NULL;
+        profiled_mutex_destroy(&pool->segments[i].mutex);
     }
     
     // Destroy global mutex
-    pthread_mutex_destroy(&pool->global_mutex);
+    profiled_mutex_destroy(&pool->global_mutex);
     
     // Free memory pool structure
     free(pool);
@@ -344,7 +347,7 @@ int compress_memory_pool(memory_pool_t *pool) {
     }
     
     // Get global mutex
-    pthread_mutex_lock(&pool->global_mutex);
+    profiled_mutex_lock(&pool->global_mutex);
     
     // Traverse all segments
     int freed_blocks = 0;
@@ -353,7 +356,7 @@ int compress_memory_pool(memory_pool_t *pool) {
     for (int i = 0; i < SEGMENT_COUNT; i++) {
         memory_segment_t *segment = &pool->segments[i];
         
-        pthread_mutex_lock(&segment->mutex);
+        profiled_mutex_lock(&segment->mutex);
         
         memory_block_t *block = segment->blocks;
         memory_block_t *prev = NULL;
@@ -414,8 +417,7 @@ int compress_memory_pool(memory_pool_t *pool) {
                     atomic_fetch_sub(&segment->total_size, block->size);
                     atomic_fetch_sub(&pool->total_size, block->size);
                     
-                    free(block->data);
-                    free(block);
+                    free_block(block);
                     freed_blocks++;
                 } else {
                     prev = block;
@@ -427,10 +429,10 @@ int compress_memory_pool(memory_pool_t *pool) {
             block = next;
         }
         
-        pthread_mutex_unlock(&segment->mutex);
+        profiled_mutex_unlock(&segment->mutex);
     }
     
-    pthread_mutex_unlock(&pool->global_mutex);
+    profiled_mutex_unlock(&pool->global_mutex);
     
     if (freed_blocks > 0) {
         log_info("Memory pool compression completed, freed %d blocks, total %zu bytes, current usage ratio: %.2f%%", 
@@ -14,27 +14,33 @@
 #include "../include/http.h"
 #include "../include/config.h"
 #include "../include/logger.h"
+#include "../include/config_snapshot.h"
+#include "../include/lock_profiler.h"
+
+// Allocations in this file are accounted to the auth subsystem
+#define ALLOC_TAG ALLOC_TAG_AUTH
+#include "../include/alloc_stats.h"
 
 // Store the last OAuth validation failure error message
 static char oauth_error_message[256] = "";
-static pthread_mutex_t oauth_error_mutex = PTHREAD_MUTEX_INITIALIZER;
+static profiled_mutex_t oauth_error_mutex = PROFILED_MUTEX_INITIALIZER("oauth.error");
 
 // Set OAuth error message
 static void set_oauth_error(const char *format, ...) {
-    pthread_mutex_lock(&oauth_error_mutex);
+    profiled_mutex_lock(&oauth_error_mutex);
     va_list args;
     va_start(args, format);
     vsnprintf(oauth_error_message, sizeof(oauth_error_message), format, args);
     va_end(args);
-    pthread_mutex_unlock(&oauth_error_mutex);
+    profiled_mutex_unlock(&oauth_error_mutex);
 }
 
 // Get the last OAuth validation failure error message
 const char *get_oauth_error_message() {
     char *error_message;
-    pthread_mutex_lock(&oauth_error_mutex);
+    profiled_mutex_lock(&oauth_error_mutex);
     error_message = strdup(oauth_error_message);
-    pthread_mutex_unlock(&oauth_error_mutex);
+    profiled_mutex_unlock(&oauth_error_mutex);
     return error_message;
 }
 
@@ -464,53 +470,8 @@ void free_api_auth_config(api_auth_config_t **configs, int count) {
     free(configs);
 }
 
-    // Global variables, store API authentication configuration
-static api_auth_config_t **g_configs = NULL;
-static int g_config_count = 0;
-static pthread_mutex_t g_config_mutex = PTHREAD_MUTEX_INITIALIZER;
-static time_t g_last_load_time = 0;
-
-// Initialize OAuth configuration, called when server starts - fix thread safety issues
-int init_oauth_config() {
-    pthread_mutex_lock(&g_config_mutex);
-    
-    // Load new configuration to temporary variables
-    int temp_config_count = 0;
-    api_auth_config_t **temp_configs = load_api_auth_config("config/api_auth.conf", &temp_config_count);
-    
-    if (temp_configs != NULL) {
-        // Save reference to old configuration
-        api_auth_config_t **old_configs = g_configs;
-        int old_config_count = g_config_count;
-        
-        // Atomically update global configuration
-        g_configs = temp_configs;
-        g_config_count = temp_config_count;
-        g_last_load_time = time(NULL);
-        
-        // Free old configuration (after update, ensuring thread safety)
-        if (old_configs != NULL) {
-            free_api_auth_config(old_configs, old_config_count);
-        }
-        
-        log_info("Successfully loaded OAuth configuration, total %d applications", g_config_count);
-        pthread_mutex_unlock(&g_config_mutex);
-        return 0;
-    } else {
-        log_error("Failed to load OAuth configuration");
-        pthread_mutex_unlock(&g_config_mutex);
-        return -1;
-    }
-}
-
-// Reload OAuth configuration, can be triggered by -s reload parameter
-int reload_oauth_config() {
-    log_info("Reloading OAuth configuration...");
-    return init_oauth_config();
-}
-
 // Validate OAuth request
-int validate_oauth(http_request_t *request, route_t *route) {
+int validate_oauth(http_request_t *request, route_t *route, const config_snapshot_t *snapshot) {
     (void)route; // avoid unused parameter warning
     // Clear error message
     set_oauth_error("");
@@ -547,70 +508,18 @@ int validate_oauth(http_request_t *request, route_t *route) {
         return 0;
     }
     
-    // Use globally cached configuration - fix thread safety issues
-    pthread_mutex_lock(&g_config_mutex);
-    
-    // If configuration not loaded, try to load
-    if (g_configs == NULL) {
-        int temp_config_count = 0;
-        api_auth_config_t **temp_configs = load_api_auth_config("config/api_auth.conf", &temp_config_count);
-        
-        if (temp_configs != NULL) {
-            g_configs = temp_configs;
-            g_config_count = temp_config_count;
-            g_last_load_time = time(NULL);
-        } else {
-            pthread_mutex_unlock(&g_config_mutex);
-            set_oauth_error("Failed to load API authentication configuration");
-            log_error("Failed to load API authentication configuration");
-            return 0;
-        }
-    }
-    
-    // Create local copy of configuration to avoid holding lock for long time
-    api_auth_config_t *local_config = NULL;
-    for (int i = 0; i < g_config_count; i++) {
-        if (strcmp(g_configs[i]->app_key, auth_app_key) == 0) {
-            // Create copy of configuration
-            local_config = malloc(sizeof(api_auth_config_t));
-            if (local_config != NULL) {
-                local_config->app_key = strdup(g_configs[i]->app_key);
-                local_config->app_secret = strdup(g_configs[i]->app_secret);
-                local_config->rate_limit = g_configs[i]->rate_limit;
-                local_config->url_count = g_configs[i]->url_count;
-                
-                // Copy URL list
-                local_config->allowed_urls = malloc(sizeof(char*) * local_config->url_count);
-                if (local_config->allowed_urls != NULL) {
-                    for (int j = 0; j < local_config->url_count; j++) {
-                        local_config->allowed_urls[j] = strdup(g_configs[i]->allowed_urls[j]);
-                    }
-                }
-            }
-            break;
-        }
+    // The application table belongs to the configuration snapshot of this request
+    if (snapshot == NULL || snapshot->auth_apps == NULL) {
+        set_oauth_error("Failed to load API authentication configuration");
+        log_error("Failed to load API authentication configuration");
+        return 0;
     }
     
-    pthread_mutex_unlock(&g_config_mutex);
-    
-    // Use local configuration copy for validation
-    api_auth_config_t *config = local_config;
+    api_auth_config_t *config = find_api_auth_config(snapshot->auth_apps, snapshot->auth_app_count, auth_app_key);
     
     if (config == NULL) {
         set_oauth_error("Application key (app_key) does not exist: %s", auth_app_key);
         log_warn("OAuth validation failed: app_key does not exist: %s", auth_app_key);
-        // Clean up local configuration copy
-        if (local_config != NULL) {
-            if (local_config->app_key) free(local_config->app_key);
-            if (local_config->app_secret) free(local_config->app_secret);
-            if (local_config->allowed_urls) {
-                for (int i = 0; i < local_config->url_count; i++) {
-                    if (local_config->allowed_urls[i]) free(local_config->allowed_urls[i]);
-                }
-                free(local_config->allowed_urls);
-            }
-            free(local_config);
-        }
         return 0;
     }
     
@@ -620,18 +529,6 @@ int validate_oauth(http_request_t *request, route_t *route) {
     if (current_time - auth_time_value > 300) {  // 5 minutes = 300 seconds
         set_oauth_error("Authentication timestamp has expired");
         log_warn("OAuth validation failed: timestamp expired");
-        // Clean up local configuration copy
-        if (local_config != NULL) {
-            if (local_config->app_key) free(local_config->app_key);
-            if (local_config->app_secret) free(local_config->app_secret);
-            if (local_config->allowed_urls) {
-                for (int i = 0; i < local_config->url_count; i++) {
-                    if (local_config->allowed_urls[i]) free(local_config->allowed_urls[i]);
-                }
-                free(local_config->allowed_urls);
-            }
-            free(local_config);
-        }
         return 0;
     }
     
@@ -662,18 +559,6 @@ int validate_oauth(http_request_t *request, route_t *route) {
     if (!token_match) {
         set_oauth_error("Authentication token does not match");
         log_warn("OAuth validation failed: token does not match");
-        // Clean up local configuration copy
-        if (local_config != NULL) {
-            if (local_config->app_key) free(local_config->app_key);
-            if (local_config->app_secret) free(local_config->app_secret);
-            if (local_config->allowed_urls) {
-                for (int i = 0; i < local_config->url_count; i++) {
-                    if (local_config->allowed_urls[i]) free(local_config->allowed_urls[i]);
-                }
-                free(local_config->allowed_urls);
-            }
-            free(local_config);
-        }
         return 0;
     }
     
@@ -681,18 +566,6 @@ int validate_oauth(http_request_t *request, route_t *route) {
     if (!is_url_allowed(config, request->path)) {
         set_oauth_error("Requested URL is not in allowed access list: %s", request->path);
         log_warn("OAuth validation failed: URL not in allowed list: %s", request->path);
-        // Clean up local configuration copy
-        if (local_config != NULL) {
-            if (local_config->app_key) free(local_config->app_key);
-            if (local_config->app_secret) free(local_config->app_secret);
-            if (local_config->allowed_urls) {
-                for (int i = 0; i < local_config->url_count; i++) {
-                    if (local_config->allowed_urls[i]) free(local_config->allowed_urls[i]);
-                }
-                free(local_config->allowed_urls);
-            }
-            free(local_config);
-        }
         return 0;
     }
     
@@ -701,19 +574,6 @@ int validate_oauth(http_request_t *request, route_t *route) {
     // Validation passed
     log_info("OAuth validation successful: %s", auth_app_key);
     
-    // Clean up local configuration copy
-    if (local_config != NULL) {
-        if (local_config->app_key) free(local_config->app_key);
-        if (local_config->app_secret) free(local_config->app_secret);
-        if (local_config->allowed_urls) {
-            for (int i = 0; i < local_config->url_count; i++) {
-                if (local_config->allowed_urls[i]) free(local_config->allowed_urls[i]);
-            }
-            free(local_config->allowed_urls);
-        }
-        free(local_config);
-    }
-    
     return 1;
 }
 
@@ -0,0 +1,219 @@
+/**
+ * Hardware Performance Counter Module Implementation
+ * Per-worker perf_event_open counters, degrades gracefully when the kernel denies access
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "../include/perf_counters.h"
+#include "../include/logger.h"
+
+static const char *g_counter_names[PERF_COUNTER_MAX] = {
+    "cycles",
+    "instructions",
+    "cache-misses",
+    "branch-misses",
+    "context-switches"
+};
+
+// Get monotonic time in nanoseconds
+static uint64_t perf_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+const char *perf_counter_name(perf_counter_type_t type) {
+    if ((int)type < 0 || type >= PERF_COUNTER_MAX) {
+        return "unknown";
+    }
+    return g_counter_names[type];
+}
+
+#if defined(__linux__)
+
+// perf_event_open has no glibc wrapper
+static int sys_perf_event_open(struct perf_event_attr *attr, pid_t pid, int cpu, int group_fd, unsigned long flags) {
+    return (int)syscall(__NR_perf_event_open, attr, pid, cpu, group_fd, flags);
+}
+
+// Open one counter for this process and its future threads
+static int open_counter(perf_counter_type_t type) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.disabled = 0;
+    attr.inherit = 1;           // Count the event loop and helper threads created later
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (type) {
+        case PERF_COUNTER_CYCLES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PERF_COUNTER_INSTRUCTIONS:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PERF_COUNTER_CACHE_MISSES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+        case PERF_COUNTER_BRANCH_MISSES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        case PERF_COUNTER_CONTEXT_SWITCHES:
+            attr.type = PERF_TYPE_SOFTWARE;
+            attr.config = PERF_COUNT_SW_CONTEXT_SWITCHES;
+            break;
+        default:
+            return -1;
+    }
+
+    int fd = sys_perf_event_open(&attr, 0, -1, -1, 0);
+    if (fd < 0 && (errno == EACCES || errno == EPERM)) {
+        // perf_event_paranoid >= 2 forbids kernel-side counting, retry user-space only
+        attr.exclude_kernel = 1;
+        fd = sys_perf_event_open(&attr, 0, -1, -1, 0);
+    }
+    return fd;
+}
+
+// Read a counter, scaled for multiplexing
+static int read_counter(int fd, uint64_t *value) {
+    uint64_t data[3];   // value, time_enabled, time_running
+
+    if (read(fd, data, sizeof(data)) != (ssize_t)sizeof(data)) {
+        return -1;
+    }
+
+    if (data[2] == 0) {
+        *value = 0;
+    } else if (data[2] < data[1]) {
+        *value = (uint64_t)((double)data[0] * (double)data[1] / (double)data[2]);
+    } else {
+        *value = data[0];
+    }
+    return 0;
+}
+
+#endif /* __linux__ */
+
+/**
+ * Open performance counters
+ */
+int perf_counters_open(perf_counters_t *pc) {
+    if (pc == NULL) {
+        return 0;
+    }
+
+    memset(pc, 0, sizeof(*pc));
+    for (int i = 0; i < PERF_COUNTER_MAX; i++) {
+        pc->fds[i] = -1;
+    }
+
+#if defined(__linux__)
+    int first_errno = 0;
+
+    for (int i = 0; i < PERF_COUNTER_MAX; i++) {
+        pc->fds[i] = open_counter((perf_counter_type_t)i);
+        if (pc->fds[i] >= 0) {
+            pc->open_count++;
+            read_counter(pc->fds[i], &pc->last_values[i]);
+        } else if (first_errno == 0) {
+            first_errno = errno;
+        }
+    }
+
+    if (pc->open_count == 0) {
+        log_warn("Performance counters unavailable (%s), check /proc/sys/kernel/perf_event_paranoid",
+                 strerror(first_errno));
+    } else if (pc->open_count < PERF_COUNTER_MAX) {
+        log_info("Performance counters partially available: %d/%d opened", pc->open_count, PERF_COUNTER_MAX);
+    } else {
+        log_info("Performance counters opened: cycles, instructions, cache-misses, branch-misses, context-switches");
+    }
+#else
+    log_warn("Performance counters are only supported on Linux");
+#endif
+
+    pc->last_sample_ns = perf_now_ns();
+    return pc->open_count;
+}
+
+/**
+ * Sample counters and derive per-interval metrics
+ */
+int perf_counters_sample(perf_counters_t *pc, uint64_t total_requests, perf_counters_sample_t *sample) {
+    if (pc == NULL || pc->open_count == 0) {
+        return -1;
+    }
+
+    perf_counters_sample_t s;
+    memset(&s, 0, sizeof(s));
+
+    uint64_t now = perf_now_ns();
+    s.interval_sec = (double)(now - pc->last_sample_ns) / 1e9;
+    s.requests = total_requests - pc->last_requests;
+    pc->last_sample_ns = now;
+    pc->last_requests = total_requests;
+
+#if defined(__linux__)
+    for (int i = 0; i < PERF_COUNTER_MAX; i++) {
+        uint64_t value;
+        if (pc->fds[i] < 0 || read_counter(pc->fds[i], &value) != 0) {
+            continue;
+        }
+        s.delta[i] = value >= pc->last_values[i] ? value - pc->last_values[i] : 0;
+        pc->last_values[i] = value;
+        s.valid_mask |= 1U << i;
+    }
+#endif
+
+    unsigned int cycles_and_instructions = (1U << PERF_COUNTER_CYCLES) | (1U << PERF_COUNTER_INSTRUCTIONS);
+    if ((s.valid_mask & cycles_and_instructions) == cycles_and_instructions && s.delta[PERF_COUNTER_CYCLES] > 0) {
+        s.ipc = (double)s.delta[PERF_COUNTER_INSTRUCTIONS] / (double)s.delta[PERF_COUNTER_CYCLES];
+    }
+    if (s.requests > 0) {
+        s.cache_misses_per_request = (double)s.delta[PERF_COUNTER_CACHE_MISSES] / (double)s.requests;
+        s.branch_misses_per_request = (double)s.delta[PERF_COUNTER_BRANCH_MISSES] / (double)s.requests;
+    }
+    if (s.interval_sec > 0) {
+        s.context_switches_per_sec = (double)s.delta[PERF_COUNTER_CONTEXT_SWITCHES] / s.interval_sec;
+    }
+
+    pc->last_sample = s;
+    if (sample) {
+        *sample = s;
+    }
+    return 0;
+}
+
+/**
+ * Close performance counters
+ */
+void perf_counters_close(perf_counters_t *pc) {
+    if (pc == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < PERF_COUNTER_MAX; i++) {
+        if (pc->fds[i] >= 0) {
+            close(pc->fds[i]);
+            pc->fds[i] = -1;
+        }
+    }
+    pc->open_count = 0;
+}
@@ -0,0 +1,151 @@
+/**
+ * Performance Monitor Implementation
+ * Load-driven Worker scaling decisions for the Master, from per-Worker shared statistics
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/performance_monitor.h"
+#include "../include/master_process.h"
+#include "../include/shared_memory.h"
+#include "../include/logger.h"
+
+// Statistics older than this are treated as missing, the Worker publishes every second
+#define STATS_STALE_SEC 3
+
+static performance_config_t g_config;
+static int g_initialized = 0;
+
+// Consecutive seconds the scale-up / scale-down condition held
+static int g_up_streak = 0;
+static int g_down_streak = 0;
+static time_t g_last_change = 0;
+
+/**
+ * Initialize performance monitoring
+ */
+int init_performance_monitor(const performance_config_t *config) {
+    if (config == NULL || config->min_workers < 1 || config->max_workers < config->min_workers ||
+        config->scale_down_utilization >= config->scale_up_utilization) {
+        log_error("Invalid auto scaling configuration");
+        return -1;
+    }
+
+    g_config = *config;
+    g_up_streak = 0;
+    g_down_streak = 0;
+    if (!g_initialized) {
+        // Hold off after startup until Workers have seen real traffic
+        g_last_change = time(NULL);
+    }
+    g_initialized = 1;
+
+    if (g_config.enable_auto_scaling) {
+        log_info("Worker auto scaling enabled: %d-%d Workers, scale up at %.0f%% loop utilization or %dms lag, "
+                 "scale down at %.0f%%",
+                 g_config.min_workers, g_config.max_workers, g_config.scale_up_utilization * 100,
+                 g_config.scale_up_lag_ms, g_config.scale_down_utilization * 100);
+    }
+    return 0;
+}
+
+/**
+ * Check whether the Worker count should change
+ */
+int check_auto_scaling_needs(void) {
+    master_context_t *ctx = get_master_context();
+    shared_stats_t *stats = get_shared_stats();
+
+    if (!g_initialized || !g_config.enable_auto_scaling || ctx == NULL || stats == NULL ||
+        ctx->state != MASTER_RUNNING) {
+        return 0;
+    }
+
+    time_t now = time(NULL);
+    int workers = 0;
+    int warming = 0;
+    double utilization_sum = 0.0;
+    double lag_ms_sum = 0.0;
+
+    // Read without the seqlock, a stale or torn sample only shifts one second of input
+    for (worker_process_t *w = ctx->workers; w != NULL; w = w->next) {
+        if (w->kill_time != 0 || w->retiring) {
+            continue;
+        }
+        time_t last_update = stats->workers[w->worker_id].last_update;
+        if (last_update <= w->start_time || now - last_update > STATS_STALE_SEC) {
+            // Not yet serving a full second, its idle loop would read as spare capacity
+            warming++;
+            continue;
+        }
+        workers++;
+        utilization_sum += stats->workers[w->worker_id].loop_utilization;
+        lag_ms_sum += (double)stats->workers[w->worker_id].loop_lag_us / 1e3;
+    }
+
+    if (warming > 0 || workers == 0) {
+        g_up_streak = 0;
+        g_down_streak = 0;
+        return 0;
+    }
+
+    double utilization = utilization_sum / workers;
+    double lag_ms = lag_ms_sum / workers;
+
+    // The scale-down test also requires the survivors to stay clear of the scale-up threshold,
+    // otherwise removing a Worker would immediately trigger adding one back
+    int want_up = (utilization >= g_config.scale_up_utilization || lag_ms >= g_config.scale_up_lag_ms) &&
+                  workers < g_config.max_workers;
+    int want_down = utilization <= g_config.scale_down_utilization &&
+                    lag_ms < g_config.scale_up_lag_ms / 2.0 &&
+                    workers > g_config.min_workers &&
+                    utilization_sum / (workers - 1) < g_config.scale_up_utilization * 0.8;
+
+    g_up_streak = want_up ? g_up_streak + 1 : 0;
+    g_down_streak = want_down ? g_down_streak + 1 : 0;
+
+    if (g_up_streak >= g_config.scale_up_sustain && now - g_last_change >= g_config.scale_up_cooldown) {
+        // Size for the midpoint between the thresholds, at most doubling per step
+        double target_utilization = (g_config.scale_up_utilization + g_config.scale_down_utilization) / 2.0;
+        int target = (int)(utilization_sum / target_utilization + 0.999);
+        int add = target - workers;
+        if (add < 1) {
+            add = 1;
+        }
+        if (add > workers) {
+            add = workers;
+        }
+        if (workers + add > g_config.max_workers) {
+            add = g_config.max_workers - workers;
+        }
+
+        log_info("Auto scaling up by %d: %d Workers at %.0f%% loop utilization, %.1fms loop lag",
+                 add, workers, utilization * 100, lag_ms);
+        g_up_streak = 0;
+        g_down_streak = 0;
+        g_last_change = now;
+        return add;
+    }
+
+    if (g_down_streak >= g_config.scale_down_sustain && now - g_last_change >= g_config.scale_down_cooldown) {
+        log_info("Auto scaling down by 1: %d Workers at %.0f%% loop utilization, %.1fms loop lag",
+                 workers, utilization * 100, lag_ms);
+        g_up_streak = 0;
+        g_down_streak = 0;
+        g_last_change = now;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Clean up performance monitoring
+ */
+void cleanup_performance_monitor(void) {
+    g_config.enable_auto_scaling = 0;
+    g_initialized = 0;
+}
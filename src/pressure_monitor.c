@@ -0,0 +1,399 @@
+/**
+ * Pressure Monitor Implementation
+ * The Master turns PSI stall averages into shared pressure flags, Workers shrink caches,
+ * pause diagnostics, quiet debug logging and shed low-priority routes while they are raised
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <malloc.h>
+#include <stdatomic.h>
+
+#include "../include/pressure_monitor.h"
+#include "../include/resource_limits.h"
+#include "../include/shared_memory.h"
+#include "../include/connection.h"
+#include "../include/worker_process.h"
+#include "../include/file_io_enhanced.h"
+#include "../include/lock_profiler.h"
+#include "../include/alloc_stats.h"
+#include "../include/route_stats.h"
+#include "../include/logger.h"
+
+// A raised flag clears once its average falls below this share of the threshold
+#define PRESSURE_CLEAR_RATIO 0.75
+
+// File cache share kept under memory pressure
+#define PRESSURE_CACHE_DIVISOR 4
+
+enum { PSI_MEMORY, PSI_CPU, PSI_IO, PSI_RESOURCES };
+
+static const char *const g_psi_names[PSI_RESOURCES] = { "memory", "cpu", "io" };
+
+// Flag bit order, matches shared_pressure_t.raised
+static const char *const g_flag_names[PRESSURE_KINDS] = { "memory", "cpu", "io", "critical" };
+
+// Master side
+static int g_psi_fds[PSI_RESOURCES] = { -1, -1, -1 };
+static int g_enabled = 0;
+static int g_memory_threshold = 0;
+static int g_cpu_threshold = 0;
+static int g_io_threshold = 0;
+static int g_critical_threshold = 0;
+static shared_pressure_t g_state;
+static time_t g_raised_at[PRESSURE_KINDS];
+
+// Worker side
+static int g_worker_id = -1;
+static size_t g_cache_limit = 0;
+static uint32_t g_applied = 0;
+static int g_saved_log_level = -1;
+static int g_paused_lock_profiling = 0;
+static int g_paused_alloc_accounting = 0;
+static int g_paused_route_stats = 0;
+static uint64_t g_reactions = 0;
+static atomic_uint_fast64_t g_shed = 0;
+
+// Read the avg10 of the "some" and "full" lines, -1 when the file cannot be read
+static int read_psi(int fd, double *some, double *full) {
+    char buf[256];
+    ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) {
+        return -1;
+    }
+    buf[n] = '\0';
+
+    *some = 0;
+    *full = 0;
+    char *full_line = strstr(buf, "full ");
+    if (sscanf(buf, "some avg10=%lf", some) != 1) {
+        return -1;
+    }
+    if (full_line != NULL) {
+        sscanf(full_line, "full avg10=%lf", full);
+    }
+    return 0;
+}
+
+// Open the PSI file of a resource: our own cgroup's when there is one, the system-wide one otherwise
+static int open_psi(const char *cgroup_dir, const char *name) {
+    char path[MAX_PATH_LEN + 32];
+    double some, full;
+
+    if (cgroup_dir[0] != '\0') {
+        snprintf(path, sizeof(path), "%s/%s.pressure", cgroup_dir, name);
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        // Kernels booted with psi=0 keep the files but fail the read
+        if (fd >= 0 && read_psi(fd, &some, &full) == 0) {
+            log_info("Pressure monitor: %s stalls from %s", name, path);
+            return fd;
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    snprintf(path, sizeof(path), "/proc/pressure/%s", name);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0 && read_psi(fd, &some, &full) == 0) {
+        log_info("Pressure monitor: %s stalls from %s", name, path);
+        return fd;
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    return -1;
+}
+
+static void close_psi(void) {
+    for (int i = 0; i < PSI_RESOURCES; i++) {
+        if (g_psi_fds[i] >= 0) {
+            close(g_psi_fds[i]);
+            g_psi_fds[i] = -1;
+        }
+    }
+}
+
+/**
+ * Open the PSI files and set the thresholds
+ */
+int pressure_monitor_init(const config_t *config) {
+    if (config == NULL) {
+        return -1;
+    }
+
+    close_psi();
+    g_memory_threshold = config->pressure_memory_threshold;
+    g_cpu_threshold = config->pressure_cpu_threshold;
+    g_io_threshold = config->pressure_io_threshold;
+    g_critical_threshold = config->pressure_critical_threshold;
+    g_enabled = config->pressure_monitor;
+
+    if (!g_enabled) {
+        // Workers undo their reactions on the next tick
+        if (g_state.flags != 0) {
+            log_info("Pressure monitor disabled, clearing pressure flags");
+            g_state.flags = 0;
+            g_state.since = time(NULL);
+            update_shared_pressure(&g_state);
+        }
+        return 0;
+    }
+
+    resource_limits_t limits;
+    resource_limits_detect(&limits);
+
+    int opened = 0;
+    for (int i = 0; i < PSI_RESOURCES; i++) {
+        g_psi_fds[i] = open_psi(limits.cgroup_dir, g_psi_names[i]);
+        if (g_psi_fds[i] >= 0) {
+            opened++;
+        }
+    }
+
+    if (opened == 0) {
+        log_warn("Pressure monitor: no readable PSI files (kernel without CONFIG_PSI or booted with psi=0), disabled");
+        g_enabled = 0;
+        return -1;
+    }
+    return 0;
+}
+
+// Raise a flag at its threshold, clear it only well below
+static uint32_t flag_state(uint32_t flags, uint32_t bit, double value, double threshold) {
+    double limit = (flags & bit) ? threshold * PRESSURE_CLEAR_RATIO : threshold;
+    return value >= limit ? bit : 0;
+}
+
+/**
+ * Read PSI, then update and publish the pressure flags
+ */
+void pressure_monitor_check(void) {
+    if (!g_enabled) {
+        return;
+    }
+
+    double some[PSI_RESOURCES] = { 0 }, full[PSI_RESOURCES] = { 0 };
+    for (int i = 0; i < PSI_RESOURCES; i++) {
+        if (g_psi_fds[i] >= 0 && read_psi(g_psi_fds[i], &some[i], &full[i]) != 0) {
+            some[i] = full[i] = 0;
+        }
+    }
+
+    uint32_t flags = g_state.flags;
+    uint32_t next = flag_state(flags, PRESSURE_MEMORY, some[PSI_MEMORY], g_memory_threshold) |
+                    flag_state(flags, PRESSURE_CPU, some[PSI_CPU], g_cpu_threshold) |
+                    flag_state(flags, PRESSURE_IO, some[PSI_IO], g_io_threshold);
+
+    // Critical: any resource stalled most of the time, or every task waiting on memory (thrashing before the OOM killer)
+    double worst = some[PSI_MEMORY];
+    if (some[PSI_CPU] > worst) {
+        worst = some[PSI_CPU];
+    }
+    if (some[PSI_IO] > worst) {
+        worst = some[PSI_IO];
+    }
+    if (flag_state(flags, PRESSURE_CRITICAL, worst, g_critical_threshold) ||
+        flag_state(flags, PRESSURE_CRITICAL, full[PSI_MEMORY], g_memory_threshold)) {
+        next |= PRESSURE_CRITICAL;
+    }
+
+    g_state.memory_some = some[PSI_MEMORY];
+    g_state.memory_full = full[PSI_MEMORY];
+    g_state.cpu_some = some[PSI_CPU];
+    g_state.io_some = some[PSI_IO];
+
+    if (next != flags) {
+        for (int i = 0; i < PRESSURE_KINDS; i++) {
+            uint32_t bit = 1U << i;
+            if ((next & bit) && !(flags & bit)) {
+                g_state.raised[i]++;
+                g_raised_at[i] = time(NULL);
+                log_warn("Pressure monitor: %s pressure raised (memory some %.1f%% full %.1f%%, cpu %.1f%%, io %.1f%%)",
+                         g_flag_names[i], g_state.memory_some, g_state.memory_full, g_state.cpu_some, g_state.io_some);
+            } else if (!(next & bit) && (flags & bit)) {
+                log_info("Pressure monitor: %s pressure cleared after %lds (memory some %.1f%% full %.1f%%, cpu %.1f%%, io %.1f%%)",
+                         g_flag_names[i], (long)(time(NULL) - g_raised_at[i]),
+                         g_state.memory_some, g_state.memory_full, g_state.cpu_some, g_state.io_some);
+            }
+        }
+        g_state.flags = next;
+        g_state.since = time(NULL);
+    }
+
+    update_shared_pressure(&g_state);
+}
+
+/**
+ * Close the PSI files and clear the flags
+ */
+void pressure_monitor_cleanup(void) {
+    close_psi();
+    g_enabled = 0;
+    g_state.flags = 0;
+    update_shared_pressure(&g_state);
+}
+
+/**
+ * Start reacting to pressure in this Worker
+ */
+void pressure_worker_start(int worker_id, size_t cache_limit) {
+    g_worker_id = worker_id;
+    g_cache_limit = cache_limit;
+    g_applied = 0;
+    g_reactions = 0;
+    atomic_store(&g_shed, 0);
+}
+
+// Memory: keep a quarter of the file cache and hand pooled memory back to the system
+static void react_memory(int raised) {
+    if (raised) {
+        size_t freed_cache = file_io_enhanced_set_cache_limit(g_cache_limit / PRESSURE_CACHE_DIVISOR);
+        int freed_blocks = compress_connection_pool();
+        worker_schedule_pool_cleanup();
+        malloc_trim(0);
+        log_warn("Worker process %d memory pressure: file cache limited to %zu KB (%zu KB freed), "
+                 "%d pool blocks freed", getpid(), g_cache_limit / PRESSURE_CACHE_DIVISOR / 1024,
+                 freed_cache / 1024, freed_blocks > 0 ? freed_blocks : 0);
+    } else {
+        file_io_enhanced_set_cache_limit(g_cache_limit);
+        log_info("Worker process %d memory pressure cleared: file cache limit restored to %zu KB",
+                 getpid(), g_cache_limit / 1024);
+    }
+    g_reactions++;
+}
+
+// CPU: pause the per-request diagnostics, restoring only what this module paused
+static void react_cpu(int raised) {
+    if (raised) {
+        g_paused_lock_profiling = lock_profiler_is_enabled();
+        g_paused_alloc_accounting = ALLOC_STATS_ACTIVE();
+        g_paused_route_stats = route_stats_is_enabled();
+        if (g_paused_lock_profiling) {
+            lock_profiler_enable(0);
+        }
+        if (g_paused_alloc_accounting) {
+            alloc_stats_enable(0);
+        }
+        if (g_paused_route_stats) {
+            route_stats_enable(0);
+        }
+        log_warn("Worker process %d CPU pressure: diagnostics paused (lock_profiling %d, alloc_accounting %d, "
+                 "route_cpu_stats %d)", getpid(), g_paused_lock_profiling, g_paused_alloc_accounting,
+                 g_paused_route_stats);
+    } else {
+        if (g_paused_lock_profiling) {
+            lock_profiler_enable(1);
+        }
+        if (g_paused_alloc_accounting) {
+            alloc_stats_enable(1);
+        }
+        if (g_paused_route_stats) {
+            route_stats_enable(1);
+        }
+        g_paused_lock_profiling = g_paused_alloc_accounting = g_paused_route_stats = 0;
+        log_info("Worker process %d CPU pressure cleared: diagnostics restored", getpid());
+    }
+    g_reactions++;
+}
+
+// CPU or IO: debug logging costs both, drop it to INFO until both clear
+static void react_logging(int raised) {
+    if (raised) {
+        if (logger_get_level() != LOG_LEVEL_DEBUG) {
+            return;
+        }
+        g_saved_log_level = LOG_LEVEL_DEBUG;
+        logger_set_level(LOG_LEVEL_INFO);
+        log_warn("Worker process %d CPU/IO pressure: debug logging suspended", getpid());
+    } else {
+        if (g_saved_log_level < 0) {
+            return;
+        }
+        // An admin change made meanwhile wins
+        if (logger_get_level() == LOG_LEVEL_INFO) {
+            logger_set_level(g_saved_log_level);
+        }
+        g_saved_log_level = -1;
+        log_info("Worker process %d CPU/IO pressure cleared: log level restored", getpid());
+    }
+    g_reactions++;
+}
+
+static void react_critical(int raised) {
+    if (raised) {
+        log_warn("Worker process %d critical pressure: shedding low-priority routes with 503", getpid());
+    } else {
+        log_info("Worker process %d critical pressure cleared: %lu low-priority requests shed so far",
+                 getpid(), (unsigned long)atomic_load(&g_shed));
+    }
+    g_reactions++;
+}
+
+// Apply the changes between two flag sets
+static void apply_flags(uint32_t from, uint32_t to) {
+    uint32_t changed = from ^ to;
+    if (changed & PRESSURE_MEMORY) {
+        react_memory((to & PRESSURE_MEMORY) != 0);
+    }
+    if (changed & PRESSURE_CPU) {
+        react_cpu((to & PRESSURE_CPU) != 0);
+    }
+    int was_loud = (from & (PRESSURE_CPU | PRESSURE_IO)) != 0;
+    int is_loud = (to & (PRESSURE_CPU | PRESSURE_IO)) != 0;
+    if (was_loud != is_loud) {
+        react_logging(is_loud);
+    }
+    if (changed & PRESSURE_CRITICAL) {
+        react_critical((to & PRESSURE_CRITICAL) != 0);
+    }
+}
+
+/**
+ * Follow the shared pressure flags and publish the reaction counters
+ */
+void pressure_worker_update(void) {
+    if (g_worker_id < 0) {
+        return;
+    }
+
+    uint32_t flags = get_shared_pressure_flags();
+    if (flags != g_applied) {
+        apply_flags(g_applied, flags);
+        g_applied = flags;
+    }
+    update_worker_pressure_stats(g_worker_id, g_reactions, atomic_load(&g_shed));
+}
+
+/**
+ * Whether to answer a request with 503 instead of serving it
+ */
+int pressure_shed_request(const route_t *route) {
+    if (route->priority != ROUTE_PRIORITY_LOW || !(get_shared_pressure_flags() & PRESSURE_CRITICAL)) {
+        return 0;
+    }
+    atomic_fetch_add_explicit(&g_shed, 1, memory_order_relaxed);
+    return 1;
+}
+
+/**
+ * Publish and report the totals, reactions in effect end with the process
+ */
+void pressure_worker_stop(void) {
+    if (g_worker_id < 0) {
+        return;
+    }
+
+    update_worker_pressure_stats(g_worker_id, g_reactions, atomic_load(&g_shed));
+
+    if (g_reactions > 0) {
+        log_info("Worker process %d pressure: %lu reactions, %lu low-priority requests shed",
+                 getpid(), (unsigned long)g_reactions, (unsigned long)atomic_load(&g_shed));
+    }
+    g_worker_id = -1;
+}
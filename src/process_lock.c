@@ -13,6 +13,7 @@
 #include <signal.h>
 
 #include "../include/process_lock.h"
+#include "../include/master_process.h"
 #include "../include/logger.h"
 
 // Global PID file descriptor
@@ -34,6 +35,10 @@ int check_port_available(int port) {
         return -1;
     }
     
+    // Same option as the real listener, so TIME_WAIT sockets left by a previous run do not count as in use
+    int opt = 1;
+    setsockopt(sock_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    
     // Set address
     memset(&addr, 0, sizeof(addr));
     addr.sin_family = AF_INET;
@@ -108,8 +113,8 @@ int create_pid_file(const char *pid_file, int port) {
     // Create logs directory (if it doesn't exist)
     mkdir("logs", 0755);
     
-    // Open PID file
-    g_pid_fd = open(g_pid_file_path, O_RDWR | O_CREAT, 0644);
+    // Open PID file, a new binary executed for an upgrade must not inherit it
+    g_pid_fd = open(g_pid_file_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
     if (g_pid_fd < 0) {
         log_error("Failed to create PID file %s: %s", g_pid_file_path, strerror(errno));
         return -1;
@@ -239,6 +244,92 @@ void release_pid_file(void) {
     }
 }
 
+/**
+ * Take the PID file over after daemonize() forked
+ */
+int refresh_pid_file(void) {
+    struct flock fl;
+    char pid_str[32];
+    int len;
+    
+    if (g_pid_fd < 0) {
+        return -1;
+    }
+    
+    fl.l_type = F_WRLCK;
+    fl.l_whence = SEEK_SET;
+    fl.l_start = 0;
+    fl.l_len = 0;
+    
+    // fcntl locks are not inherited, the lock of the exiting parent may still be held briefly
+    int attempts = 0;
+    while (fcntl(g_pid_fd, F_SETLK, &fl) < 0) {
+        if ((errno != EACCES && errno != EAGAIN) || ++attempts >= 50) {
+            log_error("Failed to lock PID file %s after fork: %s", g_pid_file_path, strerror(errno));
+            return -1;
+        }
+        usleep(20000);
+    }
+    
+    len = snprintf(pid_str, sizeof(pid_str), "%d\n", getpid());
+    if (ftruncate(g_pid_fd, 0) < 0 || pwrite(g_pid_fd, pid_str, len, 0) != len) {
+        log_error("Failed to update PID file %s: %s", g_pid_file_path, strerror(errno));
+        return -1;
+    }
+    fsync(g_pid_fd);
+    
+    log_info("PID file updated: %s (PID: %d)", g_pid_file_path, getpid());
+    return 0;
+}
+
+/**
+ * Rename the locked PID file to <pid file>.oldbin for a binary upgrade
+ */
+int rename_pid_file_oldbin(void) {
+    char oldbin[sizeof(g_pid_file_path)];
+    
+    if (g_pid_fd < 0) {
+        log_error("No PID file to hand over");
+        return -1;
+    }
+    if (snprintf(oldbin, sizeof(oldbin), "%s.oldbin", g_pid_file_path) >= (int)sizeof(oldbin)) {
+        log_error("PID file path too long: %s", g_pid_file_path);
+        return -1;
+    }
+    if (rename(g_pid_file_path, oldbin) != 0) {
+        log_error("Failed to rename PID file %s to %s: %s", g_pid_file_path, oldbin, strerror(errno));
+        return -1;
+    }
+    
+    // The lock belongs to the open descriptor and moves with the file
+    strcpy(g_pid_file_path, oldbin);
+    log_info("PID file renamed to %s", g_pid_file_path);
+    return 0;
+}
+
+/**
+ * Rename <pid file>.oldbin back after a failed upgrade
+ */
+int restore_pid_file_oldbin(void) {
+    size_t len = strlen(g_pid_file_path);
+    
+    if (g_pid_fd < 0 || len < 7 || strcmp(g_pid_file_path + len - 7, ".oldbin") != 0) {
+        return -1;
+    }
+    
+    char original[sizeof(g_pid_file_path)];
+    memcpy(original, g_pid_file_path, len - 7);
+    original[len - 7] = '\0';
+    
+    if (rename(g_pid_file_path, original) != 0) {
+        log_error("Failed to restore PID file %s: %s", original, strerror(errno));
+        return -1;
+    }
+    strcpy(g_pid_file_path, original);
+    log_info("PID file restored to %s", g_pid_file_path);
+    return 0;
+}
+
 /**
  * Send signal to running server实例
  */
@@ -268,6 +359,7 @@ int send_signal_to_running_server(int port, int signal) {
         case SIGHUP: signal_name = "RELOAD"; break;
         case SIGTERM: signal_name = "STOP"; break;
         case SIGQUIT: signal_name = "QUIT"; break;
+        case SIGUSR2: signal_name = "UPGRADE"; break;
     }
     
     printf("Sent %s signal to x-server process %d (port %d)\n", signal_name, server_pid, port);
@@ -286,6 +378,14 @@ int pre_start_check(int port) {
         return 0;
     }
     
+    // New binary of an upgrade: the old Master still holds the port and has moved its
+    // PID file to .oldbin, so only the PID file is taken over
+    if (getenv(LISTEN_FDS_ENV) != NULL) {
+        log_info("Listening socket inherited from Master %s, skipping port checks", 
+                 getenv(OLD_MASTER_ENV) ? getenv(OLD_MASTER_ENV) : "?");
+        return create_pid_file(NULL, port);
+    }
+    
     log_info("Starting server pre-start check, port: %d", port);
     
     // 1. Check if instance is already running
@@ -11,10 +11,15 @@
 
 #include "../include/process_title.h"
 
+extern char **environ;
+
 // Save original argv and environ
 static char **g_os_argv = NULL;
 static char *g_os_argv_last = NULL;
 
+// Heap copy of the command line, argv itself is overwritten by the title
+static char **g_saved_argv = NULL;
+
 /**
  * Initialize process title setting
  */
@@ -24,6 +29,27 @@ int init_process_title(int argc, char **argv, char **envp) {
     // Save original argv
     g_os_argv = argv;
     
+    g_saved_argv = calloc((size_t)argc + 1, sizeof(char *));
+    if (g_saved_argv != NULL) {
+        for (i = 0; i < argc; i++) {
+            g_saved_argv[i] = strdup(argv[i]);
+        }
+    }
+    
+    // The title overwrites the environment strings too, move them to the heap so
+    // getenv() and execve() during a binary upgrade still see the real environment
+    size_t env_count = 0;
+    while (envp[env_count]) {
+        env_count++;
+    }
+    char **env = calloc(env_count + 1, sizeof(char *));
+    if (env != NULL) {
+        for (size_t n = 0; n < env_count; n++) {
+            env[n] = strdup(envp[n]);
+        }
+        environ = env;
+    }
+    
     // Find the end position of the last environment variable
     if (envp[0]) {
         // Calculate the number of environment variables
@@ -60,4 +86,10 @@ void setproctitle(const char *fmt, ...) {
     // Set new process title
     strncpy(g_os_argv[0], title, g_os_argv_last - g_os_argv[0] - 1);
     g_os_argv[1] = NULL;
-}
\ No newline at end of file
+}
+/**
+ * Get the saved command line
+ */
+char **get_saved_argv(void) {
+    return g_saved_argv;
+}
@@ -19,6 +19,10 @@
 #include "../include/config.h"
 #include "../include/logger.h"
 
+// Allocations in this file are accounted to the proxy subsystem
+#define ALLOC_TAG ALLOC_TAG_PROXY
+#include "../include/alloc_stats.h"
+
 #define BUFFER_SIZE 8192
 #define TIMEOUT_MS 30000  // 30秒超时
 
@@ -32,14 +36,75 @@ typedef enum {
     UPSTREAM_ERROR_WRITE_FAILED
 } upstream_error_t;
 
+// Connect a socket with the upstream send/receive timeouts, -1 on failure
+static int connect_address(const struct sockaddr *addr, socklen_t addr_len, int socktype, int protocol) {
+    int server_sock = socket(addr->sa_family, socktype, protocol);
+    if (server_sock < 0) {
+        return -1;
+    }
+    
+    // Set connection timeout
+    struct timeval timeout;
+    timeout.tv_sec = 5;  // 5 second connection timeout
+    timeout.tv_usec = 0;
+    setsockopt(server_sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(server_sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    
+    if (connect(server_sock, addr, addr_len) != 0) {
+        int saved_errno = errno;
+        close(server_sock);
+        errno = saved_errno;
+        return -1;
+    }
+    return server_sock;
+}
+
+// Resolve an upstream once, ahead of the requests that use it
+int proxy_resolve_upstream(const char *host, int port, upstream_addr_t *upstream) {
+    struct addrinfo hints, *res;
+    char port_str[10];
+    
+    memset(upstream, 0, sizeof(upstream_addr_t));
+    snprintf(port_str, sizeof(port_str), "%d", port);
+    
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    
+    int dns_result = getaddrinfo(host, port_str, &hints, &res);
+    if (dns_result != 0) {
+        log_warn("Upstream %s:%d not resolved ahead of requests: %s", host, port, gai_strerror(dns_result));
+        return -1;
+    }
+    
+    if (res->ai_addrlen <= sizeof(upstream->addr)) {
+        memcpy(&upstream->addr, res->ai_addr, res->ai_addrlen);
+        upstream->addr_len = res->ai_addrlen;
+    }
+    freeaddrinfo(res);
+    
+    return upstream->addr_len > 0 ? 0 : -1;
+}
+
 // Create connection to target server (with timeout and retry)
-static int connect_to_server(const char *host, int port, upstream_error_t *error) {
+static int connect_to_server(const char *host, int port, const upstream_addr_t *upstream, 
+                             upstream_error_t *error) {
     struct addrinfo hints, *res, *res_start;
     int server_sock;
     char port_str[10];
     
     if (error) *error = UPSTREAM_ERROR_NONE;
     
+    // Address resolved when the configuration was loaded; a failure re-resolves in case it moved
+    if (upstream != NULL && upstream->addr_len > 0) {
+        server_sock = connect_address((const struct sockaddr *)&upstream->addr, upstream->addr_len, 
+                                      SOCK_STREAM, 0);
+        if (server_sock >= 0) {
+            return server_sock;
+        }
+        log_debug("Connection to resolved upstream failed: %s:%d - %s", host, port, strerror(errno));
+    }
+    
     snprintf(port_str, sizeof(port_str), "%d", port);
     
     memset(&hints, 0, sizeof(hints));
@@ -59,26 +124,19 @@ static int connect_to_server(const char *host, int port, upstream_error_t *error
     
     // Try to connect to resolved address
     while (res != NULL) {
-        server_sock = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
-        if (server_sock < 0) {
+        // Already tried above
+        if (upstream != NULL && upstream->addr_len == res->ai_addrlen &&
+            memcmp(&upstream->addr, res->ai_addr, res->ai_addrlen) == 0) {
             res = res->ai_next;
             continue;
         }
         
-        // Set connection timeout
-        struct timeval timeout;
-        timeout.tv_sec = 5;  // 5 second connection timeout
-        timeout.tv_usec = 0;
-        setsockopt(server_sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
-        setsockopt(server_sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
-        
-        if (connect(server_sock, res->ai_addr, res->ai_addrlen) == 0) {
+        server_sock = connect_address(res->ai_addr, res->ai_addrlen, res->ai_socktype, res->ai_protocol);
+        if (server_sock >= 0) {
             break;  // Connection successful
         }
         
         log_debug("Connection failed: %s:%d - %s", host, port, strerror(errno));
-        close(server_sock);
-        server_sock = -1;
         res = res->ai_next;
     }
     
@@ -233,13 +291,14 @@ static long parse_content_length(const char *response) {
 }
 
 // Forward request to target server
-int proxy_request(int client_sock, http_request_t *request, route_t *route, int *status_code, size_t *response_size) {
+int proxy_request(int client_sock, http_request_t *request, route_t *route, const upstream_addr_t *upstream,
+                  int *status_code, size_t *response_size) {
     upstream_error_t upstream_error;
     char upstream_info[256];
     
     snprintf(upstream_info, sizeof(upstream_info), "%s:%d", route->target_host, route->target_port);
     
-    int server_sock = connect_to_server(route->target_host, route->target_port, &upstream_error);
+    int server_sock = connect_to_server(route->target_host, route->target_port, upstream, &upstream_error);
     if (server_sock < 0) {
         // Return different status codes and error messages based on different error types
         int error_status;
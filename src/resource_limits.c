@@ -0,0 +1,285 @@
+/**
+ * Resource Limits Implementation
+ * CPU, memory and descriptor limits this process really runs under, cgroup v1 and v2 aware
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+#include "../include/resource_limits.h"
+#include "../include/logger.h"
+
+#define CGROUP_ROOT "/sys/fs/cgroup"
+
+// cgroup v1 reports "no limit" as the largest page-aligned signed value
+#define CGROUP_V1_UNLIMITED (1ULL << 62)
+
+// Read the first line of a file, -1 when it cannot be read
+static int read_line(const char *path, char *buf, size_t len) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        return -1;
+    }
+    char *line = fgets(buf, (int)len, fp);
+    fclose(fp);
+    if (line == NULL) {
+        return -1;
+    }
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+static int is_dir(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+// Drop the last path component, 0 once the mount root is reached
+static int parent_dir(char *dir, size_t root_len) {
+    if (strlen(dir) <= root_len) {
+        return 0;
+    }
+    char *slash = strrchr(dir, '/');
+    if (slash == NULL || (size_t)(slash - dir) < root_len) {
+        return 0;
+    }
+    *slash = '\0';
+    return 1;
+}
+
+// Directory of this process under a controller mount; inside a cgroup namespace the path
+// from /proc/self/cgroup may not exist under the mount, the mount root is then our own cgroup
+static void cgroup_dir(const char *mount, const char *rel, char *dir, size_t len) {
+    snprintf(dir, len, "%s%s", mount, strcmp(rel, "/") == 0 ? "" : rel);
+    if (!is_dir(dir)) {
+        snprintf(dir, len, "%s", mount);
+    }
+}
+
+// Tightest cgroup v2 limits from this cgroup up to the root
+static void read_v2_limits(const char *mount, const char *rel, resource_limits_t *limits) {
+    char dir[MAX_PATH_LEN];
+    char path[MAX_PATH_LEN + 32];
+    char line[128];
+    size_t root_len = strlen(mount);
+
+    cgroup_dir(mount, rel, dir, sizeof(dir));
+    snprintf(limits->cgroup_dir, sizeof(limits->cgroup_dir), "%s", dir);
+
+    do {
+        // "max 100000" or "<quota> <period>"
+        snprintf(path, sizeof(path), "%s/cpu.max", dir);
+        long long quota, period;
+        if (read_line(path, line, sizeof(line)) == 0 &&
+            sscanf(line, "%lld %lld", &quota, &period) == 2 && quota > 0 && period > 0) {
+            double cpus = (double)quota / (double)period;
+            if (limits->cpu_quota == 0 || cpus < limits->cpu_quota) {
+                limits->cpu_quota = cpus;
+            }
+        }
+
+        snprintf(path, sizeof(path), "%s/memory.max", dir);
+        unsigned long long bytes;
+        if (read_line(path, line, sizeof(line)) == 0 && sscanf(line, "%llu", &bytes) == 1 && bytes > 0) {
+            if (limits->memory_limit == 0 || bytes < limits->memory_limit) {
+                limits->memory_limit = (size_t)bytes;
+            }
+        }
+    } while (parent_dir(dir, root_len));
+}
+
+// First v1 mount of a controller
+static const char *v1_mount(const char *const *candidates) {
+    for (int i = 0; candidates[i] != NULL; i++) {
+        if (is_dir(candidates[i])) {
+            return candidates[i];
+        }
+    }
+    return NULL;
+}
+
+// Tightest cgroup v1 CPU limit from this cgroup up to the mount root
+static void read_v1_cpu(const char *rel, resource_limits_t *limits) {
+    static const char *const mounts[] = { CGROUP_ROOT "/cpu", CGROUP_ROOT "/cpu,cpuacct", CGROUP_ROOT "/cpuacct,cpu", NULL };
+    const char *mount = v1_mount(mounts);
+    if (mount == NULL) {
+        return;
+    }
+
+    char dir[MAX_PATH_LEN];
+    char path[MAX_PATH_LEN + 32];
+    char line[64];
+    size_t root_len = strlen(mount);
+    cgroup_dir(mount, rel, dir, sizeof(dir));
+
+    do {
+        long long quota = -1, period = 0;
+        snprintf(path, sizeof(path), "%s/cpu.cfs_quota_us", dir);
+        if (read_line(path, line, sizeof(line)) == 0) {
+            quota = atoll(line);
+        }
+        snprintf(path, sizeof(path), "%s/cpu.cfs_period_us", dir);
+        if (read_line(path, line, sizeof(line)) == 0) {
+            period = atoll(line);
+        }
+        if (quota > 0 && period > 0) {
+            double cpus = (double)quota / (double)period;
+            if (limits->cpu_quota == 0 || cpus < limits->cpu_quota) {
+                limits->cpu_quota = cpus;
+            }
+        }
+    } while (parent_dir(dir, root_len));
+}
+
+// Tightest cgroup v1 memory limit from this cgroup up to the mount root
+static void read_v1_memory(const char *rel, resource_limits_t *limits) {
+    static const char *const mounts[] = { CGROUP_ROOT "/memory", NULL };
+    const char *mount = v1_mount(mounts);
+    if (mount == NULL) {
+        return;
+    }
+
+    char dir[MAX_PATH_LEN];
+    char path[MAX_PATH_LEN + 32];
+    char line[64];
+    size_t root_len = strlen(mount);
+    cgroup_dir(mount, rel, dir, sizeof(dir));
+
+    do {
+        snprintf(path, sizeof(path), "%s/memory.limit_in_bytes", dir);
+        unsigned long long bytes;
+        if (read_line(path, line, sizeof(line)) == 0 && sscanf(line, "%llu", &bytes) == 1 &&
+            bytes > 0 && bytes < CGROUP_V1_UNLIMITED) {
+            if (limits->memory_limit == 0 || bytes < limits->memory_limit) {
+                limits->memory_limit = (size_t)bytes;
+            }
+        }
+    } while (parent_dir(dir, root_len));
+}
+
+// Whether a comma-separated v1 controller list names a controller
+static int has_controller(const char *list, const char *name) {
+    size_t len = strlen(name);
+    for (const char *p = list; p != NULL && *p != '\0'; ) {
+        const char *comma = strchr(p, ',');
+        size_t token = comma ? (size_t)(comma - p) : strlen(p);
+        if (token == len && strncmp(p, name, len) == 0) {
+            return 1;
+        }
+        p = comma ? comma + 1 : NULL;
+    }
+    return 0;
+}
+
+// Read /proc/self/cgroup and the limits of every hierarchy it names
+static void read_cgroup_limits(resource_limits_t *limits) {
+    FILE *fp = fopen("/proc/self/cgroup", "r");
+    if (fp == NULL) {
+        return;
+    }
+
+    // A pure v2 host mounts the unified hierarchy at the root, a hybrid one below it
+    const char *v2_mount = NULL;
+    if (access(CGROUP_ROOT "/cgroup.controllers", F_OK) == 0) {
+        v2_mount = CGROUP_ROOT;
+    } else if (access(CGROUP_ROOT "/unified/cgroup.controllers", F_OK) == 0) {
+        v2_mount = CGROUP_ROOT "/unified";
+    }
+
+    char line[MAX_PATH_LEN + 64];
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        line[strcspn(line, "\n")] = '\0';
+
+        // "<id>:<controllers>:<path>"
+        char *controllers = strchr(line, ':');
+        char *rel = controllers ? strchr(controllers + 1, ':') : NULL;
+        if (rel == NULL) {
+            continue;
+        }
+        *controllers++ = '\0';
+        *rel++ = '\0';
+
+        if (strcmp(line, "0") == 0 && *controllers == '\0') {
+            if (v2_mount != NULL) {
+                read_v2_limits(v2_mount, rel, limits);
+                if (limits->cgroup_version == 0) {
+                    limits->cgroup_version = 2;
+                }
+            }
+        } else {
+            if (has_controller(controllers, "cpu")) {
+                read_v1_cpu(rel, limits);
+                limits->cgroup_version = 1;
+            }
+            if (has_controller(controllers, "memory")) {
+                read_v1_memory(rel, limits);
+                limits->cgroup_version = 1;
+            }
+        }
+    }
+    fclose(fp);
+}
+
+/**
+ * Detect the limits of this process
+ */
+int resource_limits_detect(resource_limits_t *limits) {
+    if (limits == NULL) {
+        return -1;
+    }
+    memset(limits, 0, sizeof(*limits));
+
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    limits->online_cpus = online > 0 ? (int)online : 1;
+
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0 && CPU_COUNT(&allowed) > 0) {
+        limits->allowed_cpus = CPU_COUNT(&allowed);
+    } else {
+        limits->allowed_cpus = limits->online_cpus;
+    }
+
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (pages > 0 && page_size > 0) {
+        limits->physical_memory = (size_t)pages * (size_t)page_size;
+    }
+
+    struct rlimit rlim;
+    if (getrlimit(RLIMIT_NOFILE, &rlim) == 0) {
+        limits->nofile_soft = rlim.rlim_cur;
+        limits->nofile_hard = rlim.rlim_max;
+    } else {
+        log_warn("Failed to read RLIMIT_NOFILE");
+        limits->nofile_soft = limits->nofile_hard = 1024;
+    }
+
+    read_cgroup_limits(limits);
+    return 0;
+}
+
+/**
+ * Usable CPUs
+ */
+double resource_limits_cpus(const resource_limits_t *limits) {
+    double cpus = limits->allowed_cpus < limits->online_cpus ? limits->allowed_cpus : limits->online_cpus;
+    if (limits->cpu_quota > 0 && limits->cpu_quota < cpus) {
+        cpus = limits->cpu_quota;
+    }
+    return cpus;
+}
+
+/**
+ * Usable memory
+ */
+size_t resource_limits_memory(const resource_limits_t *limits) {
+    if (limits->memory_limit > 0 && (limits->physical_memory == 0 || limits->memory_limit < limits->physical_memory)) {
+        return limits->memory_limit;
+    }
+    return limits->physical_memory;
+}
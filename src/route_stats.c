@@ -0,0 +1,180 @@
+/**
+ * Per-Route CPU Time Accounting Implementation
+ * Accumulates thread CPU time of request handling per route within a Worker
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <stdatomic.h>
+
+#include "../include/route_stats.h"
+#include "../include/logger.h"
+
+// Per-route counters, written by the event loop thread and read by the main loop
+typedef struct route_counters {
+    char path_prefix[MAX_PATH_PREFIX_LEN];
+    atomic_uint_fast64_t requests;
+    atomic_uint_fast64_t cpu_ns;
+    atomic_uint_fast64_t max_cpu_ns;
+} route_counters_t;
+
+static route_counters_t g_route_counters[ROUTE_STATS_SLOTS];
+static atomic_int g_route_stats_enabled = 0;
+
+// Clear the counters of one slot
+static void reset_slot(route_counters_t *c) {
+    atomic_store(&c->requests, 0);
+    atomic_store(&c->cpu_ns, 0);
+    atomic_store(&c->max_cpu_ns, 0);
+}
+
+/**
+ * Enable or disable accounting
+ */
+void route_stats_enable(int enabled) {
+    int previous = atomic_exchange(&g_route_stats_enabled, enabled ? 1 : 0);
+    if (previous != (enabled ? 1 : 0)) {
+        log_info("Per-route CPU accounting %s", enabled ? "enabled" : "disabled");
+    }
+}
+
+/**
+ * Check whether accounting is enabled
+ */
+int route_stats_is_enabled(void) {
+    return atomic_load_explicit(&g_route_stats_enabled, memory_order_relaxed) ? 1 : 0;
+}
+
+/**
+ * Sync slot names with the configured routes, clearing slots whose route changed
+ */
+void route_stats_set_routes(const config_t *config) {
+    if (config == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < MAX_ROUTES; i++) {
+        route_counters_t *c = &g_route_counters[i];
+        const char *prefix = i < config->route_count ? config->routes[i].path_prefix : "";
+
+        if (strncmp(c->path_prefix, prefix, MAX_PATH_PREFIX_LEN) != 0) {
+            reset_slot(c);
+            strncpy(c->path_prefix, prefix, MAX_PATH_PREFIX_LEN - 1);
+            c->path_prefix[MAX_PATH_PREFIX_LEN - 1] = '\0';
+        }
+    }
+
+    strncpy(g_route_counters[ROUTE_STATS_UNMATCHED].path_prefix, "(unmatched)", MAX_PATH_PREFIX_LEN - 1);
+}
+
+/**
+ * Read the calling thread's CPU time
+ */
+uint64_t route_stats_thread_cpu_ns(void) {
+    struct timespec ts;
+
+    if (!route_stats_is_enabled()) {
+        return 0;
+    }
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+        return 0;
+    }
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Record CPU time spent on one request
+ */
+void route_stats_record(int route_index, uint64_t cpu_ns) {
+    if (route_index < 0 || route_index >= ROUTE_STATS_SLOTS) {
+        route_index = ROUTE_STATS_UNMATCHED;
+    }
+
+    route_counters_t *c = &g_route_counters[route_index];
+    atomic_fetch_add_explicit(&c->requests, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&c->cpu_ns, cpu_ns, memory_order_relaxed);
+
+    // Single writer thread, a plain compare is enough for the maximum
+    if (cpu_ns > atomic_load_explicit(&c->max_cpu_ns, memory_order_relaxed)) {
+        atomic_store_explicit(&c->max_cpu_ns, cpu_ns, memory_order_relaxed);
+    }
+}
+
+/**
+ * Get statistics snapshot of routes that served requests
+ */
+int route_stats_get(route_cpu_stats_t *stats, int max_count) {
+    int count = 0;
+
+    if (stats == NULL || max_count <= 0) {
+        return 0;
+    }
+
+    for (int i = 0; i < ROUTE_STATS_SLOTS && count < max_count; i++) {
+        route_counters_t *c = &g_route_counters[i];
+        uint64_t requests = atomic_load(&c->requests);
+        if (requests == 0) {
+            continue;
+        }
+
+        route_cpu_stats_t *out = &stats[count++];
+        memset(out, 0, sizeof(*out));
+        strncpy(out->path_prefix, c->path_prefix, MAX_PATH_PREFIX_LEN - 1);
+        out->requests = requests;
+        out->cpu_ns = atomic_load(&c->cpu_ns);
+        out->max_cpu_ns = atomic_load(&c->max_cpu_ns);
+        out->cpu_seconds = (double)out->cpu_ns / 1e9;
+        out->cpu_us_per_request = (double)out->cpu_ns / 1e3 / (double)requests;
+    }
+
+    return count;
+}
+
+/**
+ * Read raw counters of one slot
+ */
+void route_stats_get_slot(int slot, uint64_t *requests, uint64_t *cpu_ns) {
+    if (slot < 0 || slot >= ROUTE_STATS_SLOTS) {
+        return;
+    }
+    if (requests) {
+        *requests = atomic_load(&g_route_counters[slot].requests);
+    }
+    if (cpu_ns) {
+        *cpu_ns = atomic_load(&g_route_counters[slot].cpu_ns);
+    }
+}
+
+/**
+ * Reset all route statistics
+ */
+void route_stats_reset(void) {
+    for (int i = 0; i < ROUTE_STATS_SLOTS; i++) {
+        reset_slot(&g_route_counters[i]);
+    }
+}
+
+/**
+ * Print per-route CPU statistics
+ */
+void route_stats_print(void) {
+    route_cpu_stats_t stats[ROUTE_STATS_SLOTS];
+
+    if (!route_stats_is_enabled()) {
+        return;
+    }
+
+    int count = route_stats_get(stats, ROUTE_STATS_SLOTS);
+
+    log_info("=== Per-Route CPU Statistics (PID %d) ===", getpid());
+    for (int i = 0; i < count; i++) {
+        route_cpu_stats_t *s = &stats[i];
+        log_info("%-24s requests=%lu cpu=%.6fs cpu/request=%.1fus max=%.1fus",
+                 s->path_prefix, s->requests, s->cpu_seconds,
+                 s->cpu_us_per_request, (double)s->max_cpu_ns / 1e3);
+    }
+    log_info("==========================================");
+}
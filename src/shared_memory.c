@@ -6,308 +6,648 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <sys/shm.h>
-#include <sys/ipc.h>
-#include <sys/sem.h>
+#include <sched.h>
+#include <sys/mman.h>
 #include <errno.h>
 #include <time.h>
 
 #include "../include/shared_memory.h"
 #include "../include/logger.h"
 
-// Shared memory segment IDs
-static int g_config_shm_id = -1;
-static int g_stats_shm_id = -1;
+// The whole region, inherited by Workers through fork
+static shared_region_t *g_region = NULL;
 
-// Shared memory pointers
+// Sections inside the region
 static shared_config_t *g_shared_config = NULL;
 static shared_stats_t *g_shared_stats = NULL;
 
-// Semaphore IDs (for synchronized access)
-static int g_config_sem_id = -1;
-static int g_stats_sem_id = -1;
+// Totals of exited Workers, kept by the Master, which is the only reader of the summed totals
+static uint64_t g_retired_requests = 0;
+static uint64_t g_retired_bytes_sent = 0;
+static uint64_t g_retired_bytes_received = 0;
 
-// Semaphore operation structures
-static struct sembuf sem_lock = {0, -1, SEM_UNDO};
-static struct sembuf sem_unlock = {0, 1, SEM_UNDO};
+// Reader retries before accepting a possibly torn copy, a writer that died mid-update leaves the sequence odd
+#define SEQLOCK_READ_RETRIES 1000
 
 /**
- * Create or get semaphore
+ * Start a seqlock write, the sequence is odd until seqlock_write_end()
  */
-static int create_semaphore(key_t key) {
-    int sem_id = semget(key, 1, IPC_CREAT | 0666);
-    if (sem_id == -1) {
-        log_error("Failed to create semaphore: %s", strerror(errno));
-        return -1;
+static inline void seqlock_write_begin(uint32_t *seq) {
+    __atomic_store_n(seq, *seq + 1, __ATOMIC_RELAXED);
+    // Readers that see any of the following stores also see the odd sequence
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+ * Finish a seqlock write
+ */
+static inline void seqlock_write_end(uint32_t *seq) {
+    __atomic_store_n(seq, *seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Copy a seqlock-protected block, retrying while a write is in progress or overlapped the copy
+ */
+static void seqlock_read(const uint32_t *seq, void *dst, const void *src, size_t size) {
+    for (int attempt = 0; attempt < SEQLOCK_READ_RETRIES; attempt++) {
+        uint32_t start = __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+        if (start & 1) {
+            sched_yield();
+            continue;
+        }
+        memcpy(dst, src, size);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(seq, __ATOMIC_RELAXED) == start) {
+            return;
+        }
+    }
+    
+    memcpy(dst, src, size);
+}
+
+/**
+ * Round up to a multiple of align (a power of two)
+ */
+static size_t align_up(size_t value, size_t align) {
+    return (value + align - 1) & ~(align - 1);
+}
+
+/**
+ * Initialize shared memory
+ */
+int init_shared_memory(void) {
+    if (g_region != NULL) {
+        return 0;
     }
     
-    // Initialize semaphore value to 1
-    union semun {
-        int val;
-        struct semid_ds *buf;
-        unsigned short *array;
-    } sem_union;
+    // Sections follow the header at cache line boundaries, the total is rounded to pages
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    size_t config_offset = align_up(sizeof(shared_region_t), 64);
+    size_t stats_offset = align_up(config_offset + sizeof(shared_config_t), 64);
+    size_t size = align_up(stats_offset + sizeof(shared_stats_t), page_size);
     
-    sem_union.val = 1;
-    if (semctl(sem_id, 0, SETVAL, sem_union) == -1) {
-        log_error("Failed to initialize semaphore: %s", strerror(errno));
+    // Anonymous: private to this instance and its Workers, gone when the last of them exits
+    void *addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) {
+        log_error("Failed to map shared memory region (%zu bytes): %s", size, strerror(errno));
         return -1;
     }
     
-    return sem_id;
+    // The mapping is zero-filled
+    g_region = (shared_region_t *)addr;
+    g_region->magic = SHM_MAGIC;
+    g_region->layout_version = SHM_LAYOUT_VERSION;
+    g_region->size = size;
+    g_region->config_offset = config_offset;
+    g_region->config_size = sizeof(shared_config_t);
+    g_region->stats_offset = stats_offset;
+    g_region->stats_size = sizeof(shared_stats_t);
+    g_region->worker_slots = SHM_MAX_WORKERS;
+    
+    g_shared_config = (shared_config_t *)((char *)addr + config_offset);
+    g_shared_stats = (shared_stats_t *)((char *)addr + stats_offset);
+    
+    g_shared_config->update_time = time(NULL);
+    g_shared_stats->start_time = time(NULL);
+    
+    log_info("Shared memory initialized successfully, %zu bytes, layout version %d", size, SHM_LAYOUT_VERSION);
+    return 0;
+}
+
+/**
+ * Clean up shared memory
+ */
+void cleanup_shared_memory(void) {
+    if (g_region != NULL) {
+        munmap(g_region, g_region->size);
+        g_region = NULL;
+        g_shared_config = NULL;
+        g_shared_stats = NULL;
+    }
+    
+    log_info("Shared memory cleanup completed");
 }
 
 /**
- * Acquire semaphore lock
+ * Update configuration in shared memory
  */
-static int lock_semaphore(int sem_id) {
-    if (semop(sem_id, &sem_lock, 1) == -1) {
-        log_error("Failed to acquire semaphore lock: %s", strerror(errno));
+int update_shared_config(config_t *config) {
+    if (g_shared_config == NULL || config == NULL) {
+        log_error("Shared configuration memory not initialized or configuration is empty");
         return -1;
     }
+    
+    // Only the Master writes the configuration section
+    seqlock_write_begin(&g_shared_config->seq);
+    
+    g_shared_config->version++;
+    g_shared_config->update_time = time(NULL);
+    
+    // config_t holds no pointers, routes included
+    memcpy(&g_shared_config->config, config, sizeof(config_t));
+    
+    seqlock_write_end(&g_shared_config->seq);
+    
+    log_info("Shared configuration updated successfully, version: %d", g_shared_config->version);
     return 0;
 }
 
 /**
- * Release semaphore lock
+ * Get configuration from shared memory
+ */
+config_t *get_shared_config(void) {
+    if (g_shared_config == NULL) {
+        log_error("Shared configuration memory not initialized");
+        return NULL;
+    }
+    
+    config_t *config = (config_t *)malloc(sizeof(config_t));
+    if (config == NULL) {
+        log_error("Failed to allocate configuration memory");
+        return NULL;
+    }
+    
+    seqlock_read(&g_shared_config->seq, config, &g_shared_config->config, sizeof(config_t));
+    
+    return config;
+}
+
+/**
+ * Update Worker process statistics
  */
-static int unlock_semaphore(int sem_id) {
-    if (semop(sem_id, &sem_unlock, 1) == -1) {
-        log_error("Failed to release semaphore lock: %s", strerror(errno));
+int update_worker_stats(int worker_id, pid_t pid, uint64_t requests,
+                       uint64_t bytes_sent, uint64_t bytes_received,
+                       uint32_t active_connections) {
+    if (g_shared_stats == NULL || worker_id < 0 || worker_id >= SHM_MAX_WORKERS) {
         return -1;
     }
+    
+    seqlock_write_begin(&g_shared_stats->workers[worker_id].seq);
+    
+    g_shared_stats->workers[worker_id].pid = pid;
+    g_shared_stats->workers[worker_id].requests = requests;
+    g_shared_stats->workers[worker_id].bytes_sent = bytes_sent;
+    g_shared_stats->workers[worker_id].bytes_received = bytes_received;
+    g_shared_stats->workers[worker_id].active_connections = active_connections;
+    g_shared_stats->workers[worker_id].last_update = time(NULL);
+    
+    seqlock_write_end(&g_shared_stats->workers[worker_id].seq);
+    
+    // Global totals are summed by readers in copy_shared_stats(), Workers never write shared fields
     return 0;
 }
 
 /**
- * Initialize shared memory
+ * Update Worker process hardware counter metrics
  */
-int init_shared_memory(void) {
-    // Create configuration shared memory segment
-    g_config_shm_id = shmget(SHM_CONFIG_KEY, sizeof(shared_config_t), 
-                            IPC_CREAT | 0666);
-    if (g_config_shm_id == -1) {
-        log_error("Failed to create configuration shared memory segment: %s", strerror(errno));
+int update_worker_perf_stats(int worker_id, double ipc, double cache_misses_per_request,
+                             double branch_misses_per_request, double context_switches_per_sec) {
+    if (g_shared_stats == NULL || worker_id < 0 || worker_id >= SHM_MAX_WORKERS) {
         return -1;
     }
     
-    // Attach configuration shared memory
-    g_shared_config = (shared_config_t *)shmat(g_config_shm_id, NULL, 0);
-    if (g_shared_config == (void *)-1) {
-        log_error("Failed to attach configuration shared memory: %s", strerror(errno));
+    seqlock_write_begin(&g_shared_stats->workers[worker_id].seq);
+    
+    g_shared_stats->workers[worker_id].ipc = ipc;
+    g_shared_stats->workers[worker_id].cache_misses_per_request = cache_misses_per_request;
+    g_shared_stats->workers[worker_id].branch_misses_per_request = branch_misses_per_request;
+    g_shared_stats->workers[worker_id].context_switches_per_sec = context_switches_per_sec;
+    
+    seqlock_write_end(&g_shared_stats->workers[worker_id].seq);
+    
+    return 0;
+}
+
+/**
+ * Update Worker process allocation accounting metrics
+ */
+int update_worker_alloc_stats(int worker_id, const alloc_stats_snapshot_t *snapshot) {
+    if (g_shared_stats == NULL || snapshot == NULL || worker_id < 0 || worker_id >= SHM_MAX_WORKERS) {
         return -1;
     }
     
-    // Create statistics shared memory segment
-    g_stats_shm_id = shmget(SHM_STATS_KEY, sizeof(shared_stats_t), 
-                           IPC_CREAT | 0666);
-    if (g_stats_shm_id == -1) {
-        log_error("Failed to create statistics shared memory segment: %s", strerror(errno));
-        shmdt(g_shared_config);
-        return -1;
+    seqlock_write_begin(&g_shared_stats->workers[worker_id].seq);
+    
+    for (int i = 0; i < ALLOC_TAG_MAX; i++) {
+        g_shared_stats->workers[worker_id].allocs_per_request[i] = snapshot->tags[i].allocations_per_request;
+        g_shared_stats->workers[worker_id].alloc_bytes_per_request[i] = snapshot->tags[i].bytes_per_request;
+        g_shared_stats->workers[worker_id].alloc_live_bytes[i] = snapshot->tags[i].live_bytes;
     }
     
-    // Attach statistics shared memory
-    g_shared_stats = (shared_stats_t *)shmat(g_stats_shm_id, NULL, 0);
-    if (g_shared_stats == (void *)-1) {
-        log_error("Failed to attach statistics shared memory: %s", strerror(errno));
-        shmdt(g_shared_config);
+    seqlock_write_end(&g_shared_stats->workers[worker_id].seq);
+    
+    return 0;
+}
+
+/**
+ * Update Worker process per-route CPU time metrics
+ */
+int update_worker_route_stats(int worker_id) {
+    uint64_t requests[ROUTE_STATS_SLOTS];
+    uint64_t cpu_ns[ROUTE_STATS_SLOTS];
+    
+    if (g_shared_stats == NULL || worker_id < 0 || worker_id >= SHM_MAX_WORKERS) {
         return -1;
     }
     
-    // Create semaphores
-    g_config_sem_id = create_semaphore(SHM_CONFIG_KEY + 1000);
-    if (g_config_sem_id == -1) {
-        shmdt(g_shared_config);
-        shmdt(g_shared_stats);
-        return -1;
+    // Read counters before opening the write section, keeps it short for readers
+    for (int i = 0; i < ROUTE_STATS_SLOTS; i++) {
+        route_stats_get_slot(i, &requests[i], &cpu_ns[i]);
     }
     
-    g_stats_sem_id = create_semaphore(SHM_STATS_KEY + 1000);
-    if (g_stats_sem_id == -1) {
-        shmdt(g_shared_config);
-        shmdt(g_shared_stats);
+    seqlock_write_begin(&g_shared_stats->workers[worker_id].seq);
+    
+    memcpy(g_shared_stats->workers[worker_id].route_requests, requests, sizeof(requests));
+    memcpy(g_shared_stats->workers[worker_id].route_cpu_ns, cpu_ns, sizeof(cpu_ns));
+    
+    seqlock_write_end(&g_shared_stats->workers[worker_id].seq);
+    
+    return 0;
+}
+
+/**
+ * Update Worker process lock contention statistics
+ */
+int update_worker_lock_stats(int worker_id) {
+    static lock_profile_stats_t locks[LOCK_PROFILER_MAX_LOCKS];
+    
+    if (g_shared_stats == NULL || worker_id < 0 || worker_id >= SHM_MAX_WORKERS) {
         return -1;
     }
     
-    // Initialize shared memory content
-    if (lock_semaphore(g_config_sem_id) == 0) {
-        memset(g_shared_config, 0, sizeof(shared_config_t));
-        g_shared_config->version = 0;
-        g_shared_config->update_time = time(NULL);
-        unlock_semaphore(g_config_sem_id);
+    // Percentiles are computed here, outside the write section
+    int count = lock_profiler_get_stats(locks, LOCK_PROFILER_MAX_LOCKS);
+    if (count < 0) {
+        return -1;
+    }
+    if (count > SHM_LOCK_SLOTS) {
+        count = SHM_LOCK_SLOTS;
     }
     
-    if (lock_semaphore(g_stats_sem_id) == 0) {
-        memset(g_shared_stats, 0, sizeof(shared_stats_t));
-        g_shared_stats->start_time = time(NULL);
-        unlock_semaphore(g_stats_sem_id);
+    seqlock_write_begin(&g_shared_stats->workers[worker_id].seq);
+    
+    for (int i = 0; i < count; i++) {
+        const lock_profile_stats_t *l = &locks[i];
+        uint64_t n = l->acquisitions > 0 ? l->acquisitions : 1;
+        
+        memcpy(g_shared_stats->workers[worker_id].locks[i].name, l->name, LOCK_PROFILER_NAME_LEN);
+        g_shared_stats->workers[worker_id].locks[i].acquisitions = l->acquisitions;
+        g_shared_stats->workers[worker_id].locks[i].contended = l->contended;
+        g_shared_stats->workers[worker_id].locks[i].wait_avg_ns = l->total_wait_ns / n;
+        g_shared_stats->workers[worker_id].locks[i].wait_p50_ns = l->wait_p50_ns;
+        g_shared_stats->workers[worker_id].locks[i].wait_p99_ns = l->wait_p99_ns;
+        g_shared_stats->workers[worker_id].locks[i].wait_max_ns = l->max_wait_ns;
+        g_shared_stats->workers[worker_id].locks[i].hold_avg_ns = l->total_hold_ns / n;
+        g_shared_stats->workers[worker_id].locks[i].hold_p50_ns = l->hold_p50_ns;
+        g_shared_stats->workers[worker_id].locks[i].hold_p99_ns = l->hold_p99_ns;
+        g_shared_stats->workers[worker_id].locks[i].hold_max_ns = l->max_hold_ns;
     }
+    g_shared_stats->workers[worker_id].lock_count = (uint32_t)count;
+    
+    seqlock_write_end(&g_shared_stats->workers[worker_id].seq);
     
-    log_info("Shared memory initialized successfully");
     return 0;
 }
 
 /**
- * Clean up shared memory
+ * Update Worker process event loop and file cache state
  */
-void cleanup_shared_memory(void) {
-    // Detach shared memory
-    if (g_shared_config != NULL && g_shared_config != (void *)-1) {
-        shmdt(g_shared_config);
-        g_shared_config = NULL;
+int update_worker_runtime_stats(int worker_id, uint64_t loop_lag_us, double loop_utilization, int draining,
+                                uint64_t cache_bytes, uint64_t cache_max_bytes,
+                                uint64_t cache_hits, uint64_t cache_misses) {
+    if (g_shared_stats == NULL || worker_id < 0 || worker_id >= SHM_MAX_WORKERS) {
+        return -1;
     }
     
-    if (g_shared_stats != NULL && g_shared_stats != (void *)-1) {
-        shmdt(g_shared_stats);
-        g_shared_stats = NULL;
-    }
+    seqlock_write_begin(&g_shared_stats->workers[worker_id].seq);
     
-    // Delete shared memory segments
-    if (g_config_shm_id != -1) {
-        shmctl(g_config_shm_id, IPC_RMID, NULL);
-        g_config_shm_id = -1;
+    g_shared_stats->workers[worker_id].loop_lag_us = loop_lag_us;
+    if (loop_lag_us > g_shared_stats->workers[worker_id].loop_lag_peak_us) {
+        g_shared_stats->workers[worker_id].loop_lag_peak_us = loop_lag_us;
     }
+    g_shared_stats->workers[worker_id].loop_utilization = loop_utilization;
+    g_shared_stats->workers[worker_id].draining = draining;
+    g_shared_stats->workers[worker_id].cache_bytes = cache_bytes;
+    g_shared_stats->workers[worker_id].cache_max_bytes = cache_max_bytes;
+    g_shared_stats->workers[worker_id].cache_hits = cache_hits;
+    g_shared_stats->workers[worker_id].cache_misses = cache_misses;
+    
+    seqlock_write_end(&g_shared_stats->workers[worker_id].seq);
     
-    if (g_stats_shm_id != -1) {
-        shmctl(g_stats_shm_id, IPC_RMID, NULL);
-        g_stats_shm_id = -1;
+    return 0;
+}
+
+/**
+ * Update Worker pressure reaction counters
+ */
+int update_worker_pressure_stats(int worker_id, uint64_t reactions, uint64_t shed_requests) {
+    if (g_shared_stats == NULL || worker_id < 0 || worker_id >= SHM_MAX_WORKERS) {
+        return -1;
     }
     
-    // Delete semaphores
-    if (g_config_sem_id != -1) {
-        semctl(g_config_sem_id, 0, IPC_RMID);
-        g_config_sem_id = -1;
+    seqlock_write_begin(&g_shared_stats->workers[worker_id].seq);
+    
+    g_shared_stats->workers[worker_id].pressure_reactions = reactions;
+    g_shared_stats->workers[worker_id].shed_requests = shed_requests;
+    
+    seqlock_write_end(&g_shared_stats->workers[worker_id].seq);
+    
+    return 0;
+}
+
+/**
+ * Update Worker adaptive concurrency limit statistics
+ */
+int update_worker_limit_stats(int worker_id, uint32_t limit, uint32_t inflight, uint32_t waiting,
+                              uint64_t rejected, uint64_t queued, uint64_t expired) {
+    if (g_shared_stats == NULL || worker_id < 0 || worker_id >= SHM_MAX_WORKERS) {
+        return -1;
     }
     
-    if (g_stats_sem_id != -1) {
-        semctl(g_stats_sem_id, 0, IPC_RMID);
-        g_stats_sem_id = -1;
+    seqlock_write_begin(&g_shared_stats->workers[worker_id].seq);
+    
+    g_shared_stats->workers[worker_id].concurrency_limit = limit;
+    g_shared_stats->workers[worker_id].concurrency_inflight = inflight;
+    g_shared_stats->workers[worker_id].concurrency_waiting = waiting;
+    g_shared_stats->workers[worker_id].limit_rejected = rejected;
+    g_shared_stats->workers[worker_id].limit_queued = queued;
+    g_shared_stats->workers[worker_id].limit_expired = expired;
+    
+    seqlock_write_end(&g_shared_stats->workers[worker_id].seq);
+    
+    return 0;
+}
+
+/**
+ * Publish the pressure state
+ */
+int update_shared_pressure(const shared_pressure_t *pressure) {
+    if (g_shared_stats == NULL || pressure == NULL) {
+        return -1;
     }
     
-    log_info("Shared memory cleanup completed");
+    // The Master main thread is the only writer
+    seqlock_write_begin(&g_shared_stats->pressure.seq);
+    
+    g_shared_stats->pressure.memory_some = pressure->memory_some;
+    g_shared_stats->pressure.memory_full = pressure->memory_full;
+    g_shared_stats->pressure.cpu_some = pressure->cpu_some;
+    g_shared_stats->pressure.io_some = pressure->io_some;
+    memcpy(g_shared_stats->pressure.raised, pressure->raised, sizeof(pressure->raised));
+    g_shared_stats->pressure.since = pressure->since;
+    __atomic_store_n(&g_shared_stats->pressure.flags, pressure->flags, __ATOMIC_RELEASE);
+    
+    seqlock_write_end(&g_shared_stats->pressure.seq);
+    
+    return 0;
 }
 
+/**
+ * Read the pressure flags
+ */
+uint32_t get_shared_pressure_flags(void) {
+    if (g_shared_stats == NULL) {
+        return 0;
+    }
+    return __atomic_load_n(&g_shared_stats->pressure.flags, __ATOMIC_ACQUIRE);
+}
 
 /**
- * Update configuration in shared memory
+ * Post an admin command to a Worker
  */
-int update_shared_config(config_t *config) {
-    if (g_shared_config == NULL || config == NULL) {
-        log_error("Shared configuration memory not initialized or configuration is empty");
+int post_worker_command(int worker_id, worker_command_t command, int arg, uint32_t *seq) {
+    if (g_shared_stats == NULL || worker_id < 0 || worker_id >= SHM_MAX_WORKERS) {
         return -1;
     }
     
-    if (lock_semaphore(g_config_sem_id) != 0) {
+    // The Master main thread is the only mailbox writer
+    seqlock_write_begin(&g_shared_stats->workers[worker_id].command_lock);
+    
+    g_shared_stats->workers[worker_id].command = (int)command;
+    g_shared_stats->workers[worker_id].command_arg = arg;
+    
+    // Publish the sequence last so the Worker's check sees a complete command
+    uint32_t next = g_shared_stats->workers[worker_id].command_seq + 1;
+    __atomic_store_n(&g_shared_stats->workers[worker_id].command_seq, next, __ATOMIC_RELEASE);
+    
+    seqlock_write_end(&g_shared_stats->workers[worker_id].command_lock);
+    
+    if (seq) {
+        *seq = next;
+    }
+    return 0;
+}
+
+/**
+ * Wait until a Worker acknowledges a command
+ */
+int wait_worker_command(int worker_id, uint32_t seq, int timeout_ms, int *result) {
+    if (g_shared_stats == NULL || worker_id < 0 || worker_id >= SHM_MAX_WORKERS) {
         return -1;
     }
     
-    // Update configuration version and time
-    g_shared_config->version++;
-    g_shared_config->update_time = time(NULL);
+    for (int waited = 0; ; waited += 10) {
+        uint32_t ack = __atomic_load_n(&g_shared_stats->workers[worker_id].command_ack, __ATOMIC_ACQUIRE);
+        if ((int32_t)(ack - seq) >= 0) {
+            if (result) {
+                *result = g_shared_stats->workers[worker_id].command_result;
+            }
+            return 0;
+        }
+        if (waited >= timeout_ms) {
+            break;
+        }
+        usleep(10000);
+    }
     
-    // Copy configuration content (Note: only copy basic configuration, excluding dynamically allocated memory)
-    memcpy(&g_shared_config->config, config, sizeof(config_t));
+    return -1;
+}
+
+/**
+ * Fetch a pending admin command for this Worker
+ */
+int fetch_worker_command(int worker_id, uint32_t *seq, worker_command_t *command, int *arg) {
+    if (g_shared_stats == NULL || worker_id < 0 || worker_id >= SHM_MAX_WORKERS) {
+        return 0;
+    }
     
-    // For dynamic content like routes, special handling is required
-    // Simplified handling here, actual applications may need more complex serialization mechanisms
-    if (config->route_count > 0 && config->route_count <= MAX_ROUTES) {
-        for (int i = 0; i < config->route_count; i++) {
-            // Copy route basic information
-            g_shared_config->config.routes[i] = config->routes[i];
-            
-            // Copy strings (limit length to fit in shared memory)
-            if (strlen(config->routes[i].path_prefix) > 0) {
-                strncpy(g_shared_config->config.routes[i].path_prefix, 
-                       config->routes[i].path_prefix, 255);
-                g_shared_config->config.routes[i].path_prefix[255] = '\0';
-            }
-            
-            if (strlen(config->routes[i].target_host) > 0) {
-                strncpy(g_shared_config->config.routes[i].target_host, 
-                       config->routes[i].target_host, 255);
-                g_shared_config->config.routes[i].target_host[255] = '\0';
-            }
-            
-            if (strlen(config->routes[i].local_path) > 0) {
-                strncpy(g_shared_config->config.routes[i].local_path, 
-                       config->routes[i].local_path, 511);
-                g_shared_config->config.routes[i].local_path[511] = '\0';
-            }
-            
-            if (strlen(config->routes[i].charset) > 0) {
-                strncpy(g_shared_config->config.routes[i].charset, 
-                       config->routes[i].charset, 31);
-                g_shared_config->config.routes[i].charset[31] = '\0';
-            }
+    // Cheap check first, this runs on every Worker main loop iteration
+    uint32_t pending = __atomic_load_n(&g_shared_stats->workers[worker_id].command_seq, __ATOMIC_ACQUIRE);
+    if (pending == __atomic_load_n(&g_shared_stats->workers[worker_id].command_ack, __ATOMIC_RELAXED)) {
+        return 0;
+    }
+    
+    // Sequence, command and argument must come from the same post
+    struct {
+        uint32_t seq;
+        int command;
+        int arg;
+    } mailbox;
+    const uint32_t *lock = &g_shared_stats->workers[worker_id].command_lock;
+    for (int attempt = 0; attempt < SEQLOCK_READ_RETRIES; attempt++) {
+        uint32_t start = __atomic_load_n(lock, __ATOMIC_ACQUIRE);
+        if (start & 1) {
+            sched_yield();
+            continue;
+        }
+        mailbox.seq = g_shared_stats->workers[worker_id].command_seq;
+        mailbox.command = g_shared_stats->workers[worker_id].command;
+        mailbox.arg = g_shared_stats->workers[worker_id].command_arg;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(lock, __ATOMIC_RELAXED) == start) {
+            *seq = mailbox.seq;
+            *command = (worker_command_t)mailbox.command;
+            *arg = mailbox.arg;
+            return 1;
         }
     }
     
-    unlock_semaphore(g_config_sem_id);
+    // The Master is posting right now, pick it up on the next iteration
+    return 0;
+}
+
+/**
+ * Acknowledge an admin command
+ */
+int ack_worker_command(int worker_id, uint32_t seq, int result) {
+    if (g_shared_stats == NULL || worker_id < 0 || worker_id >= SHM_MAX_WORKERS) {
+        return -1;
+    }
+    
+    // The result is published by the release store of the acknowledgement
+    g_shared_stats->workers[worker_id].command_result = result;
+    __atomic_store_n(&g_shared_stats->workers[worker_id].command_ack, seq, __ATOMIC_RELEASE);
     
-    log_info("Shared configuration updated successfully, version: %d", g_shared_config->version);
     return 0;
 }
 
 /**
- * Get configuration from shared memory
+ * Reset a Worker slot for a newly started Worker
  */
-config_t *get_shared_config(void) {
-    if (g_shared_config == NULL) {
-        log_error("Shared configuration memory not initialized");
-        return NULL;
+int reset_worker_slot(int worker_id) {
+    if (g_shared_stats == NULL || worker_id < 0 || worker_id >= SHM_MAX_WORKERS) {
+        return -1;
     }
     
-    if (lock_semaphore(g_config_sem_id) != 0) {
-        return NULL;
+    // A previous occupant killed inside a write section leaves the sequence odd
+    uint32_t *seq = &g_shared_stats->workers[worker_id].seq;
+    if (*seq & 1) {
+        __atomic_store_n(seq, *seq + 1, __ATOMIC_RELEASE);
     }
     
-    // Copy configuration
-    config_t *config = duplicate_config(&g_shared_config->config);
+    seqlock_write_begin(seq);
+    
+    // Commands posted to the previous occupant are dropped
+    g_shared_stats->workers[worker_id].command_ack = g_shared_stats->workers[worker_id].command_seq;
+    g_shared_stats->workers[worker_id].loop_lag_us = 0;
+    g_shared_stats->workers[worker_id].loop_lag_peak_us = 0;
+    g_shared_stats->workers[worker_id].loop_utilization = 0.0;
+    g_shared_stats->workers[worker_id].draining = 0;
+    g_shared_stats->workers[worker_id].pressure_reactions = 0;
+    g_shared_stats->workers[worker_id].shed_requests = 0;
+    g_shared_stats->workers[worker_id].concurrency_limit = 0;
+    g_shared_stats->workers[worker_id].concurrency_inflight = 0;
+    g_shared_stats->workers[worker_id].concurrency_waiting = 0;
+    g_shared_stats->workers[worker_id].limit_rejected = 0;
+    g_shared_stats->workers[worker_id].limit_queued = 0;
+    g_shared_stats->workers[worker_id].limit_expired = 0;
+    g_shared_stats->workers[worker_id].lock_count = 0;
+    __atomic_store_n(&g_shared_stats->workers[worker_id].heartbeat_ms, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_shared_stats->workers[worker_id].loop_iterations, 0, __ATOMIC_RELAXED);
+    
+    seqlock_write_end(seq);
     
-    unlock_semaphore(g_config_sem_id);
+    return 0;
+}
+
+/**
+ * Get the addresses of a Worker's heartbeat fields
+ */
+int get_worker_heartbeat_slot(int worker_id, uint64_t **heartbeat_ms, uint64_t **loop_iterations) {
+    if (g_shared_stats == NULL || worker_id < 0 || worker_id >= SHM_MAX_WORKERS) {
+        return -1;
+    }
     
-    return config;
+    // Written outside the seqlock, each field is a single atomic store and readers tolerate a stale value
+    *heartbeat_ms = &g_shared_stats->workers[worker_id].heartbeat_ms;
+    *loop_iterations = &g_shared_stats->workers[worker_id].loop_iterations;
+    
+    return 0;
 }
 
 /**
- * Update Worker process statistics
+ * Read a Worker's heartbeat
  */
-int update_worker_stats(int worker_id, pid_t pid, uint64_t requests, 
-                       uint64_t bytes_sent, uint64_t bytes_received, 
-                       uint32_t active_connections) {
-    if (g_shared_stats == NULL || worker_id < 0 || worker_id >= 32) {
+int read_worker_heartbeat(int worker_id, uint64_t *heartbeat_ms, uint64_t *loop_iterations) {
+    if (g_shared_stats == NULL || worker_id < 0 || worker_id >= SHM_MAX_WORKERS) {
         return -1;
     }
     
-    if (lock_semaphore(g_stats_sem_id) != 0) {
+    *heartbeat_ms = __atomic_load_n(&g_shared_stats->workers[worker_id].heartbeat_ms, __ATOMIC_RELAXED);
+    *loop_iterations = __atomic_load_n(&g_shared_stats->workers[worker_id].loop_iterations, __ATOMIC_RELAXED);
+    
+    return 0;
+}
+
+/**
+ * Fold an exited Worker's counters into the retired totals and clear its slot
+ */
+int retire_worker_slot(int worker_id) {
+    if (g_shared_stats == NULL || worker_id < 0 || worker_id >= SHM_MAX_WORKERS) {
         return -1;
     }
     
-    // Update Worker statistics
-    g_shared_stats->workers[worker_id].pid = pid;
-    g_shared_stats->workers[worker_id].requests = requests;
-    g_shared_stats->workers[worker_id].bytes_sent = bytes_sent;
-    g_shared_stats->workers[worker_id].bytes_received = bytes_received;
-    g_shared_stats->workers[worker_id].active_connections = active_connections;
-    g_shared_stats->workers[worker_id].last_update = time(NULL);
+    uint32_t *seq = &g_shared_stats->workers[worker_id].seq;
+    if (*seq & 1) {
+        __atomic_store_n(seq, *seq + 1, __ATOMIC_RELEASE);
+    }
     
-    // Update global statistics
-    g_shared_stats->total_requests = 0;
-    g_shared_stats->total_bytes_sent = 0;
-    g_shared_stats->total_bytes_received = 0;
-    g_shared_stats->active_connections = 0;
-    
-    for (int i = 0; i < 32; i++) {
-        if (g_shared_stats->workers[i].pid > 0) {
-            g_shared_stats->total_requests += g_shared_stats->workers[i].requests;
-            g_shared_stats->total_bytes_sent += g_shared_stats->workers[i].bytes_sent;
-            g_shared_stats->total_bytes_received += g_shared_stats->workers[i].bytes_received;
-            g_shared_stats->active_connections += g_shared_stats->workers[i].active_connections;
-        }
+    seqlock_write_begin(seq);
+    
+    if (g_shared_stats->workers[worker_id].pid > 0) {
+        g_retired_requests += g_shared_stats->workers[worker_id].requests;
+        g_retired_bytes_sent += g_shared_stats->workers[worker_id].bytes_sent;
+        g_retired_bytes_received += g_shared_stats->workers[worker_id].bytes_received;
     }
+    g_shared_stats->workers[worker_id].pid = 0;
+    g_shared_stats->workers[worker_id].requests = 0;
+    g_shared_stats->workers[worker_id].bytes_sent = 0;
+    g_shared_stats->workers[worker_id].bytes_received = 0;
+    g_shared_stats->workers[worker_id].active_connections = 0;
     
-    unlock_semaphore(g_stats_sem_id);
+    seqlock_write_end(seq);
+    
+    return 0;
+}
+
+/**
+ * Copy shared statistics, one consistent snapshot per Worker slot
+ */
+int copy_shared_stats(shared_stats_t *out) {
+    if (g_shared_stats == NULL || out == NULL) {
+        return -1;
+    }
+    
+    out->start_time = g_shared_stats->start_time;
+    out->worker_count = g_shared_stats->worker_count;
+    out->total_connections = g_shared_stats->total_connections;
+    out->total_requests = g_retired_requests;
+    out->total_bytes_sent = g_retired_bytes_sent;
+    out->total_bytes_received = g_retired_bytes_received;
+    out->active_connections = 0;
+    seqlock_read(&g_shared_stats->pressure.seq, &out->pressure, &g_shared_stats->pressure, sizeof(out->pressure));
+    
+    for (int i = 0; i < SHM_MAX_WORKERS; i++) {
+        seqlock_read(&g_shared_stats->workers[i].seq, &out->workers[i], &g_shared_stats->workers[i],
+                     sizeof(out->workers[i]));
+    
+        if (out->workers[i].pid > 0) {
+            out->total_requests += out->workers[i].requests;
+            out->total_bytes_sent += out->workers[i].bytes_sent;
+            out->total_bytes_received += out->workers[i].bytes_received;
+            out->active_connections += out->workers[i].active_connections;
+        }
+    }
     
     return 0;
 }
@@ -317,4 +657,4 @@ int update_worker_stats(int worker_id, pid_t pid, uint64_t requests,
  */
 shared_stats_t *get_shared_stats(void) {
     return g_shared_stats;
-}
\ No newline at end of file
+}
@@ -1,225 +1,710 @@
 /**
  * Thread Pool Implementation Module
+ * Work-stealing pool: per-thread Chase-Lev deques, a bounded MPMC injector for outside submitters,
+ * and eventfd completion channels that hand results back to the submitting event loop
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <sys/eventfd.h>
 #include "../include/thread_pool.h"
 #include "../include/logger.h"
 
-// Task structure
-typedef struct {
-    void (*function)(void *);  // Task function
-    void *argument;            // Task argument
+#define CACHE_LINE 64
+
+// Completion nodes a channel keeps for reuse instead of returning them to malloc
+#define CHANNEL_FREE_MAX 1024
+
+// Shutdown states
+#define POOL_RUNNING  0
+#define POOL_DRAIN    1
+#define POOL_STOP_NOW 2
+
+// Task structure, also the completion node once the function ran
+typedef struct thread_pool_task {
+    void (*function)(void *);       // Task function
+    void *argument;                 // Task argument
+    void (*completion)(void *);     // Completion callback, run on the channel's loop
+    offload_channel_t *channel;     // Completion channel, NULL for fire-and-forget tasks
+    struct thread_pool_task *next;  // Completion stack or channel free list
 } thread_pool_task_t;
 
+// Chase-Lev deque: the owner pushes and pops at the bottom, thieves take from the top
+typedef struct {
+    atomic_long top;
+    char pad_top[CACHE_LINE - sizeof(atomic_long)];
+    atomic_long bottom;
+    char pad_bottom[CACHE_LINE - sizeof(atomic_long)];
+    _Atomic(thread_pool_task_t *) buffer[THREAD_POOL_DEQUE_SIZE];
+} task_deque_t;
+
+// Injector cell, the sequence tells producers and consumers whose turn the cell is
+typedef struct {
+    atomic_size_t sequence;
+    thread_pool_task_t *task;
+} injector_cell_t;
+
+// Per-thread state
+typedef struct {
+    thread_pool_t *pool;
+    pthread_t thread;
+    int index;
+    uint64_t executed;              // Owner only, read after join
+    uint64_t stolen;
+    task_deque_t deque;
+} pool_thread_t;
+
 // Thread pool structure
 struct thread_pool {
-    pthread_mutex_t lock;           // Mutex lock
-    pthread_cond_t notify;          // Condition variable
-    pthread_t *threads;             // Worker threads array
-    thread_pool_task_t *queue;      // Task queue
+    pool_thread_t *threads;         // Worker threads array
     int thread_count;               // Thread count
-    int queue_size;                 // Queue size
-    int head;                       // Queue head
-    int tail;                       // Queue tail
-    int count;                      // Current task count
-    int shutdown;                   // Shutdown flag
     int started;                    // Started thread count
+    injector_cell_t *injector;      // Global injector ring
+    size_t injector_mask;
+    atomic_size_t enqueue_pos;
+    char pad_enqueue[CACHE_LINE - sizeof(atomic_size_t)];
+    atomic_size_t dequeue_pos;
+    char pad_dequeue[CACHE_LINE - sizeof(atomic_size_t)];
+    atomic_int sleepers;            // Threads registered to sleep and not yet claimed by a waker
+    atomic_int shutdown;            // Shutdown state
+    sem_t wake;                     // One post per claimed sleeper
 };
 
-// Thread worker function
-static void *thread_worker(void *arg) {
-    thread_pool_t *pool = (thread_pool_t *)arg;
-    thread_pool_task_t task;
+// Completion channel structure
+struct offload_channel {
+    event_loop_t *loop;
+    int event_fd;
+    _Atomic(thread_pool_task_t *) completed;   // Completed tasks, pushed by pool threads
+    thread_pool_task_t *free_tasks;            // Reusable nodes, loop thread only
+    int free_count;
+};
+
+// Pool thread running on this thread, NULL outside pool threads
+static __thread pool_thread_t *t_self = NULL;
+
+// Pool and channel used by offload() in this process
+static thread_pool_t *g_offload_pool = NULL;
+static offload_channel_t *g_offload_channel = NULL;
+
+// Push at the bottom, owner only; -1 when the deque is full
+static int deque_push(task_deque_t *deque, thread_pool_task_t *task) {
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    if (bottom - top >= THREAD_POOL_DEQUE_SIZE) {
+        return -1;
+    }
+    atomic_store_explicit(&deque->buffer[bottom % THREAD_POOL_DEQUE_SIZE], task, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    return 0;
+}
+
+// Pop at the bottom, owner only
+static thread_pool_task_t *deque_pop(task_deque_t *deque) {
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (top > bottom) {
+        // Empty
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    thread_pool_task_t *task = atomic_load_explicit(&deque->buffer[bottom % THREAD_POOL_DEQUE_SIZE],
+                                                    memory_order_relaxed);
+    if (top == bottom) {
+        // Last task, race the thieves for it
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                     memory_order_seq_cst, memory_order_relaxed)) {
+            task = NULL;
+        }
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+// Take from the top, any thread
+static thread_pool_task_t *deque_steal(task_deque_t *deque) {
+    for (;;) {
+        long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+        atomic_thread_fence(memory_order_seq_cst);
+        long bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+        if (top >= bottom) {
+            return NULL;
+        }
+
+        thread_pool_task_t *task = atomic_load_explicit(&deque->buffer[top % THREAD_POOL_DEQUE_SIZE],
+                                                        memory_order_relaxed);
+        if (atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                    memory_order_seq_cst, memory_order_relaxed)) {
+            return task;
+        }
+        // Lost to the owner or another thief, look again
+    }
+}
+
+// Bounded MPMC enqueue; -1 when the injector is full
+static int injector_push(thread_pool_t *pool, thread_pool_task_t *task) {
+    size_t pos = atomic_load_explicit(&pool->enqueue_pos, memory_order_relaxed);
+    injector_cell_t *cell;
+
+    for (;;) {
+        cell = &pool->injector[pos & pool->injector_mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&pool->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return -1;
+        } else {
+            pos = atomic_load_explicit(&pool->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    cell->task = task;
+    atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+    return 0;
+}
+
+// Bounded MPMC dequeue; NULL when the injector is empty
+static thread_pool_task_t *injector_pop(thread_pool_t *pool) {
+    size_t pos = atomic_load_explicit(&pool->dequeue_pos, memory_order_relaxed);
+    injector_cell_t *cell;
+
+    for (;;) {
+        cell = &pool->injector[pos & pool->injector_mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&pool->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return NULL;
+        } else {
+            pos = atomic_load_explicit(&pool->dequeue_pos, memory_order_relaxed);
+        }
+    }
+
+    thread_pool_task_t *task = cell->task;
+    atomic_store_explicit(&cell->sequence, pos + pool->injector_mask + 1, memory_order_release);
+    return task;
+}
+
+// Wake one sleeping thread, if any
+static void wake_one(thread_pool_t *pool) {
+    // Pairs with the sleeper's registration before its final look at the queues
+    atomic_thread_fence(memory_order_seq_cst);
+    int sleepers = atomic_load(&pool->sleepers);
+    while (sleepers > 0) {
+        if (atomic_compare_exchange_weak(&pool->sleepers, &sleepers, sleepers - 1)) {
+            sem_post(&pool->wake);
+            return;
+        }
+    }
+}
 
-    while (1) {
-        // Get task
-        pthread_mutex_lock(&(pool->lock));
+// Queue a task: pool threads keep their own submissions local, everyone else goes through the injector
+static int pool_enqueue(thread_pool_t *pool, thread_pool_task_t *task) {
+    if (atomic_load(&pool->shutdown) != POOL_RUNNING) {
+        return THREAD_POOL_SHUTDOWN;
+    }
 
-        // Wait for task or shutdown signal
-        while ((pool->count == 0) && (!pool->shutdown)) {
-            pthread_cond_wait(&(pool->notify), &(pool->lock));
+    if (t_self == NULL || t_self->pool != pool || deque_push(&t_self->deque, task) != 0) {
+        if (injector_push(pool, task) != 0) {
+            return THREAD_POOL_QUEUE_FULL;
         }
+    }
+
+    wake_one(pool);
+    return THREAD_POOL_SUCCESS;
+}
 
-        // Check if thread needs to be shut down
-        if ((pool->shutdown == 1) && (pool->count == 0)) {
+// Next task for a pool thread: own deque, then the injector, then steal from the others
+static thread_pool_task_t *find_task(thread_pool_t *pool, pool_thread_t *self) {
+    thread_pool_task_t *task = deque_pop(&self->deque);
+    if (task != NULL) {
+        return task;
+    }
+
+    task = injector_pop(pool);
+    if (task != NULL) {
+        return task;
+    }
+
+    for (int i = 1; i < pool->thread_count; i++) {
+        pool_thread_t *victim = &pool->threads[(self->index + i) % pool->thread_count];
+        task = deque_steal(&victim->deque);
+        if (task != NULL) {
+            self->stolen++;
+            return task;
+        }
+    }
+    return NULL;
+}
+
+// Hand a finished task to its channel's loop
+static void channel_deliver(offload_channel_t *channel, thread_pool_task_t *task) {
+    thread_pool_task_t *head = atomic_load_explicit(&channel->completed, memory_order_relaxed);
+    do {
+        task->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&channel->completed, &head, task,
+                                                    memory_order_release, memory_order_relaxed));
+
+    // Only the push onto an empty stack signals, the loop takes the whole stack at once
+    if (head == NULL) {
+        uint64_t one = 1;
+        if (write(channel->event_fd, &one, sizeof(one)) != sizeof(one)) {
+            log_error("Failed to signal offload completion: %s", strerror(errno));
+        }
+    }
+}
+
+// Run a task and pass it on
+static void run_task(thread_pool_task_t *task) {
+    task->function(task->argument);
+    if (task->channel != NULL) {
+        channel_deliver(task->channel, task);
+    } else {
+        free(task);
+    }
+}
+
+// Sleep until woken; returns at once when work or shutdown turns up after registering
+static void idle_wait(thread_pool_t *pool, pool_thread_t *self) {
+    atomic_fetch_add(&pool->sleepers, 1);
+
+    // A submitter that queued before the registration is visible here
+    thread_pool_task_t *task = find_task(pool, self);
+    if (task == NULL && atomic_load(&pool->shutdown) == POOL_RUNNING) {
+        while (sem_wait(&pool->wake) != 0 && errno == EINTR) {
+        }
+        return;
+    }
+
+    // Withdraw the registration, unless a waker already claimed it and its post is on the way
+    int sleepers = atomic_load(&pool->sleepers);
+    for (;;) {
+        if (sleepers <= 0) {
+            while (sem_wait(&pool->wake) != 0 && errno == EINTR) {
+            }
+            break;
+        }
+        if (atomic_compare_exchange_weak(&pool->sleepers, &sleepers, sleepers - 1)) {
             break;
         }
+    }
+
+    if (task != NULL) {
+        run_task(task);
+        self->executed++;
+    }
+}
 
-        // Get task
-        task.function = pool->queue[pool->head].function;
-        task.argument = pool->queue[pool->head].argument;
-        pool->head = (pool->head + 1) % pool->queue_size;
-        pool->count--;
+// Thread worker function
+static void *thread_worker(void *arg) {
+    pool_thread_t *self = (pool_thread_t *)arg;
+    thread_pool_t *pool = self->pool;
+    t_self = self;
 
-        pthread_mutex_unlock(&(pool->lock));
+    for (;;) {
+        int state = atomic_load(&pool->shutdown);
+        if (state == POOL_STOP_NOW) {
+            break;
+        }
 
-        // Execute task
-        (*(task.function))(task.argument);
+        thread_pool_task_t *task = find_task(pool, self);
+        if (task != NULL) {
+            run_task(task);
+            self->executed++;
+            continue;
+        }
+
+        // Draining and nothing left to take
+        if (state == POOL_DRAIN) {
+            break;
+        }
+        idle_wait(pool, self);
     }
 
-    // Thread exit
-    pool->started--;
-    pthread_mutex_unlock(&(pool->lock));
-    pthread_exit(NULL);
+    t_self = NULL;
     return NULL;
 }
 
 // Create thread pool
 thread_pool_t *thread_pool_create(int thread_count, int queue_size) {
-    thread_pool_t *pool;
-    int i;
-
     // Check parameters
     if (thread_count <= 0 || queue_size <= 0) {
         return NULL;
     }
 
-    // Allocate memory
-    pool = (thread_pool_t *)malloc(sizeof(thread_pool_t));
+    thread_pool_t *pool = (thread_pool_t *)calloc(1, sizeof(thread_pool_t));
     if (pool == NULL) {
         log_error("Failed to allocate thread pool memory");
         return NULL;
     }
 
-    // Initialize thread pool
-    pool->thread_count = thread_count;
-    pool->queue_size = queue_size;
-    pool->head = pool->tail = pool->count = 0;
-    pool->shutdown = pool->started = 0;
+    // Injector capacity is a power of two so positions map to cells with a mask
+    size_t capacity = 2;
+    while (capacity < (size_t)queue_size) {
+        capacity <<= 1;
+    }
 
-    // Allocate thread and task queue memory
-    pool->threads = (pthread_t *)malloc(sizeof(pthread_t) * thread_count);
-    pool->queue = (thread_pool_task_t *)malloc(sizeof(thread_pool_task_t) * queue_size);
+    pool->thread_count = thread_count;
+    pool->injector_mask = capacity - 1;
+    pool->threads = (pool_thread_t *)aligned_alloc(CACHE_LINE,
+        ((sizeof(pool_thread_t) * (size_t)thread_count + CACHE_LINE - 1) / CACHE_LINE) * CACHE_LINE);
+    pool->injector = (injector_cell_t *)malloc(sizeof(injector_cell_t) * capacity);
 
-    // Check memory allocation
-    if (pool->threads == NULL || pool->queue == NULL) {
+    if (pool->threads == NULL || pool->injector == NULL) {
         log_error("Failed to allocate thread pool queue memory");
-        if (pool->threads) free(pool->threads);
-        if (pool->queue) free(pool->queue);
+        free(pool->threads);
+        free(pool->injector);
         free(pool);
         return NULL;
     }
 
-    // Initialize mutex and condition variable
-    if (pthread_mutex_init(&(pool->lock), NULL) != 0 ||
-        pthread_cond_init(&(pool->notify), NULL) != 0) {
-        log_error("Failed to initialize thread pool lock or condition variable");
+    memset(pool->threads, 0, sizeof(pool_thread_t) * (size_t)thread_count);
+    for (size_t i = 0; i < capacity; i++) {
+        atomic_init(&pool->injector[i].sequence, i);
+        pool->injector[i].task = NULL;
+    }
+    atomic_init(&pool->enqueue_pos, 0);
+    atomic_init(&pool->dequeue_pos, 0);
+    atomic_init(&pool->sleepers, 0);
+    atomic_init(&pool->shutdown, POOL_RUNNING);
+
+    if (sem_init(&pool->wake, 0, 0) != 0) {
+        log_error("Failed to initialize thread pool semaphore: %s", strerror(errno));
         free(pool->threads);
-        free(pool->queue);
+        free(pool->injector);
         free(pool);
         return NULL;
     }
 
-    // Create worker threads
-    for (i = 0; i < thread_count; i++) {
-        if (pthread_create(&(pool->threads[i]), NULL, thread_worker, (void*)pool) != 0) {
-            thread_pool_destroy(pool, 0);
+    // Pool threads never take process signals, those belong to the Worker's own threads
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+
+    for (int i = 0; i < thread_count; i++) {
+        pool_thread_t *self = &pool->threads[i];
+        self->pool = pool;
+        self->index = i;
+        atomic_init(&self->deque.top, 0);
+        atomic_init(&self->deque.bottom, 0);
+        if (pthread_create(&self->thread, NULL, thread_worker, self) != 0) {
+            log_error("Failed to create thread pool thread %d", i);
+            pthread_sigmask(SIG_SETMASK, &previous, NULL);
+            thread_pool_destroy(pool, 1);
             return NULL;
         }
         pool->started++;
         log_debug("Thread pool created worker thread %d", i);
     }
 
-    log_info("Thread pool initialized successfully, thread count: %d, queue size: %d", thread_count, queue_size);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    log_info("Thread pool initialized successfully, thread count: %d, queue size: %zu", thread_count, capacity);
     return pool;
 }
 
 // Add task to thread pool
 int thread_pool_add(thread_pool_t *pool, void (*function)(void *), void *argument) {
-    int err = 0;
-    int next;
-
     if (pool == NULL || function == NULL) {
         return THREAD_POOL_INVALID;
     }
 
-    // Acquire lock
-    if (pthread_mutex_lock(&(pool->lock)) != 0) {
-        return THREAD_POOL_LOCK_FAILURE;
+    thread_pool_task_t *task = (thread_pool_task_t *)malloc(sizeof(thread_pool_task_t));
+    if (task == NULL) {
+        return THREAD_POOL_INVALID;
     }
+    task->function = function;
+    task->argument = argument;
+    task->completion = NULL;
+    task->channel = NULL;
+    task->next = NULL;
+
+    int err = pool_enqueue(pool, task);
+    if (err != THREAD_POOL_SUCCESS) {
+        if (err == THREAD_POOL_QUEUE_FULL) {
+            log_warn("Thread pool queue is full");
+        }
+        free(task);
+    }
+    return err;
+}
 
-    // Calculate next available position
-    next = (pool->tail + 1) % pool->queue_size;
+// Take a completion node from the channel, loop thread only
+static thread_pool_task_t *channel_task_get(offload_channel_t *channel) {
+    thread_pool_task_t *task = channel->free_tasks;
+    if (task != NULL) {
+        channel->free_tasks = task->next;
+        channel->free_count--;
+        return task;
+    }
+    return (thread_pool_task_t *)malloc(sizeof(thread_pool_task_t));
+}
 
-    // Check if queue is full
-    if (pool->count == pool->queue_size) {
-        err = THREAD_POOL_QUEUE_FULL;
-        log_warn("Thread pool queue is full");
+// Return a completion node to the channel, loop thread only
+static void channel_task_put(offload_channel_t *channel, thread_pool_task_t *task) {
+    if (channel->free_count >= CHANNEL_FREE_MAX) {
+        free(task);
+        return;
     }
-    // Check if thread pool is shut down
-    else if (pool->shutdown) {
-        err = THREAD_POOL_SHUTDOWN;
+    task->next = channel->free_tasks;
+    channel->free_tasks = task;
+    channel->free_count++;
+}
+
+// Submit a task whose completion runs on the channel's loop
+int thread_pool_submit(thread_pool_t *pool, offload_channel_t *channel,
+                       void (*function)(void *), void *argument, void (*completion)(void *)) {
+    if (channel == NULL || function == NULL) {
+        return THREAD_POOL_INVALID;
     }
-    // Add task to queue
-    else {
-        pool->queue[pool->tail].function = function;
-        pool->queue[pool->tail].argument = argument;
-        pool->tail = next;
-        pool->count++;
 
-        // Notify worker threads
-        if (pthread_cond_signal(&(pool->notify)) != 0) {
-            err = THREAD_POOL_LOCK_FAILURE;
-        }
+    thread_pool_task_t *task = channel_task_get(channel);
+    if (task == NULL) {
+        return THREAD_POOL_INVALID;
     }
+    task->function = function;
+    task->argument = argument;
+    task->completion = completion;
+    task->channel = channel;
+    task->next = NULL;
 
-    // Release lock
-    if (pthread_mutex_unlock(&(pool->lock)) != 0) {
-        err = THREAD_POOL_LOCK_FAILURE;
+    if (pool == NULL) {
+        // No pool threads: run here, the completion still comes from the loop like an offloaded one
+        run_task(task);
+        return THREAD_POOL_SUCCESS;
     }
 
+    int err = pool_enqueue(pool, task);
+    if (err != THREAD_POOL_SUCCESS) {
+        channel_task_put(channel, task);
+    }
     return err;
 }
 
 // Destroy thread pool
 int thread_pool_destroy(thread_pool_t *pool, int flags) {
-    int i, err = 0;
+    int err = 0;
 
     if (pool == NULL) {
         return THREAD_POOL_INVALID;
     }
 
-    // Acquire lock
-    if (pthread_mutex_lock(&(pool->lock)) != 0) {
-        return THREAD_POOL_LOCK_FAILURE;
+    int expected = POOL_RUNNING;
+    if (!atomic_compare_exchange_strong(&pool->shutdown, &expected, flags ? POOL_STOP_NOW : POOL_DRAIN)) {
+        return THREAD_POOL_SHUTDOWN;
     }
 
-    // Check if thread pool is already shut down
-    if (pool->shutdown) {
-        err = THREAD_POOL_SHUTDOWN;
+    // Wake every registered sleeper, later ones see the shutdown state before sleeping
+    int sleepers = atomic_exchange(&pool->sleepers, 0);
+    for (int i = 0; i < sleepers; i++) {
+        sem_post(&pool->wake);
     }
-    else {
-        // Set shutdown flag
-        pool->shutdown = 1;
 
-        // Wake up all worker threads
-        if ((pthread_cond_broadcast(&(pool->notify)) != 0) ||
-            (pthread_mutex_unlock(&(pool->lock)) != 0)) {
-            err = THREAD_POOL_LOCK_FAILURE;
-            return err;
+    // Wait for all threads to complete
+    uint64_t executed = 0;
+    uint64_t stolen = 0;
+    for (int i = 0; i < pool->started; i++) {
+        if (pthread_join(pool->threads[i].thread, NULL) != 0) {
+            err = THREAD_POOL_THREAD_FAILURE;
         }
+        executed += pool->threads[i].executed;
+        stolen += pool->threads[i].stolen;
+    }
 
-        // Wait for all threads to complete
-        for (i = 0; i < pool->thread_count; i++) {
-            if (pthread_join(pool->threads[i], NULL) != 0) {
-                err = THREAD_POOL_THREAD_FAILURE;
-            }
+    // Tasks left behind by an immediate shutdown never run
+    int dropped = 0;
+    thread_pool_task_t *task;
+    while ((task = injector_pop(pool)) != NULL) {
+        free(task);
+        dropped++;
+    }
+    for (int i = 0; i < pool->started; i++) {
+        while ((task = deque_steal(&pool->threads[i].deque)) != NULL) {
+            free(task);
+            dropped++;
         }
     }
 
-    // Release resources
-    if (!err || flags) {
-        pthread_mutex_destroy(&(pool->lock));
-        pthread_cond_destroy(&(pool->notify));
-        free(pool->threads);
-        free(pool->queue);
-        free(pool);
-    }
+    log_info("Thread pool stopped: %lu tasks executed, %lu stolen, %d dropped",
+             (unsigned long)executed, (unsigned long)stolen, dropped);
+
+    sem_destroy(&pool->wake);
+    free(pool->threads);
+    free(pool->injector);
+    free(pool);
 
     return err;
-}
\ No newline at end of file
+}
+
+// Run every completion delivered so far, in submission order
+static int channel_run_completed(offload_channel_t *channel) {
+    thread_pool_task_t *stack = atomic_exchange_explicit(&channel->completed, NULL, memory_order_acquire);
+
+    // The stack holds the newest first
+    thread_pool_task_t *fifo = NULL;
+    while (stack != NULL) {
+        thread_pool_task_t *next = stack->next;
+        stack->next = fifo;
+        fifo = stack;
+        stack = next;
+    }
+
+    int count = 0;
+    while (fifo != NULL) {
+        thread_pool_task_t *next = fifo->next;
+        if (fifo->completion != NULL) {
+            fifo->completion(fifo->argument);
+        }
+        channel_task_put(channel, fifo);
+        fifo = next;
+        count++;
+    }
+    return count;
+}
+
+// Completion eventfd callback
+static void offload_channel_callback(int fd, void *arg) {
+    offload_channel_t *channel = (offload_channel_t *)arg;
+    uint64_t signals;
+
+    // Reset the counter before taking the stack: a push after the take signals again
+    if (read(fd, &signals, sizeof(signals)) < 0 && errno != EAGAIN) {
+        log_error("Failed to read offload completion signal: %s", strerror(errno));
+    }
+    channel_run_completed(channel);
+}
+
+// Create a completion channel
+offload_channel_t *offload_channel_create(event_loop_t *loop) {
+    if (loop == NULL) {
+        return NULL;
+    }
+
+    offload_channel_t *channel = (offload_channel_t *)calloc(1, sizeof(offload_channel_t));
+    if (channel == NULL) {
+        log_error("Failed to allocate offload channel");
+        return NULL;
+    }
+
+    channel->loop = loop;
+    atomic_init(&channel->completed, NULL);
+    channel->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (channel->event_fd < 0) {
+        log_error("Failed to create offload eventfd: %s", strerror(errno));
+        free(channel);
+        return NULL;
+    }
+
+    if (event_loop_add_handler(loop, channel->event_fd, EVENT_READ, offload_channel_callback, NULL, channel) != 0) {
+        log_error("Failed to add offload eventfd to event loop");
+        close(channel->event_fd);
+        free(channel);
+        return NULL;
+    }
+    return channel;
+}
+
+// Run delivered completions on the calling thread
+int offload_channel_flush(offload_channel_t *channel) {
+    if (channel == NULL) {
+        return 0;
+    }
+    return channel_run_completed(channel);
+}
+
+// Destroy a completion channel
+void offload_channel_destroy(offload_channel_t *channel) {
+    if (channel == NULL) {
+        return;
+    }
+
+    event_loop_del_handler(channel->loop, channel->event_fd);
+    close(channel->event_fd);
+
+    thread_pool_task_t *task = atomic_exchange(&channel->completed, NULL);
+    while (task != NULL) {
+        thread_pool_task_t *next = task->next;
+        free(task);
+        task = next;
+    }
+    task = channel->free_tasks;
+    while (task != NULL) {
+        thread_pool_task_t *next = task->next;
+        free(task);
+        task = next;
+    }
+    free(channel);
+}
+
+/**
+ * Set up offloading for this process
+ */
+int offload_init(event_loop_t *loop, int thread_count, int queue_size) {
+    g_offload_channel = offload_channel_create(loop);
+    if (g_offload_channel == NULL) {
+        return -1;
+    }
+
+    if (thread_count > 0) {
+        g_offload_pool = thread_pool_create(thread_count, queue_size);
+        if (g_offload_pool == NULL) {
+            log_warn("Failed to create offload thread pool, blocking work stays on the event loop");
+        }
+    }
+    return 0;
+}
+
+/**
+ * Offload a blocking call, the completion runs on the event loop
+ */
+int offload(void (*fn)(void *), void *arg, void (*completion_cb)(void *)) {
+    if (g_offload_channel == NULL) {
+        return THREAD_POOL_SHUTDOWN;
+    }
+    return thread_pool_submit(g_offload_pool, g_offload_channel, fn, arg, completion_cb);
+}
+
+/**
+ * Whether offloaded work leaves the event loop thread
+ */
+int offload_available(void) {
+    return g_offload_pool != NULL;
+}
+
+/**
+ * Finish offloaded work and release the pool and channel
+ */
+void offload_shutdown(void) {
+    if (g_offload_pool != NULL) {
+        thread_pool_destroy(g_offload_pool, 0);
+        g_offload_pool = NULL;
+    }
+    if (g_offload_channel != NULL) {
+        int flushed = offload_channel_flush(g_offload_channel);
+        if (flushed > 0) {
+            log_info("Ran %d offload completions after the event loop stopped", flushed);
+        }
+        offload_channel_destroy(g_offload_channel);
+        g_offload_channel = NULL;
+    }
+}
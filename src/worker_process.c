@@ -15,6 +15,7 @@
 #include <stdatomic.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <sys/timerfd.h>
 
 #include "../include/worker_process.h"
 #include "../include/event_loop.h"
@@ -23,10 +24,20 @@
 #include "../include/connection_pool.h"
 #include "../include/logger.h"
 #include "../include/config.h"
+#include "../include/config_snapshot.h"
 #include "../include/connection_limit.h"
 #include "../include/process_title.h"
 #include "../include/shared_memory.h"
 #include "../include/file_io_enhanced.h"
+#include "../include/lock_profiler.h"
+#include "../include/perf_counters.h"
+#include "../include/alloc_stats.h"
+#include "../include/route_stats.h"
+#include "../include/cpu_affinity.h"
+#include "../include/connection_handoff.h"
+#include "../include/adaptive_limit.h"
+#include "../include/thread_pool.h"
+#include "../include/pressure_monitor.h"
 
 // Global Worker context
 static worker_context_t *g_worker_ctx = NULL;
@@ -34,6 +45,27 @@ static worker_context_t *g_worker_ctx = NULL;
 // Global connection pool
 static connection_pool_t *g_connection_pool = NULL;
 
+// Hardware performance counters (opened only when perf_counters is on)
+static perf_counters_t g_perf_counters;
+
+// Single-threaded mode: the event loop runs on the main thread and periodic duties run from a loop timer
+static int g_single_thread = 0;
+static int g_tick_fd = -1;
+
+// Idle-pool cleanup timer: closing pooled connections touches loop-owned state, so it runs on the loop thread
+static int g_pool_timer_fd = -1;
+static int g_pool_cleanup_interval = 0;
+
+// Periodic duty state, touched only by the thread running worker_tick()
+static time_t g_last_stats_publish = 0;
+static int g_memory_cleanup_counter = 0;
+static time_t g_last_cache_cleanup = 0;
+static int g_cache_cleanup_interval = 0;
+static time_t g_drain_start = 0;
+
+// Main loop and tick timer period
+#define WORKER_TICK_US 10000
+
 // Signal handling flags
 static volatile sig_atomic_t g_reload_config = 0;
 static volatile sig_atomic_t g_shutdown_worker = 0;
@@ -100,11 +132,12 @@ static int setup_worker_signals(void) {
 static void worker_accept_callback(int listen_fd, void *arg) {
     (void)arg; // avoid unused parameter warning
     
-    // Batch accept connections to improve performance under high concurrency
+    // Batch accept connections to improve performance under high concurrency.
+    // The listen socket is edge-triggered, so the backlog must be drained until EAGAIN:
+    // connections left in the queue would otherwise wait for the next new connection.
     int accepted_count = 0;
-    const int max_accept_per_loop = 100; // maximum connections per loop
     
-    while (accepted_count < max_accept_per_loop) {
+    for (;;) {
         struct sockaddr_in client_addr;
         socklen_t client_len = sizeof(client_addr);
         
@@ -133,10 +166,10 @@ static void worker_accept_callback(int listen_fd, void *arg) {
         // Use connection pool
         conn = connection_pool_get_connection(g_connection_pool, client_fd, 
                                             g_worker_ctx->event_loop, 1, // Use unified event loop
-                                            g_worker_ctx->config, &client_addr);
+                                            &client_addr);
     } else {
         // Create connection directly (compatibility mode)
-        conn = connection_create(client_fd, g_worker_ctx->event_loop, g_worker_ctx->config, &client_addr);
+        conn = connection_create(client_fd, g_worker_ctx->event_loop, &client_addr);
     }
     
     if (conn == NULL) {
@@ -200,18 +233,291 @@ static int worker_reload_config(void) {
         return -1;
     }
     
-    // Update configuration
-    if (g_worker_ctx->config != NULL) {
-        free_config(g_worker_ctx->config);
+    // Publish the new snapshot: requests in flight finish on the old one, connections and caches stay
+    if (config_snapshot_publish(new_config) != 0) {
+        log_error("Worker process %d Failed to publish configuration snapshot", getpid());
+        g_worker_ctx->state = WORKER_RUNNING;
+        return -1;
     }
     g_worker_ctx->config = new_config;
     
+    // Rebuild derived settings
+    update_connection_limit_from_config(new_config->connection_limit_per_ip,
+                                        new_config->connection_limit_window);
+    connection_handoff_set_threshold(new_config->connection_handoff);
+    adaptive_limit_configure(new_config);
+    
+    // Apply diagnostics switches
+    lock_profiler_enable(new_config->lock_profiling);
+    alloc_stats_enable(new_config->alloc_accounting);
+    
+    // Report per-route CPU cost under the old routes, then rebind slots to the new ones
+    route_stats_print();
+    route_stats_set_routes(new_config);
+    route_stats_enable(new_config->route_cpu_stats);
+    
     g_worker_ctx->state = WORKER_RUNNING;
     
-    log_info("Worker process %d Configuration reload completed", getpid());
+    log_info("Worker process %d Configuration reload completed, snapshot %lu", getpid(),
+             (unsigned long)config_snapshot_generation());
+    return 0;
+}
+
+/**
+ * Publish Worker statistics and hardware counter metrics to shared memory
+ */
+static void worker_publish_stats(void) {
+    uint64_t requests = atomic_load(&g_worker_ctx->requests_processed);
+    
+    update_worker_stats(g_worker_ctx->worker_id, g_worker_ctx->worker_pid, requests,
+                        atomic_load(&g_worker_ctx->bytes_sent),
+                        atomic_load(&g_worker_ctx->bytes_received),
+                        (uint32_t)atomic_load(&g_worker_ctx->active_connections));
+    
+    perf_counters_sample_t sample;
+    if (perf_counters_sample(&g_perf_counters, requests, &sample) == 0) {
+        update_worker_perf_stats(g_worker_ctx->worker_id, sample.ipc,
+                                 sample.cache_misses_per_request,
+                                 sample.branch_misses_per_request,
+                                 sample.context_switches_per_sec);
+        if (sample.requests > 0) {
+            log_debug("Worker process %d perf: ipc=%.2f cache-misses/req=%.1f branch-misses/req=%.1f cs/s=%.1f requests=%lu",
+                      getpid(), sample.ipc, sample.cache_misses_per_request,
+                      sample.branch_misses_per_request, sample.context_switches_per_sec, sample.requests);
+        }
+    }
+    
+    if (ALLOC_STATS_ACTIVE()) {
+        alloc_stats_snapshot_t alloc_snapshot;
+        alloc_stats_get(&alloc_snapshot);
+        update_worker_alloc_stats(g_worker_ctx->worker_id, &alloc_snapshot);
+    }
+    
+    if (route_stats_is_enabled()) {
+        update_worker_route_stats(g_worker_ctx->worker_id);
+    }
+    
+    if (lock_profiler_is_enabled()) {
+        update_worker_lock_stats(g_worker_ctx->worker_id);
+    }
+    
+    size_t cache_bytes = 0, cache_max_bytes = 0, cache_hits = 0, cache_misses = 0;
+    file_io_enhanced_get_cache_info(&cache_bytes, &cache_max_bytes, &cache_hits, &cache_misses);
+    update_worker_runtime_stats(g_worker_ctx->worker_id,
+                                event_loop_take_max_lag_us(g_worker_ctx->event_loop),
+                                event_loop_take_utilization(g_worker_ctx->event_loop),
+                                g_worker_ctx->state == WORKER_STOPPING,
+                                cache_bytes, cache_max_bytes, cache_hits, cache_misses);
+}
+
+/**
+ * Execute an admin command relayed by the Master through shared memory
+ */
+static void worker_handle_command(void) {
+    uint32_t seq;
+    worker_command_t command;
+    int arg;
+    int result = 0;
+    
+    if (!fetch_worker_command(g_worker_ctx->worker_id, &seq, &command, &arg)) {
+        return;
+    }
+    
+    switch (command) {
+        case WORKER_CMD_SET_LOG_LEVEL:
+            result = logger_set_level(arg);
+            if (result == 0) {
+                log_info("Worker process %d log level set to %d", getpid(), arg);
+            }
+            break;
+            
+        case WORKER_CMD_SET_DIAGNOSTIC: {
+            int enabled = (arg >> 8) & 1;
+            switch ((worker_diagnostic_t)(arg & 0xff)) {
+                case WORKER_DIAG_LOCK_PROFILING:
+                    lock_profiler_enable(enabled);
+                    break;
+                case WORKER_DIAG_ALLOC_ACCOUNTING:
+                    alloc_stats_enable(enabled);
+                    break;
+                case WORKER_DIAG_ROUTE_CPU_STATS:
+                    route_stats_enable(enabled);
+                    break;
+                default:
+                    result = -1;
+                    break;
+            }
+            break;
+        }
+            
+        case WORKER_CMD_CACHE_DUMP:
+            result = (int)file_io_enhanced_dump_cache();
+            break;
+            
+        case WORKER_CMD_CACHE_CLEAR:
+            file_io_enhanced_clear_cache();
+            log_info("Worker process %d file cache cleared", getpid());
+            break;
+            
+        case WORKER_CMD_ALLOC_RESET:
+            alloc_stats_reset();
+            log_info("Worker process %d allocation statistics reset", getpid());
+            break;
+            
+        case WORKER_CMD_DRAIN:
+            // Acknowledge first, draining waits for connections to finish
+            log_info("Worker process %d draining on admin request", getpid());
+            g_shutdown_worker = 1;
+            break;
+            
+        default:
+            result = -1;
+            break;
+    }
+    
+    ack_worker_command(g_worker_ctx->worker_id, seq, result);
+}
+
+/**
+ * Stop accepting connections, existing connections keep being served
+ */
+static void worker_stop_accepting(void) {
+    g_worker_ctx->state = WORKER_STOPPING;
+    event_loop_del_handler(g_worker_ctx->event_loop, g_worker_ctx->listen_fd);
+    worker_publish_stats();
+}
+
+/**
+ * Periodic Worker duties, every tick from the main loop or from the single-threaded loop's timer
+ * Returns 1 once the Worker should leave its loop
+ */
+static int worker_tick(void) {
+    // Check signal flags
+    if (g_reload_config) {
+        g_reload_config = 0;
+        worker_reload_config();
+    }
+    
+    // Admin commands may request a drain, handle them before the shutdown check
+    worker_handle_command();
+    
+    if (g_shutdown_worker) {
+        g_shutdown_worker = 0;
+        log_info("Worker process %d Start graceful shutdown", getpid());
+        if (!g_single_thread) {
+            worker_graceful_shutdown();
+            return 1;
+        }
+        // The loop must keep running to finish the connections, later ticks watch the drain
+        worker_stop_accepting();
+        g_drain_start = time(NULL);
+    }
+    
+    if (g_terminate_worker) {
+        g_terminate_worker = 0;
+        log_info("Worker process %d Immediately terminate", getpid());
+        g_worker_ctx->state = WORKER_STOPPED;
+        return 1;
+    }
+    
+    time_t now = time(NULL);
+    
+    // Same 30 second bound as worker_graceful_shutdown()
+    if (g_single_thread && g_worker_ctx->state == WORKER_STOPPING) {
+        uint64_t active = atomic_load(&g_worker_ctx->active_connections);
+        if (active == 0 || now - g_drain_start >= 30) {
+            if (active > 0) {
+                log_warn("Worker process %d Still have %lu active connections, force close", getpid(), active);
+            }
+            g_worker_ctx->state = WORKER_STOPPED;
+            return 1;
+        }
+    }
+    
+    // Periodic memory cleanup, every 1000 ticks
+    if (++g_memory_cleanup_counter >= 1000) {
+        // Force compress memory pool - cleanup through connection manager
+        extern int compress_connection_pool(void);
+        int freed_blocks = compress_connection_pool();
+        if (freed_blocks > 0) {
+            log_info("Worker process %d Periodic memory cleanup completed, freed %d memory blocks", getpid(), freed_blocks);
+        }
+        g_memory_cleanup_counter = 0;
+    }
+    
+    // Publish statistics to shared memory once per second
+    if (now != g_last_stats_publish) {
+        g_last_stats_publish = now;
+        worker_publish_stats();
+        
+        // Follow the Master's PSI flags: shrink caches, pause diagnostics, shed low-priority routes
+        pressure_worker_update();
+        adaptive_limit_publish();
+        
+        // Hand back snapshots replaced by a reload once the event loop is past them
+        config_snapshot_reclaim();
+        
+        // Work the cache cleanup thread does in the threaded mode
+        if (g_single_thread && now - g_last_cache_cleanup >= g_cache_cleanup_interval) {
+            g_last_cache_cleanup = now;
+            file_io_enhanced_cleanup_expired();
+        }
+    }
+    
+    // Check and flush idle log buffers
+    logger_check_idle_flush();
+    
     return 0;
 }
 
+/**
+ * Tick timer callback of a single-threaded Worker
+ */
+static void worker_tick_callback(int fd, void *arg) {
+    (void)arg;
+    uint64_t expirations;
+    while (read(fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+    }
+    
+    if (worker_tick() != 0) {
+        event_loop_stop(g_worker_ctx->event_loop);
+    }
+}
+
+/**
+ * Idle-pool cleanup timer callback, on the event loop thread
+ */
+static void worker_pool_timer_callback(int fd, void *arg) {
+    (void)arg;
+    uint64_t expirations;
+    while (read(fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+    }
+    
+    if (g_connection_pool != NULL) {
+        connection_pool_cleanup_idle(g_connection_pool);
+    }
+}
+
+/**
+ * Arm the idle-pool cleanup timer: soon, or every pool_cleanup_interval seconds
+ */
+static int worker_arm_pool_timer(int immediate) {
+    if (g_pool_timer_fd < 0) {
+        return -1;
+    }
+    
+    struct itimerspec spec = {
+        .it_interval = { g_pool_cleanup_interval, 0 },
+        .it_value = immediate ? (struct timespec){ 0, 1 } : (struct timespec){ g_pool_cleanup_interval, 0 }
+    };
+    return timerfd_settime(g_pool_timer_fd, 0, &spec, NULL);
+}
+
+void worker_schedule_pool_cleanup(void) {
+    // timerfd_settime is safe from the main thread; the pass itself runs on the loop thread
+    worker_arm_pool_timer(1);
+}
+
 /**
  * Worker process main function
  */
@@ -246,17 +552,21 @@ int worker_process_run(int worker_id, int listen_fd, config_t *config) {
         return -1;
     }
     
-    // Copy configuration
-    g_worker_ctx->config = duplicate_config(config);
+    // Requests read the snapshot the Master built before fork, with its route table, OAuth
+    // applications and resolved upstreams; without one, copy the configuration and build it here
+    g_worker_ctx->config = config_snapshot_inherit();
     if (g_worker_ctx->config == NULL) {
-        log_error("Worker process %d Failed to copy configuration", getpid());
-        free(g_worker_ctx);
-        return -1;
+        g_worker_ctx->config = duplicate_config(config);
+        if (g_worker_ctx->config == NULL || config_snapshot_publish(g_worker_ctx->config) != 0) {
+            log_error("Worker process %d Failed to copy configuration", getpid());
+            free(g_worker_ctx);
+            return -1;
+        }
     }
     
     // Set up signal handling
     if (setup_worker_signals() != 0) {
-        free_config(g_worker_ctx->config);
+        config_snapshot_shutdown();
         free(g_worker_ctx);
         return -1;
     }
@@ -272,18 +582,45 @@ int worker_process_run(int worker_id, int listen_fd, config_t *config) {
     // Just need to simply record startup information
     log_info("Worker process %d starting, PID: %d", worker_id, getpid());
     
+    // Pin before any pool, cache or thread exists: helper threads inherit the CPU set
+    // and first touch places the Worker's memory on its local NUMA node
+    cpu_affinity_apply(g_worker_ctx->config->worker_cpu_affinity, worker_id,
+                       g_worker_ctx->config->worker_processes);
+    
+    // Discard admin commands left for a previous Worker in this slot
+    reset_worker_slot(worker_id);
+    
+    // Enable lock contention profiling if configured
+    lock_profiler_enable(g_worker_ctx->config->lock_profiling);
+    
+    // Enable per-subsystem allocation accounting if configured
+    alloc_stats_enable(g_worker_ctx->config->alloc_accounting);
+    
+    // Enable per-route CPU time accounting if configured
+    route_stats_set_routes(g_worker_ctx->config);
+    route_stats_enable(g_worker_ctx->config->route_cpu_stats);
+    
+    // Open hardware counters before any thread is created so inherited counting covers them
+    memset(&g_perf_counters, 0, sizeof(g_perf_counters));
+    if (g_worker_ctx->config->perf_counters) {
+        perf_counters_open(&g_perf_counters);
+    }
+    
     // Initialize connection management module - use memory pool size from configuration
     size_t pool_size = g_worker_ctx->config->memory_pool_size > 0 ? 
                       g_worker_ctx->config->memory_pool_size : 1024 * 1024 * 100; // Default 100MB
     if (init_connection_manager(pool_size) != 0) {
         log_error("Worker process %d Failed to initialize connection management module", getpid());
-        free_config(g_worker_ctx->config);
+        config_snapshot_shutdown();
         free(g_worker_ctx);
         return -1;
     }
     
     // Initialize connection pool
     connection_pool_config_t pool_config = connection_pool_load_config(g_worker_ctx->config);
+    g_single_thread = g_worker_ctx->config->worker_single_thread;
+    pool_config.external_cleanup = 1;
+    g_pool_cleanup_interval = pool_config.pool_cleanup_interval > 0 ? pool_config.pool_cleanup_interval : 30;
     g_connection_pool = connection_pool_create(&pool_config);
     if (g_connection_pool == NULL) {
         log_warn("Worker process %d Failed to create connection pool, will use direct connection creation mode", getpid());
@@ -299,15 +636,17 @@ int worker_process_run(int worker_id, int listen_fd, config_t *config) {
     
     // Initialize enhanced file I/O module
     file_io_config_t file_io_config = {
-        .cache_size = 100,                    // 100MB cache
+        .cache_size = config->file_cache_size / (1024 * 1024),  // file_cache_size in MB
         .max_file_size = 50,                  // Maximum 50MB file
         .enable_mmap = 1,                     // Enable mmap
         .enable_async = 0,                    // Temporarily disable async I/O
         .enable_sendfile = 1,                 // Enable sendfile
         .cache_cleanup_interval = 300,        // 5 minute cleanup interval
         .read_buffer_size = 8192,             // 8KB read buffer
-        .write_buffer_size = 8192             // 8KB write buffer
+        .write_buffer_size = 8192,            // 8KB write buffer
+        .external_cleanup = g_single_thread   // Single-threaded Workers clean up from the tick
     };
+    g_cache_cleanup_interval = file_io_config.cache_cleanup_interval;
     
     if (file_io_enhanced_init(&file_io_config) != 0) {
         log_warn("Worker process %d Failed to initialize enhanced file I/O module, will use standard file processing", getpid());
@@ -323,7 +662,7 @@ int worker_process_run(int worker_id, int listen_fd, config_t *config) {
     if (g_worker_ctx->event_loop == NULL) {
         log_error("Worker process %d Failed to create unified event loop", getpid());
         cleanup_connection_manager();
-        free_config(g_worker_ctx->config);
+        config_snapshot_shutdown();
         free(g_worker_ctx);
         return -1;
     }
@@ -334,17 +673,78 @@ int worker_process_run(int worker_id, int listen_fd, config_t *config) {
         log_error("Worker process %d Failed to add listen socket to unified event loop", getpid());
         event_loop_destroy(g_worker_ctx->event_loop);
         cleanup_connection_manager();
-        free_config(g_worker_ctx->config);
+        config_snapshot_shutdown();
         free(g_worker_ctx);
         return -1;
     }
     
-    // Start unified event loop
-    if (event_loop_start(g_worker_ctx->event_loop) != 0) {
+    // Peers may hand this Worker idle connections, and it hands its own off when ahead by the threshold
+    connection_handoff_start(worker_id, g_worker_ctx->event_loop, g_worker_ctx->config->connection_handoff);
+    
+    // Blocking calls leave the loop through the offload pool; a single-threaded Worker runs them inline
+    int offload_threads = (g_worker_ctx->config->use_thread_pool && !g_single_thread) ?
+                          g_worker_ctx->config->thread_pool_size : 0;
+    if (offload_init(g_worker_ctx->event_loop, offload_threads, g_worker_ctx->config->thread_pool_queue_size) != 0) {
+        log_warn("Worker process %d Failed to set up offloading, blocking work stays on the event loop", getpid());
+    }
+    
+    pressure_worker_start(worker_id, g_worker_ctx->config->file_cache_size);
+    
+    // Requests past the latency-driven concurrency limit fail fast or wait briefly after parsing
+    adaptive_limit_init(worker_id, g_worker_ctx->event_loop, g_worker_ctx->config);
+    
+    // Idle pooled connections are closed from the loop thread that owns them
+    if (g_connection_pool != NULL) {
+        g_pool_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (g_pool_timer_fd < 0 || worker_arm_pool_timer(0) != 0 ||
+            event_loop_add_handler(g_worker_ctx->event_loop, g_pool_timer_fd, EVENT_READ,
+                                   worker_pool_timer_callback, NULL, NULL) != 0) {
+            log_warn("Worker process %d Failed to create pool cleanup timer, idle pooled connections close only on peer close: %s",
+                     getpid(), strerror(errno));
+            if (g_pool_timer_fd >= 0) {
+                close(g_pool_timer_fd);
+                g_pool_timer_fd = -1;
+            }
+        }
+    }
+    
+    // The loop thread stamps the shared-memory heartbeat the Master watchdog reads
+    uint64_t *heartbeat_ms = NULL;
+    uint64_t *loop_iterations = NULL;
+    if (get_worker_heartbeat_slot(worker_id, &heartbeat_ms, &loop_iterations) == 0) {
+        event_loop_set_heartbeat(g_worker_ctx->event_loop, heartbeat_ms, loop_iterations);
+    }
+    
+    if (g_single_thread) {
+        // Periodic duties run from a loop timer instead of this thread
+        struct itimerspec tick = { .it_interval = { 0, WORKER_TICK_US * 1000 }, .it_value = { 0, WORKER_TICK_US * 1000 } };
+        g_tick_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (g_tick_fd < 0 || timerfd_settime(g_tick_fd, 0, &tick, NULL) != 0 ||
+            event_loop_add_handler(g_worker_ctx->event_loop, g_tick_fd, EVENT_READ,
+                                   worker_tick_callback, NULL, NULL) != 0) {
+            log_error("Worker process %d Failed to create tick timer: %s", getpid(), strerror(errno));
+            if (g_tick_fd >= 0) {
+                close(g_tick_fd);
+            }
+            offload_shutdown();
+            event_loop_destroy(g_worker_ctx->event_loop);
+            cleanup_connection_manager();
+            config_snapshot_shutdown();
+            free(g_worker_ctx);
+            return -1;
+        }
+        
+        // Every module lock is uncontended from here on; with a stray thread they stay real locks
+        if (lock_elision_enable() == 0) {
+            log_info("Worker process %d running single-threaded, internal locks disabled", getpid());
+        }
+    } else if (event_loop_start(g_worker_ctx->event_loop) != 0) {
+        // Start unified event loop
         log_error("Worker process %d Failed to start unified event loop", getpid());
+        offload_shutdown();
         event_loop_destroy(g_worker_ctx->event_loop);
         cleanup_connection_manager();
-        free_config(g_worker_ctx->config);
+        config_snapshot_shutdown();
         free(g_worker_ctx);
         return -1;
     }
@@ -356,56 +756,41 @@ int worker_process_run(int worker_id, int listen_fd, config_t *config) {
     
     log_info("Worker process %d Start running", getpid());
     
-    // Memory cleanup counter
-    int memory_cleanup_counter = 0;
-    const int MEMORY_CLEANUP_INTERVAL = 1000; // clean up memory every loops
+    time_t now = time(NULL);
+    g_last_stats_publish = now;
+    g_last_cache_cleanup = now;
     
-    // Worker process main loop
-    while (g_worker_ctx->state != WORKER_STOPPED) {
-        // Check signal flags
-        if (g_reload_config) {
-            g_reload_config = 0;
-            worker_reload_config();
-        }
-        
-        if (g_shutdown_worker) {
-            g_shutdown_worker = 0;
-            log_info("Worker process %d Start graceful shutdown", getpid());
-            worker_graceful_shutdown();
-            break;
-        }
-        
-        if (g_terminate_worker) {
-            g_terminate_worker = 0;
-            log_info("Worker process %d Immediately terminate", getpid());
-            g_worker_ctx->state = WORKER_STOPPED;
-            break;
-        }
-        
-        // Periodic memory cleanup
-        memory_cleanup_counter++;
-        if (memory_cleanup_counter >= MEMORY_CLEANUP_INTERVAL) {
-            // Force compress memory pool - cleanup through connection manager
-            extern int compress_connection_pool(void);
-            int freed_blocks = compress_connection_pool();
-            if (freed_blocks > 0) {
-                log_info("Worker process %d Periodic memory cleanup completed, freed %d memory blocks", getpid(), freed_blocks);
-            }
-            memory_cleanup_counter = 0;
+    if (g_single_thread) {
+        // Returns once the tick stops the loop
+        event_loop_run(g_worker_ctx->event_loop);
+    } else {
+        // Worker process main loop
+        while (g_worker_ctx->state != WORKER_STOPPED && worker_tick() == 0) {
+            // Sleep for a short time to let event loop process events
+            usleep(WORKER_TICK_US);
         }
-        
-        // Check and flush idle log buffers
-        logger_check_idle_flush();
-        
-        // Sleep for a short time to let event loop process events
-        usleep(10000); // 10ms，减少延迟
     }
     
     // Stop event loop
     event_loop_stop(g_worker_ctx->event_loop);
+    event_loop_wait(g_worker_ctx->event_loop);
+    
+    // Offloaded requests finish and complete here, while their connections and the loop still exist
+    offload_shutdown();
     
     // Clean up resources
     event_loop_destroy(g_worker_ctx->event_loop);
+    connection_handoff_stop();
+    pressure_worker_stop();
+    adaptive_limit_stop();
+    if (g_tick_fd >= 0) {
+        close(g_tick_fd);
+        g_tick_fd = -1;
+    }
+    if (g_pool_timer_fd >= 0) {
+        close(g_pool_timer_fd);
+        g_pool_timer_fd = -1;
+    }
     
     // Destroy connection pool
     if (g_connection_pool) {
@@ -417,8 +802,16 @@ int worker_process_run(int worker_id, int listen_fd, config_t *config) {
     // Destroy enhanced file I/O module
     file_io_enhanced_destroy();
     
+    // Report lock contention collected during this Worker's lifetime
+    lock_profiler_print_stats();
+    alloc_stats_print();
+    route_stats_print();
+    
+    perf_counters_close(&g_perf_counters);
+    
     cleanup_connection_manager();
-    free_config(g_worker_ctx->config);
+    config_snapshot_shutdown();
+    g_worker_ctx->config = NULL;
     
     log_info("Worker process %d Exit, processed %lu requests, sent %lu bytes", 
              getpid(), atomic_load(&g_worker_ctx->requests_processed), 
@@ -448,16 +841,15 @@ void worker_graceful_shutdown(void) {
         return;
     }
     
-    g_worker_ctx->state = WORKER_STOPPING;
-    
     // Stop accepting new connections
-    event_loop_del_handler(g_worker_ctx->event_loop, g_worker_ctx->listen_fd);
+    worker_stop_accepting();
     
     // Wait for existing connections to complete processing (wait up to 30 seconds)
     time_t start_time = time(NULL);
     while (g_worker_ctx->active_connections > 0 && 
            (time(NULL) - start_time) < 30) {
         sleep(1);
+        worker_publish_stats();
     }
     
     if (g_worker_ctx->active_connections > 0) {
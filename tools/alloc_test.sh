@@ -0,0 +1,146 @@
+#!/bin/sh
+# Allocation regression test, used by `make alloc-test`. Starts an allocation
+# accounting build of x-server with one Worker, a static route over public/
+# and a proxy route to mock-upstream. After warming up it restarts the Worker's
+# counters with `alloc reset`, sends keep-alive GETs of one static file and one
+# proxied path and reads the allocations per request from the admin `stats`
+# output. Fails when either exceeds its entry in the checked-in baseline.
+#
+# Environment:
+#   SERVER          accounting build of x-server (set by make)
+#   ALLOC_BASELINE  baseline file (default: tools/alloc_baseline)
+#   ALLOC_PORT      listen port of the test instance (default: 9190)
+#   ALLOC_UPSTREAM_PORT
+#                   mock-upstream port (default: 3190)
+#   ALLOC_WARMUP    warm-up requests per kind (default: 200)
+#   ALLOC_REQUESTS  measured requests per kind (default: 1000)
+#   ALLOC_UPDATE    1 writes the measured values to the baseline instead of checking
+
+SERVER=${SERVER:-bin/x-server}
+LOADGEN=${LOADGEN:-tools/bin/x-loadgen}
+MOCK_UPSTREAM=${MOCK_UPSTREAM:-tools/bin/mock-upstream}
+ALLOC_BASELINE=${ALLOC_BASELINE:-tools/alloc_baseline}
+ALLOC_PORT=${ALLOC_PORT:-9190}
+ALLOC_UPSTREAM_PORT=${ALLOC_UPSTREAM_PORT:-3190}
+ALLOC_WARMUP=${ALLOC_WARMUP:-200}
+ALLOC_REQUESTS=${ALLOC_REQUESTS:-1000}
+ALLOC_UPDATE=${ALLOC_UPDATE:-0}
+
+STATIC_PATH=/s/index.html
+PROXY_PATH=/p/items
+
+if [ ! -x "$SERVER" ] || [ ! -x "$LOADGEN" ] || [ ! -x "$MOCK_UPSTREAM" ]; then
+    echo "Missing $SERVER, $LOADGEN or $MOCK_UPSTREAM, run make alloc-test" >&2
+    exit 1
+fi
+if [ "$ALLOC_UPDATE" != "1" ] && [ ! -f "$ALLOC_BASELINE" ]; then
+    echo "Missing baseline $ALLOC_BASELINE, create it with ALLOC_UPDATE=1" >&2
+    exit 1
+fi
+
+mkdir -p logs
+CONF=logs/alloc-test.conf
+ADMIN=$(pwd)/logs/alloc-test.admin.sock
+{
+    echo "worker_processes 1;"
+    echo "log_path logs/"
+    echo "log_level 2;"
+    echo "admin_socket $ADMIN;"
+    echo "route static /s/ ./public/ none UTF-8"
+    echo "route proxy /p/ 127.0.0.1:$ALLOC_UPSTREAM_PORT none UTF-8"
+} > "$CONF"
+
+"$MOCK_UPSTREAM" -q -p "$ALLOC_UPSTREAM_PORT" -s 1k &
+MOCK_PID=$!
+"$SERVER" -f -p "$ALLOC_PORT" -c "$CONF" >/dev/null 2>&1 &
+SERVER_PID=$!
+
+stop_server() {
+    kill -TERM "$SERVER_PID" 2>/dev/null
+    wait "$SERVER_PID" 2>/dev/null
+    kill -TERM "$MOCK_PID" 2>/dev/null
+    wait "$MOCK_PID" 2>/dev/null
+}
+trap stop_server EXIT INT TERM
+
+# Wait until the server accepts requests
+ready=0
+for _ in 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20; do
+    if ! kill -0 "$SERVER_PID" 2>/dev/null; then
+        break
+    fi
+    if "$LOADGEN" -q -c 1 -t 1 -n 1 -d 1 -T 1 -u "$STATIC_PATH" "127.0.0.1:$ALLOC_PORT" >/dev/null 2>&1; then
+        ready=1
+        break
+    fi
+    sleep 0.25
+done
+if [ "$ready" -ne 1 ]; then
+    echo "x-server did not start on port $ALLOC_PORT" >&2
+    exit 1
+fi
+
+admin() {
+    "$SERVER" -c "$CONF" -a "$1"
+}
+
+# Allocations per request of one request kind in steady state, summed over the tags
+measure() {
+    "$LOADGEN" -q -c 1 -t 1 -n "$ALLOC_WARMUP" -d 60 -u "$1" "127.0.0.1:$ALLOC_PORT" >/dev/null 2>&1
+    admin "alloc reset" >/dev/null || return 1
+    "$LOADGEN" -q -c 1 -t 1 -n "$ALLOC_REQUESTS" -d 60 -u "$1" "127.0.0.1:$ALLOC_PORT" >/dev/null 2>&1
+    # Workers publish their counters once per second
+    sleep 1.5
+    admin stats | awk '
+        $1 == "alloc" {
+            split($3, a, "=");
+            total += a[2];
+            breakdown = breakdown sprintf(" %s=%s", $2, a[2]);
+        }
+        END { printf "%.2f%s\n", total, breakdown }'
+}
+
+status=0
+results=""
+for kind in static proxy; do
+    if [ "$kind" = "static" ]; then
+        path=$STATIC_PATH
+    else
+        path=$PROXY_PATH
+    fi
+
+    line=$(measure "$path")
+    value=${line%% *}
+    if [ -z "$value" ]; then
+        echo "$kind: no allocation statistics (is the server built with ALLOC_ACCOUNTING?)" >&2
+        exit 1
+    fi
+    results="$results$kind $value
+"
+
+    if [ "$ALLOC_UPDATE" = "1" ]; then
+        echo "$kind: $value allocations/request ($line)"
+        continue
+    fi
+
+    baseline=$(awk -v kind="$kind" '$1 == kind { print $2 }' "$ALLOC_BASELINE")
+    if [ -z "$baseline" ]; then
+        echo "$kind: no entry in $ALLOC_BASELINE" >&2
+        status=1
+    elif awk -v v="$value" -v b="$baseline" 'BEGIN { exit !(v > b) }'; then
+        echo "FAIL $kind: $value allocations/request, baseline $baseline ($line)"
+        status=1
+    else
+        echo "ok   $kind: $value allocations/request, baseline $baseline"
+    fi
+done
+
+if [ "$ALLOC_UPDATE" = "1" ]; then
+    {
+        echo "# Allocations per request in steady state, summed over all tags (make alloc-test)"
+        echo "# Regenerate with: make alloc-test ALLOC_UPDATE=1"
+        printf "%s" "$results"
+    } > "$ALLOC_BASELINE"
+    echo "Baseline written to $ALLOC_BASELINE"
+fi
+exit $status
@@ -0,0 +1,762 @@
+/**
+ * X-Server Benchmark Comparison
+ * Compares two sets of x-loadgen / x-replay / x-soak / x-microbench JSON results. Every result
+ * file (and every microbenchmark run inside one) is a sample; the difference
+ * of the means is tested with Welch's t-test and reported with its 95%
+ * confidence interval. Throughput, p99 latency, ns/op and memory per
+ * connection changes that are significant and worse than the threshold are
+ * flagged as regressions.
+ *
+ * Usage: x-bench-compare [options] <base> <head>
+ *        base/head: a result file or a directory of result files
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <dirent.h>
+#include <getopt.h>
+#include <sys/stat.h>
+
+#define MAX_METRICS 256
+#define MAX_SAMPLES 256
+#define MAX_FILES 256
+
+// JSON value types
+enum {
+    JSON_NULL = 0,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT
+};
+
+// Parsed JSON value
+typedef struct json_value {
+    int type;
+    double number;
+    char *string;
+    int count;
+    char **keys;                // Object member names
+    struct json_value **items;  // Array elements or object member values
+} json_value_t;
+
+// How a metric is judged
+enum {
+    GATE_NONE = 0,      // Reported only
+    GATE_THROUGHPUT,    // Higher is better, -t threshold
+    GATE_LATENCY,       // Lower is better, -p threshold
+    GATE_NS_PER_OP,     // Lower is better, -n threshold
+    GATE_MEMORY         // Lower is better, -M threshold
+};
+
+// Samples of one metric on both sides
+typedef struct metric {
+    char name[192];
+    int gate;
+    int higher_better;
+    double samples[2][MAX_SAMPLES];
+    int count[2];
+} metric_t;
+
+// Identity of one side, taken from the first result file's metadata
+typedef struct side_info {
+    char revision[64];
+    int dirty;
+    char hostname[128];
+    char cpu_model[128];
+    int cpus;
+    int files;
+} side_info_t;
+
+static metric_t g_metrics[MAX_METRICS];
+static int g_metric_count = 0;
+static side_info_t g_sides[2];
+static double g_threshold_throughput = 5.0;
+static double g_threshold_latency = 10.0;
+static double g_threshold_ns = 5.0;
+static double g_threshold_memory = 10.0;
+
+/* ---- Minimal JSON reader ---- */
+
+static void json_free(json_value_t *v) {
+    if (v == NULL) {
+        return;
+    }
+    for (int i = 0; i < v->count; i++) {
+        json_free(v->items[i]);
+        if (v->keys != NULL) {
+            free(v->keys[i]);
+        }
+    }
+    free(v->items);
+    free(v->keys);
+    free(v->string);
+    free(v);
+}
+
+static void skip_space(const char **p) {
+    while (**p == ' ' || **p == '\t' || **p == '\n' || **p == '\r') {
+        (*p)++;
+    }
+}
+
+static char *parse_string(const char **p) {
+    if (**p != '"') {
+        return NULL;
+    }
+    (*p)++;
+
+    size_t cap = 32, len = 0;
+    char *s = malloc(cap);
+    if (s == NULL) {
+        return NULL;
+    }
+
+    while (**p != '"') {
+        char ch = **p;
+        if (ch == '\0') {
+            free(s);
+            return NULL;
+        }
+        (*p)++;
+        if (ch == '\\') {
+            char esc = **p;
+            (*p)++;
+            switch (esc) {
+                case 'n': ch = '\n'; break;
+                case 't': ch = '\t'; break;
+                case 'r': ch = '\r'; break;
+                case 'b': ch = '\b'; break;
+                case 'f': ch = '\f'; break;
+                case 'u': {
+                    // Only ASCII escapes are produced by the benchmark tools
+                    char hex[5];
+                    if (strnlen(*p, 4) < 4) {
+                        free(s);
+                        return NULL;
+                    }
+                    memcpy(hex, *p, 4);
+                    hex[4] = '\0';
+                    ch = (char)strtol(hex, NULL, 16);
+                    *p += 4;
+                    break;
+                }
+                case '\0':
+                    free(s);
+                    return NULL;
+                default: ch = esc; break;
+            }
+        }
+        if (len + 1 >= cap) {
+            cap *= 2;
+            char *n = realloc(s, cap);
+            if (n == NULL) {
+                free(s);
+                return NULL;
+            }
+            s = n;
+        }
+        s[len++] = ch;
+    }
+    (*p)++;
+    s[len] = '\0';
+    return s;
+}
+
+static json_value_t *parse_value(const char **p, int depth);
+
+// Append a member or element to an array/object
+static int json_append(json_value_t *v, char *key, json_value_t *item) {
+    json_value_t **items = realloc(v->items, (size_t)(v->count + 1) * sizeof(json_value_t *));
+    if (items == NULL) {
+        return -1;
+    }
+    v->items = items;
+    if (v->type == JSON_OBJECT) {
+        char **keys = realloc(v->keys, (size_t)(v->count + 1) * sizeof(char *));
+        if (keys == NULL) {
+            return -1;
+        }
+        v->keys = keys;
+        v->keys[v->count] = key;
+    }
+    v->items[v->count++] = item;
+    return 0;
+}
+
+static json_value_t *parse_container(const char **p, int depth, int type) {
+    json_value_t *v = calloc(1, sizeof(json_value_t));
+    if (v == NULL) {
+        return NULL;
+    }
+    v->type = type;
+    char close = type == JSON_OBJECT ? '}' : ']';
+
+    (*p)++;
+    skip_space(p);
+    if (**p == close) {
+        (*p)++;
+        return v;
+    }
+
+    for (;;) {
+        char *key = NULL;
+        skip_space(p);
+        if (type == JSON_OBJECT) {
+            key = parse_string(p);
+            skip_space(p);
+            if (key == NULL || **p != ':') {
+                free(key);
+                json_free(v);
+                return NULL;
+            }
+            (*p)++;
+        }
+
+        json_value_t *item = parse_value(p, depth + 1);
+        if (item == NULL || json_append(v, key, item) < 0) {
+            free(key);
+            json_free(item);
+            json_free(v);
+            return NULL;
+        }
+
+        skip_space(p);
+        if (**p == ',') {
+            (*p)++;
+            continue;
+        }
+        if (**p == close) {
+            (*p)++;
+            return v;
+        }
+        json_free(v);
+        return NULL;
+    }
+}
+
+static json_value_t *parse_value(const char **p, int depth) {
+    if (depth > 64) {
+        return NULL;
+    }
+
+    skip_space(p);
+    if (**p == '{') {
+        return parse_container(p, depth, JSON_OBJECT);
+    }
+    if (**p == '[') {
+        return parse_container(p, depth, JSON_ARRAY);
+    }
+
+    json_value_t *v = calloc(1, sizeof(json_value_t));
+    if (v == NULL) {
+        return NULL;
+    }
+
+    if (**p == '"') {
+        v->type = JSON_STRING;
+        v->string = parse_string(p);
+        if (v->string == NULL) {
+            free(v);
+            return NULL;
+        }
+    } else if (strncmp(*p, "true", 4) == 0 || strncmp(*p, "false", 5) == 0) {
+        v->type = JSON_BOOL;
+        v->number = **p == 't';
+        *p += **p == 't' ? 4 : 5;
+    } else if (strncmp(*p, "null", 4) == 0) {
+        v->type = JSON_NULL;
+        *p += 4;
+    } else {
+        char *end;
+        v->type = JSON_NUMBER;
+        v->number = strtod(*p, &end);
+        if (end == *p) {
+            free(v);
+            return NULL;
+        }
+        *p = end;
+    }
+    return v;
+}
+
+// Member of an object by dotted path, NULL if missing
+static const json_value_t *json_get(const json_value_t *v, const char *path) {
+    char key[128];
+
+    while (v != NULL && *path) {
+        size_t len = strcspn(path, ".");
+        if (v->type != JSON_OBJECT || len >= sizeof(key)) {
+            return NULL;
+        }
+        memcpy(key, path, len);
+        key[len] = '\0';
+        path += len + (path[len] == '.');
+
+        const json_value_t *next = NULL;
+        for (int i = 0; i < v->count; i++) {
+            if (strcmp(v->keys[i], key) == 0) {
+                next = v->items[i];
+                break;
+            }
+        }
+        v = next;
+    }
+    return v;
+}
+
+static const char *json_get_string(const json_value_t *v, const char *path, const char *fallback) {
+    const json_value_t *s = json_get(v, path);
+    return s != NULL && s->type == JSON_STRING ? s->string : fallback;
+}
+
+static int json_get_number(const json_value_t *v, const char *path, double *out) {
+    const json_value_t *n = json_get(v, path);
+    if (n == NULL || (n->type != JSON_NUMBER && n->type != JSON_BOOL)) {
+        return -1;
+    }
+    *out = n->number;
+    return 0;
+}
+
+static json_value_t *load_json_file(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return NULL;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *data = malloc((size_t)size + 1);
+    if (data == NULL || fread(data, 1, (size_t)size, f) != (size_t)size) {
+        free(data);
+        fclose(f);
+        fprintf(stderr, "%s: read failed\n", path);
+        return NULL;
+    }
+    data[size] = '\0';
+    fclose(f);
+
+    const char *p = data;
+    json_value_t *root = parse_value(&p, 0);
+    skip_space(&p);
+    if (root == NULL || *p != '\0') {
+        fprintf(stderr, "%s: invalid JSON\n", path);
+        json_free(root);
+        root = NULL;
+    }
+    free(data);
+    return root;
+}
+
+/* ---- Sample collection ---- */
+
+static metric_t *find_metric(const char *name, int gate, int higher_better) {
+    for (int i = 0; i < g_metric_count; i++) {
+        if (strcmp(g_metrics[i].name, name) == 0) {
+            return &g_metrics[i];
+        }
+    }
+    if (g_metric_count >= MAX_METRICS) {
+        return NULL;
+    }
+
+    metric_t *m = &g_metrics[g_metric_count++];
+    memset(m, 0, sizeof(*m));
+    snprintf(m->name, sizeof(m->name), "%s", name);
+    m->gate = gate;
+    m->higher_better = higher_better;
+    return m;
+}
+
+static void add_sample(int side, const char *name, int gate, int higher_better, double value) {
+    metric_t *m = find_metric(name, gate, higher_better);
+    if (m != NULL && m->count[side] < MAX_SAMPLES) {
+        m->samples[side][m->count[side]++] = value;
+    }
+}
+
+static void collect_loadgen(int side, const json_value_t *root) {
+    const char *scenario = json_get_string(root, "meta.labels.scenario", "default");
+    static const struct { const char *path; const char *label; int gate; int higher_better; } fields[] = {
+        {"results.throughput_rps", "throughput_rps", GATE_THROUGHPUT, 1},
+        {"latency_us.p50", "latency_p50_us", GATE_NONE, 0},
+        {"latency_us.p99", "latency_p99_us", GATE_LATENCY, 0},
+        {"latency_us.p99_9", "latency_p99_9_us", GATE_NONE, 0},
+        {"results.errors.total", "errors", GATE_NONE, 0}
+    };
+
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        double value;
+        if (json_get_number(root, fields[i].path, &value) == 0) {
+            char name[192];
+            snprintf(name, sizeof(name), "%s/%s", scenario, fields[i].label);
+            add_sample(side, name, fields[i].gate, fields[i].higher_better, value);
+        }
+    }
+}
+
+static void collect_microbench(int side, const json_value_t *root) {
+    const json_value_t *list = json_get(root, "benchmarks");
+    if (list == NULL || list->type != JSON_ARRAY) {
+        return;
+    }
+
+    for (int i = 0; i < list->count; i++) {
+        const json_value_t *b = list->items[i];
+        const char *name = json_get_string(b, "name", NULL);
+        if (name == NULL) {
+            continue;
+        }
+
+        char metric_name[192];
+        snprintf(metric_name, sizeof(metric_name), "%s ns/op", name);
+
+        // Every run is a sample; older files only carry the median
+        const json_value_t *samples = json_get(b, "samples");
+        if (samples != NULL && samples->type == JSON_ARRAY && samples->count > 0) {
+            for (int s = 0; s < samples->count; s++) {
+                add_sample(side, metric_name, GATE_NS_PER_OP, 0, samples->items[s]->number);
+            }
+        } else {
+            double value;
+            if (json_get_number(b, "ns_per_op", &value) == 0) {
+                add_sample(side, metric_name, GATE_NS_PER_OP, 0, value);
+            }
+        }
+
+        double allocs;
+        if (json_get_number(b, "allocs_per_op", &allocs) == 0) {
+            snprintf(metric_name, sizeof(metric_name), "%s allocs/op", name);
+            add_sample(side, metric_name, GATE_NONE, 0, allocs);
+        }
+    }
+}
+
+static void collect_replay(int side, const json_value_t *root) {
+    const char *scenario = json_get_string(root, "meta.labels.scenario", "replay");
+    char name[192];
+    double value;
+
+    // Throughput is dictated by the log timing unless replayed at maximum rate
+    double speed = 1;
+    json_get_number(root, "config.speed", &speed);
+    if (speed == 0 && json_get_number(root, "results.throughput_rps", &value) == 0) {
+        snprintf(name, sizeof(name), "%s/throughput_rps", scenario);
+        add_sample(side, name, GATE_THROUGHPUT, 1, value);
+    }
+    if (json_get_number(root, "latency_us.p99", &value) == 0) {
+        snprintf(name, sizeof(name), "%s/latency_p99_us", scenario);
+        add_sample(side, name, GATE_LATENCY, 0, value);
+    }
+
+    const json_value_t *routes = json_get(root, "routes");
+    if (routes == NULL || routes->type != JSON_ARRAY) {
+        return;
+    }
+    for (int i = 0; i < routes->count; i++) {
+        const json_value_t *r = routes->items[i];
+        const char *route = json_get_string(r, "route", "?");
+        if (json_get_number(r, "latency_us.p50", &value) == 0) {
+            snprintf(name, sizeof(name), "%s%s p50_us", scenario, route);
+            add_sample(side, name, GATE_NONE, 0, value);
+        }
+        if (json_get_number(r, "latency_us.p99", &value) == 0) {
+            snprintf(name, sizeof(name), "%s%s p99_us", scenario, route);
+            add_sample(side, name, GATE_LATENCY, 0, value);
+        }
+        if (json_get_number(r, "errors", &value) == 0) {
+            snprintf(name, sizeof(name), "%s%s errors", scenario, route);
+            add_sample(side, name, GATE_NONE, 0, value);
+        }
+    }
+}
+
+static void collect_soak(int side, const json_value_t *root) {
+    const char *scenario = json_get_string(root, "meta.labels.scenario", "soak");
+    static const struct { const char *path; const char *label; int gate; int higher_better; } fields[] = {
+        {"summary.bytes_per_connection", "bytes_per_connection", GATE_MEMORY, 0},
+        {"summary.accept_rate_avg", "accept_rate", GATE_THROUGHPUT, 1},
+        {"latency_us.p99", "trickle_p99_us", GATE_LATENCY, 0},
+        {"summary.soak_rss_slope_kb_per_min", "rss_slope_kb_per_min", GATE_NONE, 0},
+        {"summary.retained_after_close_kb", "retained_after_close_kb", GATE_NONE, 0},
+        {"summary.loop_lag_peak_ms", "loop_lag_peak_ms", GATE_NONE, 0}
+    };
+
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        double value;
+        if (json_get_number(root, fields[i].path, &value) == 0) {
+            char name[192];
+            snprintf(name, sizeof(name), "%s/%s", scenario, fields[i].label);
+            add_sample(side, name, fields[i].gate, fields[i].higher_better, value);
+        }
+    }
+}
+
+static int load_result(int side, const char *path) {
+    json_value_t *root = load_json_file(path);
+    if (root == NULL) {
+        return -1;
+    }
+
+    const char *tool = json_get_string(root, "tool", "");
+    if (strcmp(tool, "x-loadgen") == 0) {
+        collect_loadgen(side, root);
+    } else if (strcmp(tool, "x-microbench") == 0) {
+        collect_microbench(side, root);
+    } else if (strcmp(tool, "x-replay") == 0) {
+        collect_replay(side, root);
+    } else if (strcmp(tool, "x-soak") == 0) {
+        collect_soak(side, root);
+    } else {
+        fprintf(stderr, "%s: not a benchmark result, skipped\n", path);
+        json_free(root);
+        return 0;
+    }
+
+    side_info_t *info = &g_sides[side];
+    if (info->files++ == 0) {
+        double value = 0;
+        snprintf(info->revision, sizeof(info->revision), "%s", json_get_string(root, "meta.git_revision", "unknown"));
+        info->dirty = json_get_number(root, "meta.git_dirty", &value) == 0 && value != 0;
+        snprintf(info->hostname, sizeof(info->hostname), "%s", json_get_string(root, "meta.hostname", "?"));
+        snprintf(info->cpu_model, sizeof(info->cpu_model), "%s", json_get_string(root, "meta.cpu_model", "?"));
+        info->cpus = json_get_number(root, "meta.cpus_online", &value) == 0 ? (int)value : 0;
+    }
+
+    json_free(root);
+    return 0;
+}
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// Load a result file or every *.json file in a directory
+static int load_side(int side, const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        perror(path);
+        return -1;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        return load_result(side, path);
+    }
+
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    char *names[MAX_FILES];
+    int count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL && count < MAX_FILES) {
+        size_t len = strlen(entry->d_name);
+        if (len > 5 && strcmp(entry->d_name + len - 5, ".json") == 0) {
+            names[count++] = strdup(entry->d_name);
+        }
+    }
+    closedir(dir);
+    qsort(names, (size_t)count, sizeof(char *), compare_names);
+
+    int result = 0;
+    for (int i = 0; i < count; i++) {
+        char file[4096];
+        snprintf(file, sizeof(file), "%s/%s", path, names[i]);
+        if (load_result(side, file) < 0) {
+            result = -1;
+        }
+        free(names[i]);
+    }
+    return result;
+}
+
+/* ---- Statistics ---- */
+
+// Two-sided 95% critical value of Student's t distribution
+static double t_critical(double df) {
+    static const double table[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+
+    int d = (int)floor(df);
+    if (d < 1) {
+        d = 1;
+    }
+    if (d <= 30) {
+        return table[d - 1];
+    }
+    return d <= 60 ? 2.000 : d <= 120 ? 1.980 : 1.960;
+}
+
+static void mean_var(const double *x, int n, double *mean, double *var) {
+    double sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += x[i];
+    }
+    *mean = n > 0 ? sum / n : 0;
+
+    double sq = 0;
+    for (int i = 0; i < n; i++) {
+        sq += (x[i] - *mean) * (x[i] - *mean);
+    }
+    *var = n > 1 ? sq / (n - 1) : 0;
+}
+
+static double gate_threshold(int gate) {
+    switch (gate) {
+        case GATE_THROUGHPUT: return g_threshold_throughput;
+        case GATE_LATENCY: return g_threshold_latency;
+        case GATE_NS_PER_OP: return g_threshold_ns;
+        case GATE_MEMORY: return g_threshold_memory;
+        default: return 0;
+    }
+}
+
+/**
+ * Print one comparison row
+ * @return 1 if the metric regressed, otherwise 0
+ */
+static int compare_metric(const metric_t *m) {
+    double mb, vb, mh, vh;
+    int nb = m->count[0], nh = m->count[1];
+
+    if (nb == 0 || nh == 0) {
+        printf("%-44s %s\n", m->name, nb == 0 ? "only in head" : "only in base");
+        return 0;
+    }
+
+    mean_var(m->samples[0], nb, &mb, &vb);
+    mean_var(m->samples[1], nh, &mh, &vh);
+
+    double delta_pct = mb != 0 ? (mh - mb) / fabs(mb) * 100.0 : 0;
+    double worse_pct = m->higher_better ? -delta_pct : delta_pct;
+    double threshold = gate_threshold(m->gate);
+
+    char ci[48] = "n/a";
+    int tested = nb > 1 && nh > 1;
+    int significant = 0;
+    if (tested) {
+        // Welch's t-test on the difference of the means
+        double sb = vb / nb, sh = vh / nh;
+        double se = sqrt(sb + sh);
+        if (se > 0) {
+            double df = (sb + sh) * (sb + sh) / (sb * sb / (nb - 1) + sh * sh / (nh - 1));
+            double half = t_critical(df) * se;
+            double low = mh - mb - half, high = mh - mb + half;
+            significant = low > 0 || high < 0;
+            if (mb != 0) {
+                snprintf(ci, sizeof(ci), "[%+.1f%%, %+.1f%%]", low / fabs(mb) * 100.0, high / fabs(mb) * 100.0);
+            }
+        } else {
+            significant = mh != mb;
+            snprintf(ci, sizeof(ci), "exact");
+        }
+    }
+
+    const char *verdict;
+    int regressed = 0;
+    if (m->gate != GATE_NONE && worse_pct > threshold && (significant || !tested)) {
+        verdict = tested ? "REGRESSION" : "REGRESSION?";
+        regressed = 1;
+    } else if (tested && !significant) {
+        verdict = "~";
+    } else if (m->gate != GATE_NONE && -worse_pct > threshold) {
+        verdict = "improved";
+    } else if (!tested) {
+        verdict = "";
+    } else {
+        verdict = worse_pct > 0 ? "worse" : "better";
+    }
+
+    printf("%-44s %12.2f %12.2f %+8.2f%% %20s  %s\n", m->name, mb, mh, delta_pct, ci, verdict);
+    return regressed;
+}
+
+static void print_side(const char *label, const side_info_t *s) {
+    printf("%s: %.12s%s, %d file(s), %s, %s x%d\n", label, s->revision, s->dirty ? "-dirty" : "",
+           s->files, s->hostname, s->cpu_model, s->cpus);
+}
+
+static void show_help(const char *program_name) {
+    printf("Usage: %s [options] <base> <head>\n", program_name);
+    printf("\n");
+    printf("base and head are result files or directories of result files from\n");
+    printf("x-loadgen, x-replay or x-microbench; repeated runs give the statistics.\n");
+    printf("\n");
+    printf("Options:\n");
+    printf("  -t <pct>        Throughput regression threshold (default: %.0f%%)\n", g_threshold_throughput);
+    printf("  -p <pct>        p99 latency regression threshold (default: %.0f%%)\n", g_threshold_latency);
+    printf("  -n <pct>        Microbenchmark ns/op regression threshold (default: %.0f%%)\n", g_threshold_ns);
+    printf("  -M <pct>        Soak memory per connection regression threshold (default: %.0f%%)\n", g_threshold_memory);
+    printf("  -h              Show help information\n");
+    printf("\n");
+    printf("Exit status is 1 when a regression is flagged, 2 on errors.\n");
+}
+
+int main(int argc, char *argv[]) {
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:p:n:M:h")) != -1) {
+        switch (opt) {
+            case 't': g_threshold_throughput = atof(optarg); break;
+            case 'p': g_threshold_latency = atof(optarg); break;
+            case 'n': g_threshold_ns = atof(optarg); break;
+            case 'M': g_threshold_memory = atof(optarg); break;
+            case 'h':
+                show_help(argv[0]);
+                return 0;
+            default:
+                show_help(argv[0]);
+                return 2;
+        }
+    }
+
+    if (optind != argc - 2) {
+        show_help(argv[0]);
+        return 2;
+    }
+
+    if (load_side(0, argv[optind]) < 0 || load_side(1, argv[optind + 1]) < 0) {
+        return 2;
+    }
+    if (g_sides[0].files == 0 || g_sides[1].files == 0) {
+        fprintf(stderr, "No benchmark results found\n");
+        return 2;
+    }
+
+    print_side("base", &g_sides[0]);
+    print_side("head", &g_sides[1]);
+    if (strcmp(g_sides[0].cpu_model, g_sides[1].cpu_model) != 0 || g_sides[0].cpus != g_sides[1].cpus) {
+        printf("warning: results come from different machines\n");
+    }
+    printf("\n%-44s %12s %12s %9s %20s  %s\n", "metric", "base", "head", "delta", "95% CI of delta", "verdict");
+
+    int regressions = 0;
+    int untested = 0;
+    for (int i = 0; i < g_metric_count; i++) {
+        const metric_t *m = &g_metrics[i];
+        regressions += compare_metric(m);
+        if (m->gate != GATE_NONE && (m->count[0] < 2 || m->count[1] < 2)) {
+            untested++;
+        }
+    }
+
+    printf("\nThresholds: throughput %.1f%%, p99 %.1f%%, ns/op %.1f%%, bytes/connection %.1f%%\n",
+           g_threshold_throughput, g_threshold_latency, g_threshold_ns, g_threshold_memory);
+    if (untested > 0) {
+        printf("%d metric(s) have fewer than 2 samples per side; repeat runs (BENCH_RUNS) for significance\n", untested);
+    }
+    printf("%d regression(s)\n", regressions);
+
+    return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,161 @@
+/**
+ * Benchmark Metadata Implementation
+ * Machine, revision and label information attached to benchmark results
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/utsname.h>
+
+#include "bench_meta.h"
+
+static char g_label_keys[BENCH_META_MAX_LABELS][64];
+static char g_label_values[BENCH_META_MAX_LABELS][512];
+static int g_label_count = 0;
+
+/**
+ * Add a "key=value" label
+ */
+int bench_meta_add_label(const char *spec) {
+    const char *eq = strchr(spec, '=');
+    if (eq == NULL || eq == spec || (size_t)(eq - spec) >= sizeof(g_label_keys[0]) ||
+        strlen(eq + 1) >= sizeof(g_label_values[0]) || g_label_count >= BENCH_META_MAX_LABELS) {
+        return -1;
+    }
+
+    memcpy(g_label_keys[g_label_count], spec, (size_t)(eq - spec));
+    g_label_keys[g_label_count][eq - spec] = '\0';
+    strcpy(g_label_values[g_label_count], eq + 1);
+    g_label_count++;
+    return 0;
+}
+
+/**
+ * Write a JSON string literal
+ */
+void bench_json_string(FILE *out, const char *s) {
+    fputc('"', out);
+    for (; *s; s++) {
+        unsigned char ch = (unsigned char)*s;
+        if (ch == '"' || ch == '\\') {
+            fprintf(out, "\\%c", ch);
+        } else if (ch < 0x20) {
+            fprintf(out, "\\u%04x", ch);
+        } else {
+            fputc(ch, out);
+        }
+    }
+    fputc('"', out);
+}
+
+// First line of a command's output, empty on failure
+static void command_output(const char *command, char *buf, size_t size) {
+    buf[0] = '\0';
+
+    FILE *p = popen(command, "r");
+    if (p == NULL) {
+        return;
+    }
+    if (fgets(buf, (int)size, p) == NULL) {
+        buf[0] = '\0';
+    }
+    pclose(p);
+    buf[strcspn(buf, "\r\n")] = '\0';
+}
+
+// Value of a "key : value" line in a /proc file
+static void proc_field(const char *path, const char *key, char *buf, size_t size) {
+    buf[0] = '\0';
+
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return;
+    }
+
+    char line[512];
+    size_t key_len = strlen(key);
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (strncmp(line, key, key_len) != 0) {
+            continue;
+        }
+        char *v = strchr(line + key_len, ':');
+        if (v == NULL) {
+            continue;
+        }
+        v++;
+        while (*v == ' ' || *v == '\t') {
+            v++;
+        }
+        v[strcspn(v, "\r\n")] = '\0';
+        snprintf(buf, size, "%s", v);
+        break;
+    }
+    fclose(f);
+}
+
+/**
+ * Print metadata object
+ */
+void bench_meta_print_json(FILE *out, const char *indent) {
+    char timestamp[64];
+    time_t now = time(NULL);
+    struct tm tm;
+    gmtime_r(&now, &tm);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", &tm);
+
+    char hostname[256] = "";
+    gethostname(hostname, sizeof(hostname) - 1);
+
+    struct utsname uts;
+    char kernel[512] = "";
+    if (uname(&uts) == 0) {
+        snprintf(kernel, sizeof(kernel), "%s %s %s", uts.sysname, uts.release, uts.machine);
+    }
+
+    char cpu_model[256];
+    proc_field("/proc/cpuinfo", "model name", cpu_model, sizeof(cpu_model));
+    char mem_total[64];
+    proc_field("/proc/meminfo", "MemTotal", mem_total, sizeof(mem_total));
+
+    char revision[128];
+    int dirty = 0;
+    const char *env_rev = getenv("BENCH_GIT_REV");
+    if (env_rev != NULL && env_rev[0] != '\0') {
+        snprintf(revision, sizeof(revision), "%s", env_rev);
+    } else {
+        char status[8];
+        command_output("git rev-parse HEAD 2>/dev/null", revision, sizeof(revision));
+        command_output("git status --porcelain --untracked-files=no 2>/dev/null", status, sizeof(status));
+        dirty = status[0] != '\0';
+    }
+
+    fprintf(out, "{\n");
+    fprintf(out, "%s  \"timestamp\": \"%s\",\n", indent, timestamp);
+    fprintf(out, "%s  \"hostname\": ", indent);
+    bench_json_string(out, hostname);
+    fprintf(out, ",\n%s  \"kernel\": ", indent);
+    bench_json_string(out, kernel);
+    fprintf(out, ",\n%s  \"cpu_model\": ", indent);
+    bench_json_string(out, cpu_model);
+    fprintf(out, ",\n%s  \"cpus_online\": %ld,\n", indent, sysconf(_SC_NPROCESSORS_ONLN));
+    fprintf(out, "%s  \"mem_total_kb\": %lu,\n", indent, strtoul(mem_total, NULL, 10));
+    fprintf(out, "%s  \"compiler\": ", indent);
+    bench_json_string(out, __VERSION__);
+    fprintf(out, ",\n%s  \"git_revision\": ", indent);
+    bench_json_string(out, revision[0] ? revision : "unknown");
+    fprintf(out, ",\n%s  \"git_dirty\": %s,\n", indent, dirty ? "true" : "false");
+    fprintf(out, "%s  \"labels\": {", indent);
+    for (int i = 0; i < g_label_count; i++) {
+        fprintf(out, "%s\n%s    ", i ? "," : "", indent);
+        bench_json_string(out, g_label_keys[i]);
+        fprintf(out, ": ");
+        bench_json_string(out, g_label_values[i]);
+    }
+    if (g_label_count > 0) {
+        fprintf(out, "\n%s  ", indent);
+    }
+    fprintf(out, "}\n");
+    fprintf(out, "%s}", indent);
+}
@@ -0,0 +1,38 @@
+/**
+ * 基准测试元数据头文件
+ * 为各测试工具的JSON结果附加机器信息、git版本与用户标签，
+ * 使不同时间、不同机器上的结果可以被追溯和比较
+ */
+
+#ifndef BENCH_META_H
+#define BENCH_META_H
+
+#include <stdio.h>
+
+// 最多的用户标签数
+#define BENCH_META_MAX_LABELS 16
+
+/**
+ * 添加一个用户标签（如 scenario=proxy）
+ * @param spec "key=value" 格式的标签
+ * @return 成功返回0，格式错误或标签过多返回-1
+ */
+int bench_meta_add_label(const char *spec);
+
+/**
+ * 以JSON对象形式输出元数据
+ * 包括时间戳、主机名、内核、CPU型号与数量、内存、编译器、git版本及用户标签；
+ * git版本优先取环境变量BENCH_GIT_REV，否则在当前目录执行git查询
+ * @param out 输出流
+ * @param indent 每行前缀的缩进
+ */
+void bench_meta_print_json(FILE *out, const char *indent);
+
+/**
+ * 输出JSON字符串字面量（带引号与转义）
+ * @param out 输出流
+ * @param s 字符串
+ */
+void bench_json_string(FILE *out, const char *s);
+
+#endif /* BENCH_META_H */
@@ -0,0 +1,158 @@
+/**
+ * HDR-style Latency Histogram Implementation
+ * Log-linear buckets with bounded relative error, shared by the benchmark tools
+ */
+
+#include <string.h>
+#include <math.h>
+
+#include "hdr_histogram.h"
+
+// Map a value to its bucket index
+static int bucket_index(uint64_t value) {
+    if (value < HDR_LINEAR_BUCKETS) {
+        return (int)value;
+    }
+
+    // Level L covers [64 << L, 128 << L) with 64 buckets of width 1 << L
+    int level = 63 - __builtin_clzll(value) - 6;
+    int index = HDR_LINEAR_BUCKETS + (level - 1) * HDR_SUB_BUCKETS +
+                (int)((value >> level) - HDR_SUB_BUCKETS);
+
+    return index < HDR_BUCKET_COUNT ? index : HDR_BUCKET_COUNT - 1;
+}
+
+// Highest value that maps to a bucket
+static uint64_t bucket_upper_bound(int index) {
+    if (index < HDR_LINEAR_BUCKETS) {
+        return (uint64_t)index;
+    }
+
+    int level = (index - HDR_LINEAR_BUCKETS) / HDR_SUB_BUCKETS + 1;
+    uint64_t sub = (uint64_t)((index - HDR_LINEAR_BUCKETS) % HDR_SUB_BUCKETS) + HDR_SUB_BUCKETS;
+    return ((sub + 1) << level) - 1;
+}
+
+/**
+ * Initialize histogram
+ */
+void hdr_init(hdr_histogram_t *h) {
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+/**
+ * Record one value
+ */
+void hdr_record(hdr_histogram_t *h, uint64_t value) {
+    h->counts[bucket_index(value)]++;
+    h->total_count++;
+    if (value < h->min) {
+        h->min = value;
+    }
+    if (value > h->max) {
+        h->max = value;
+    }
+    h->sum += (double)value;
+    h->sum_sq += (double)value * (double)value;
+}
+
+/**
+ * Merge src into dst
+ */
+void hdr_merge(hdr_histogram_t *dst, const hdr_histogram_t *src) {
+    if (src->total_count == 0) {
+        return;
+    }
+
+    for (int i = 0; i < HDR_BUCKET_COUNT; i++) {
+        dst->counts[i] += src->counts[i];
+    }
+    dst->total_count += src->total_count;
+    if (src->min < dst->min) {
+        dst->min = src->min;
+    }
+    if (src->max > dst->max) {
+        dst->max = src->max;
+    }
+    dst->sum += src->sum;
+    dst->sum_sq += src->sum_sq;
+}
+
+/**
+ * Value at percentile
+ */
+uint64_t hdr_value_at_percentile(const hdr_histogram_t *h, double percentile) {
+    if (h->total_count == 0) {
+        return 0;
+    }
+
+    if (percentile > 100.0) {
+        percentile = 100.0;
+    }
+
+    uint64_t target = (uint64_t)ceil(percentile / 100.0 * (double)h->total_count);
+    if (target == 0) {
+        target = 1;
+    }
+
+    uint64_t seen = 0;
+    for (int i = 0; i < HDR_BUCKET_COUNT; i++) {
+        seen += h->counts[i];
+        if (seen >= target) {
+            // Bucket bounds are approximate, never report beyond the observed range
+            uint64_t value = bucket_upper_bound(i);
+            if (value > h->max) {
+                value = h->max;
+            }
+            if (value < h->min) {
+                value = h->min;
+            }
+            return value;
+        }
+    }
+
+    return h->max;
+}
+
+/**
+ * Mean value
+ */
+double hdr_mean(const hdr_histogram_t *h) {
+    return h->total_count ? h->sum / (double)h->total_count : 0.0;
+}
+
+/**
+ * Standard deviation
+ */
+double hdr_stddev(const hdr_histogram_t *h) {
+    if (h->total_count == 0) {
+        return 0.0;
+    }
+
+    double mean = hdr_mean(h);
+    double variance = h->sum_sq / (double)h->total_count - mean * mean;
+    return variance > 0 ? sqrt(variance) : 0.0;
+}
+
+/**
+ * Print summary as a JSON object
+ */
+void hdr_print_json(const hdr_histogram_t *h, FILE *out, const char *indent) {
+    static const struct { const char *name; double value; } percentiles[] = {
+        {"p50", 50.0}, {"p75", 75.0}, {"p90", 90.0}, {"p99", 99.0},
+        {"p99_9", 99.9}, {"p99_99", 99.99}
+    };
+
+    fprintf(out, "{\n");
+    fprintf(out, "%s  \"count\": %lu,\n", indent, h->total_count);
+    fprintf(out, "%s  \"min\": %lu,\n", indent, h->total_count ? h->min : 0);
+    fprintf(out, "%s  \"mean\": %.2f,\n", indent, hdr_mean(h));
+    fprintf(out, "%s  \"stdev\": %.2f,\n", indent, hdr_stddev(h));
+    for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+        fprintf(out, "%s  \"%s\": %lu,\n", indent, percentiles[i].name,
+                hdr_value_at_percentile(h, percentiles[i].value));
+    }
+    fprintf(out, "%s  \"max\": %lu\n", indent, h->max);
+    fprintf(out, "%s}", indent);
+}
@@ -0,0 +1,80 @@
+/**
+ * 延迟直方图（HDR风格）头文件
+ * 对数-线性分桶：小于128的值精确记录，之后每个2的幂区间分为64个子桶，
+ * 相对误差不超过1/64，固定内存、O(1)记录，可合并多个线程的直方图
+ */
+
+#ifndef HDR_HISTOGRAM_H
+#define HDR_HISTOGRAM_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// 线性区间的桶数（0..127精确记录）
+#define HDR_LINEAR_BUCKETS 128
+// 每个2的幂区间的子桶数
+#define HDR_SUB_BUCKETS 64
+// 覆盖到2^40（微秒约12天）所需的桶数
+#define HDR_BUCKET_COUNT (HDR_LINEAR_BUCKETS + 34 * HDR_SUB_BUCKETS)
+
+// 直方图
+typedef struct hdr_histogram {
+    uint64_t counts[HDR_BUCKET_COUNT];
+    uint64_t total_count;
+    uint64_t min;
+    uint64_t max;
+    double sum;
+    double sum_sq;
+} hdr_histogram_t;
+
+/**
+ * 初始化（清空）直方图
+ * @param h 直方图
+ */
+void hdr_init(hdr_histogram_t *h);
+
+/**
+ * 记录一个值
+ * @param h 直方图
+ * @param value 记录值（单位由调用者决定，通常为微秒）
+ */
+void hdr_record(hdr_histogram_t *h, uint64_t value);
+
+/**
+ * 将src合并到dst
+ * @param dst 目标直方图
+ * @param src 源直方图
+ */
+void hdr_merge(hdr_histogram_t *dst, const hdr_histogram_t *src);
+
+/**
+ * 查询百分位值
+ * @param h 直方图
+ * @param percentile 百分位(0-100)
+ * @return 该百分位所在桶的上界，空直方图返回0
+ */
+uint64_t hdr_value_at_percentile(const hdr_histogram_t *h, double percentile);
+
+/**
+ * 平均值
+ * @param h 直方图
+ * @return 平均值，空直方图返回0
+ */
+double hdr_mean(const hdr_histogram_t *h);
+
+/**
+ * 标准差
+ * @param h 直方图
+ * @return 标准差，空直方图返回0
+ */
+double hdr_stddev(const hdr_histogram_t *h);
+
+/**
+ * 以JSON对象输出统计摘要（min/mean/stdev/百分位/max）
+ * @param h 直方图
+ * @param out 输出文件
+ * @param indent 缩进字符串
+ */
+void hdr_print_json(const hdr_histogram_t *h, FILE *out, const char *indent);
+
+#endif /* HDR_HISTOGRAM_H */
@@ -0,0 +1,1254 @@
+/**
+ * X-Server HTTP Load Generator
+ * Epoll-driven client with keep-alive/close connections, weighted request mix,
+ * pipelining and open-loop rate control. In open-loop mode latency is measured
+ * from each request's scheduled send time, so a stalled server is charged for
+ * the requests it delayed (coordinated omission correction).
+ *
+ * Usage: x-loadgen [options] <host:port>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <netdb.h>
+#include <signal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "hdr_histogram.h"
+#include "bench_meta.h"
+
+#define MAX_PATHS 64
+#define MAX_HEADERS 16
+#define MAX_PIPELINE 64
+#define MAX_REQUEST_LEN 2048
+#define READ_BUFFER_SIZE (64 * 1024)
+#define MAX_EVENTS 256
+#define HOUSEKEEPING_MS 50
+#define RECONNECT_BACKOFF_NS (50 * 1000000ULL)
+
+// Connection states
+enum {
+    CONN_CLOSED = 0,
+    CONN_CONNECTING,
+    CONN_OPEN
+};
+
+// Response parser states
+enum {
+    PARSE_HEADERS = 0,
+    PARSE_BODY,
+    PARSE_CHUNK_SIZE,
+    PARSE_CHUNK_DATA,
+    PARSE_CHUNK_TRAILER,
+    PARSE_UNTIL_CLOSE
+};
+
+// One entry of the request mix
+typedef struct request_spec {
+    char method[16];
+    char path[1024];
+    unsigned int weight;
+    char request[MAX_REQUEST_LEN];
+    size_t request_len;
+} request_spec_t;
+
+// Command line options
+typedef struct loadgen_options {
+    char host[256];
+    char port[16];
+    int connections;
+    int threads;
+    int duration;
+    uint64_t requests;
+    int pipeline;
+    double rate;
+    int keep_alive;
+    int timeout;
+    const char *json_path;
+    int quiet;
+    request_spec_t paths[MAX_PATHS];
+    int path_count;
+    unsigned int total_weight;
+    char headers[MAX_HEADERS][256];
+    int header_count;
+} loadgen_options_t;
+
+// Request waiting for its response
+typedef struct pending_request {
+    uint64_t intended_ns;   // Scheduled send time (open-loop) or first send time
+    uint64_t sent_ns;       // Time the request was written to the current connection
+    int path;
+} pending_request_t;
+
+// Counters owned by one thread
+typedef struct loadgen_counters {
+    uint64_t responses;
+    uint64_t bytes_read;
+    uint64_t status[6];     // Index by status / 100
+    uint64_t connect_errors;
+    uint64_t read_errors;
+    uint64_t write_errors;
+    uint64_t timeouts;
+    uint64_t parse_errors;
+    uint64_t reconnects;
+    uint64_t path_responses[MAX_PATHS];
+} loadgen_counters_t;
+
+struct loadgen_thread;
+
+// Client connection
+typedef struct client_conn {
+    int fd;
+    int state;
+    struct loadgen_thread *thread;
+    uint64_t connect_ns;
+    uint64_t reconnect_at_ns;
+    uint64_t responses;     // Responses received since connect
+
+    pending_request_t queue[MAX_PIPELINE];
+    int head;
+    int count;
+
+    char *wbuf;
+    size_t wlen;
+    size_t woff;
+
+    char rbuf[READ_BUFFER_SIZE];
+    size_t rlen;
+    int parse_state;
+    uint64_t body_remaining;
+    int status;
+    int close_after;
+} client_conn_t;
+
+// Load generating thread
+typedef struct loadgen_thread {
+    pthread_t tid;
+    int id;
+    int epfd;
+    int timerfd;
+    client_conn_t *conns;
+    int conn_count;
+    int rr_cursor;
+    unsigned int seed;
+
+    uint64_t interval_ns;   // Open-loop request interval, 0 for closed-loop
+    uint64_t next_send_ns;
+    int timer_armed;
+
+    hdr_histogram_t latency;            // Corrected in open-loop, raw otherwise
+    hdr_histogram_t service_latency;    // Always measured from the actual send
+    loadgen_counters_t counters;
+    uint64_t finished_ns;
+} loadgen_thread_t;
+
+static loadgen_options_t g_opts;
+static struct sockaddr_storage g_addr;
+static socklen_t g_addrlen;
+static uint64_t g_start_ns;
+static uint64_t g_timeout_ns;
+static atomic_int g_stop = 0;
+static atomic_int g_budget_exhausted = 0;
+static atomic_int_fast64_t g_budget = 0;
+static atomic_int g_threads_done = 0;
+
+// Monotonic clock in nanoseconds
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void handle_signal(int sig) {
+    (void)sig;
+    atomic_store(&g_stop, 1);
+}
+
+static void show_help(const char *program_name) {
+    printf("Usage: %s [options] <host:port>\n", program_name);
+    printf("\n");
+    printf("Options:\n");
+    printf("  -c <n>          Connections (default: 64)\n");
+    printf("  -t <n>          Threads (default: 2)\n");
+    printf("  -d <sec>        Duration in seconds (default: 10)\n");
+    printf("  -n <n>          Stop after n requests (default: unlimited, bounded by -d)\n");
+    printf("  -p <n>          Pipelining depth per connection (default: 1, max: %d)\n", MAX_PIPELINE);
+    printf("  -R <rate>       Open-loop total request rate in req/s (default: 0, closed-loop)\n");
+    printf("  -u <spec>       Request mix entry \"[METHOD ]PATH[@WEIGHT]\", repeatable (default: GET /)\n");
+    printf("  -H <header>     Extra request header, repeatable\n");
+    printf("  -C              Close connection after each response (default: keep-alive)\n");
+    printf("  -T <sec>        Request timeout in seconds (default: 5)\n");
+    printf("  -j <file>       Write JSON results to file (\"-\" for stdout)\n");
+    printf("  -m <key=value>  Label stored in the JSON metadata, repeatable (e.g. scenario=proxy)\n");
+    printf("  -q              Do not print the text report\n");
+    printf("  -h              Show help information\n");
+    printf("\n");
+    printf("Examples:\n");
+    printf("  %s -c 128 -d 30 127.0.0.1:9001\n", program_name);
+    printf("  %s -R 20000 -u /index.html@3 -u /css/style.css 127.0.0.1:9001\n", program_name);
+}
+
+// Parse "[METHOD ]PATH[@WEIGHT]" into the request mix
+static int add_request_spec(const char *spec) {
+    if (g_opts.path_count >= MAX_PATHS) {
+        fprintf(stderr, "Too many request mix entries (max %d)\n", MAX_PATHS);
+        return -1;
+    }
+
+    request_spec_t *r = &g_opts.paths[g_opts.path_count];
+    memset(r, 0, sizeof(*r));
+    strcpy(r->method, "GET");
+    r->weight = 1;
+
+    const char *path = spec;
+    const char *space = strchr(spec, ' ');
+    if (space != NULL) {
+        size_t len = (size_t)(space - spec);
+        if (len == 0 || len >= sizeof(r->method)) {
+            fprintf(stderr, "Invalid method in request spec: %s\n", spec);
+            return -1;
+        }
+        memcpy(r->method, spec, len);
+        r->method[len] = '\0';
+        path = space + 1;
+    }
+
+    size_t path_len = strlen(path);
+    const char *at = strrchr(path, '@');
+    if (at != NULL && at[1] != '\0' && strspn(at + 1, "0123456789") == strlen(at + 1)) {
+        r->weight = (unsigned int)strtoul(at + 1, NULL, 10);
+        path_len = (size_t)(at - path);
+    }
+
+    if (path_len == 0 || path_len >= sizeof(r->path) || path[0] != '/' || r->weight == 0) {
+        fprintf(stderr, "Invalid request spec: %s\n", spec);
+        return -1;
+    }
+    memcpy(r->path, path, path_len);
+    r->path[path_len] = '\0';
+
+    g_opts.path_count++;
+    return 0;
+}
+
+// Render the raw request bytes of every mix entry
+static int build_requests(void) {
+    char extra[MAX_HEADERS * 258 + 1] = "";
+    size_t extra_len = 0;
+
+    for (int i = 0; i < g_opts.header_count; i++) {
+        extra_len += (size_t)snprintf(extra + extra_len, sizeof(extra) - extra_len, "%s\r\n", g_opts.headers[i]);
+    }
+
+    g_opts.total_weight = 0;
+    for (int i = 0; i < g_opts.path_count; i++) {
+        request_spec_t *r = &g_opts.paths[i];
+        int has_body = strcmp(r->method, "GET") != 0 && strcmp(r->method, "HEAD") != 0;
+
+        int len = snprintf(r->request, sizeof(r->request),
+                           "%s %s HTTP/1.1\r\n"
+                           "Host: %s:%s\r\n"
+                           "User-Agent: x-loadgen\r\n"
+                           "%s%s"
+                           "Connection: %s\r\n"
+                           "\r\n",
+                           r->method, r->path, g_opts.host, g_opts.port,
+                           extra, has_body ? "Content-Length: 0\r\n" : "",
+                           g_opts.keep_alive ? "keep-alive" : "close");
+        if (len < 0 || (size_t)len >= sizeof(r->request)) {
+            fprintf(stderr, "Request too long for path: %s\n", r->path);
+            return -1;
+        }
+        r->request_len = (size_t)len;
+        g_opts.total_weight += r->weight;
+    }
+
+    return 0;
+}
+
+// Pick a request mix entry by weight
+static int pick_path(loadgen_thread_t *t) {
+    if (g_opts.path_count == 1) {
+        return 0;
+    }
+
+    unsigned int r = (unsigned int)rand_r(&t->seed) % g_opts.total_weight;
+    for (int i = 0; i < g_opts.path_count; i++) {
+        if (r < g_opts.paths[i].weight) {
+            return i;
+        }
+        r -= g_opts.paths[i].weight;
+    }
+    return g_opts.path_count - 1;
+}
+
+// Reserve one request from the global budget (-n)
+static int reserve_request(void) {
+    if (atomic_load_explicit(&g_stop, memory_order_relaxed)) {
+        return 0;
+    }
+    if (g_opts.requests == 0) {
+        return 1;
+    }
+    if (atomic_fetch_sub(&g_budget, 1) > 0) {
+        return 1;
+    }
+    atomic_store(&g_budget_exhausted, 1);
+    return 0;
+}
+
+static void reset_parser(client_conn_t *c) {
+    c->rlen = 0;
+    c->parse_state = PARSE_HEADERS;
+    c->body_remaining = 0;
+    c->status = 0;
+    c->close_after = 0;
+}
+
+static void conn_open(client_conn_t *c, uint64_t now);
+
+// Whether a closed connection should be reopened
+static int conn_wanted(const client_conn_t *c) {
+    if (atomic_load_explicit(&g_stop, memory_order_relaxed)) {
+        return 0;
+    }
+    // After the budget is spent only reconnect to finish requeued requests
+    return !atomic_load_explicit(&g_budget_exhausted, memory_order_relaxed) || c->count > 0;
+}
+
+/**
+ * Close a connection and reconnect, immediately or after a backoff
+ * Pending requests are kept for resending when requeue is set, dropped otherwise
+ */
+static void conn_close(client_conn_t *c, int requeue, uint64_t delay_ns) {
+    if (c->fd >= 0) {
+        close(c->fd);
+        c->fd = -1;
+    }
+    c->state = CONN_CLOSED;
+    c->wlen = 0;
+    c->woff = 0;
+    reset_parser(c);
+    if (!requeue) {
+        c->head = 0;
+        c->count = 0;
+    }
+    uint64_t now = now_ns();
+    c->reconnect_at_ns = now + delay_ns;
+    if (delay_ns == 0 && conn_wanted(c)) {
+        conn_open(c, now);
+    }
+}
+
+// Write buffered request bytes until the socket would block
+static int conn_flush(client_conn_t *c) {
+    while (c->woff < c->wlen) {
+        ssize_t n = send(c->fd, c->wbuf + c->woff, c->wlen - c->woff, MSG_NOSIGNAL);
+        if (n > 0) {
+            c->woff += (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        }
+        c->thread->counters.write_errors++;
+        conn_close(c, 1, RECONNECT_BACKOFF_NS);
+        return -1;
+    }
+
+    c->wlen = 0;
+    c->woff = 0;
+    return 0;
+}
+
+// Append the request bytes of one pending entry to the write buffer
+static void conn_append(client_conn_t *c, pending_request_t *p) {
+    const request_spec_t *r = &g_opts.paths[p->path];
+    memcpy(c->wbuf + c->wlen, r->request, r->request_len);
+    c->wlen += r->request_len;
+}
+
+// Queue a new request on an open connection
+static void conn_enqueue(client_conn_t *c, uint64_t intended_ns, uint64_t now) {
+    pending_request_t *p = &c->queue[(c->head + c->count) % MAX_PIPELINE];
+    p->intended_ns = intended_ns;
+    p->sent_ns = now;
+    p->path = pick_path(c->thread);
+    c->count++;
+    conn_append(c, p);
+}
+
+// Keep the pipeline full in closed-loop mode
+static void conn_fill(client_conn_t *c, uint64_t now) {
+    if (c->state != CONN_OPEN || c->thread->interval_ns != 0) {
+        return;
+    }
+
+    int depth = g_opts.keep_alive ? g_opts.pipeline : 1;
+    int queued = 0;
+    while (c->count < depth && reserve_request()) {
+        conn_enqueue(c, now, now);
+        queued++;
+    }
+    if (queued > 0) {
+        conn_flush(c);
+    }
+}
+
+// Connection became writable for the first time
+static void conn_established(client_conn_t *c, uint64_t now) {
+    c->state = CONN_OPEN;
+    c->responses = 0;
+
+    // Resend requests left unanswered by the previous connection
+    for (int i = 0; i < c->count; i++) {
+        pending_request_t *p = &c->queue[(c->head + i) % MAX_PIPELINE];
+        p->sent_ns = now;
+        conn_append(c, p);
+    }
+    if (c->count > 0 && conn_flush(c) < 0) {
+        return;
+    }
+
+    conn_fill(c, now);
+}
+
+// Start a non-blocking connect
+static void conn_open(client_conn_t *c, uint64_t now) {
+    loadgen_thread_t *t = c->thread;
+
+    int fd = socket(g_addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        t->counters.connect_errors++;
+        c->reconnect_at_ns = now + RECONNECT_BACKOFF_NS;
+        return;
+    }
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    c->fd = fd;
+    c->connect_ns = now;
+    reset_parser(c);
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = c;
+    if (epoll_ctl(t->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        t->counters.connect_errors++;
+        conn_close(c, 1, RECONNECT_BACKOFF_NS);
+        return;
+    }
+
+    if (connect(fd, (struct sockaddr *)&g_addr, g_addrlen) == 0) {
+        conn_established(c, now);
+    } else if (errno == EINPROGRESS) {
+        c->state = CONN_CONNECTING;
+    } else {
+        t->counters.connect_errors++;
+        conn_close(c, 1, RECONNECT_BACKOFF_NS);
+    }
+}
+
+/**
+ * Account a complete response
+ * @return 0 to keep parsing, -1 when the connection was closed
+ */
+static int complete_response(client_conn_t *c, uint64_t now) {
+    loadgen_thread_t *t = c->thread;
+
+    if (c->count == 0) {
+        // Response without a request
+        t->counters.parse_errors++;
+        conn_close(c, 0, 0);
+        return -1;
+    }
+
+    pending_request_t *p = &c->queue[c->head];
+    c->head = (c->head + 1) % MAX_PIPELINE;
+    c->count--;
+    c->responses++;
+
+    hdr_record(&t->latency, (now - p->intended_ns) / 1000);
+    hdr_record(&t->service_latency, (now - p->sent_ns) / 1000);
+    t->counters.responses++;
+    t->counters.path_responses[p->path]++;
+    if (c->status >= 100 && c->status < 600) {
+        t->counters.status[c->status / 100]++;
+    }
+
+    int close_after = c->close_after || !g_opts.keep_alive;
+    c->parse_state = PARSE_HEADERS;
+    c->status = 0;
+    c->close_after = 0;
+
+    if (close_after) {
+        if (g_opts.keep_alive) {
+            t->counters.reconnects++;
+        }
+        conn_close(c, 1, 0);
+        return -1;
+    }
+
+    conn_fill(c, now);
+    return c->state == CONN_OPEN ? 0 : -1;
+}
+
+// Find a header line value (case-insensitive name), returns NULL if absent
+static const char *find_header(const char *headers, const char *end, const char *name, size_t *value_len) {
+    size_t name_len = strlen(name);
+    const char *line = headers;
+
+    while (line < end) {
+        const char *eol = memmem(line, (size_t)(end - line), "\r\n", 2);
+        if (eol == NULL) {
+            eol = end;
+        }
+        if ((size_t)(eol - line) > name_len && line[name_len] == ':' &&
+            strncasecmp(line, name, name_len) == 0) {
+            const char *value = line + name_len + 1;
+            while (value < eol && (*value == ' ' || *value == '\t')) {
+                value++;
+            }
+            *value_len = (size_t)(eol - value);
+            return value;
+        }
+        line = eol + 2;
+    }
+
+    return NULL;
+}
+
+// Case-insensitive token search within a header value
+static int value_contains(const char *value, size_t len, const char *token) {
+    size_t token_len = strlen(token);
+    for (size_t i = 0; i + token_len <= len; i++) {
+        if (strncasecmp(value + i, token, token_len) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Parse the status line and headers of one response
+ * @return 0 on success, -1 on malformed response
+ */
+static int parse_headers(client_conn_t *c, const char *start, const char *end) {
+    if (end - start < 12 || strncmp(start, "HTTP/1.", 7) != 0) {
+        return -1;
+    }
+
+    c->status = atoi(start + 9);
+    int http10 = start[7] == '0';
+
+    const char *headers = memmem(start, (size_t)(end - start), "\r\n", 2);
+    headers = headers ? headers + 2 : end;
+
+    size_t len = 0;
+    const char *value = find_header(headers, end, "Connection", &len);
+    if (value != NULL) {
+        c->close_after = value_contains(value, len, "close");
+    } else {
+        c->close_after = http10;
+    }
+
+    pending_request_t *p = &c->queue[c->head];
+    int no_body = c->count > 0 && strcmp(g_opts.paths[p->path].method, "HEAD") == 0;
+    if (no_body || c->status < 200 || c->status == 204 || c->status == 304) {
+        c->parse_state = PARSE_HEADERS;
+        c->body_remaining = 0;
+        return 0;
+    }
+
+    value = find_header(headers, end, "Transfer-Encoding", &len);
+    if (value != NULL && value_contains(value, len, "chunked")) {
+        c->parse_state = PARSE_CHUNK_SIZE;
+        return 0;
+    }
+
+    value = find_header(headers, end, "Content-Length", &len);
+    if (value != NULL) {
+        c->body_remaining = strtoull(value, NULL, 10);
+        c->parse_state = PARSE_BODY;
+        return 0;
+    }
+
+    // No framing, body ends with the connection
+    c->parse_state = PARSE_UNTIL_CLOSE;
+    c->close_after = 1;
+    return 0;
+}
+
+/**
+ * Consume complete responses from the read buffer
+ * @return 0 to keep reading, -1 when the connection was closed
+ */
+static int parse_responses(client_conn_t *c, uint64_t now) {
+    size_t pos = 0;
+
+    while (pos < c->rlen) {
+        char *data = c->rbuf + pos;
+        size_t avail = c->rlen - pos;
+
+        if (c->parse_state == PARSE_HEADERS) {
+            char *end = memmem(data, avail, "\r\n\r\n", 4);
+            if (end == NULL) {
+                break;
+            }
+            if (parse_headers(c, data, end + 2) < 0) {
+                c->thread->counters.parse_errors++;
+                conn_close(c, 0, 0);
+                return -1;
+            }
+            pos += (size_t)(end - data) + 4;
+            if (c->parse_state == PARSE_HEADERS ||
+                (c->parse_state == PARSE_BODY && c->body_remaining == 0)) {
+                if (complete_response(c, now) < 0) {
+                    return -1;
+                }
+            }
+        } else if (c->parse_state == PARSE_BODY || c->parse_state == PARSE_CHUNK_DATA) {
+            size_t take = avail < c->body_remaining ? avail : (size_t)c->body_remaining;
+            pos += take;
+            c->body_remaining -= take;
+            if (c->body_remaining == 0) {
+                if (c->parse_state == PARSE_CHUNK_DATA) {
+                    c->parse_state = PARSE_CHUNK_SIZE;
+                } else if (complete_response(c, now) < 0) {
+                    return -1;
+                }
+            }
+        } else if (c->parse_state == PARSE_CHUNK_SIZE || c->parse_state == PARSE_CHUNK_TRAILER) {
+            char *eol = memmem(data, avail, "\r\n", 2);
+            if (eol == NULL) {
+                break;
+            }
+            pos += (size_t)(eol - data) + 2;
+            if (c->parse_state == PARSE_CHUNK_SIZE) {
+                uint64_t size = strtoull(data, NULL, 16);
+                if (size == 0) {
+                    c->parse_state = PARSE_CHUNK_TRAILER;
+                } else {
+                    c->body_remaining = size + 2;
+                    c->parse_state = PARSE_CHUNK_DATA;
+                }
+            } else if (eol == data) {
+                // Empty line ends the trailer section
+                if (complete_response(c, now) < 0) {
+                    return -1;
+                }
+            }
+        } else {
+            // PARSE_UNTIL_CLOSE: discard
+            pos = c->rlen;
+        }
+    }
+
+    if (pos > 0) {
+        memmove(c->rbuf, c->rbuf + pos, c->rlen - pos);
+        c->rlen -= pos;
+    }
+    if (c->rlen == sizeof(c->rbuf)) {
+        // Header block larger than the read buffer
+        c->thread->counters.parse_errors++;
+        conn_close(c, 0, 0);
+        return -1;
+    }
+    return 0;
+}
+
+// Peer closed the connection (EOF or reset)
+static void conn_peer_closed(client_conn_t *c, uint64_t now) {
+    loadgen_thread_t *t = c->thread;
+
+    if (c->parse_state == PARSE_UNTIL_CLOSE && c->count > 0) {
+        c->close_after = 0;
+        c->parse_state = PARSE_HEADERS;
+        if (complete_response(c, now) < 0) {
+            return;
+        }
+    }
+
+    if (c->count > 0) {
+        if (c->responses == 0) {
+            // Nothing answered on this connection, drop the head request to avoid retrying forever
+            t->counters.read_errors++;
+            c->head = (c->head + 1) % MAX_PIPELINE;
+            c->count--;
+        } else {
+            t->counters.reconnects++;
+        }
+    }
+
+    conn_close(c, 1, 0);
+}
+
+// Read until the socket would block
+static void conn_read(client_conn_t *c, uint64_t now) {
+    while (c->state == CONN_OPEN) {
+        ssize_t n = recv(c->fd, c->rbuf + c->rlen, sizeof(c->rbuf) - c->rlen, 0);
+        if (n > 0) {
+            c->thread->counters.bytes_read += (uint64_t)n;
+            c->rlen += (size_t)n;
+            if (parse_responses(c, now) < 0) {
+                return;
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        if (n == 0 || errno == ECONNRESET) {
+            conn_peer_closed(c, now);
+        } else {
+            c->thread->counters.read_errors++;
+            conn_close(c, 1, RECONNECT_BACKOFF_NS);
+        }
+        return;
+    }
+}
+
+// Handle readiness of one connection
+static void conn_event(client_conn_t *c, uint32_t events, uint64_t now) {
+    if (c->state == CONN_CONNECTING) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0) {
+            c->thread->counters.connect_errors++;
+            conn_close(c, 1, RECONNECT_BACKOFF_NS);
+            return;
+        }
+        if (!(events & (EPOLLOUT | EPOLLIN))) {
+            return;
+        }
+        conn_established(c, now);
+    }
+
+    if (c->state == CONN_OPEN && (events & EPOLLOUT) && c->woff < c->wlen) {
+        if (conn_flush(c) < 0) {
+            return;
+        }
+    }
+
+    if (c->state == CONN_OPEN && (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) {
+        conn_read(c, now);
+    }
+}
+
+// Hand out due open-loop requests to connections with free pipeline slots
+static void dispatch_scheduled(loadgen_thread_t *t, uint64_t now) {
+    int depth = g_opts.keep_alive ? g_opts.pipeline : 1;
+
+    while (t->next_send_ns <= now) {
+        client_conn_t *target = NULL;
+        for (int i = 0; i < t->conn_count; i++) {
+            client_conn_t *c = &t->conns[(t->rr_cursor + i) % t->conn_count];
+            if (c->state == CONN_OPEN && c->count < depth) {
+                target = c;
+                t->rr_cursor = (t->rr_cursor + i + 1) % t->conn_count;
+                break;
+            }
+        }
+
+        // All connections busy: the request stays due and its latency keeps growing
+        if (target == NULL || !reserve_request()) {
+            return;
+        }
+
+        conn_enqueue(target, t->next_send_ns, now);
+        t->next_send_ns += t->interval_ns;
+        conn_flush(target);
+    }
+}
+
+// Arm the timer for the next scheduled send
+static void arm_send_timer(loadgen_thread_t *t) {
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+
+    its.it_value.tv_sec = (time_t)(t->next_send_ns / 1000000000ULL);
+    its.it_value.tv_nsec = (long)(t->next_send_ns % 1000000000ULL);
+    if (timerfd_settime(t->timerfd, TFD_TIMER_ABSTIME, &its, NULL) == 0) {
+        t->timer_armed = 1;
+    }
+}
+
+// Timeouts and reconnects
+static void housekeeping(loadgen_thread_t *t) {
+    // Fresh clock: connections reopened while handling events carry newer timestamps
+    uint64_t now = now_ns();
+
+    for (int i = 0; i < t->conn_count; i++) {
+        client_conn_t *c = &t->conns[i];
+
+        if (c->state == CONN_CLOSED) {
+            if (conn_wanted(c) && now >= c->reconnect_at_ns) {
+                conn_open(c, now);
+            }
+            continue;
+        }
+
+        if (c->state == CONN_CONNECTING && now - c->connect_ns > g_timeout_ns) {
+            t->counters.connect_errors++;
+            conn_close(c, 1, 0);
+            continue;
+        }
+
+        if (c->count > 0 && now - c->queue[c->head].sent_ns > g_timeout_ns) {
+            t->counters.timeouts += (uint64_t)c->count;
+            conn_close(c, 0, 0);
+        }
+    }
+}
+
+// Check whether a budget-limited run has drained
+static int thread_idle(loadgen_thread_t *t) {
+    for (int i = 0; i < t->conn_count; i++) {
+        if (t->conns[i].count > 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void *loadgen_thread_main(void *arg) {
+    loadgen_thread_t *t = (loadgen_thread_t *)arg;
+    struct epoll_event events[MAX_EVENTS];
+    uint64_t last_housekeeping = 0;
+
+    if (t->interval_ns > 0) {
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = NULL;
+        epoll_ctl(t->epfd, EPOLL_CTL_ADD, t->timerfd, &ev);
+        t->next_send_ns = g_start_ns;
+    }
+
+    uint64_t now = now_ns();
+    for (int i = 0; i < t->conn_count; i++) {
+        conn_open(&t->conns[i], now);
+    }
+
+    while (!atomic_load(&g_stop)) {
+        now = now_ns();
+        if (t->interval_ns > 0 && !atomic_load(&g_budget_exhausted)) {
+            dispatch_scheduled(t, now);
+            // A backlog with every connection busy is picked up when a response frees a slot
+            if (!t->timer_armed && t->next_send_ns > now) {
+                arm_send_timer(t);
+            }
+        }
+
+        int n = epoll_wait(t->epfd, events, MAX_EVENTS, HOUSEKEEPING_MS);
+        if (n < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            break;
+        }
+
+        now = now_ns();
+        for (int i = 0; i < n; i++) {
+            client_conn_t *c = (client_conn_t *)events[i].data.ptr;
+            if (c == NULL) {
+                uint64_t expirations;
+                if (read(t->timerfd, &expirations, sizeof(expirations)) < 0) {
+                    // Spurious wakeup, the timer is re-armed below
+                }
+                t->timer_armed = 0;
+                continue;
+            }
+            conn_event(c, events[i].events, now);
+        }
+
+        if (now - last_housekeeping >= HOUSEKEEPING_MS * 1000000ULL) {
+            last_housekeeping = now;
+            housekeeping(t);
+        }
+
+        if (atomic_load(&g_budget_exhausted) && thread_idle(t)) {
+            break;
+        }
+    }
+
+    t->finished_ns = now_ns();
+    atomic_fetch_add(&g_threads_done, 1);
+    for (int i = 0; i < t->conn_count; i++) {
+        if (t->conns[i].fd >= 0) {
+            close(t->conns[i].fd);
+        }
+    }
+    return NULL;
+}
+
+// Resolve host:port into g_addr
+static int resolve_target(const char *target) {
+    const char *p = target;
+    if (strncmp(p, "http://", 7) == 0) {
+        p += 7;
+    }
+
+    const char *colon = strrchr(p, ':');
+    const char *slash = strchr(p, '/');
+    size_t host_len = colon ? (size_t)(colon - p) : (slash ? (size_t)(slash - p) : strlen(p));
+    if (host_len == 0 || host_len >= sizeof(g_opts.host)) {
+        fprintf(stderr, "Invalid target: %s\n", target);
+        return -1;
+    }
+    memcpy(g_opts.host, p, host_len);
+    g_opts.host[host_len] = '\0';
+
+    if (colon) {
+        size_t port_len = slash && slash > colon ? (size_t)(slash - colon - 1) : strlen(colon + 1);
+        if (port_len == 0 || port_len >= sizeof(g_opts.port)) {
+            fprintf(stderr, "Invalid port in target: %s\n", target);
+            return -1;
+        }
+        memcpy(g_opts.port, colon + 1, port_len);
+        g_opts.port[port_len] = '\0';
+    } else {
+        strcpy(g_opts.port, "80");
+    }
+
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    int rc = getaddrinfo(g_opts.host, g_opts.port, &hints, &res);
+    if (rc != 0) {
+        fprintf(stderr, "Unable to resolve %s:%s: %s\n", g_opts.host, g_opts.port, gai_strerror(rc));
+        return -1;
+    }
+    memcpy(&g_addr, res->ai_addr, res->ai_addrlen);
+    g_addrlen = res->ai_addrlen;
+    freeaddrinfo(res);
+    return 0;
+}
+
+static void print_json(FILE *out, const loadgen_counters_t *total, const hdr_histogram_t *latency,
+                       const hdr_histogram_t *service_latency, double elapsed) {
+    uint64_t errors = total->connect_errors + total->read_errors + total->write_errors +
+                      total->timeouts + total->parse_errors;
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"tool\": \"x-loadgen\",\n");
+    fprintf(out, "  \"meta\": ");
+    bench_meta_print_json(out, "  ");
+    fprintf(out, ",\n");
+    fprintf(out, "  \"config\": {\n");
+    fprintf(out, "    \"target\": ");
+    bench_json_string(out, g_opts.host);
+    fprintf(out, ",\n    \"port\": %s,\n", g_opts.port);
+    fprintf(out, "    \"connections\": %d,\n", g_opts.connections);
+    fprintf(out, "    \"threads\": %d,\n", g_opts.threads);
+    fprintf(out, "    \"duration_sec\": %d,\n", g_opts.duration);
+    fprintf(out, "    \"requests_limit\": %lu,\n", g_opts.requests);
+    fprintf(out, "    \"keep_alive\": %s,\n", g_opts.keep_alive ? "true" : "false");
+    fprintf(out, "    \"pipeline\": %d,\n", g_opts.pipeline);
+    fprintf(out, "    \"rate\": %.2f,\n", g_opts.rate);
+    fprintf(out, "    \"mix\": [");
+    for (int i = 0; i < g_opts.path_count; i++) {
+        fprintf(out, "%s\n      {\"method\": \"%s\", \"path\": ", i ? "," : "", g_opts.paths[i].method);
+        bench_json_string(out, g_opts.paths[i].path);
+        fprintf(out, ", \"weight\": %u, \"responses\": %lu}", g_opts.paths[i].weight, total->path_responses[i]);
+    }
+    fprintf(out, "\n    ]\n");
+    fprintf(out, "  },\n");
+    fprintf(out, "  \"results\": {\n");
+    fprintf(out, "    \"elapsed_sec\": %.3f,\n", elapsed);
+    fprintf(out, "    \"responses\": %lu,\n", total->responses);
+    fprintf(out, "    \"throughput_rps\": %.2f,\n", elapsed > 0 ? (double)total->responses / elapsed : 0.0);
+    fprintf(out, "    \"bytes_read\": %lu,\n", total->bytes_read);
+    fprintf(out, "    \"transfer_mbps\": %.2f,\n",
+            elapsed > 0 ? (double)total->bytes_read / elapsed / (1024.0 * 1024.0) : 0.0);
+    fprintf(out, "    \"status\": {\"1xx\": %lu, \"2xx\": %lu, \"3xx\": %lu, \"4xx\": %lu, \"5xx\": %lu},\n",
+            total->status[1], total->status[2], total->status[3], total->status[4], total->status[5]);
+    fprintf(out, "    \"errors\": {\"total\": %lu, \"connect\": %lu, \"read\": %lu, \"write\": %lu, "
+            "\"timeout\": %lu, \"parse\": %lu},\n",
+            errors, total->connect_errors, total->read_errors, total->write_errors,
+            total->timeouts, total->parse_errors);
+    fprintf(out, "    \"reconnects\": %lu\n", total->reconnects);
+    fprintf(out, "  },\n");
+    fprintf(out, "  \"latency_us\": ");
+    hdr_print_json(latency, out, "  ");
+    fprintf(out, ",\n  \"latency_corrected\": %s,\n", g_opts.rate > 0 ? "true" : "false");
+    fprintf(out, "  \"service_latency_us\": ");
+    hdr_print_json(service_latency, out, "  ");
+    fprintf(out, "\n}\n");
+}
+
+static void print_latency_row(const char *label, const hdr_histogram_t *h) {
+    printf("  %-9s %8lu %9.1f %9.1f %8lu %8lu %8lu %8lu %8lu %8lu %8lu\n", label,
+           h->total_count ? h->min : 0, hdr_mean(h), hdr_stddev(h),
+           hdr_value_at_percentile(h, 50.0), hdr_value_at_percentile(h, 75.0),
+           hdr_value_at_percentile(h, 90.0), hdr_value_at_percentile(h, 99.0),
+           hdr_value_at_percentile(h, 99.9), hdr_value_at_percentile(h, 99.99), h->max);
+}
+
+static void print_text(const loadgen_counters_t *total, const hdr_histogram_t *latency,
+                       const hdr_histogram_t *service_latency, double elapsed) {
+    uint64_t errors = total->connect_errors + total->read_errors + total->write_errors +
+                      total->timeouts + total->parse_errors;
+
+    printf("x-loadgen %s:%s - %d threads, %d connections, %s, pipeline %d, ",
+           g_opts.host, g_opts.port, g_opts.threads, g_opts.connections,
+           g_opts.keep_alive ? "keep-alive" : "close", g_opts.pipeline);
+    if (g_opts.rate > 0) {
+        printf("open-loop %.0f req/s\n", g_opts.rate);
+    } else {
+        printf("closed-loop\n");
+    }
+    for (int i = 0; i < g_opts.path_count; i++) {
+        printf("  %-6s %-40s weight %-4u responses %lu\n", g_opts.paths[i].method, g_opts.paths[i].path,
+               g_opts.paths[i].weight, total->path_responses[i]);
+    }
+    printf("\n");
+    printf("  Elapsed:     %.2fs\n", elapsed);
+    printf("  Responses:   %lu (1xx %lu, 2xx %lu, 3xx %lu, 4xx %lu, 5xx %lu)\n", total->responses,
+           total->status[1], total->status[2], total->status[3], total->status[4], total->status[5]);
+    printf("  Errors:      %lu (connect %lu, read %lu, write %lu, timeout %lu, parse %lu)\n", errors,
+           total->connect_errors, total->read_errors, total->write_errors, total->timeouts, total->parse_errors);
+    printf("  Reconnects:  %lu (keep-alive connections closed by server)\n", total->reconnects);
+    printf("  Throughput:  %.2f req/s, %.2f MB/s\n",
+           elapsed > 0 ? (double)total->responses / elapsed : 0.0,
+           elapsed > 0 ? (double)total->bytes_read / elapsed / (1024.0 * 1024.0) : 0.0);
+    printf("\n");
+    printf("  Latency(us)      min      mean     stdev      p50      p75      p90      p99    p99.9   p99.99      max\n");
+    if (g_opts.rate > 0) {
+        print_latency_row("corrected", latency);
+    }
+    print_latency_row("service", service_latency);
+    if (g_opts.rate > 0) {
+        printf("  (corrected latency is measured from the scheduled send time)\n");
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int opt;
+
+    memset(&g_opts, 0, sizeof(g_opts));
+    g_opts.connections = 64;
+    g_opts.threads = 2;
+    g_opts.duration = 10;
+    g_opts.pipeline = 1;
+    g_opts.keep_alive = 1;
+    g_opts.timeout = 5;
+
+    while ((opt = getopt(argc, argv, "c:t:d:n:p:R:u:H:CT:j:m:qh")) != -1) {
+        switch (opt) {
+            case 'c': g_opts.connections = atoi(optarg); break;
+            case 't': g_opts.threads = atoi(optarg); break;
+            case 'd': g_opts.duration = atoi(optarg); break;
+            case 'n': g_opts.requests = strtoull(optarg, NULL, 10); break;
+            case 'p': g_opts.pipeline = atoi(optarg); break;
+            case 'R': g_opts.rate = atof(optarg); break;
+            case 'u':
+                if (add_request_spec(optarg) < 0) {
+                    return 1;
+                }
+                break;
+            case 'H':
+                if (g_opts.header_count >= MAX_HEADERS || strlen(optarg) >= sizeof(g_opts.headers[0])) {
+                    fprintf(stderr, "Too many or too long headers\n");
+                    return 1;
+                }
+                strcpy(g_opts.headers[g_opts.header_count++], optarg);
+                break;
+            case 'C': g_opts.keep_alive = 0; break;
+            case 'T': g_opts.timeout = atoi(optarg); break;
+            case 'j': g_opts.json_path = optarg; break;
+            case 'm':
+                if (bench_meta_add_label(optarg) < 0) {
+                    fprintf(stderr, "Invalid label: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'q': g_opts.quiet = 1; break;
+            case 'h':
+                show_help(argv[0]);
+                return 0;
+            default:
+                show_help(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind != argc - 1) {
+        show_help(argv[0]);
+        return 1;
+    }
+    if (g_opts.connections <= 0 || g_opts.threads <= 0 || g_opts.duration <= 0 ||
+        g_opts.pipeline <= 0 || g_opts.pipeline > MAX_PIPELINE || g_opts.rate < 0 || g_opts.timeout <= 0) {
+        fprintf(stderr, "Invalid option value\n");
+        return 1;
+    }
+    if (g_opts.threads > g_opts.connections) {
+        g_opts.threads = g_opts.connections;
+    }
+    if (!g_opts.keep_alive) {
+        g_opts.pipeline = 1;
+    }
+    if (g_opts.path_count == 0 && add_request_spec("/") < 0) {
+        return 1;
+    }
+    if (resolve_target(argv[optind]) < 0 || build_requests() < 0) {
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+
+    atomic_store(&g_budget, (int_fast64_t)g_opts.requests);
+    g_timeout_ns = (uint64_t)g_opts.timeout * 1000000000ULL;
+
+    loadgen_thread_t *threads = calloc((size_t)g_opts.threads, sizeof(loadgen_thread_t));
+    if (threads == NULL) {
+        perror("calloc");
+        return 1;
+    }
+
+    size_t wbuf_size = 0;
+    for (int i = 0; i < g_opts.path_count; i++) {
+        if (g_opts.paths[i].request_len > wbuf_size) {
+            wbuf_size = g_opts.paths[i].request_len;
+        }
+    }
+    wbuf_size *= MAX_PIPELINE;
+
+    g_start_ns = now_ns();
+    for (int i = 0; i < g_opts.threads; i++) {
+        loadgen_thread_t *t = &threads[i];
+        t->id = i;
+        t->seed = (unsigned int)(g_start_ns ^ (uint64_t)(i + 1) * 2654435761U);
+        t->conn_count = g_opts.connections / g_opts.threads + (i < g_opts.connections % g_opts.threads ? 1 : 0);
+        t->epfd = epoll_create1(0);
+        t->timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+        t->conns = calloc((size_t)t->conn_count, sizeof(client_conn_t));
+        if (t->epfd < 0 || t->timerfd < 0 || t->conns == NULL) {
+            perror("thread setup");
+            return 1;
+        }
+        if (g_opts.rate > 0) {
+            t->interval_ns = (uint64_t)(1e9 * g_opts.threads / g_opts.rate);
+            if (t->interval_ns == 0) {
+                t->interval_ns = 1;
+            }
+        }
+        hdr_init(&t->latency);
+        hdr_init(&t->service_latency);
+        for (int j = 0; j < t->conn_count; j++) {
+            t->conns[j].fd = -1;
+            t->conns[j].thread = t;
+            t->conns[j].wbuf = malloc(wbuf_size);
+            if (t->conns[j].wbuf == NULL) {
+                perror("malloc");
+                return 1;
+            }
+        }
+    }
+
+    for (int i = 0; i < g_opts.threads; i++) {
+        if (pthread_create(&threads[i].tid, NULL, loadgen_thread_main, &threads[i]) != 0) {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+
+    // Wait for the deadline or for a budget-limited run to drain
+    uint64_t deadline = g_start_ns + (uint64_t)g_opts.duration * 1000000000ULL;
+    while (!atomic_load(&g_stop) && now_ns() < deadline &&
+           atomic_load(&g_threads_done) < g_opts.threads) {
+        usleep(10000);
+    }
+    atomic_store(&g_stop, 1);
+
+    loadgen_counters_t total;
+    hdr_histogram_t *latency = malloc(sizeof(hdr_histogram_t));
+    hdr_histogram_t *service_latency = malloc(sizeof(hdr_histogram_t));
+    if (latency == NULL || service_latency == NULL) {
+        perror("malloc");
+        return 1;
+    }
+    memset(&total, 0, sizeof(total));
+    hdr_init(latency);
+    hdr_init(service_latency);
+
+    uint64_t finished = 0;
+    for (int i = 0; i < g_opts.threads; i++) {
+        loadgen_thread_t *t = &threads[i];
+        pthread_join(t->tid, NULL);
+
+        hdr_merge(latency, &t->latency);
+        hdr_merge(service_latency, &t->service_latency);
+        total.responses += t->counters.responses;
+        total.bytes_read += t->counters.bytes_read;
+        for (int s = 0; s < 6; s++) {
+            total.status[s] += t->counters.status[s];
+        }
+        total.connect_errors += t->counters.connect_errors;
+        total.read_errors += t->counters.read_errors;
+        total.write_errors += t->counters.write_errors;
+        total.timeouts += t->counters.timeouts;
+        total.parse_errors += t->counters.parse_errors;
+        total.reconnects += t->counters.reconnects;
+        for (int p = 0; p < g_opts.path_count; p++) {
+            total.path_responses[p] += t->counters.path_responses[p];
+        }
+        if (t->finished_ns > finished) {
+            finished = t->finished_ns;
+        }
+    }
+
+    double elapsed = (double)(finished - g_start_ns) / 1e9;
+
+    if (!g_opts.quiet) {
+        print_text(&total, latency, service_latency, elapsed);
+    }
+    if (g_opts.json_path != NULL) {
+        FILE *out = strcmp(g_opts.json_path, "-") == 0 ? stdout : fopen(g_opts.json_path, "w");
+        if (out == NULL) {
+            perror(g_opts.json_path);
+            return 1;
+        }
+        print_json(out, &total, latency, service_latency, elapsed);
+        if (out != stdout) {
+            fclose(out);
+        }
+    }
+
+    for (int i = 0; i < g_opts.threads; i++) {
+        for (int j = 0; j < threads[i].conn_count; j++) {
+            free(threads[i].conns[j].wbuf);
+        }
+        free(threads[i].conns);
+        close(threads[i].epfd);
+        close(threads[i].timerfd);
+    }
+    free(threads);
+    free(latency);
+    free(service_latency);
+
+    uint64_t errors = total.connect_errors + total.read_errors + total.write_errors +
+                      total.timeouts + total.parse_errors;
+    return total.responses > 0 && errors < total.responses ? 0 : 2;
+}
@@ -0,0 +1,821 @@
+/**
+ * X-Server Hot-Path Microbenchmarks
+ * Linked against the server object files, reports ns/op and allocations/op
+ * of request parsing, routing, memory pool, logging, limits, OAuth and the
+ * file cache. Allocations are counted by interposing malloc/free in this
+ * binary, so allocations made inside libc (strdup, vsnprintf) are included.
+ *
+ * Usage: x-microbench [-f filter] [-t min_ms] [-r runs] [-j file] [-l]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+#include <malloc.h>
+
+#include "../include/http.h"
+#include "../include/http_optimized.h"
+#include "../include/config.h"
+#include "../include/file_handler.h"
+#include "../include/memory_pool.h"
+#include "../include/logger.h"
+#include "../include/connection_limit.h"
+#include "../include/oauth.h"
+#include "../include/config_snapshot.h"
+#include "../include/file_io_enhanced.h"
+
+#include "bench_meta.h"
+
+#define MAX_BENCH_THREADS 64
+#define MAX_RUNS 32
+#define IP_COUNT 1024
+#define CACHE_ENTRIES 256
+
+// glibc allocator entry points, wrapped below to count allocations
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+extern void *__libc_memalign(size_t alignment, size_t size);
+
+static __thread uint64_t tls_allocs;
+static __thread uint64_t tls_alloc_bytes;
+
+void *malloc(size_t size) {
+    tls_allocs++;
+    tls_alloc_bytes += size;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+    tls_allocs++;
+    tls_alloc_bytes += nmemb * size;
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    tls_allocs++;
+    tls_alloc_bytes += size;
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+    __libc_free(ptr);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size) {
+    void *ptr = __libc_memalign(alignment, size);
+    if (ptr == NULL) {
+        return 12; // ENOMEM
+    }
+    tls_allocs++;
+    tls_alloc_bytes += size;
+    *memptr = ptr;
+    return 0;
+}
+
+// Benchmark definition; run() executes iters operations on behalf of thread tid
+typedef struct benchmark {
+    const char *name;
+    int threads;
+    int (*setup)(void);
+    void (*run)(int tid, uint64_t iters);
+    void (*teardown)(void);
+} benchmark_t;
+
+// Result of one measured run
+typedef struct bench_run {
+    uint64_t ops;
+    uint64_t wall_ns;
+    uint64_t allocs;
+    uint64_t alloc_bytes;
+} bench_run_t;
+
+// Benchmark summary
+typedef struct bench_result {
+    const benchmark_t *bench;
+    uint64_t iterations;
+    int runs;
+    double ns_per_op;       // Median over runs
+    double ns_per_op_min;
+    double ns_per_op_max;
+    double allocs_per_op;
+    double bytes_per_op;
+    double samples[MAX_RUNS];   // ns/op of each run in run order
+} bench_result_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Keep the compiler from discarding benchmark results
+static volatile uintptr_t g_sink;
+
+/* ---------- HTTP request parsing ---------- */
+
+// Requests captured from common clients
+static const char *g_request_corpus[] = {
+    "GET / HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "Connection: keep-alive\r\n"
+    "sec-ch-ua: \"Chromium\";v=\"124\", \"Google Chrome\";v=\"124\", \"Not-A.Brand\";v=\"99\"\r\n"
+    "sec-ch-ua-mobile: ?0\r\n"
+    "sec-ch-ua-platform: \"Windows\"\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/124.0.0.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,image/apng,*/*;q=0.8\r\n"
+    "Sec-Fetch-Site: none\r\n"
+    "Sec-Fetch-Mode: navigate\r\n"
+    "Sec-Fetch-User: ?1\r\n"
+    "Sec-Fetch-Dest: document\r\n"
+    "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+    "Accept-Language: en-US,en;q=0.9,zh-CN;q=0.8\r\n"
+    "Cookie: _ga=GA1.1.1234567890.1700000000; session=9f8e7d6c5b4a39281706f5e4d3c2b1a0\r\n"
+    "\r\n",
+
+    "GET /css/style.css HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:125.0) Gecko/20100101 Firefox/125.0\r\n"
+    "Accept: text/css,*/*;q=0.1\r\n"
+    "Accept-Language: en-US,en;q=0.5\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Referer: https://www.example.com/\r\n"
+    "Connection: keep-alive\r\n"
+    "Sec-Fetch-Dest: style\r\n"
+    "Sec-Fetch-Mode: no-cors\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "If-Modified-Since: Tue, 14 May 2024 08:12:31 GMT\r\n"
+    "If-None-Match: \"66431b2f-4c2\"\r\n"
+    "\r\n",
+
+    "GET /api/v2/orders?status=open&page=2&limit=50 HTTP/1.1\r\n"
+    "Host: api.example.com\r\n"
+    "User-Agent: curl/8.5.0\r\n"
+    "Accept: */*\r\n"
+    "\r\n",
+
+    "POST /api/v1/orders HTTP/1.1\r\n"
+    "Host: api.example.com\r\n"
+    "User-Agent: okhttp/4.12.0\r\n"
+    "Content-Type: application/json; charset=utf-8\r\n"
+    "Accept: application/json\r\n"
+    "oauth-app-key: test_app_key\r\n"
+    "oauth-time: 1715673600\r\n"
+    "oauth-random: 8c1f2e3d\r\n"
+    "oauth-token: 0d4b3e6f2a1c9b8e7d6c5b4a39281706\r\n"
+    "Content-Length: 57\r\n"
+    "\r\n"
+    "{\"sku\":\"A-1029\",\"quantity\":3,\"address_id\":77812,\"rush\":0}",
+
+    "GET /ws/notifications HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "Upgrade: websocket\r\n"
+    "Connection: Upgrade\r\n"
+    "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+    "Sec-WebSocket-Version: 13\r\n"
+    "Origin: https://www.example.com\r\n"
+    "\r\n",
+
+    "GET /health HTTP/1.1\r\n"
+    "Host: 10.0.3.17:9001\r\n"
+    "User-Agent: kube-probe/1.29\r\n"
+    "Accept: */*\r\n"
+    "Connection: close\r\n"
+    "\r\n",
+
+    "GET /images/example.png HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (iPhone; CPU iPhone OS 17_4 like Mac OS X) AppleWebKit/605.1.15 (KHTML, like Gecko) Version/17.4 Mobile/15E148 Safari/604.1\r\n"
+    "Accept: image/webp,image/avif,image/jxl,image/heic,image/heic-sequence,video/*;q=0.8,image/png,image/svg+xml,image/*;q=0.8,*/*;q=0.5\r\n"
+    "Referer: https://www.example.com/\r\n"
+    "Accept-Language: zh-CN,zh-Hans;q=0.9\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n",
+};
+
+#define CORPUS_SIZE (sizeof(g_request_corpus) / sizeof(g_request_corpus[0]))
+
+static size_t g_request_lengths[CORPUS_SIZE];
+static http_parser_t *g_parsers[MAX_BENCH_THREADS];
+
+static int setup_http_corpus(void) {
+    for (size_t i = 0; i < CORPUS_SIZE; i++) {
+        g_request_lengths[i] = strlen(g_request_corpus[i]);
+    }
+    return 0;
+}
+
+static int setup_parse_buffer(void) {
+    setup_http_corpus();
+
+    // Every corpus entry must parse, otherwise the benchmark measures the error path
+    for (size_t i = 0; i < CORPUS_SIZE; i++) {
+        http_request_t request;
+        memset(&request, 0, sizeof(request));
+        int rc = parse_http_request_from_buffer(g_request_corpus[i], g_request_lengths[i], &request);
+        free_http_request(&request);
+        if (rc != 0) {
+            fprintf(stderr, "parse_http_request_from_buffer rejected corpus entry %zu (%d)\n", i, rc);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void run_parse_buffer(int tid, uint64_t iters) {
+    (void)tid;
+    for (uint64_t i = 0; i < iters; i++) {
+        size_t idx = i % CORPUS_SIZE;
+        http_request_t request;
+        memset(&request, 0, sizeof(request));
+        parse_http_request_from_buffer(g_request_corpus[idx], g_request_lengths[idx], &request);
+        g_sink += (uintptr_t)request.header_count;
+        free_http_request(&request);
+    }
+}
+
+static int setup_state_machine(void) {
+    setup_http_corpus();
+
+    g_parsers[0] = http_parser_create();
+    if (g_parsers[0] == NULL) {
+        return -1;
+    }
+    for (size_t i = 0; i < CORPUS_SIZE; i++) {
+        http_parser_reset(g_parsers[0]);
+        if (http_parser_parse(g_parsers[0], g_request_corpus[i], g_request_lengths[i]) <= 0) {
+            fprintf(stderr, "http_parser_parse rejected corpus entry %zu\n", i);
+            http_parser_destroy(g_parsers[0]);
+            g_parsers[0] = NULL;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void run_state_machine(int tid, uint64_t iters) {
+    (void)tid;
+    http_parser_t *parser = g_parsers[0];
+    for (uint64_t i = 0; i < iters; i++) {
+        size_t idx = i % CORPUS_SIZE;
+        http_parser_reset(parser);
+        g_sink += (uintptr_t)http_parser_parse(parser, g_request_corpus[idx], g_request_lengths[idx]);
+    }
+}
+
+static void teardown_state_machine(void) {
+    if (g_parsers[0] != NULL) {
+        http_parser_destroy(g_parsers[0]);
+        g_parsers[0] = NULL;
+    }
+}
+
+/* ---------- Routing ---------- */
+
+static config_t *g_route_config;
+static char g_route_paths[256][128];
+#define ROUTE_PATH_COUNT (sizeof(g_route_paths) / sizeof(g_route_paths[0]))
+
+static int setup_find_route(void) {
+    g_route_config = calloc(1, sizeof(config_t));
+    if (g_route_config == NULL) {
+        return -1;
+    }
+
+    // 63 service prefixes plus the catch-all static route, as in a large gateway config
+    for (int i = 0; i < MAX_ROUTES - 1; i++) {
+        route_t *route = &g_route_config->routes[i];
+        route->type = ROUTE_PROXY;
+        snprintf(route->path_prefix, sizeof(route->path_prefix), "/api/v%d/service%02d/", i % 3 + 1, i);
+        snprintf(route->target_host, sizeof(route->target_host), "127.0.0.1");
+        route->target_port = 3000 + i;
+    }
+    route_t *fallback = &g_route_config->routes[MAX_ROUTES - 1];
+    fallback->type = ROUTE_STATIC;
+    strcpy(fallback->path_prefix, "/");
+    strcpy(fallback->local_path, "./public/");
+    g_route_config->route_count = MAX_ROUTES;
+
+    for (size_t i = 0; i < ROUTE_PATH_COUNT; i++) {
+        if (i % 4 == 0) {
+            snprintf(g_route_paths[i], sizeof(g_route_paths[i]), "/static/js/app.%zu.js", i);
+        } else {
+            int r = (int)(i * 7 % (MAX_ROUTES - 1));
+            snprintf(g_route_paths[i], sizeof(g_route_paths[i]), "/api/v%d/service%02d/items/%zu", r % 3 + 1, r, i);
+        }
+    }
+    return 0;
+}
+
+static void run_find_route(int tid, uint64_t iters) {
+    (void)tid;
+    for (uint64_t i = 0; i < iters; i++) {
+        g_sink += (uintptr_t)find_route(g_route_config, g_route_paths[i % ROUTE_PATH_COUNT]);
+    }
+}
+
+static void teardown_find_route(void) {
+    free(g_route_config);
+    g_route_config = NULL;
+}
+
+/* ---------- MIME types ---------- */
+
+static const char *g_mime_files[] = {
+    "/index.html", "/css/style.css", "/js/main.js", "/images/logo.png", "/images/photo.jpeg",
+    "/api/test.json", "/fonts/inter.woff2", "/favicon.ico", "/docs/manual.pdf", "/download/archive.tar.gz",
+    "/README", "/images/icon.svg"
+};
+
+#define MIME_FILE_COUNT (sizeof(g_mime_files) / sizeof(g_mime_files[0]))
+
+static void run_get_mime_type(int tid, uint64_t iters) {
+    (void)tid;
+    for (uint64_t i = 0; i < iters; i++) {
+        g_sink += (uintptr_t)get_mime_type(g_mime_files[i % MIME_FILE_COUNT]);
+    }
+}
+
+/* ---------- Memory pool ---------- */
+
+static memory_pool_t *g_memory_pool;
+
+static int setup_memory_pool(void) {
+    g_memory_pool = create_memory_pool(4 * 1024 * 1024);
+    return g_memory_pool ? 0 : -1;
+}
+
+static void run_memory_pool(int tid, uint64_t iters) {
+    static const size_t sizes[] = {64, 256, 512, 1024, 4096, 8192, 128, 2048};
+    void *held[8];
+
+    (void)tid;
+    // Keep a few blocks live so allocation and free interleave like request processing
+    for (uint64_t i = 0; i < iters; i++) {
+        int slot = (int)(i & 7);
+        if (i >= 8) {
+            pool_free(g_memory_pool, held[slot]);
+        }
+        held[slot] = pool_malloc(g_memory_pool, sizes[slot]);
+    }
+    for (uint64_t i = 0; i < iters && i < 8; i++) {
+        pool_free(g_memory_pool, held[i]);
+    }
+}
+
+static void teardown_memory_pool(void) {
+    destroy_memory_pool(g_memory_pool);
+    g_memory_pool = NULL;
+}
+
+/* ---------- Access log ---------- */
+
+static void run_log_access(int tid, uint64_t iters) {
+    static const char *paths[] = {"/", "/css/style.css", "/api/v2/orders?page=2", "/images/example.png"};
+    for (uint64_t i = 0; i < iters; i++) {
+        log_access(tid & 1 ? "192.168.10.24" : "10.0.0.7", "GET", paths[i & 3], 200, 3794,
+                   "Mozilla/5.0 (X11; Linux x86_64; rv:125.0) Gecko/20100101 Firefox/125.0");
+    }
+}
+
+static void teardown_log_access(void) {
+    logger_flush();
+}
+
+/* ---------- Connection and rate limits ---------- */
+
+static char g_client_ips[IP_COUNT][16];
+
+static int setup_limits(void) {
+    for (int i = 0; i < IP_COUNT; i++) {
+        snprintf(g_client_ips[i], sizeof(g_client_ips[i]), "10.%d.%d.%d", i >> 8, i & 0xff, i % 200 + 1);
+    }
+
+    // Limits high enough that the benchmark measures the accept path
+    connection_limit_config_t config;
+    get_connection_limit_config(&config);
+    config.max_connections_per_ip = 1000000;
+    config.max_requests_per_second = 1000000000;
+    config.max_requests_burst = 1000000000;
+    configure_connection_limit(&config);
+    return 0;
+}
+
+static void run_connection_limit(int tid, uint64_t iters) {
+    for (uint64_t i = 0; i < iters; i++) {
+        const char *ip = g_client_ips[(i * 7 + (uint64_t)tid * 131) % IP_COUNT];
+        if (check_connection_limit(ip) == 0) {
+            release_connection(ip);
+        }
+    }
+}
+
+static void run_rate_limit(int tid, uint64_t iters) {
+    for (uint64_t i = 0; i < iters; i++) {
+        g_sink += (uintptr_t)check_rate_limit(g_client_ips[(i * 7 + (uint64_t)tid * 131) % IP_COUNT]);
+    }
+}
+
+static void teardown_limits(void) {
+    cleanup_all_limits();
+}
+
+/* ---------- OAuth validation ---------- */
+
+static http_request_t g_oauth_request;
+static http_header_t g_oauth_headers[6];
+static char g_oauth_time[32];
+static char g_oauth_token[64];
+static route_t g_oauth_route;
+static config_snapshot_t *g_oauth_snapshot;
+
+// MD5 of app_key + app_secret + time + random, computed with md5sum to stay independent of oauth.c
+static int compute_oauth_token(const char *input) {
+    char command[512];
+    snprintf(command, sizeof(command), "printf '%%s' '%s' | md5sum", input);
+
+    FILE *pipe = popen(command, "r");
+    if (pipe == NULL) {
+        return -1;
+    }
+    int ok = fscanf(pipe, "%32s", g_oauth_token) == 1;
+    pclose(pipe);
+    return ok && strlen(g_oauth_token) == 32 ? 0 : -1;
+}
+
+static int setup_oauth(void) {
+    char input[256];
+
+    // The application table comes with a configuration snapshot, as in a Worker
+    if (g_oauth_snapshot == NULL) {
+        if (config_snapshot_publish(get_default_config()) != 0) {
+            return -1;
+        }
+        g_oauth_snapshot = config_snapshot_acquire();
+    }
+    if (g_oauth_snapshot->auth_apps == NULL) {
+        fprintf(stderr, "OAuth benchmark needs config/api_auth.conf, run from the repository root\n");
+        return -1;
+    }
+
+    snprintf(g_oauth_time, sizeof(g_oauth_time), "%ld", (long)time(NULL));
+    snprintf(input, sizeof(input), "test_app_keytest_app_secret%s8c1f2e3d", g_oauth_time);
+    if (compute_oauth_token(input) != 0) {
+        fprintf(stderr, "Unable to compute OAuth token with md5sum\n");
+        return -1;
+    }
+
+    static const char *names[] = {"Host", "User-Agent", "oauth-app-key", "oauth-time", "oauth-random", "oauth-token"};
+    const char *values[] = {"api.example.com", "okhttp/4.12.0", "test_app_key", g_oauth_time, "8c1f2e3d", g_oauth_token};
+    for (int i = 0; i < 6; i++) {
+        g_oauth_headers[i].name = (char *)names[i];
+        g_oauth_headers[i].value = (char *)values[i];
+    }
+
+    memset(&g_oauth_request, 0, sizeof(g_oauth_request));
+    g_oauth_request.method = HTTP_GET;
+    g_oauth_request.path = "/api/v1/orders";
+    g_oauth_request.headers = g_oauth_headers;
+    g_oauth_request.header_count = 6;
+
+    strcpy(g_oauth_route.path_prefix, "/api/v1/");
+    g_oauth_route.auth_type = AUTH_OAUTH;
+
+    if (validate_oauth(&g_oauth_request, &g_oauth_route, g_oauth_snapshot) != 1) {
+        fprintf(stderr, "OAuth benchmark request does not validate\n");
+        return -1;
+    }
+    return 0;
+}
+
+static void run_oauth(int tid, uint64_t iters) {
+    (void)tid;
+    for (uint64_t i = 0; i < iters; i++) {
+        g_sink += (uintptr_t)validate_oauth(&g_oauth_request, &g_oauth_route, g_oauth_snapshot);
+    }
+}
+
+/* ---------- File cache ---------- */
+
+static char g_cache_paths[CACHE_ENTRIES][64];
+
+static int setup_file_cache(void) {
+    file_io_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.cache_size = 64;
+    config.enable_sendfile = 1;
+
+    if (file_io_enhanced_init(&config) != 0) {
+        return -1;
+    }
+
+    static char content[4096];
+    memset(content, 'x', sizeof(content));
+    for (int i = 0; i < CACHE_ENTRIES; i++) {
+        snprintf(g_cache_paths[i], sizeof(g_cache_paths[i]), "./public/assets/file%03d.html", i);
+        if (file_io_enhanced_add_to_cache(g_cache_paths[i], content, sizeof(content)) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void run_cache_hit(int tid, uint64_t iters) {
+    for (uint64_t i = 0; i < iters; i++) {
+        const char *path = g_cache_paths[(i + (uint64_t)tid * 17) % CACHE_ENTRIES];
+        size_t size = 0;
+        if (file_io_enhanced_get_from_cache(path, &size) != NULL) {
+            file_io_enhanced_release_cached(path);
+        }
+        g_sink += size;
+    }
+}
+
+static void run_cache_miss(int tid, uint64_t iters) {
+    (void)tid;
+    for (uint64_t i = 0; i < iters; i++) {
+        g_sink += (uintptr_t)file_io_enhanced_get_from_cache("./public/missing/file.html", NULL);
+    }
+}
+
+static void teardown_file_cache(void) {
+    file_io_enhanced_destroy();
+}
+
+/* ---------- Harness ---------- */
+
+static const benchmark_t g_benchmarks[] = {
+    {"http/parse_from_buffer",         1, setup_parse_buffer,  run_parse_buffer,     NULL},
+    {"http/parser_state_machine",      1, setup_state_machine, run_state_machine,    teardown_state_machine},
+    {"route/find_route_64",            1, setup_find_route,    run_find_route,       teardown_find_route},
+    {"file/get_mime_type",             1, NULL,                run_get_mime_type,    NULL},
+    {"memory_pool/malloc_free",        1, setup_memory_pool,   run_memory_pool,      teardown_memory_pool},
+    {"memory_pool/malloc_free_4t",     4, setup_memory_pool,   run_memory_pool,      teardown_memory_pool},
+    {"logger/log_access",              1, NULL,                run_log_access,       teardown_log_access},
+    {"logger/log_access_4t",           4, NULL,                run_log_access,       teardown_log_access},
+    {"limit/check_connection_limit",   1, setup_limits,        run_connection_limit, teardown_limits},
+    {"limit/check_connection_limit_4t",4, setup_limits,        run_connection_limit, teardown_limits},
+    {"limit/check_rate_limit",         1, setup_limits,        run_rate_limit,       teardown_limits},
+    {"auth/validate_oauth",            1, setup_oauth,         run_oauth,            NULL},
+    {"cache/lookup_hit",               1, setup_file_cache,    run_cache_hit,        teardown_file_cache},
+    {"cache/lookup_hit_4t",            4, setup_file_cache,    run_cache_hit,        teardown_file_cache},
+    {"cache/lookup_miss",              1, setup_file_cache,    run_cache_miss,       teardown_file_cache},
+};
+
+#define BENCHMARK_COUNT (sizeof(g_benchmarks) / sizeof(g_benchmarks[0]))
+
+// Per-thread arguments of one measured run
+typedef struct bench_thread {
+    pthread_t tid;
+    int id;
+    const benchmark_t *bench;
+    uint64_t iters;
+    pthread_barrier_t *barrier;
+    uint64_t allocs;
+    uint64_t alloc_bytes;
+} bench_thread_t;
+
+static void *bench_thread_main(void *arg) {
+    bench_thread_t *t = (bench_thread_t *)arg;
+
+    pthread_barrier_wait(t->barrier);
+    uint64_t allocs = tls_allocs;
+    uint64_t bytes = tls_alloc_bytes;
+    t->bench->run(t->id, t->iters);
+    t->allocs = tls_allocs - allocs;
+    t->alloc_bytes = tls_alloc_bytes - bytes;
+    return NULL;
+}
+
+// Run iters operations per thread and measure wall time and allocations
+static void measure(const benchmark_t *bench, uint64_t iters, bench_run_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->ops = iters * (uint64_t)bench->threads;
+
+    if (bench->threads == 1) {
+        uint64_t allocs = tls_allocs;
+        uint64_t bytes = tls_alloc_bytes;
+        uint64_t start = now_ns();
+        bench->run(0, iters);
+        out->wall_ns = now_ns() - start;
+        out->allocs = tls_allocs - allocs;
+        out->alloc_bytes = tls_alloc_bytes - bytes;
+        return;
+    }
+
+    bench_thread_t threads[MAX_BENCH_THREADS];
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, (unsigned int)bench->threads + 1);
+
+    for (int i = 0; i < bench->threads; i++) {
+        threads[i].id = i;
+        threads[i].bench = bench;
+        threads[i].iters = iters;
+        threads[i].barrier = &barrier;
+        pthread_create(&threads[i].tid, NULL, bench_thread_main, &threads[i]);
+    }
+
+    pthread_barrier_wait(&barrier);
+    uint64_t start = now_ns();
+    for (int i = 0; i < bench->threads; i++) {
+        pthread_join(threads[i].tid, NULL);
+        out->allocs += threads[i].allocs;
+        out->alloc_bytes += threads[i].alloc_bytes;
+    }
+    out->wall_ns = now_ns() - start;
+    pthread_barrier_destroy(&barrier);
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Calibrate the iteration count to min_ns, then take runs measurements
+ * ns/op is wall time over total operations of all threads
+ */
+static int run_benchmark(const benchmark_t *bench, uint64_t min_ns, int runs, bench_result_t *result) {
+    bench_run_t run;
+    uint64_t iters = 1;
+
+    if (bench->setup != NULL && bench->setup() != 0) {
+        return -1;
+    }
+
+    for (;;) {
+        measure(bench, iters, &run);
+        if (run.wall_ns >= min_ns || iters >= (1ULL << 40)) {
+            break;
+        }
+        uint64_t next = run.wall_ns > 0 ? (uint64_t)((double)iters * (double)min_ns / (double)run.wall_ns * 1.2) : iters * 100;
+        if (next > iters * 100) {
+            next = iters * 100;
+        }
+        iters = next > iters ? next : iters * 2;
+    }
+
+    double ns_per_op[MAX_RUNS];
+    uint64_t allocs = 0, bytes = 0, ops = 0;
+    for (int r = 0; r < runs; r++) {
+        measure(bench, iters, &run);
+        ns_per_op[r] = (double)run.wall_ns / (double)run.ops;
+        result->samples[r] = ns_per_op[r];
+        allocs += run.allocs;
+        bytes += run.alloc_bytes;
+        ops += run.ops;
+    }
+
+    if (bench->teardown != NULL) {
+        bench->teardown();
+    }
+
+    qsort(ns_per_op, (size_t)runs, sizeof(double), compare_double);
+    result->bench = bench;
+    result->iterations = iters;
+    result->runs = runs;
+    result->ns_per_op = runs % 2 ? ns_per_op[runs / 2] : (ns_per_op[runs / 2 - 1] + ns_per_op[runs / 2]) / 2;
+    result->ns_per_op_min = ns_per_op[0];
+    result->ns_per_op_max = ns_per_op[runs - 1];
+    result->allocs_per_op = (double)allocs / (double)ops;
+    result->bytes_per_op = (double)bytes / (double)ops;
+    return 0;
+}
+
+static void print_json(FILE *out, const bench_result_t *results, int count,
+                       const char *filter, int min_ms, int runs) {
+    fprintf(out, "{\n");
+    fprintf(out, "  \"tool\": \"x-microbench\",\n");
+    fprintf(out, "  \"meta\": ");
+    bench_meta_print_json(out, "  ");
+    fprintf(out, ",\n");
+    fprintf(out, "  \"config\": {\"filter\": ");
+    bench_json_string(out, filter != NULL ? filter : "");
+    fprintf(out, ", \"min_time_ms\": %d, \"runs\": %d},\n", min_ms, runs);
+    fprintf(out, "  \"benchmarks\": [");
+    for (int i = 0; i < count; i++) {
+        const bench_result_t *r = &results[i];
+        fprintf(out, "%s\n    {\"name\": \"%s\", \"threads\": %d, \"iterations\": %lu, \"runs\": %d, "
+                "\"ns_per_op\": %.2f, \"ns_per_op_min\": %.2f, \"ns_per_op_max\": %.2f, "
+                "\"allocs_per_op\": %.2f, \"bytes_per_op\": %.1f, \"samples\": [",
+                i ? "," : "", r->bench->name, r->bench->threads, r->iterations, r->runs,
+                r->ns_per_op, r->ns_per_op_min, r->ns_per_op_max, r->allocs_per_op, r->bytes_per_op);
+        for (int s = 0; s < r->runs; s++) {
+            fprintf(out, "%s%.2f", s ? ", " : "", r->samples[s]);
+        }
+        fprintf(out, "]}");
+    }
+    fprintf(out, "\n  ]\n}\n");
+}
+
+static void show_help(const char *program_name) {
+    printf("Usage: %s [options]\n", program_name);
+    printf("\n");
+    printf("Options:\n");
+    printf("  -f <filter>     Only run benchmarks whose name contains filter\n");
+    printf("  -t <ms>         Minimum time per measurement in milliseconds (default: 200)\n");
+    printf("  -r <runs>       Measurements per benchmark, median is reported (default: 5, max: %d)\n", MAX_RUNS);
+    printf("  -j <file>       Write JSON results to file (\"-\" for stdout)\n");
+    printf("  -m <key=value>  Label stored in the JSON metadata, repeatable\n");
+    printf("  -l              List benchmarks\n");
+    printf("  -h              Show help information\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *filter = NULL;
+    const char *json_path = NULL;
+    int min_ms = 200;
+    int runs = 5;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:t:r:j:m:lh")) != -1) {
+        switch (opt) {
+            case 'f': filter = optarg; break;
+            case 't': min_ms = atoi(optarg); break;
+            case 'r': runs = atoi(optarg); break;
+            case 'j': json_path = optarg; break;
+            case 'm':
+                if (bench_meta_add_label(optarg) < 0) {
+                    fprintf(stderr, "Invalid label: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'l':
+                for (size_t i = 0; i < BENCHMARK_COUNT; i++) {
+                    printf("%s\n", g_benchmarks[i].name);
+                }
+                return 0;
+            case 'h':
+                show_help(argv[0]);
+                return 0;
+            default:
+                show_help(argv[0]);
+                return 1;
+        }
+    }
+
+    if (min_ms <= 0 || runs <= 0 || runs > MAX_RUNS) {
+        fprintf(stderr, "Invalid option value\n");
+        return 1;
+    }
+
+    // Logger writes into a scratch directory; warnings and errors only, like a production config
+    char log_dir[] = "/tmp/x-microbench.XXXXXX";
+    if (mkdtemp(log_dir) == NULL) {
+        perror("mkdtemp");
+        return 1;
+    }
+    char log_path[sizeof(log_dir) + 1];
+    snprintf(log_path, sizeof(log_path), "%s/", log_dir);
+    if (init_logger(log_path, 2, 0) != 0) {
+        fprintf(stderr, "Unable to initialize logger in %s\n", log_dir);
+        return 1;
+    }
+
+    bench_result_t results[BENCHMARK_COUNT];
+    int count = 0;
+    int failed = 0;
+
+    printf("%-34s %8s %12s %12s %12s %10s %10s\n",
+           "benchmark", "threads", "iterations", "ns/op", "±range", "allocs/op", "B/op");
+    for (size_t i = 0; i < BENCHMARK_COUNT; i++) {
+        const benchmark_t *bench = &g_benchmarks[i];
+        if (filter != NULL && strstr(bench->name, filter) == NULL) {
+            continue;
+        }
+
+        bench_result_t *r = &results[count];
+        if (run_benchmark(bench, (uint64_t)min_ms * 1000000ULL, runs, r) != 0) {
+            fprintf(stderr, "%-34s setup failed, skipped\n", bench->name);
+            failed++;
+            continue;
+        }
+        printf("%-34s %8d %12lu %12.1f %12.1f %10.2f %10.1f\n", bench->name, bench->threads,
+               r->iterations, r->ns_per_op, (r->ns_per_op_max - r->ns_per_op_min) / 2,
+               r->allocs_per_op, r->bytes_per_op);
+        fflush(stdout);
+        count++;
+    }
+
+    if (json_path != NULL) {
+        FILE *out = strcmp(json_path, "-") == 0 ? stdout : fopen(json_path, "w");
+        if (out == NULL) {
+            perror(json_path);
+            return 1;
+        }
+        print_json(out, results, count, filter, min_ms, runs);
+        if (out != stdout) {
+            fclose(out);
+        }
+    }
+
+    close_logger();
+    return failed ? 2 : 0;
+}
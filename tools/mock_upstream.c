@@ -0,0 +1,950 @@
+/**
+ * X-Server Mock Upstream
+ * Small epoll server that stands in for the proxy backends during benchmarks.
+ * Listens on the upstream ports of gateway_multiprocess.conf and answers every
+ * request with a configurable body size, Content-Length or chunked framing,
+ * keep-alive or close behavior, injected latency and injected errors.
+ *
+ * Usage: mock-upstream [options]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <math.h>
+#include <signal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define MAX_PORTS 32
+#define MAX_EVENTS 256
+#define READ_BUFFER_SIZE (16 * 1024)
+#define CHUNK_SIZE 8192
+#define MAX_WAIT_MS 100
+
+// Latency distributions
+enum {
+    LATENCY_NONE = 0,
+    LATENCY_FIXED,
+    LATENCY_UNIFORM,
+    LATENCY_EXP,
+    LATENCY_BIMODAL
+};
+
+// Injected error kinds
+enum {
+    FAULT_NONE = 0,
+    FAULT_500,
+    FAULT_RESET,
+    FAULT_HANG
+};
+
+// Connection states
+enum {
+    CONN_READING = 0,
+    CONN_DELAYED,
+    CONN_WRITING,
+    CONN_HUNG
+};
+
+// Command line options
+typedef struct mock_options {
+    char host[64];
+    int ports[MAX_PORTS];
+    int port_count;
+    int threads;
+    size_t body_size;
+    int chunked;
+    int force_close;
+    int latency_type;
+    double latency_a;       // fixed / min / mean / fast (ms)
+    double latency_b;       // max / slow (ms)
+    double latency_pct;     // bimodal share of slow responses (%)
+    double error_rates[4];  // Fraction of requests answered with each FAULT_*
+    double error_rate;      // Sum of error_rates
+    int quiet;
+} mock_options_t;
+
+// Pre-rendered response
+typedef struct mock_response {
+    char *data;
+    size_t len;
+} mock_response_t;
+
+// Counters owned by one thread
+typedef struct mock_counters {
+    uint64_t connections;
+    uint64_t requests;
+    uint64_t responses;
+    uint64_t bytes_written;
+    uint64_t delayed;
+    uint64_t faults[4];     // Index by FAULT_*
+} mock_counters_t;
+
+struct mock_thread;
+
+// Server side connection
+typedef struct mock_conn {
+    int fd;
+    int state;
+    int closed;             // Closed while queued in the delay heap
+    int in_heap;
+    int keep_alive;
+    int fault;
+    struct mock_thread *thread;
+
+    char rbuf[READ_BUFFER_SIZE];
+    size_t rlen;
+    size_t body_remaining;  // Request body bytes still to be discarded
+
+    const mock_response_t *response;
+    size_t woff;
+    uint64_t due_ns;
+} mock_conn_t;
+
+// Server thread
+typedef struct mock_thread {
+    pthread_t tid;
+    int id;
+    int epfd;
+    int listen_fds[MAX_PORTS];
+    unsigned int seed;
+
+    mock_conn_t **heap;     // Delayed connections ordered by due time
+    int heap_count;
+    int heap_capacity;
+
+    mock_counters_t counters;
+} mock_thread_t;
+
+static mock_options_t g_opts;
+static atomic_int g_stop = 0;
+
+// Responses indexed by [keep_alive]
+static mock_response_t g_ok[2];
+static mock_response_t g_error[2];
+
+// Monotonic clock in nanoseconds
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void handle_signal(int sig) {
+    (void)sig;
+    atomic_store(&g_stop, 1);
+}
+
+static void show_help(const char *program_name) {
+    printf("Usage: %s [options]\n", program_name);
+    printf("\n");
+    printf("Options:\n");
+    printf("  -p <ports>      Ports, list and ranges e.g. \"3001-3006\" or \"3002,3004\" (default: 3001-3006)\n");
+    printf("  -b <addr>       Bind address (default: 127.0.0.1)\n");
+    printf("  -t <n>          Threads, each with its own SO_REUSEPORT listeners (default: 1)\n");
+    printf("  -s <size>       Response body size, k/m suffix allowed (default: 1k)\n");
+    printf("  -c              Chunked transfer encoding instead of Content-Length\n");
+    printf("  -C              Close after every response (default: honor request keep-alive)\n");
+    printf("  -l <dist>       Injected latency in ms:\n");
+    printf("                    fixed:MS | uniform:MIN:MAX | exp:MEAN | bimodal:FAST:SLOW:PCT\n");
+    printf("  -e <spec>       Injected errors \"PCT[:500|reset|hang]\", repeatable (default kind: 500)\n");
+    printf("  -q              Do not print statistics on exit\n");
+    printf("  -h              Show help information\n");
+    printf("\n");
+    printf("Examples:\n");
+    printf("  %s -s 16k\n", program_name);
+    printf("  %s -l bimodal:1:200:5 -e 2:reset\n", program_name);
+}
+
+// Parse "3001-3006,3010" into the port list
+static int parse_ports(const char *spec) {
+    char buf[256];
+    if (strlen(spec) >= sizeof(buf)) {
+        return -1;
+    }
+    strcpy(buf, spec);
+
+    g_opts.port_count = 0;
+    char *save = NULL;
+    for (char *tok = strtok_r(buf, ",", &save); tok != NULL; tok = strtok_r(NULL, ",", &save)) {
+        char *end;
+        long first = strtol(tok, &end, 10);
+        long last = first;
+        if (*end == '-') {
+            last = strtol(end + 1, &end, 10);
+        }
+        if (*end != '\0' || first <= 0 || last > 65535 || first > last) {
+            return -1;
+        }
+        for (long port = first; port <= last; port++) {
+            if (g_opts.port_count >= MAX_PORTS) {
+                return -1;
+            }
+            g_opts.ports[g_opts.port_count++] = (int)port;
+        }
+    }
+
+    return g_opts.port_count > 0 ? 0 : -1;
+}
+
+// Parse a size with optional k/m suffix
+static int parse_size(const char *spec, size_t *size) {
+    char *end;
+    double value = strtod(spec, &end);
+    if (end == spec || value < 0) {
+        return -1;
+    }
+    if (*end == 'k' || *end == 'K') {
+        value *= 1024;
+        end++;
+    } else if (*end == 'm' || *end == 'M') {
+        value *= 1024 * 1024;
+        end++;
+    }
+    if (*end != '\0') {
+        return -1;
+    }
+    *size = (size_t)value;
+    return 0;
+}
+
+// Parse the -l latency distribution
+static int parse_latency(const char *spec) {
+    double a = 0, b = 0, c = 0;
+
+    if (sscanf(spec, "fixed:%lf", &a) == 1 && a >= 0) {
+        g_opts.latency_type = LATENCY_FIXED;
+    } else if (sscanf(spec, "uniform:%lf:%lf", &a, &b) == 2 && a >= 0 && b >= a) {
+        g_opts.latency_type = LATENCY_UNIFORM;
+    } else if (sscanf(spec, "exp:%lf", &a) == 1 && a > 0) {
+        g_opts.latency_type = LATENCY_EXP;
+    } else if (sscanf(spec, "bimodal:%lf:%lf:%lf", &a, &b, &c) == 3 &&
+               a >= 0 && b >= 0 && c >= 0 && c <= 100) {
+        g_opts.latency_type = LATENCY_BIMODAL;
+    } else {
+        return -1;
+    }
+
+    g_opts.latency_a = a;
+    g_opts.latency_b = b;
+    g_opts.latency_pct = c;
+    return 0;
+}
+
+// Parse the -e error injection spec
+static int parse_errors(const char *spec) {
+    char *end;
+    double pct = strtod(spec, &end);
+    if (end == spec || pct < 0 || pct > 100) {
+        return -1;
+    }
+
+    int fault = FAULT_500;
+    if (*end == ':') {
+        const char *kind = end + 1;
+        if (strcmp(kind, "500") == 0) {
+            fault = FAULT_500;
+        } else if (strcmp(kind, "reset") == 0) {
+            fault = FAULT_RESET;
+        } else if (strcmp(kind, "hang") == 0) {
+            fault = FAULT_HANG;
+        } else {
+            return -1;
+        }
+    } else if (*end != '\0') {
+        return -1;
+    }
+
+    g_opts.error_rates[fault] += pct / 100.0;
+    g_opts.error_rate += pct / 100.0;
+    return g_opts.error_rate <= 1.0 ? 0 : -1;
+}
+
+// Render a complete response with the configured framing
+static int render_response(mock_response_t *r, int status, const char *reason,
+                           size_t body_size, int chunked, int keep_alive) {
+    char header[256];
+    int header_len;
+
+    if (chunked) {
+        header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.1 %d %s\r\n"
+                              "Server: mock-upstream\r\n"
+                              "Content-Type: text/plain\r\n"
+                              "Transfer-Encoding: chunked\r\n"
+                              "Connection: %s\r\n"
+                              "\r\n",
+                              status, reason, keep_alive ? "keep-alive" : "close");
+    } else {
+        header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.1 %d %s\r\n"
+                              "Server: mock-upstream\r\n"
+                              "Content-Type: text/plain\r\n"
+                              "Content-Length: %zu\r\n"
+                              "Connection: %s\r\n"
+                              "\r\n",
+                              status, reason, body_size, keep_alive ? "keep-alive" : "close");
+    }
+
+    // Chunk framing adds at most 16 bytes per chunk plus the terminator
+    size_t capacity = (size_t)header_len + body_size + (body_size / CHUNK_SIZE + 1) * 16 + 8;
+    r->data = malloc(capacity);
+    if (r->data == NULL) {
+        return -1;
+    }
+
+    memcpy(r->data, header, (size_t)header_len);
+    r->len = (size_t)header_len;
+
+    size_t remaining = body_size;
+    while (remaining > 0) {
+        size_t n = chunked && remaining > CHUNK_SIZE ? CHUNK_SIZE : remaining;
+        if (chunked) {
+            r->len += (size_t)sprintf(r->data + r->len, "%zx\r\n", n);
+        }
+        memset(r->data + r->len, 'x', n);
+        r->len += n;
+        if (chunked) {
+            memcpy(r->data + r->len, "\r\n", 2);
+            r->len += 2;
+        }
+        remaining -= n;
+    }
+    if (chunked) {
+        memcpy(r->data + r->len, "0\r\n\r\n", 5);
+        r->len += 5;
+    }
+
+    return 0;
+}
+
+// Uniform random number in [0, 1)
+static double random_unit(mock_thread_t *t) {
+    return (double)rand_r(&t->seed) / ((double)RAND_MAX + 1.0);
+}
+
+// Draw one injected latency in nanoseconds
+static uint64_t sample_latency(mock_thread_t *t) {
+    double ms = 0;
+
+    switch (g_opts.latency_type) {
+        case LATENCY_FIXED:
+            ms = g_opts.latency_a;
+            break;
+        case LATENCY_UNIFORM:
+            ms = g_opts.latency_a + (g_opts.latency_b - g_opts.latency_a) * random_unit(t);
+            break;
+        case LATENCY_EXP:
+            ms = -g_opts.latency_a * log(1.0 - random_unit(t));
+            break;
+        case LATENCY_BIMODAL:
+            ms = random_unit(t) * 100.0 < g_opts.latency_pct ? g_opts.latency_b : g_opts.latency_a;
+            break;
+        default:
+            break;
+    }
+
+    return (uint64_t)(ms * 1000000.0);
+}
+
+// Delay heap keyed by due time
+static int heap_push(mock_thread_t *t, mock_conn_t *c) {
+    if (t->heap_count == t->heap_capacity) {
+        int capacity = t->heap_capacity ? t->heap_capacity * 2 : 256;
+        mock_conn_t **heap = realloc(t->heap, (size_t)capacity * sizeof(mock_conn_t *));
+        if (heap == NULL) {
+            return -1;
+        }
+        t->heap = heap;
+        t->heap_capacity = capacity;
+    }
+
+    int i = t->heap_count++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (t->heap[parent]->due_ns <= c->due_ns) {
+            break;
+        }
+        t->heap[i] = t->heap[parent];
+        i = parent;
+    }
+    t->heap[i] = c;
+    c->in_heap = 1;
+    return 0;
+}
+
+static mock_conn_t *heap_pop(mock_thread_t *t) {
+    mock_conn_t *top = t->heap[0];
+    mock_conn_t *last = t->heap[--t->heap_count];
+
+    int i = 0;
+    for (;;) {
+        int child = i * 2 + 1;
+        if (child >= t->heap_count) {
+            break;
+        }
+        if (child + 1 < t->heap_count && t->heap[child + 1]->due_ns < t->heap[child]->due_ns) {
+            child++;
+        }
+        if (last->due_ns <= t->heap[child]->due_ns) {
+            break;
+        }
+        t->heap[i] = t->heap[child];
+        i = child;
+    }
+    if (t->heap_count > 0) {
+        t->heap[i] = last;
+    }
+
+    top->in_heap = 0;
+    return top;
+}
+
+static void conn_set_events(mock_conn_t *c, uint32_t events) {
+    struct epoll_event ev;
+    ev.events = events;
+    ev.data.ptr = c;
+    epoll_ctl(c->thread->epfd, EPOLL_CTL_MOD, c->fd, &ev);
+}
+
+// Close the socket; the structure lives on while the delay heap references it
+static void conn_close(mock_conn_t *c, int reset) {
+    if (c->fd >= 0) {
+        if (reset) {
+            struct linger lg = { 1, 0 };
+            setsockopt(c->fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+        }
+        close(c->fd);
+        c->fd = -1;
+    }
+
+    if (c->in_heap) {
+        c->closed = 1;
+    } else {
+        free(c);
+    }
+}
+
+// Whether the request headers ask to keep the connection open
+static int request_keep_alive(const char *headers, size_t len) {
+    int http10 = len > 8 && memmem(headers, len, "HTTP/1.0\r\n", 10) != NULL;
+
+    for (const char *p = headers; p != NULL && p < headers + len; ) {
+        const char *line = p;
+        const char *eol = memmem(line, (size_t)(headers + len - line), "\r\n", 2);
+        if (eol == NULL) {
+            break;
+        }
+        if ((size_t)(eol - line) > 11 && strncasecmp(line, "Connection:", 11) == 0) {
+            const char *v = line + 11;
+            while (v < eol && *v == ' ') {
+                v++;
+            }
+            if ((size_t)(eol - v) >= 5 && strncasecmp(v, "close", 5) == 0) {
+                return 0;
+            }
+            if ((size_t)(eol - v) >= 10 && strncasecmp(v, "keep-alive", 10) == 0) {
+                return 1;
+            }
+        }
+        p = eol + 2;
+    }
+
+    return !http10;
+}
+
+// Request body length announced by Content-Length
+static size_t request_content_length(const char *headers, size_t len) {
+    for (const char *p = headers; p < headers + len; ) {
+        const char *eol = memmem(p, (size_t)(headers + len - p), "\r\n", 2);
+        if (eol == NULL) {
+            break;
+        }
+        if ((size_t)(eol - p) > 15 && strncasecmp(p, "Content-Length:", 15) == 0) {
+            return (size_t)strtoull(p + 15, NULL, 10);
+        }
+        p = eol + 2;
+    }
+    return 0;
+}
+
+static void conn_process(mock_conn_t *c, uint64_t now);
+
+// Write as much of the pending response as the socket takes
+static void conn_write(mock_conn_t *c, uint64_t now) {
+    mock_thread_t *t = c->thread;
+
+    while (c->woff < c->response->len) {
+        ssize_t n = send(c->fd, c->response->data + c->woff, c->response->len - c->woff, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (c->state != CONN_WRITING) {
+                    c->state = CONN_WRITING;
+                    conn_set_events(c, EPOLLOUT);
+                }
+                return;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            conn_close(c, 0);
+            return;
+        }
+        c->woff += (size_t)n;
+        t->counters.bytes_written += (uint64_t)n;
+    }
+
+    t->counters.responses++;
+    if (!c->keep_alive) {
+        shutdown(c->fd, SHUT_WR);
+        conn_close(c, 0);
+        return;
+    }
+
+    // Serve the next pipelined request, if any
+    c->response = NULL;
+    c->state = CONN_READING;
+    conn_set_events(c, EPOLLIN | EPOLLRDHUP);
+    conn_process(c, now);
+}
+
+// Deliver the response for the current request
+static void conn_respond(mock_conn_t *c, uint64_t now) {
+    switch (c->fault) {
+        case FAULT_RESET:
+            conn_close(c, 1);
+            return;
+        case FAULT_HANG:
+            c->state = CONN_HUNG;
+            conn_set_events(c, EPOLLIN | EPOLLRDHUP);
+            return;
+        case FAULT_500:
+            c->response = &g_error[c->keep_alive];
+            break;
+        default:
+            c->response = &g_ok[c->keep_alive];
+            break;
+    }
+
+    c->woff = 0;
+    conn_write(c, now);
+}
+
+// Parse the next complete request in the read buffer and schedule its response
+static void conn_process(mock_conn_t *c, uint64_t now) {
+    mock_thread_t *t = c->thread;
+
+    // Discard request body bytes
+    if (c->body_remaining > 0) {
+        size_t n = c->rlen < c->body_remaining ? c->rlen : c->body_remaining;
+        memmove(c->rbuf, c->rbuf + n, c->rlen - n);
+        c->rlen -= n;
+        c->body_remaining -= n;
+        if (c->body_remaining > 0) {
+            return;
+        }
+    }
+
+    char *end = memmem(c->rbuf, c->rlen, "\r\n\r\n", 4);
+    if (end == NULL) {
+        if (c->rlen == sizeof(c->rbuf)) {
+            // Header block larger than the buffer
+            conn_close(c, 0);
+        }
+        return;
+    }
+
+    size_t header_len = (size_t)(end - c->rbuf) + 4;
+    c->keep_alive = !g_opts.force_close && request_keep_alive(c->rbuf, header_len);
+    c->body_remaining = request_content_length(c->rbuf, header_len);
+    memmove(c->rbuf, c->rbuf + header_len, c->rlen - header_len);
+    c->rlen -= header_len;
+    if (c->body_remaining > 0) {
+        size_t n = c->rlen < c->body_remaining ? c->rlen : c->body_remaining;
+        memmove(c->rbuf, c->rbuf + n, c->rlen - n);
+        c->rlen -= n;
+        c->body_remaining -= n;
+    }
+
+    t->counters.requests++;
+    c->fault = FAULT_NONE;
+    if (g_opts.error_rate > 0) {
+        double r = random_unit(t);
+        for (int k = FAULT_500; k <= FAULT_HANG; k++) {
+            if (r < g_opts.error_rates[k]) {
+                c->fault = k;
+                t->counters.faults[k]++;
+                break;
+            }
+            r -= g_opts.error_rates[k];
+        }
+    }
+
+    uint64_t delay = sample_latency(t);
+    if (delay > 0 && c->fault != FAULT_HANG) {
+        c->due_ns = now + delay;
+        c->state = CONN_DELAYED;
+        if (heap_push(t, c) < 0) {
+            conn_close(c, 0);
+            return;
+        }
+        t->counters.delayed++;
+        conn_set_events(c, 0);
+        return;
+    }
+
+    conn_respond(c, now);
+}
+
+// Read available request bytes
+static void conn_read(mock_conn_t *c, uint64_t now) {
+    for (;;) {
+        if (c->rlen == sizeof(c->rbuf)) {
+            break;
+        }
+        ssize_t n = recv(c->fd, c->rbuf + c->rlen, sizeof(c->rbuf) - c->rlen, 0);
+        if (n == 0) {
+            conn_close(c, 0);
+            return;
+        }
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            conn_close(c, 0);
+            return;
+        }
+        c->rlen += (size_t)n;
+    }
+
+    if (c->state == CONN_HUNG) {
+        // Swallow input until the peer gives up
+        c->rlen = 0;
+        return;
+    }
+
+    conn_process(c, now);
+}
+
+static void conn_event(mock_conn_t *c, uint32_t events, uint64_t now) {
+    if (events & EPOLLERR) {
+        conn_close(c, 0);
+        return;
+    }
+
+    switch (c->state) {
+        case CONN_READING:
+        case CONN_HUNG:
+            if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+                conn_read(c, now);
+            }
+            break;
+        case CONN_WRITING:
+            if (events & EPOLLHUP) {
+                conn_close(c, 0);
+            } else if (events & EPOLLOUT) {
+                conn_write(c, now);
+            }
+            break;
+        default:
+            // Delayed: only a hangup is reported, drop the connection early
+            if (events & EPOLLHUP) {
+                conn_close(c, 0);
+            }
+            break;
+    }
+}
+
+static void accept_connections(mock_thread_t *t, int listen_fd) {
+    for (;;) {
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+
+        mock_conn_t *c = calloc(1, sizeof(mock_conn_t));
+        if (c == NULL) {
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        c->thread = t;
+        c->state = CONN_READING;
+
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.ptr = c;
+        if (epoll_ctl(t->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            close(fd);
+            free(c);
+            continue;
+        }
+        t->counters.connections++;
+    }
+}
+
+// Respond to every delayed connection that is due; returns ms until the next one
+static int run_due(mock_thread_t *t, uint64_t now) {
+    while (t->heap_count > 0 && t->heap[0]->due_ns <= now) {
+        mock_conn_t *c = heap_pop(t);
+        if (c->closed) {
+            free(c);
+            continue;
+        }
+        conn_set_events(c, EPOLLIN | EPOLLRDHUP);
+        c->state = CONN_READING;
+        conn_respond(c, now);
+    }
+
+    if (t->heap_count == 0) {
+        return MAX_WAIT_MS;
+    }
+
+    uint64_t wait_ms = (t->heap[0]->due_ns - now + 999999) / 1000000;
+    return wait_ms < MAX_WAIT_MS ? (int)wait_ms : MAX_WAIT_MS;
+}
+
+static void *mock_thread_main(void *arg) {
+    mock_thread_t *t = arg;
+    struct epoll_event events[MAX_EVENTS];
+
+    while (!atomic_load(&g_stop)) {
+        int timeout = run_due(t, now_ns());
+        int n = epoll_wait(t->epfd, events, MAX_EVENTS, timeout);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            break;
+        }
+
+        uint64_t now = now_ns();
+        for (int i = 0; i < n; i++) {
+            void *ptr = events[i].data.ptr;
+            int listener = -1;
+            for (int p = 0; p < g_opts.port_count; p++) {
+                if (ptr == &t->listen_fds[p]) {
+                    listener = t->listen_fds[p];
+                    break;
+                }
+            }
+            if (listener >= 0) {
+                accept_connections(t, listener);
+            } else {
+                conn_event(ptr, events[i].events, now);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+// Open one SO_REUSEPORT listener so that every thread accepts on its own queue
+static int open_listener(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, g_opts.host, &addr.sin_addr) != 1 ||
+        bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(fd, SOMAXCONN) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static const char *latency_name(void) {
+    static const char *names[] = {"none", "fixed", "uniform", "exp", "bimodal"};
+    return names[g_opts.latency_type];
+}
+
+static void print_stats(const mock_thread_t *threads, double elapsed) {
+    static const char *fault_names[] = {"", "500", "reset", "hang"};
+    mock_counters_t total;
+    memset(&total, 0, sizeof(total));
+
+    for (int i = 0; i < g_opts.threads; i++) {
+        const mock_counters_t *c = &threads[i].counters;
+        total.connections += c->connections;
+        total.requests += c->requests;
+        total.responses += c->responses;
+        total.bytes_written += c->bytes_written;
+        total.delayed += c->delayed;
+        for (int k = 0; k < 4; k++) {
+            total.faults[k] += c->faults[k];
+        }
+    }
+
+    fprintf(stderr, "mock-upstream: %.1fs, %lu connections, %lu requests, %lu responses, %.2f MB written\n",
+            elapsed, total.connections, total.requests, total.responses,
+            (double)total.bytes_written / (1024.0 * 1024.0));
+    fprintf(stderr, "  delayed: %lu (%s)", total.delayed, latency_name());
+    for (int k = FAULT_500; k <= FAULT_HANG; k++) {
+        if (total.faults[k] > 0) {
+            fprintf(stderr, ", %s: %lu", fault_names[k], total.faults[k]);
+        }
+    }
+    fprintf(stderr, "\n");
+}
+
+int main(int argc, char *argv[]) {
+    int opt;
+
+    memset(&g_opts, 0, sizeof(g_opts));
+    strcpy(g_opts.host, "127.0.0.1");
+    g_opts.threads = 1;
+    g_opts.body_size = 1024;
+    parse_ports("3001-3006");
+
+    while ((opt = getopt(argc, argv, "p:b:t:s:cCl:e:qh")) != -1) {
+        switch (opt) {
+            case 'p':
+                if (parse_ports(optarg) < 0) {
+                    fprintf(stderr, "Invalid port list: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'b':
+                if (strlen(optarg) >= sizeof(g_opts.host)) {
+                    fprintf(stderr, "Invalid bind address: %s\n", optarg);
+                    return 1;
+                }
+                strcpy(g_opts.host, optarg);
+                break;
+            case 't': g_opts.threads = atoi(optarg); break;
+            case 's':
+                if (parse_size(optarg, &g_opts.body_size) < 0) {
+                    fprintf(stderr, "Invalid body size: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'c': g_opts.chunked = 1; break;
+            case 'C': g_opts.force_close = 1; break;
+            case 'l':
+                if (parse_latency(optarg) < 0) {
+                    fprintf(stderr, "Invalid latency distribution: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'e':
+                if (parse_errors(optarg) < 0) {
+                    fprintf(stderr, "Invalid error spec: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'q': g_opts.quiet = 1; break;
+            case 'h':
+                show_help(argv[0]);
+                return 0;
+            default:
+                show_help(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind != argc || g_opts.threads <= 0) {
+        show_help(argv[0]);
+        return 1;
+    }
+
+    for (int ka = 0; ka < 2; ka++) {
+        if (render_response(&g_ok[ka], 200, "OK", g_opts.body_size, g_opts.chunked, ka) < 0 ||
+            render_response(&g_error[ka], 500, "Internal Server Error", 22, g_opts.chunked, ka) < 0) {
+            perror("malloc");
+            return 1;
+        }
+        // Error body reads as text rather than filler
+        memcpy(strstr(g_error[ka].data, "\r\n\r\n") + 4 + (g_opts.chunked ? 4 : 0), "mock upstream failure\n", 22);
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+
+    mock_thread_t *threads = calloc((size_t)g_opts.threads, sizeof(mock_thread_t));
+    if (threads == NULL) {
+        perror("calloc");
+        return 1;
+    }
+
+    uint64_t start = now_ns();
+    for (int i = 0; i < g_opts.threads; i++) {
+        mock_thread_t *t = &threads[i];
+        t->id = i;
+        t->seed = (unsigned int)(start ^ (uint64_t)(i + 1) * 2654435761U);
+        t->epfd = epoll_create1(0);
+        if (t->epfd < 0) {
+            perror("epoll_create1");
+            return 1;
+        }
+
+        for (int p = 0; p < g_opts.port_count; p++) {
+            t->listen_fds[p] = open_listener(g_opts.ports[p]);
+            if (t->listen_fds[p] < 0) {
+                fprintf(stderr, "Cannot listen on %s:%d: %s\n", g_opts.host, g_opts.ports[p], strerror(errno));
+                return 1;
+            }
+
+            struct epoll_event ev;
+            ev.events = EPOLLIN;
+            ev.data.ptr = &t->listen_fds[p];
+            epoll_ctl(t->epfd, EPOLL_CTL_ADD, t->listen_fds[p], &ev);
+        }
+    }
+
+    if (!g_opts.quiet) {
+        fprintf(stderr, "mock-upstream: %d port(s) from %d, %d thread(s), body %zu bytes %s, %s, latency %s, errors %.2f%%\n",
+                g_opts.port_count, g_opts.ports[0], g_opts.threads, g_opts.body_size,
+                g_opts.chunked ? "chunked" : "content-length",
+                g_opts.force_close ? "close" : "keep-alive", latency_name(), g_opts.error_rate * 100.0);
+    }
+
+    for (int i = 0; i < g_opts.threads; i++) {
+        if (pthread_create(&threads[i].tid, NULL, mock_thread_main, &threads[i]) != 0) {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+    for (int i = 0; i < g_opts.threads; i++) {
+        pthread_join(threads[i].tid, NULL);
+    }
+
+    if (!g_opts.quiet) {
+        print_stats(threads, (double)(now_ns() - start) / 1e9);
+    }
+
+    return 0;
+}
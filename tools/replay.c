@@ -0,0 +1,815 @@
+/**
+ * X-Server Access Log Replay
+ * Rebuilds the request stream from access logs written by log_access() and
+ * replays it against a test instance at the original timing, at a scaled
+ * speed or as fast as the concurrency limit allows, then reports latency per
+ * route. Parsed logs can be saved as a compact binary trace (-w) that loads
+ * much faster than re-parsing large text logs.
+ *
+ * Usage: x-replay [options] <host:port> <access.log|trace.bin>...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <netdb.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "hdr_histogram.h"
+#include "bench_meta.h"
+
+#define MAX_ROUTES 128
+#define MAX_EVENTS 256
+#define MAX_REQUEST_LEN 4096
+#define TRACE_MAGIC "XRPLAY01"
+#define HOUSEKEEPING_NS (50 * 1000000ULL)
+
+// One request reconstructed from the log
+typedef struct replay_record {
+    uint64_t offset_us;     // Time since the first record
+    int status;             // Status code written to the log
+    uint32_t size;          // Response size written to the log
+    int route;
+    char method[8];
+    char *path;
+} replay_record_t;
+
+// Latency and status counters of one route
+typedef struct replay_route {
+    char prefix[256];
+    uint64_t requests;
+    uint64_t errors;
+    uint64_t status[6];
+    uint64_t mismatches;    // Status differs from the logged one
+    hdr_histogram_t latency;
+} replay_route_t;
+
+// In-flight request, one connection each (x-server closes after every response)
+typedef struct replay_conn {
+    int fd;
+    int record;
+    uint64_t intended_ns;
+    uint64_t sent_ns;
+    char request[MAX_REQUEST_LEN];
+    size_t request_len;
+    size_t woff;
+    char head[16];          // Start of the status line
+    size_t head_len;
+    int writing;
+    struct replay_conn *next_free;
+} replay_conn_t;
+
+// Command line options
+typedef struct replay_options {
+    char host[256];
+    char port[16];
+    double speed;           // 0 replays at maximum rate
+    int concurrency;
+    int timeout;
+    size_t limit;
+    const char *routes_conf;
+    const char *trace_out;
+    const char *json_path;
+    int quiet;
+} replay_options_t;
+
+static replay_options_t g_opts;
+static struct sockaddr_storage g_addr;
+static socklen_t g_addrlen;
+static volatile sig_atomic_t g_stop = 0;
+
+static replay_record_t *g_records = NULL;
+static size_t g_record_count = 0;
+static size_t g_record_capacity = 0;
+static size_t g_skipped_lines = 0;
+
+static replay_route_t g_routes[MAX_ROUTES];
+static int g_route_count = 0;
+static int g_routes_from_conf = 0;
+
+static uint64_t g_connect_errors = 0;
+static uint64_t g_io_errors = 0;
+static uint64_t g_timeouts = 0;
+static int g_in_flight = 0;
+
+// Monotonic clock in nanoseconds
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void handle_signal(int sig) {
+    (void)sig;
+    g_stop = 1;
+}
+
+static void show_help(const char *program_name) {
+    printf("Usage: %s [options] <host:port> <access.log|trace.bin>...\n", program_name);
+    printf("\n");
+    printf("Options:\n");
+    printf("  -s <factor>     Replay speed: 1 original timing, 2 twice as fast, 0 maximum rate (default: 1)\n");
+    printf("  -c <n>          Maximum concurrent requests (default: 256)\n");
+    printf("  -n <n>          Replay at most n requests\n");
+    printf("  -r <conf>       Group latency by the route prefixes of a server config file\n");
+    printf("                  (default: first path segment)\n");
+    printf("  -T <sec>        Request timeout in seconds (default: 5)\n");
+    printf("  -w <file>       Write the parsed requests as a binary trace and exit\n");
+    printf("  -j <file>       Write JSON results to file (\"-\" for stdout)\n");
+    printf("  -m <key=value>  Label stored in the JSON metadata, repeatable\n");
+    printf("  -q              Do not print the text report\n");
+    printf("  -h              Show help information\n");
+    printf("\n");
+    printf("Latency is measured from each request's scheduled time, so requests held back\n");
+    printf("by the concurrency limit are charged to the server.\n");
+    printf("\n");
+    printf("Examples:\n");
+    printf("  %s -s 4 -r config/gateway_multiprocess.conf 127.0.0.1:9001 logs/access.2024-01-01.log\n", program_name);
+    printf("  %s -w trace.bin 127.0.0.1:9001 logs/access.*.log && %s -s 0 127.0.0.1:9001 trace.bin\n",
+           program_name, program_name);
+}
+
+/* ---- Input ---- */
+
+static replay_record_t *new_record(void) {
+    if (g_record_count == g_record_capacity) {
+        size_t capacity = g_record_capacity ? g_record_capacity * 2 : 4096;
+        replay_record_t *records = realloc(g_records, capacity * sizeof(replay_record_t));
+        if (records == NULL) {
+            return NULL;
+        }
+        g_records = records;
+        g_record_capacity = capacity;
+    }
+    replay_record_t *r = &g_records[g_record_count];
+    memset(r, 0, sizeof(*r));
+    return r;
+}
+
+/**
+ * Parse one log_access() line:
+ * ip - - [YYYY-MM-DD HH:MM:SS.uuuuuu] "METHOD path HTTP/1.1" status size "-" "agent"
+ * The absolute time is only used for ordering and spacing, so it is read as UTC
+ */
+static int parse_log_line(const char *line, replay_record_t *r) {
+    const char *open = strchr(line, '[');
+    const char *close = open ? strchr(open, ']') : NULL;
+    if (close == NULL) {
+        return -1;
+    }
+
+    struct tm tm;
+    int usec = 0;
+    memset(&tm, 0, sizeof(tm));
+    if (sscanf(open + 1, "%d-%d-%d %d:%d:%d.%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+               &tm.tm_hour, &tm.tm_min, &tm.tm_sec, &usec) < 6) {
+        return -1;
+    }
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    r->offset_us = (uint64_t)timegm(&tm) * 1000000ULL + (uint64_t)usec;
+
+    char path[MAX_REQUEST_LEN / 2];
+    unsigned long size = 0;
+    if (sscanf(close + 1, " \"%7s %2047s HTTP/%*[^\"]\" %d %lu", r->method, path, &r->status, &size) != 4 ||
+        path[0] != '/') {
+        return -1;
+    }
+    r->size = (uint32_t)size;
+    r->path = strdup(path);
+    return r->path != NULL ? 0 : -1;
+}
+
+static int read_text_log(FILE *f) {
+    char line[8192];
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        replay_record_t *r = new_record();
+        if (r == NULL) {
+            return -1;
+        }
+        if (parse_log_line(line, r) == 0) {
+            g_record_count++;
+        } else {
+            g_skipped_lines++;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Binary trace: magic, then per record
+ * u64 offset_us, u32 size, u16 status, u8 method_len, u16 path_len, method, path
+ */
+static int read_trace(FILE *f) {
+    for (;;) {
+        uint64_t offset_us;
+        uint32_t size;
+        uint16_t status, path_len;
+        uint8_t method_len;
+
+        if (fread(&offset_us, sizeof(offset_us), 1, f) != 1) {
+            return feof(f) ? 0 : -1;
+        }
+        if (fread(&size, sizeof(size), 1, f) != 1 || fread(&status, sizeof(status), 1, f) != 1 ||
+            fread(&method_len, sizeof(method_len), 1, f) != 1 || fread(&path_len, sizeof(path_len), 1, f) != 1 ||
+            method_len >= sizeof(((replay_record_t *)0)->method) || path_len == 0 || path_len >= MAX_REQUEST_LEN / 2) {
+            return -1;
+        }
+
+        replay_record_t *r = new_record();
+        if (r == NULL || (r->path = malloc((size_t)path_len + 1)) == NULL) {
+            return -1;
+        }
+        if (fread(r->method, 1, method_len, f) != method_len || fread(r->path, 1, path_len, f) != path_len) {
+            free(r->path);
+            return -1;
+        }
+        r->method[method_len] = '\0';
+        r->path[path_len] = '\0';
+        r->offset_us = offset_us;
+        r->size = size;
+        r->status = status;
+        g_record_count++;
+    }
+}
+
+static int load_input(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    char magic[sizeof(TRACE_MAGIC) - 1];
+    int is_trace = fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+                   memcmp(magic, TRACE_MAGIC, sizeof(magic)) == 0;
+    if (!is_trace) {
+        rewind(f);
+    }
+
+    int rc = is_trace ? read_trace(f) : read_text_log(f);
+    fclose(f);
+    if (rc < 0) {
+        fprintf(stderr, "%s: %s\n", path, is_trace ? "corrupt trace" : "read failed");
+    }
+    return rc;
+}
+
+static int write_trace(const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    fwrite(TRACE_MAGIC, 1, sizeof(TRACE_MAGIC) - 1, f);
+    for (size_t i = 0; i < g_record_count; i++) {
+        const replay_record_t *r = &g_records[i];
+        uint16_t status = (uint16_t)r->status;
+        uint8_t method_len = (uint8_t)strlen(r->method);
+        uint16_t path_len = (uint16_t)strlen(r->path);
+
+        fwrite(&r->offset_us, sizeof(r->offset_us), 1, f);
+        fwrite(&r->size, sizeof(r->size), 1, f);
+        fwrite(&status, sizeof(status), 1, f);
+        fwrite(&method_len, sizeof(method_len), 1, f);
+        fwrite(&path_len, sizeof(path_len), 1, f);
+        fwrite(r->method, 1, method_len, f);
+        fwrite(r->path, 1, path_len, f);
+    }
+
+    if (fclose(f) != 0) {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+static int compare_records(const void *a, const void *b) {
+    const replay_record_t *x = a, *y = b;
+    return x->offset_us < y->offset_us ? -1 : x->offset_us > y->offset_us;
+}
+
+/* ---- Routes ---- */
+
+static int add_route(const char *prefix) {
+    for (int i = 0; i < g_route_count; i++) {
+        if (strcmp(g_routes[i].prefix, prefix) == 0) {
+            return i;
+        }
+    }
+    if (g_route_count >= MAX_ROUTES || strlen(prefix) >= sizeof(g_routes[0].prefix)) {
+        return -1;
+    }
+
+    replay_route_t *route = &g_routes[g_route_count];
+    memset(route, 0, sizeof(*route));
+    strcpy(route->prefix, prefix);
+    hdr_init(&route->latency);
+    return g_route_count++;
+}
+
+// Read "route <type> <prefix> ..." lines of a server config file
+static int load_routes(const char *conf) {
+    FILE *f = fopen(conf, "r");
+    if (f == NULL) {
+        perror(conf);
+        return -1;
+    }
+
+    char line[1024];
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char type[32], prefix[256];
+        if (sscanf(line, " route %31s %255s", type, prefix) == 2 && prefix[0] == '/') {
+            add_route(prefix);
+        }
+    }
+    fclose(f);
+
+    g_routes_from_conf = g_route_count > 0;
+    return 0;
+}
+
+// Longest configured prefix, or the first path segment without a config
+static int route_of(const char *path) {
+    if (g_routes_from_conf) {
+        int best = -1;
+        size_t best_len = 0;
+        for (int i = 0; i < g_route_count; i++) {
+            size_t len = strlen(g_routes[i].prefix);
+            if (len > best_len && strncmp(path, g_routes[i].prefix, len) == 0) {
+                best = i;
+                best_len = len;
+            }
+        }
+        return best >= 0 ? best : add_route("(unrouted)");
+    }
+
+    char prefix[256];
+    size_t len = strcspn(path + 1, "/?");
+    if (path[1 + len] == '/' && len + 2 < sizeof(prefix)) {
+        memcpy(prefix, path, len + 2);
+        prefix[len + 2] = '\0';
+    } else {
+        strcpy(prefix, "/");
+    }
+    int route = add_route(prefix);
+    return route >= 0 ? route : add_route("(other)");
+}
+
+/* ---- Replay ---- */
+
+static int resolve_target(const char *target) {
+    const char *p = strncmp(target, "http://", 7) == 0 ? target + 7 : target;
+    const char *colon = strrchr(p, ':');
+    size_t host_len = colon ? (size_t)(colon - p) : strlen(p);
+    if (host_len == 0 || host_len >= sizeof(g_opts.host) || (colon && strlen(colon + 1) >= sizeof(g_opts.port))) {
+        fprintf(stderr, "Invalid target: %s\n", target);
+        return -1;
+    }
+    memcpy(g_opts.host, p, host_len);
+    g_opts.host[host_len] = '\0';
+    strcpy(g_opts.port, colon ? colon + 1 : "80");
+
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    int rc = getaddrinfo(g_opts.host, g_opts.port, &hints, &res);
+    if (rc != 0) {
+        fprintf(stderr, "Unable to resolve %s:%s: %s\n", g_opts.host, g_opts.port, gai_strerror(rc));
+        return -1;
+    }
+    memcpy(&g_addr, res->ai_addr, res->ai_addrlen);
+    g_addrlen = res->ai_addrlen;
+    freeaddrinfo(res);
+    return 0;
+}
+
+// Record the outcome of a request and release its connection
+static void finish_request(int epfd, replay_conn_t *c, replay_conn_t **free_list, int status, uint64_t now) {
+    const replay_record_t *r = &g_records[c->record];
+    replay_route_t *route = &g_routes[r->route];
+
+    route->requests++;
+    if (status <= 0) {
+        route->errors++;
+    } else {
+        route->status[status / 100 < 6 ? status / 100 : 0]++;
+        if (status != r->status) {
+            route->mismatches++;
+        }
+        hdr_record(&route->latency, (now - c->intended_ns) / 1000);
+    }
+
+    epoll_ctl(epfd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    c->fd = -1;
+    c->next_free = *free_list;
+    *free_list = c;
+    g_in_flight--;
+}
+
+static int start_request(int epfd, replay_conn_t *c, int record, uint64_t intended_ns) {
+    const replay_record_t *r = &g_records[record];
+    int has_body = strcmp(r->method, "GET") != 0 && strcmp(r->method, "HEAD") != 0;
+
+    int len = snprintf(c->request, sizeof(c->request),
+                       "%s %s HTTP/1.1\r\n"
+                       "Host: %s:%s\r\n"
+                       "User-Agent: x-replay\r\n"
+                       "Connection: close\r\n"
+                       "%s"
+                       "\r\n",
+                       r->method, r->path, g_opts.host, g_opts.port, has_body ? "Content-Length: 0\r\n" : "");
+    if (len <= 0 || (size_t)len >= sizeof(c->request)) {
+        return -1;
+    }
+
+    c->fd = socket(g_addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (c->fd < 0) {
+        return -1;
+    }
+    int one = 1;
+    setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (connect(c->fd, (struct sockaddr *)&g_addr, g_addrlen) < 0 && errno != EINPROGRESS) {
+        close(c->fd);
+        c->fd = -1;
+        return -1;
+    }
+
+    c->record = record;
+    c->intended_ns = intended_ns;
+    c->sent_ns = now_ns();
+    c->request_len = (size_t)len;
+    c->woff = 0;
+    c->head_len = 0;
+    c->writing = 1;
+
+    struct epoll_event ev;
+    ev.events = EPOLLOUT | EPOLLIN | EPOLLRDHUP;
+    ev.data.ptr = c;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, c->fd, &ev) < 0) {
+        close(c->fd);
+        c->fd = -1;
+        return -1;
+    }
+    g_in_flight++;
+    return 0;
+}
+
+static void conn_event(int epfd, replay_conn_t *c, uint32_t events, replay_conn_t **free_list, uint64_t now) {
+    if (c->writing && (events & EPOLLOUT)) {
+        while (c->woff < c->request_len) {
+            ssize_t n = send(c->fd, c->request + c->woff, c->request_len - c->woff, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    return;
+                }
+                if (c->woff == 0 && errno != EPIPE) {
+                    g_connect_errors++;
+                } else {
+                    g_io_errors++;
+                }
+                finish_request(epfd, c, free_list, -1, now);
+                return;
+            }
+            c->woff += (size_t)n;
+        }
+        c->writing = 0;
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.ptr = c;
+        epoll_ctl(epfd, EPOLL_CTL_MOD, c->fd, &ev);
+    }
+
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+        char buf[16384];
+        for (;;) {
+            ssize_t n = recv(c->fd, buf, sizeof(buf), 0);
+            if (n > 0) {
+                size_t take = sizeof(c->head) - 1 - c->head_len;
+                if (take > (size_t)n) {
+                    take = (size_t)n;
+                }
+                memcpy(c->head + c->head_len, buf, take);
+                c->head_len += take;
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                return;
+            }
+
+            // The request carries Connection: close, so EOF ends the response
+            c->head[c->head_len] = '\0';
+            int status = 0;
+            if (n < 0 || sscanf(c->head, "HTTP/%*d.%*d %d", &status) != 1) {
+                if (c->woff == 0) {
+                    g_connect_errors++;
+                } else {
+                    g_io_errors++;
+                }
+                status = -1;
+            }
+            finish_request(epfd, c, free_list, status, now);
+            return;
+        }
+    }
+}
+
+// Fail requests that exceeded the timeout
+static void expire_requests(int epfd, replay_conn_t *conns, replay_conn_t **free_list, uint64_t now) {
+    uint64_t timeout_ns = (uint64_t)g_opts.timeout * 1000000000ULL;
+    for (int i = 0; i < g_opts.concurrency; i++) {
+        if (conns[i].fd >= 0 && now - conns[i].sent_ns > timeout_ns) {
+            g_timeouts++;
+            finish_request(epfd, &conns[i], free_list, -1, now);
+        }
+    }
+}
+
+static double replay(void) {
+    int epfd = epoll_create1(0);
+    replay_conn_t *conns = calloc((size_t)g_opts.concurrency, sizeof(replay_conn_t));
+    if (epfd < 0 || conns == NULL) {
+        perror("setup");
+        exit(1);
+    }
+
+    replay_conn_t *free_list = NULL;
+    for (int i = g_opts.concurrency - 1; i >= 0; i--) {
+        conns[i].fd = -1;
+        conns[i].next_free = free_list;
+        free_list = &conns[i];
+    }
+
+    struct epoll_event events[MAX_EVENTS];
+    size_t next = 0;
+    uint64_t start = now_ns();
+    uint64_t base_us = g_records[0].offset_us;
+    uint64_t last_housekeeping = start;
+
+    while (!g_stop && (next < g_record_count || g_in_flight > 0)) {
+        uint64_t now = now_ns();
+
+        // Dispatch every request that is due and has a free connection
+        int wait_ms = 100;
+        while (next < g_record_count && free_list != NULL) {
+            uint64_t intended = now;
+            if (g_opts.speed > 0) {
+                intended = start + (uint64_t)((double)(g_records[next].offset_us - base_us) * 1000.0 / g_opts.speed);
+                if (intended > now) {
+                    uint64_t ms = (intended - now + 999999) / 1000000;
+                    wait_ms = ms < 100 ? (int)ms : 100;
+                    break;
+                }
+            }
+
+            replay_conn_t *c = free_list;
+            free_list = c->next_free;
+            if (start_request(epfd, c, (int)next, intended) < 0) {
+                g_connect_errors++;
+                g_routes[g_records[next].route].requests++;
+                g_routes[g_records[next].route].errors++;
+                c->next_free = free_list;
+                free_list = c;
+            }
+            next++;
+        }
+
+        int n = epoll_wait(epfd, events, MAX_EVENTS, wait_ms);
+        if (n < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            break;
+        }
+
+        now = now_ns();
+        for (int i = 0; i < n; i++) {
+            conn_event(epfd, events[i].data.ptr, events[i].events, &free_list, now);
+        }
+
+        if (now - last_housekeeping >= HOUSEKEEPING_NS) {
+            expire_requests(epfd, conns, &free_list, now);
+            last_housekeeping = now;
+        }
+    }
+
+    for (int i = 0; i < g_opts.concurrency; i++) {
+        if (conns[i].fd >= 0) {
+            close(conns[i].fd);
+        }
+    }
+    free(conns);
+    close(epfd);
+    return (double)(now_ns() - start) / 1e9;
+}
+
+/* ---- Reporting ---- */
+
+static void print_text(const hdr_histogram_t *total, uint64_t requests, uint64_t errors, double elapsed, double span) {
+    printf("x-replay %s:%s - %zu requests, log span %.1fs, ", g_opts.host, g_opts.port, g_record_count, span);
+    if (g_opts.speed > 0) {
+        printf("speed %.2fx, ", g_opts.speed);
+    } else {
+        printf("maximum rate, ");
+    }
+    printf("concurrency %d\n", g_opts.concurrency);
+    if (g_skipped_lines > 0) {
+        printf("  (%zu unparsable log lines skipped)\n", g_skipped_lines);
+    }
+    printf("\n");
+    printf("  Elapsed:     %.2fs\n", elapsed);
+    printf("  Requests:    %lu (%.2f req/s)\n", requests, elapsed > 0 ? (double)requests / elapsed : 0.0);
+    printf("  Errors:      %lu (connect %lu, io %lu, timeout %lu)\n", errors, g_connect_errors, g_io_errors, g_timeouts);
+    printf("\n");
+    printf("  %-24s %9s %7s %7s %7s %7s %7s %9s %9s %9s %9s %9s\n", "route", "requests", "errors",
+           "2xx", "3xx", "4xx", "5xx", "mismatch", "p50(us)", "p90(us)", "p99(us)", "max(us)");
+    for (int i = 0; i < g_route_count; i++) {
+        const replay_route_t *r = &g_routes[i];
+        if (r->requests == 0) {
+            continue;
+        }
+        printf("  %-24.24s %9lu %7lu %7lu %7lu %7lu %7lu %9lu %9lu %9lu %9lu %9lu\n", r->prefix, r->requests,
+               r->errors, r->status[2], r->status[3], r->status[4], r->status[5], r->mismatches,
+               hdr_value_at_percentile(&r->latency, 50.0), hdr_value_at_percentile(&r->latency, 90.0),
+               hdr_value_at_percentile(&r->latency, 99.0), r->latency.max);
+    }
+    printf("  %-24s %9lu %7lu %47s %9lu %9lu %9lu %9lu\n", "total", requests, errors, "",
+           hdr_value_at_percentile(total, 50.0), hdr_value_at_percentile(total, 90.0),
+           hdr_value_at_percentile(total, 99.0), total->max);
+}
+
+static void print_json(FILE *out, const hdr_histogram_t *total, uint64_t requests, uint64_t errors,
+                       double elapsed, double span) {
+    fprintf(out, "{\n");
+    fprintf(out, "  \"tool\": \"x-replay\",\n");
+    fprintf(out, "  \"meta\": ");
+    bench_meta_print_json(out, "  ");
+    fprintf(out, ",\n");
+    fprintf(out, "  \"config\": {\"target\": ");
+    bench_json_string(out, g_opts.host);
+    fprintf(out, ", \"port\": %s, \"speed\": %.2f, \"concurrency\": %d, \"records\": %zu, \"log_span_sec\": %.3f},\n",
+            g_opts.port, g_opts.speed, g_opts.concurrency, g_record_count, span);
+    fprintf(out, "  \"results\": {\n");
+    fprintf(out, "    \"elapsed_sec\": %.3f,\n", elapsed);
+    fprintf(out, "    \"requests\": %lu,\n", requests);
+    fprintf(out, "    \"throughput_rps\": %.2f,\n", elapsed > 0 ? (double)requests / elapsed : 0.0);
+    fprintf(out, "    \"errors\": {\"total\": %lu, \"connect\": %lu, \"io\": %lu, \"timeout\": %lu}\n",
+            errors, g_connect_errors, g_io_errors, g_timeouts);
+    fprintf(out, "  },\n");
+    fprintf(out, "  \"latency_us\": ");
+    hdr_print_json(total, out, "  ");
+    fprintf(out, ",\n  \"routes\": [");
+    int first = 1;
+    for (int i = 0; i < g_route_count; i++) {
+        const replay_route_t *r = &g_routes[i];
+        if (r->requests == 0) {
+            continue;
+        }
+        fprintf(out, "%s\n    {\n      \"route\": ", first ? "" : ",");
+        bench_json_string(out, r->prefix);
+        fprintf(out, ",\n      \"requests\": %lu,\n      \"errors\": %lu,\n", r->requests, r->errors);
+        fprintf(out, "      \"status\": {\"2xx\": %lu, \"3xx\": %lu, \"4xx\": %lu, \"5xx\": %lu},\n",
+                r->status[2], r->status[3], r->status[4], r->status[5]);
+        fprintf(out, "      \"status_mismatches\": %lu,\n", r->mismatches);
+        fprintf(out, "      \"latency_us\": ");
+        hdr_print_json(&r->latency, out, "      ");
+        fprintf(out, "\n    }");
+        first = 0;
+    }
+    fprintf(out, "\n  ]\n}\n");
+}
+
+int main(int argc, char *argv[]) {
+    int opt;
+
+    memset(&g_opts, 0, sizeof(g_opts));
+    g_opts.speed = 1.0;
+    g_opts.concurrency = 256;
+    g_opts.timeout = 5;
+
+    while ((opt = getopt(argc, argv, "s:c:n:r:T:w:j:m:qh")) != -1) {
+        switch (opt) {
+            case 's': g_opts.speed = atof(optarg); break;
+            case 'c': g_opts.concurrency = atoi(optarg); break;
+            case 'n': g_opts.limit = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'r': g_opts.routes_conf = optarg; break;
+            case 'T': g_opts.timeout = atoi(optarg); break;
+            case 'w': g_opts.trace_out = optarg; break;
+            case 'j': g_opts.json_path = optarg; break;
+            case 'm':
+                if (bench_meta_add_label(optarg) < 0) {
+                    fprintf(stderr, "Invalid label: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'q': g_opts.quiet = 1; break;
+            case 'h':
+                show_help(argv[0]);
+                return 0;
+            default:
+                show_help(argv[0]);
+                return 1;
+        }
+    }
+
+    if (argc - optind < 2) {
+        show_help(argv[0]);
+        return 1;
+    }
+    if (g_opts.speed < 0 || g_opts.concurrency <= 0 || g_opts.timeout <= 0) {
+        fprintf(stderr, "Invalid option value\n");
+        return 1;
+    }
+    if (resolve_target(argv[optind]) < 0) {
+        return 1;
+    }
+
+    for (int i = optind + 1; i < argc; i++) {
+        if (load_input(argv[i]) < 0) {
+            return 1;
+        }
+    }
+    if (g_record_count == 0) {
+        fprintf(stderr, "No requests found in the input (%zu lines skipped)\n", g_skipped_lines);
+        return 1;
+    }
+
+    // Several workers append to the same log, restore the global order
+    qsort(g_records, g_record_count, sizeof(replay_record_t), compare_records);
+    if (g_opts.limit > 0 && g_opts.limit < g_record_count) {
+        for (size_t i = g_opts.limit; i < g_record_count; i++) {
+            free(g_records[i].path);
+        }
+        g_record_count = g_opts.limit;
+    }
+
+    if (g_opts.trace_out != NULL) {
+        if (write_trace(g_opts.trace_out) < 0) {
+            return 1;
+        }
+        printf("Wrote %zu requests to %s\n", g_record_count, g_opts.trace_out);
+        return 0;
+    }
+
+    if (g_opts.routes_conf != NULL && load_routes(g_opts.routes_conf) < 0) {
+        return 1;
+    }
+    for (size_t i = 0; i < g_record_count; i++) {
+        g_records[i].route = route_of(g_records[i].path);
+        if (g_records[i].route < 0) {
+            fprintf(stderr, "Too many routes (max %d)\n", MAX_ROUTES);
+            return 1;
+        }
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+
+    double span = (double)(g_records[g_record_count - 1].offset_us - g_records[0].offset_us) / 1e6;
+    double elapsed = replay();
+
+    hdr_histogram_t *total = malloc(sizeof(hdr_histogram_t));
+    if (total == NULL) {
+        perror("malloc");
+        return 1;
+    }
+    hdr_init(total);
+    uint64_t requests = 0, errors = 0;
+    for (int i = 0; i < g_route_count; i++) {
+        hdr_merge(total, &g_routes[i].latency);
+        requests += g_routes[i].requests;
+        errors += g_routes[i].errors;
+    }
+
+    if (!g_opts.quiet) {
+        print_text(total, requests, errors, elapsed, span);
+    }
+    if (g_opts.json_path != NULL) {
+        FILE *out = strcmp(g_opts.json_path, "-") == 0 ? stdout : fopen(g_opts.json_path, "w");
+        if (out == NULL) {
+            perror(g_opts.json_path);
+            return 1;
+        }
+        print_json(out, total, requests, errors, elapsed, span);
+        if (out != stdout) {
+            fclose(out);
+        }
+    }
+
+    return errors > 0 && errors == requests ? 2 : 0;
+}
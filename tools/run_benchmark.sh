@@ -0,0 +1,183 @@
+#!/bin/sh
+# Start a local x-server with the shipped config and public/ content, drive it
+# with x-loadgen and stop it again. Used by `make benchmark`.
+#
+# Proxy scenarios start mock-upstream on the upstream ports of the config
+# (3001-3006) so proxy throughput and tail latency can be compared against a
+# fast, slow or failing backend:
+#   static         static files from public/ (default)
+#   proxy          /api/v2/ and /public/ routes, 1 KB upstream responses
+#   proxy-slow     as proxy, upstream latency 1 ms with 5% at 100 ms
+#   proxy-failing  as proxy, 5% upstream 500s and 1% connection resets
+#   replay         replay REPLAY_LOG (access logs or x-replay trace) with x-replay
+#   soak           hold SOAK_CONNECTIONS idle keep-alive connections with x-soak
+#                  and sample Worker RSS, descriptors and event loop lag; the
+#                  config gets worker_connections and an admin socket appended
+#
+# Environment:
+#   BENCH_SCENARIO one of the scenarios above (default: static)
+#   BENCH_RUNS     repeated load runs, each one sample for x-bench-compare (default: 1)
+#   BENCH_STORE_DIR
+#                  result store directory, every run is copied there as
+#                  <scenario>-<time>-<run>.json (set by make to bench-results/<rev>)
+#   BENCH_PORT     listen port of the benchmark instance (default: 9180)
+#   BENCH_CONF     configuration file (default: config/gateway_multiprocess.conf)
+#   BENCH_ARGS     x-loadgen options, or x-replay options for the replay scenario
+#                  (default: 64 keep-alive connections, 10s, scenario mix)
+#   BENCH_JSON     JSON result file (default: logs/benchmark.json)
+#   MOCK_ARGS      mock-upstream options, overrides the scenario's defaults
+#   REPLAY_LOG     space separated log or trace files for the replay scenario
+#   SOAK_CONNECTIONS
+#                  connections held by the soak scenario (default: 10000)
+
+SERVER=${SERVER:-bin/x-server}
+LOADGEN=${LOADGEN:-tools/bin/x-loadgen}
+REPLAY=${REPLAY:-tools/bin/x-replay}
+SOAK=${SOAK:-tools/bin/x-soak}
+MOCK_UPSTREAM=${MOCK_UPSTREAM:-tools/bin/mock-upstream}
+BENCH_SCENARIO=${BENCH_SCENARIO:-static}
+BENCH_PORT=${BENCH_PORT:-9180}
+BENCH_CONF=${BENCH_CONF:-config/gateway_multiprocess.conf}
+BENCH_JSON=${BENCH_JSON:-logs/benchmark.json}
+BENCH_RUNS=${BENCH_RUNS:-1}
+SOAK_CONNECTIONS=${SOAK_CONNECTIONS:-10000}
+
+DRIVER=$LOADGEN
+DRIVER_ARGS=""
+PROXY_MIX="-u /api/v2/items@4 -u /api/v2/items/42@2 -u /public/feed@2 -u /health"
+case "$BENCH_SCENARIO" in
+    static)
+        DEFAULT_ARGS="-c 64 -t 2 -d 10 -u /index.html@4 -u /css/style.css@2 -u /js/main.js@2 -u /api/test.json -u /images/example.png"
+        DEFAULT_MOCK=""
+        ;;
+    proxy)
+        DEFAULT_ARGS="-c 64 -t 2 -d 10 $PROXY_MIX"
+        DEFAULT_MOCK="-s 1k"
+        ;;
+    proxy-slow)
+        DEFAULT_ARGS="-c 64 -t 2 -d 10 $PROXY_MIX"
+        DEFAULT_MOCK="-s 1k -l bimodal:1:100:5"
+        ;;
+    proxy-failing)
+        DEFAULT_ARGS="-c 64 -t 2 -d 10 $PROXY_MIX"
+        DEFAULT_MOCK="-s 1k -e 5:500 -e 1:reset"
+        ;;
+    replay)
+        if [ -z "$REPLAY_LOG" ]; then
+            echo "REPLAY_LOG is required for the replay scenario" >&2
+            exit 1
+        fi
+        DEFAULT_ARGS="-s 1 -r $BENCH_CONF"
+        DEFAULT_MOCK="-s 1k"
+        DRIVER=$REPLAY
+        ;;
+    soak)
+        DEFAULT_ARGS="-c $SOAK_CONNECTIONS -r 5000 -a 20 -d 60 -i 5 -u /index.html"
+        DEFAULT_MOCK=""
+        DRIVER=$SOAK
+        # Later keys override earlier ones, so the shipped config only needs the limits raised
+        SOAK_CONF=logs/bench-soak.conf
+        SOAK_ADMIN=$(pwd)/logs/bench-soak.admin.sock
+        mkdir -p logs
+        cp "$BENCH_CONF" "$SOAK_CONF"
+        {
+            echo ""
+            echo "worker_connections $((SOAK_CONNECTIONS + 1024));"
+            echo "worker_rlimit_nofile $((SOAK_CONNECTIONS + 4096));"
+            echo "admin_socket $SOAK_ADMIN;"
+        } >> "$SOAK_CONF"
+        BENCH_CONF=$SOAK_CONF
+        ;;
+    *)
+        echo "Unknown BENCH_SCENARIO: $BENCH_SCENARIO (static, proxy, proxy-slow, proxy-failing, replay, soak)" >&2
+        exit 1
+        ;;
+esac
+BENCH_ARGS=${BENCH_ARGS:-$DEFAULT_ARGS}
+MOCK_ARGS=${MOCK_ARGS:-$DEFAULT_MOCK}
+
+if [ ! -x "$SERVER" ] || [ ! -x "$LOADGEN" ] || [ ! -x "$DRIVER" ]; then
+    echo "Missing $SERVER, $LOADGEN or $DRIVER, run make first" >&2
+    exit 1
+fi
+
+mkdir -p "$(dirname "$BENCH_JSON")"
+
+MOCK_PID=""
+if [ "$BENCH_SCENARIO" != "static" ] && [ "$BENCH_SCENARIO" != "soak" ]; then
+    if [ ! -x "$MOCK_UPSTREAM" ]; then
+        echo "Missing $MOCK_UPSTREAM, run make tools first" >&2
+        exit 1
+    fi
+    # shellcheck disable=SC2086
+    "$MOCK_UPSTREAM" -t 2 $MOCK_ARGS &
+    MOCK_PID=$!
+fi
+
+"$SERVER" -f -p "$BENCH_PORT" -c "$BENCH_CONF" >/dev/null 2>&1 &
+SERVER_PID=$!
+
+stop_server() {
+    kill -TERM "$SERVER_PID" 2>/dev/null
+    wait "$SERVER_PID" 2>/dev/null
+    if [ -n "$MOCK_PID" ]; then
+        kill -TERM "$MOCK_PID" 2>/dev/null
+        wait "$MOCK_PID" 2>/dev/null
+    fi
+}
+trap stop_server EXIT INT TERM
+
+if [ -n "$MOCK_PID" ] && ! kill -0 "$MOCK_PID" 2>/dev/null; then
+    echo "mock-upstream did not start" >&2
+    exit 1
+fi
+
+# Wait until the server accepts requests
+ready=0
+for _ in 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20; do
+    if ! kill -0 "$SERVER_PID" 2>/dev/null; then
+        break
+    fi
+    if "$LOADGEN" -q -c 1 -t 1 -n 1 -d 1 -T 1 "127.0.0.1:$BENCH_PORT" >/dev/null 2>&1; then
+        ready=1
+        break
+    fi
+    sleep 0.25
+done
+
+if [ "$ready" -ne 1 ]; then
+    echo "x-server did not start on port $BENCH_PORT" >&2
+    exit 1
+fi
+
+if [ "$BENCH_SCENARIO" = "soak" ]; then
+    DRIVER_ARGS="-P $SERVER_PID -A $SOAK_ADMIN"
+fi
+
+if [ -n "$BENCH_STORE_DIR" ]; then
+    mkdir -p "$BENCH_STORE_DIR"
+fi
+stamp=$(date +%Y%m%d-%H%M%S)
+
+status=0
+run=1
+while [ "$run" -le "$BENCH_RUNS" ]; do
+    if [ "$BENCH_RUNS" -gt 1 ]; then
+        echo "--- run $run/$BENCH_RUNS"
+    fi
+    # shellcheck disable=SC2086
+    "$DRIVER" $BENCH_ARGS $DRIVER_ARGS -j "$BENCH_JSON" \
+        -m "scenario=$BENCH_SCENARIO" -m "server_conf=$BENCH_CONF" -m "mock_args=$MOCK_ARGS" \
+        -m "run=$run/$BENCH_RUNS" "127.0.0.1:$BENCH_PORT" $REPLAY_LOG || status=$?
+    if [ -n "$BENCH_STORE_DIR" ]; then
+        cp "$BENCH_JSON" "$BENCH_STORE_DIR/$BENCH_SCENARIO-$stamp-$run.json"
+    fi
+    run=$((run + 1))
+done
+
+echo ""
+echo "JSON results: $BENCH_JSON"
+if [ -n "$BENCH_STORE_DIR" ]; then
+    echo "Stored in: $BENCH_STORE_DIR"
+fi
+exit $status
@@ -0,0 +1,926 @@
+/**
+ * X-Server Connection Scaling and Idle Memory Soak
+ * Opens a large number of mostly idle keep-alive connections, keeps them open
+ * for a soak period with a trickle of active requests, then closes them. The
+ * server's Worker RSS and descriptor counts are sampled from /proc, event
+ * loop lag from the admin socket, and the client tracks accept (connect
+ * completion) rate and trickle request latency. The report gives memory per
+ * connection, RSS growth during the soak and memory retained after close,
+ * which expose leaks in connection_pool or memory_pool.
+ *
+ * Usage: x-soak [options] -P <master_pid> <host:port>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <netdb.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "hdr_histogram.h"
+#include "bench_meta.h"
+
+#define MAX_EVENTS 1024
+#define MAX_WORKERS 256
+#define MAX_SAMPLES 4096
+#define MAX_PENDING_CONNECTS 512
+#define CONNS_PER_SOURCE 25000
+#define RESPONSE_HEAD_SIZE 1024
+
+#ifndef IP_BIND_ADDRESS_NO_PORT
+#define IP_BIND_ADDRESS_NO_PORT 24
+#endif
+
+// Soak phases
+enum {
+    PHASE_BASELINE = 0,
+    PHASE_RAMP,
+    PHASE_SOAK,
+    PHASE_CLOSED
+};
+
+static const char *g_phase_names[] = {"baseline", "ramp", "soak", "closed"};
+
+// Connection states
+enum {
+    SLOT_EMPTY = 0,
+    SLOT_CONNECTING,
+    SLOT_IDLE,
+    SLOT_ACTIVE
+};
+
+// One client connection slot
+typedef struct soak_conn {
+    int fd;
+    int state;
+    uint64_t sent_ns;
+    char head[RESPONSE_HEAD_SIZE];
+    size_t head_len;
+    long body_remaining;    // -1 until the headers are complete
+} soak_conn_t;
+
+// Server side measurements of one sample
+typedef struct server_sample {
+    int workers;
+    uint64_t worker_rss_kb;
+    uint64_t master_rss_kb;
+    uint64_t worker_fds;
+    double loop_lag_ms;         // Max over Workers, -1 without admin socket
+    double loop_lag_peak_ms;
+    long tcp_mem_pages;         // Kernel TCP memory from /proc/net/sockstat
+} server_sample_t;
+
+// One timeline sample
+typedef struct soak_sample {
+    double t;
+    int phase;
+    int established;
+    uint64_t connects;          // Completed connects since the previous sample
+    double connect_rate;
+    int64_t accepted;           // Connections held by the Workers, descriptors above the baseline
+    double accept_rate;
+    uint64_t requests;          // Trickle responses since the previous sample
+    uint64_t p99_us;
+    uint64_t idle_closed;       // Idle connections closed by the server since the previous sample
+    server_sample_t server;
+} soak_sample_t;
+
+// Command line options
+typedef struct soak_options {
+    char host[256];
+    char port[16];
+    int connections;
+    double ramp_rate;
+    double request_rate;
+    int duration;
+    int interval;
+    int sources;
+    pid_t master_pid;
+    const char *admin_socket;
+    const char *path;
+    const char *json_path;
+    int quiet;
+} soak_options_t;
+
+static soak_options_t g_opts;
+static struct sockaddr_in g_addr;
+static volatile sig_atomic_t g_stop = 0;
+
+static soak_conn_t *g_conns = NULL;
+static int g_epfd = -1;
+static int g_established = 0;
+static int g_pending_connects = 0;
+static int g_next_slot = 0;
+static unsigned int g_seed = 1;
+static char g_request[1024];
+static size_t g_request_len = 0;
+
+// Counters since start and since the last sample
+static uint64_t g_connects_total = 0, g_connects_interval = 0;
+static uint64_t g_connect_errors = 0;
+static uint64_t g_requests_total = 0, g_requests_interval = 0;
+static uint64_t g_request_errors = 0;
+static uint64_t g_idle_closed_total = 0, g_idle_closed_interval = 0;
+static uint64_t g_churned = 0;      // Reconnects during the soak phase
+static hdr_histogram_t g_latency;
+static hdr_histogram_t g_latency_interval;
+
+static soak_sample_t g_samples[MAX_SAMPLES];
+static int g_sample_count = 0;
+static uint64_t g_baseline_fds = 0;
+
+// Monotonic clock in nanoseconds
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void handle_signal(int sig) {
+    (void)sig;
+    g_stop = 1;
+}
+
+static void show_help(const char *program_name) {
+    printf("Usage: %s [options] -P <master_pid> <host:port>\n", program_name);
+    printf("\n");
+    printf("Options:\n");
+    printf("  -c <n>          Idle connections to hold (default: 10000)\n");
+    printf("  -r <rate>       Connection ramp rate in connects/s (default: 5000)\n");
+    printf("  -a <rate>       Trickle of active requests in req/s over the idle connections (default: 20)\n");
+    printf("  -d <sec>        Soak duration once all connections are open (default: 60)\n");
+    printf("  -i <sec>        Sampling interval (default: 5)\n");
+    printf("  -S <n>          Source addresses 127.0.0.1..n for loopback targets\n");
+    printf("                  (default: one per %d connections)\n", CONNS_PER_SOURCE);
+    printf("  -P <pid>        Master PID of the server, its children are sampled as Workers\n");
+    printf("  -A <path>       Admin socket of the server, for event loop lag\n");
+    printf("  -u <path>       Path of the trickle requests (default: /)\n");
+    printf("  -j <file>       Write JSON results to file (\"-\" for stdout)\n");
+    printf("  -m <key=value>  Label stored in the JSON metadata, repeatable\n");
+    printf("  -q              Only print the summary\n");
+    printf("  -h              Show help information\n");
+    printf("\n");
+    printf("Examples:\n");
+    printf("  %s -c 50000 -d 600 -P $(cat logs/x-server.pid) -A logs/x-server.admin.sock 127.0.0.1:9001\n",
+           program_name);
+}
+
+/* ---- Server sampling ---- */
+
+// VmRSS of a process in KB, 0 if it is gone
+static uint64_t process_rss_kb(pid_t pid) {
+    char path[64], line[256];
+    uint64_t rss = 0;
+
+    snprintf(path, sizeof(path), "/proc/%d/status", (int)pid);
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return 0;
+    }
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (strncmp(line, "VmRSS:", 6) == 0) {
+            rss = strtoull(line + 6, NULL, 10);
+            break;
+        }
+    }
+    fclose(f);
+    return rss;
+}
+
+static uint64_t process_fd_count(pid_t pid) {
+    char path[64];
+    uint64_t count = 0;
+
+    snprintf(path, sizeof(path), "/proc/%d/fd", (int)pid);
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        return 0;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] != '.') {
+            count++;
+        }
+    }
+    closedir(dir);
+    return count;
+}
+
+// Children of the master process
+static int find_workers(pid_t master, pid_t *workers, int max) {
+    int count = 0;
+    DIR *dir = opendir("/proc");
+    if (dir == NULL) {
+        return 0;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL && count < max) {
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9') {
+            continue;
+        }
+
+        char path[300], buf[512];
+        snprintf(path, sizeof(path), "/proc/%s/stat", entry->d_name);
+        FILE *f = fopen(path, "r");
+        if (f == NULL) {
+            continue;
+        }
+        size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+        fclose(f);
+        buf[n] = '\0';
+
+        // Fields after the parenthesized command name: state ppid ...
+        char *p = strrchr(buf, ')');
+        int ppid = 0;
+        if (p != NULL && sscanf(p + 1, " %*c %d", &ppid) == 1 && ppid == master) {
+            workers[count++] = (pid_t)atoi(entry->d_name);
+        }
+    }
+    closedir(dir);
+    return count;
+}
+
+static long tcp_mem_pages(void) {
+    char line[256];
+    long pages = -1;
+
+    FILE *f = fopen("/proc/net/sockstat", "r");
+    if (f == NULL) {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char *mem = strncmp(line, "TCP:", 4) == 0 ? strstr(line, " mem ") : NULL;
+        if (mem != NULL) {
+            pages = strtol(mem + 5, NULL, 10);
+            break;
+        }
+    }
+    fclose(f);
+    return pages;
+}
+
+// Ask the admin socket for "workers" and take the largest loop lag
+static void admin_loop_lag(server_sample_t *s) {
+    s->loop_lag_ms = -1;
+    s->loop_lag_peak_ms = -1;
+    if (g_opts.admin_socket == NULL) {
+        return;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", g_opts.admin_socket);
+    struct timeval tv = {2, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    char buf[16384];
+    size_t len = 0;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0 && write(fd, "workers\n", 8) == 8) {
+        ssize_t n;
+        while (len < sizeof(buf) - 1 && (n = read(fd, buf + len, sizeof(buf) - 1 - len)) > 0) {
+            len += (size_t)n;
+        }
+    }
+    close(fd);
+    buf[len] = '\0';
+
+    for (char *line = strtok(buf, "\n"); line != NULL; line = strtok(NULL, "\n")) {
+        char *lag = strstr(line, "loop_lag_ms=");
+        char *peak = strstr(line, "loop_lag_peak_ms=");
+        if (lag != NULL) {
+            double v = atof(lag + 12);
+            s->loop_lag_ms = v > s->loop_lag_ms ? v : s->loop_lag_ms;
+        }
+        if (peak != NULL) {
+            double v = atof(peak + 17);
+            s->loop_lag_peak_ms = v > s->loop_lag_peak_ms ? v : s->loop_lag_peak_ms;
+        }
+    }
+}
+
+static void sample_server(server_sample_t *s) {
+    pid_t workers[MAX_WORKERS];
+
+    memset(s, 0, sizeof(*s));
+    s->master_rss_kb = process_rss_kb(g_opts.master_pid);
+    s->workers = find_workers(g_opts.master_pid, workers, MAX_WORKERS);
+    for (int i = 0; i < s->workers; i++) {
+        s->worker_rss_kb += process_rss_kb(workers[i]);
+        s->worker_fds += process_fd_count(workers[i]);
+    }
+    s->tcp_mem_pages = tcp_mem_pages();
+    admin_loop_lag(s);
+}
+
+/* ---- Client connections ---- */
+
+static void slot_close(soak_conn_t *c) {
+    if (c->fd >= 0) {
+        close(c->fd);
+        c->fd = -1;
+    }
+    if (c->state == SLOT_CONNECTING) {
+        g_pending_connects--;
+    } else if (c->state == SLOT_IDLE || c->state == SLOT_ACTIVE) {
+        g_established--;
+    }
+    c->state = SLOT_EMPTY;
+}
+
+static int slot_connect(soak_conn_t *c, int slot) {
+    c->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (c->fd < 0) {
+        return -1;
+    }
+
+    // Spread loopback connections over several source addresses, each has its own port range
+    if (g_opts.sources > 1) {
+        int one = 1;
+        setsockopt(c->fd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &one, sizeof(one));
+        struct sockaddr_in src;
+        memset(&src, 0, sizeof(src));
+        src.sin_family = AF_INET;
+        src.sin_addr.s_addr = htonl(0x7f000001u + (uint32_t)(slot % g_opts.sources));
+        if (bind(c->fd, (struct sockaddr *)&src, sizeof(src)) < 0) {
+            close(c->fd);
+            c->fd = -1;
+            return -1;
+        }
+    }
+
+    if (connect(c->fd, (struct sockaddr *)&g_addr, sizeof(g_addr)) < 0 && errno != EINPROGRESS) {
+        close(c->fd);
+        c->fd = -1;
+        return -1;
+    }
+
+    struct epoll_event ev;
+    ev.events = EPOLLOUT | EPOLLRDHUP;
+    ev.data.u32 = (uint32_t)slot;
+    if (epoll_ctl(g_epfd, EPOLL_CTL_ADD, c->fd, &ev) < 0) {
+        close(c->fd);
+        c->fd = -1;
+        return -1;
+    }
+
+    c->state = SLOT_CONNECTING;
+    g_pending_connects++;
+    return 0;
+}
+
+// Open connections into empty slots, at most budget of them
+static int open_connections(int budget) {
+    int opened = 0;
+
+    for (int scanned = 0; scanned < g_opts.connections && opened < budget &&
+                          g_pending_connects < MAX_PENDING_CONNECTS; scanned++) {
+        int slot = g_next_slot;
+        g_next_slot = (g_next_slot + 1) % g_opts.connections;
+        if (g_conns[slot].state != SLOT_EMPTY) {
+            continue;
+        }
+        if (slot_connect(&g_conns[slot], slot) < 0) {
+            g_connect_errors++;
+            break;
+        }
+        opened++;
+    }
+    return opened;
+}
+
+// Send one trickle request over a random idle connection
+static void send_request(uint64_t now) {
+    for (int attempt = 0; attempt < 16; attempt++) {
+        int slot = (int)((unsigned int)rand_r(&g_seed) % (unsigned int)g_opts.connections);
+        soak_conn_t *c = &g_conns[slot];
+        if (c->state != SLOT_IDLE) {
+            continue;
+        }
+
+        ssize_t n = send(c->fd, g_request, g_request_len, MSG_NOSIGNAL);
+        if (n != (ssize_t)g_request_len) {
+            g_request_errors++;
+            slot_close(c);
+            return;
+        }
+        c->state = SLOT_ACTIVE;
+        c->sent_ns = now;
+        c->head_len = 0;
+        c->body_remaining = -1;
+        return;
+    }
+}
+
+// Body length once the response headers are complete, -2 if still incomplete
+static long response_body_length(soak_conn_t *c, size_t *header_len) {
+    char *end = memmem(c->head, c->head_len, "\r\n\r\n", 4);
+    if (end == NULL) {
+        return -2;
+    }
+    *header_len = (size_t)(end - c->head) + 4;
+
+    c->head[c->head_len < sizeof(c->head) ? c->head_len : sizeof(c->head) - 1] = '\0';
+    char *cl = strcasestr(c->head, "\r\nContent-Length:");
+    return cl != NULL && cl < end ? strtol(cl + 17, NULL, 10) : -1;
+}
+
+static void conn_readable(soak_conn_t *c, int phase, uint64_t now) {
+    char buf[16384];
+    int closed = 0;
+
+    for (;;) {
+        ssize_t n = recv(c->fd, buf, sizeof(buf), 0);
+        if (n > 0) {
+            if (c->state != SLOT_ACTIVE) {
+                continue;   // Unsolicited data, ignore
+            }
+            if (c->body_remaining < 0) {
+                size_t take = sizeof(c->head) - 1 - c->head_len;
+                take = take < (size_t)n ? take : (size_t)n;
+                memcpy(c->head + c->head_len, buf, take);
+                c->head_len += take;
+
+                size_t header_len = 0;
+                long length = response_body_length(c, &header_len);
+                if (length >= 0) {
+                    c->body_remaining = length - (long)(c->head_len - header_len) - (long)((size_t)n - take);
+                }
+            } else {
+                c->body_remaining -= n;
+            }
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        closed = 1;
+        break;
+    }
+
+    if (c->state == SLOT_ACTIVE && (c->body_remaining == 0 || (closed && c->head_len > 0))) {
+        uint64_t us = (now - c->sent_ns) / 1000;
+        hdr_record(&g_latency, us);
+        hdr_record(&g_latency_interval, us);
+        g_requests_total++;
+        g_requests_interval++;
+        c->state = SLOT_IDLE;
+    } else if (c->state == SLOT_ACTIVE && closed) {
+        g_request_errors++;
+    } else if (c->state == SLOT_IDLE && closed) {
+        g_idle_closed_total++;
+        g_idle_closed_interval++;
+    }
+
+    if (closed) {
+        // The slot is reopened by the refill so the connection count stays at target
+        if (phase == PHASE_SOAK) {
+            g_churned++;
+        }
+        slot_close(c);
+    }
+}
+
+static void conn_event(int slot, uint32_t events, int phase, uint64_t now) {
+    soak_conn_t *c = &g_conns[slot];
+
+    if (c->state == SLOT_CONNECTING) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+        if (err != 0 || (events & (EPOLLERR | EPOLLHUP))) {
+            g_connect_errors++;
+            slot_close(c);
+            return;
+        }
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.u32 = (uint32_t)slot;
+        epoll_ctl(g_epfd, EPOLL_CTL_MOD, c->fd, &ev);
+        c->state = SLOT_IDLE;
+        g_pending_connects--;
+        g_established++;
+        g_connects_total++;
+        g_connects_interval++;
+        return;
+    }
+
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+        conn_readable(c, phase, now);
+    }
+}
+
+/* ---- Driver ---- */
+
+static void take_sample(double t, int phase, double interval_sec) {
+    if (g_sample_count >= MAX_SAMPLES) {
+        return;
+    }
+
+    soak_sample_t *s = &g_samples[g_sample_count++];
+    s->t = t;
+    s->phase = phase;
+    s->established = g_established;
+    s->connects = g_connects_interval;
+    s->connect_rate = interval_sec > 0 ? (double)g_connects_interval / interval_sec : 0;
+    s->requests = g_requests_interval;
+    s->p99_us = hdr_value_at_percentile(&g_latency_interval, 99.0);
+    s->idle_closed = g_idle_closed_interval;
+    sample_server(&s->server);
+    s->accepted = (int64_t)s->server.worker_fds - (int64_t)g_baseline_fds;
+    if (g_sample_count > 1 && interval_sec > 0) {
+        s->accept_rate = (double)(s->accepted - g_samples[g_sample_count - 2].accepted) / interval_sec;
+        s->accept_rate = s->accept_rate > 0 ? s->accept_rate : 0;
+    }
+
+    g_connects_interval = 0;
+    g_requests_interval = 0;
+    g_idle_closed_interval = 0;
+    hdr_init(&g_latency_interval);
+
+    if (!g_opts.quiet) {
+        printf("%8.1f %-8s %9d %10.0f %9ld %9.0f %8lu %9lu %8lu %7d %10.1f %10.1f ", s->t, g_phase_names[phase],
+               s->established, s->connect_rate, (long)s->accepted, s->accept_rate, s->requests, s->p99_us,
+               s->idle_closed, s->server.workers, (double)s->server.worker_rss_kb / 1024.0,
+               (double)s->server.master_rss_kb / 1024.0);
+        if (s->server.loop_lag_ms >= 0) {
+            printf("%9.3f %9.3f\n", s->server.loop_lag_ms, s->server.loop_lag_peak_ms);
+        } else {
+            printf("%9s %9s\n", "-", "-");
+        }
+        fflush(stdout);
+    }
+}
+
+// Run the event loop until the deadline, the target count (ramp, if stop_at_target) or a stop signal
+static void run_phase(int phase, uint64_t start, uint64_t deadline, uint64_t *last_sample, int stop_at_target) {
+    struct epoll_event events[MAX_EVENTS];
+    uint64_t phase_start = now_ns();
+    uint64_t opened = 0;
+    uint64_t sent = 0;
+    uint64_t interval_ns = (uint64_t)g_opts.interval * 1000000000ULL;
+
+    while (!g_stop) {
+        uint64_t now = now_ns();
+        if (now >= deadline || (stop_at_target && g_established >= g_opts.connections)) {
+            break;
+        }
+
+        // Ramp at the configured rate; afterwards refill slots the server closed
+        if (phase == PHASE_RAMP) {
+            uint64_t due = (uint64_t)((double)(now - phase_start) / 1e9 * g_opts.ramp_rate) + 1;
+            if (due > opened) {
+                opened += (uint64_t)open_connections((int)(due - opened));
+            }
+        } else if (phase == PHASE_SOAK && g_established + g_pending_connects < g_opts.connections) {
+            open_connections(g_opts.connections);
+        }
+
+        if (phase == PHASE_SOAK && g_opts.request_rate > 0) {
+            uint64_t due = (uint64_t)((double)(now - phase_start) / 1e9 * g_opts.request_rate);
+            while (sent < due) {
+                send_request(now);
+                sent++;
+            }
+        }
+
+        int n = epoll_wait(g_epfd, events, MAX_EVENTS, 5);
+        now = now_ns();
+        for (int i = 0; i < n; i++) {
+            conn_event((int)events[i].data.u32, events[i].events, phase, now);
+        }
+
+        if (now - *last_sample >= interval_ns) {
+            take_sample((double)(now - start) / 1e9, phase, (double)(now - *last_sample) / 1e9);
+            *last_sample = now;
+        }
+    }
+}
+
+// Least squares slope of Worker RSS over time within a phase, KB per minute
+static double rss_slope_kb_per_min(int phase) {
+    double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (int i = 0; i < g_sample_count; i++) {
+        if (g_samples[i].phase != phase) {
+            continue;
+        }
+        double x = g_samples[i].t / 60.0, y = (double)g_samples[i].server.worker_rss_kb;
+        n++;
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    double d = n * sxx - sx * sx;
+    return n >= 3 && d != 0 ? (n * sxy - sx * sy) / d : 0;
+}
+
+static int resolve_target(const char *target) {
+    const char *p = strncmp(target, "http://", 7) == 0 ? target + 7 : target;
+    const char *colon = strrchr(p, ':');
+    size_t host_len = colon ? (size_t)(colon - p) : strlen(p);
+    if (host_len == 0 || host_len >= sizeof(g_opts.host) || (colon && strlen(colon + 1) >= sizeof(g_opts.port))) {
+        fprintf(stderr, "Invalid target: %s\n", target);
+        return -1;
+    }
+    memcpy(g_opts.host, p, host_len);
+    g_opts.host[host_len] = '\0';
+    strcpy(g_opts.port, colon ? colon + 1 : "80");
+
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    int rc = getaddrinfo(g_opts.host, g_opts.port, &hints, &res);
+    if (rc != 0) {
+        fprintf(stderr, "Unable to resolve %s:%s: %s\n", g_opts.host, g_opts.port, gai_strerror(rc));
+        return -1;
+    }
+    memcpy(&g_addr, res->ai_addr, sizeof(g_addr));
+    freeaddrinfo(res);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int opt;
+
+    memset(&g_opts, 0, sizeof(g_opts));
+    g_opts.connections = 10000;
+    g_opts.ramp_rate = 5000;
+    g_opts.request_rate = 20;
+    g_opts.duration = 60;
+    g_opts.interval = 5;
+    g_opts.path = "/";
+
+    while ((opt = getopt(argc, argv, "c:r:a:d:i:S:P:A:u:j:m:qh")) != -1) {
+        switch (opt) {
+            case 'c': g_opts.connections = atoi(optarg); break;
+            case 'r': g_opts.ramp_rate = atof(optarg); break;
+            case 'a': g_opts.request_rate = atof(optarg); break;
+            case 'd': g_opts.duration = atoi(optarg); break;
+            case 'i': g_opts.interval = atoi(optarg); break;
+            case 'S': g_opts.sources = atoi(optarg); break;
+            case 'P': g_opts.master_pid = (pid_t)atoi(optarg); break;
+            case 'A': g_opts.admin_socket = optarg; break;
+            case 'u': g_opts.path = optarg; break;
+            case 'j': g_opts.json_path = optarg; break;
+            case 'm':
+                if (bench_meta_add_label(optarg) < 0) {
+                    fprintf(stderr, "Invalid label: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'q': g_opts.quiet = 1; break;
+            case 'h':
+                show_help(argv[0]);
+                return 0;
+            default:
+                show_help(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind != argc - 1 || g_opts.master_pid <= 0) {
+        show_help(argv[0]);
+        return 1;
+    }
+    if (g_opts.connections <= 0 || g_opts.ramp_rate <= 0 || g_opts.request_rate < 0 ||
+        g_opts.duration < 0 || g_opts.interval <= 0 || g_opts.sources < 0 || g_opts.sources > 254) {
+        fprintf(stderr, "Invalid option value\n");
+        return 1;
+    }
+    if (kill(g_opts.master_pid, 0) != 0) {
+        fprintf(stderr, "No server process with PID %d\n", (int)g_opts.master_pid);
+        return 1;
+    }
+    if (resolve_target(argv[optind]) < 0) {
+        return 1;
+    }
+
+    int loopback = (ntohl(g_addr.sin_addr.s_addr) >> 24) == 127;
+    if (g_opts.sources == 0) {
+        g_opts.sources = loopback ? (g_opts.connections + CONNS_PER_SOURCE - 1) / CONNS_PER_SOURCE : 1;
+    }
+    if (!loopback) {
+        g_opts.sources = 1;
+    }
+
+    // Every connection needs a descriptor on this side
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+        rlim_t want = (rlim_t)g_opts.connections + 64;
+        if (rl.rlim_cur < want) {
+            rl.rlim_cur = want < rl.rlim_max ? want : rl.rlim_max;
+            setrlimit(RLIMIT_NOFILE, &rl);
+        }
+        if (rl.rlim_cur < want) {
+            fprintf(stderr, "Warning: descriptor limit %lu is below %d connections, raise ulimit -n\n",
+                    (unsigned long)rl.rlim_cur, g_opts.connections);
+        }
+    }
+
+    g_request_len = (size_t)snprintf(g_request, sizeof(g_request),
+                                     "GET %s HTTP/1.1\r\nHost: %s:%s\r\nUser-Agent: x-soak\r\n"
+                                     "Connection: keep-alive\r\n\r\n", g_opts.path, g_opts.host, g_opts.port);
+
+    g_conns = calloc((size_t)g_opts.connections, sizeof(soak_conn_t));
+    g_epfd = epoll_create1(0);
+    if (g_conns == NULL || g_epfd < 0) {
+        perror("setup");
+        return 1;
+    }
+    for (int i = 0; i < g_opts.connections; i++) {
+        g_conns[i].fd = -1;
+    }
+    hdr_init(&g_latency);
+    hdr_init(&g_latency_interval);
+    g_seed = (unsigned int)now_ns();
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+
+    if (!g_opts.quiet) {
+        printf("x-soak %s:%s - %d connections from %d source address(es), ramp %.0f/s, trickle %.1f req/s, soak %ds\n\n",
+               g_opts.host, g_opts.port, g_opts.connections, g_opts.sources, g_opts.ramp_rate,
+               g_opts.request_rate, g_opts.duration);
+        printf("%8s %-8s %9s %10s %9s %9s %8s %9s %8s %7s %10s %10s %9s %9s\n", "time(s)", "phase", "conns",
+               "connect/s", "accepted", "accept/s", "reqs", "p99(us)", "idle_cls", "workers", "wrk_rss_MB",
+               "mst_rss_MB", "lag_ms", "lag_peak");
+    }
+
+    uint64_t start = now_ns();
+    uint64_t last_sample = start;
+    server_sample_t probe;
+    sample_server(&probe);
+    g_baseline_fds = probe.worker_fds;
+    take_sample(0, PHASE_BASELINE, 0);
+    const soak_sample_t baseline = g_samples[0];
+
+    // Ramp, bounded so that an unreachable target still ends
+    uint64_t ramp_limit = (uint64_t)((double)g_opts.connections / g_opts.ramp_rate * 4 + 30) * 1000000000ULL;
+    uint64_t ramp_start = now_ns();
+    run_phase(PHASE_RAMP, start, ramp_start + ramp_limit, &last_sample, 1);
+    double connect_sec = (double)(now_ns() - ramp_start) / 1e9;
+    int ramp_established = g_established;
+
+    // The kernel completes handshakes ahead of the Workers, wait until the accept queues drain
+    server_sample_t server;
+    int64_t accepted = 0, previous = -1;
+    int stalled = 0;
+    while (!g_stop && stalled < 5) {
+        sample_server(&server);
+        accepted = (int64_t)server.worker_fds - (int64_t)g_baseline_fds;
+        if (accepted >= g_established) {
+            break;
+        }
+        stalled = accepted > previous ? 0 : stalled + 1;
+        previous = accepted;
+        run_phase(PHASE_RAMP, start, now_ns() + 1000000000ULL, &last_sample, 0);
+    }
+    double ramp_sec = (double)(now_ns() - ramp_start) / 1e9;
+    take_sample((double)(now_ns() - start) / 1e9, PHASE_RAMP, (double)(now_ns() - last_sample) / 1e9);
+    last_sample = now_ns();
+    const soak_sample_t plateau = g_samples[g_sample_count - 1];
+
+    g_churned = 0;
+    run_phase(PHASE_SOAK, start, now_ns() + (uint64_t)g_opts.duration * 1000000000ULL, &last_sample, 0);
+    take_sample((double)(now_ns() - start) / 1e9, PHASE_SOAK, (double)(now_ns() - last_sample) / 1e9);
+    const soak_sample_t soak_end = g_samples[g_sample_count - 1];
+
+    // Close everything and give the Workers time to release connections
+    for (int i = 0; i < g_opts.connections; i++) {
+        slot_close(&g_conns[i]);
+    }
+    sleep(2);
+    take_sample((double)(now_ns() - start) / 1e9, PHASE_CLOSED, (double)(now_ns() - last_sample) / 1e9);
+    const soak_sample_t closed = g_samples[g_sample_count - 1];
+
+    // Summary
+    int64_t conn_rss_kb = (int64_t)plateau.server.worker_rss_kb - (int64_t)baseline.server.worker_rss_kb;
+    double bytes_per_conn = plateau.established > 0 ? (double)conn_rss_kb * 1024.0 / plateau.established : 0;
+    double tcp_bytes_per_conn = plateau.established > 0 && baseline.server.tcp_mem_pages >= 0 ?
+        (double)(plateau.server.tcp_mem_pages - baseline.server.tcp_mem_pages) * (double)sysconf(_SC_PAGESIZE) /
+        plateau.established : 0;
+    int64_t soak_growth_kb = (int64_t)soak_end.server.worker_rss_kb - (int64_t)plateau.server.worker_rss_kb;
+    int64_t retained_kb = (int64_t)closed.server.worker_rss_kb - (int64_t)baseline.server.worker_rss_kb;
+    double slope = rss_slope_kb_per_min(PHASE_SOAK);
+    double peak_rate = 0, peak_lag = -1;
+    for (int i = 0; i < g_sample_count; i++) {
+        peak_rate = g_samples[i].accept_rate > peak_rate ? g_samples[i].accept_rate : peak_rate;
+        peak_lag = g_samples[i].server.loop_lag_peak_ms > peak_lag ? g_samples[i].server.loop_lag_peak_ms : peak_lag;
+    }
+
+    // Growth while the connection count is flat is the leak signal; churn makes it per-connection
+    int leak_suspect = soak_growth_kb > 1024 && (double)soak_growth_kb > 0.05 * (double)(conn_rss_kb > 0 ? conn_rss_kb : 1);
+
+    printf("\nSummary\n");
+    printf("  Connections:        %d/%d connected in %.1fs, %d %s in %.1fs (avg %.0f/s, peak %.0f/s), "
+           "%lu connect errors\n", ramp_established, g_opts.connections, connect_sec, plateau.established,
+           plateau.accepted >= plateau.established ? "accepted" : "established, not all accepted", ramp_sec,
+           ramp_sec > 0 ? (double)plateau.accepted / ramp_sec : 0.0, peak_rate, g_connect_errors);
+    printf("  Worker RSS:         baseline %.1f MB, plateau %.1f MB, soak end %.1f MB, after close %.1f MB\n",
+           baseline.server.worker_rss_kb / 1024.0, plateau.server.worker_rss_kb / 1024.0,
+           soak_end.server.worker_rss_kb / 1024.0, closed.server.worker_rss_kb / 1024.0);
+    printf("  Memory/connection:  %.0f bytes Worker RSS, %.0f bytes kernel TCP (both endpoints)\n",
+           bytes_per_conn, tcp_bytes_per_conn);
+    printf("  Soak:               %+ld KB RSS over %ds (slope %+.1f KB/min), %lu connections churned, "
+           "%lu idle closed by server\n", (long)soak_growth_kb, g_opts.duration, slope, g_churned, g_idle_closed_total);
+    if (g_churned > 0) {
+        printf("                      %+.1f bytes RSS per churned connection\n",
+               (double)soak_growth_kb * 1024.0 / (double)g_churned);
+    }
+    printf("  Retained:           %+ld KB Worker RSS after closing all connections\n", (long)retained_kb);
+    printf("  Requests:           %lu ok, %lu closed or failed without response, p50 %lu us, p99 %lu us, max %lu us\n",
+           g_requests_total, g_request_errors, hdr_value_at_percentile(&g_latency, 50.0),
+           hdr_value_at_percentile(&g_latency, 99.0), g_latency.max);
+    if (peak_lag >= 0) {
+        printf("  Event loop lag:     peak %.3f ms\n", peak_lag);
+    }
+    printf("  Verdict:            %s\n", leak_suspect ? "POSSIBLE LEAK (RSS grew while the connection count was flat)" :
+           "no RSS growth beyond noise");
+
+    if (g_opts.json_path != NULL) {
+        FILE *out = strcmp(g_opts.json_path, "-") == 0 ? stdout : fopen(g_opts.json_path, "w");
+        if (out == NULL) {
+            perror(g_opts.json_path);
+            return 1;
+        }
+        fprintf(out, "{\n");
+        fprintf(out, "  \"tool\": \"x-soak\",\n");
+        fprintf(out, "  \"meta\": ");
+        bench_meta_print_json(out, "  ");
+        fprintf(out, ",\n");
+        fprintf(out, "  \"config\": {\"target\": ");
+        bench_json_string(out, g_opts.host);
+        fprintf(out, ", \"port\": %s, \"connections\": %d, \"ramp_rate\": %.0f, \"request_rate\": %.2f, "
+                "\"duration_sec\": %d, \"sources\": %d},\n", g_opts.port, g_opts.connections, g_opts.ramp_rate,
+                g_opts.request_rate, g_opts.duration, g_opts.sources);
+        fprintf(out, "  \"summary\": {\n");
+        fprintf(out, "    \"established\": %d,\n", ramp_established);
+        fprintf(out, "    \"accepted\": %ld,\n", (long)plateau.accepted);
+        fprintf(out, "    \"connect_sec\": %.3f,\n", connect_sec);
+        fprintf(out, "    \"ramp_sec\": %.3f,\n", ramp_sec);
+        fprintf(out, "    \"accept_rate_avg\": %.1f,\n", ramp_sec > 0 ? (double)plateau.accepted / ramp_sec : 0.0);
+        fprintf(out, "    \"accept_rate_peak\": %.1f,\n", peak_rate);
+        fprintf(out, "    \"connect_errors\": %lu,\n", g_connect_errors);
+        fprintf(out, "    \"worker_rss_baseline_kb\": %lu,\n", baseline.server.worker_rss_kb);
+        fprintf(out, "    \"worker_rss_plateau_kb\": %lu,\n", plateau.server.worker_rss_kb);
+        fprintf(out, "    \"worker_rss_soak_end_kb\": %lu,\n", soak_end.server.worker_rss_kb);
+        fprintf(out, "    \"worker_rss_closed_kb\": %lu,\n", closed.server.worker_rss_kb);
+        fprintf(out, "    \"bytes_per_connection\": %.1f,\n", bytes_per_conn);
+        fprintf(out, "    \"kernel_tcp_bytes_per_connection\": %.1f,\n", tcp_bytes_per_conn);
+        fprintf(out, "    \"soak_rss_growth_kb\": %ld,\n", (long)soak_growth_kb);
+        fprintf(out, "    \"soak_rss_slope_kb_per_min\": %.2f,\n", slope);
+        fprintf(out, "    \"churned_connections\": %lu,\n", g_churned);
+        fprintf(out, "    \"idle_closed_by_server\": %lu,\n", g_idle_closed_total);
+        fprintf(out, "    \"retained_after_close_kb\": %ld,\n", (long)retained_kb);
+        fprintf(out, "    \"loop_lag_peak_ms\": %.3f,\n", peak_lag);
+        fprintf(out, "    \"request_errors\": %lu,\n", g_request_errors);
+        fprintf(out, "    \"leak_suspect\": %s\n", leak_suspect ? "true" : "false");
+        fprintf(out, "  },\n");
+        fprintf(out, "  \"latency_us\": ");
+        hdr_print_json(&g_latency, out, "  ");
+        fprintf(out, ",\n  \"timeline\": [");
+        for (int i = 0; i < g_sample_count; i++) {
+            const soak_sample_t *s = &g_samples[i];
+            fprintf(out, "%s\n    {\"t\": %.1f, \"phase\": \"%s\", \"connections\": %d, \"connect_rate\": %.1f, "
+                    "\"accepted\": %ld, \"accept_rate\": %.1f, \"requests\": %lu, \"p99_us\": %lu, \"idle_closed\": %lu, \"workers\": %d, "
+                    "\"worker_rss_kb\": %lu, \"master_rss_kb\": %lu, \"worker_fds\": %lu, "
+                    "\"loop_lag_ms\": %.3f, \"tcp_mem_pages\": %ld}",
+                    i ? "," : "", s->t, g_phase_names[s->phase], s->established, s->connect_rate,
+                    (long)s->accepted, s->accept_rate, s->requests,
+                    s->p99_us, s->idle_closed, s->server.workers, s->server.worker_rss_kb,
+                    s->server.master_rss_kb, s->server.worker_fds, s->server.loop_lag_ms, s->server.tcp_mem_pages);
+        }
+        fprintf(out, "\n  ]\n}\n");
+        if (out != stdout) {
+            fclose(out);
+        }
+    }
+
+    close(g_epfd);
+    free(g_conns);
+    return ramp_established < g_opts.connections ? 2 : 0;
+}